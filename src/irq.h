@@ -2,5 +2,11 @@
 #define IRQ_H
 
 void g_irq_vbl(void);  // <-- src/irq.s
+void g_irq_bench_timer_d(void);  // <-- src/irq.s
+void g_irq_sched_timer_d(void);  // <-- src/irq.s
+void g_irq_input_raster(void);  // <-- src/irq.s
+void g_irq_link_rx(void);  // <-- src/irq.s
+void g_irq_link_tx(void);  // <-- src/irq.s
+void g_irq_link_special(void);  // <-- src/irq.s
 
 #endif  // IRQ_H
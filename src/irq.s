@@ -1,4 +1,10 @@
 	.extern	g_xt_vbl_pending
+	.extern	g_x68k_bench_ovf
+	.extern	g_x68k_sched_ovf
+	.extern	x68k_input_sample
+	.extern	x68k_link_rx_isr
+	.extern	x68k_link_tx_isr
+	.extern	x68k_link_special_isr
 
 	align 2
 .global	g_irq_vbl
@@ -6,3 +12,53 @@
 g_irq_vbl:
 	clr.w	g_xt_vbl_pending
 	rte
+
+	align 2
+.global	g_irq_bench_timer_d
+
+g_irq_bench_timer_d:
+	addq.l	#1, g_x68k_bench_ovf
+	rte
+
+	align 2
+.global	g_irq_sched_timer_d
+
+g_irq_sched_timer_d:
+	addq.l	#1, g_x68k_sched_ovf
+	rte
+
+	align 2
+.global	g_irq_input_raster
+
+g_irq_input_raster:
+	movem.l	d0-d1/a0-a1, -(sp)
+	jsr	x68k_input_sample
+	movem.l	(sp)+, d0-d1/a0-a1
+	rte
+
+	align 2
+.global	g_irq_link_rx
+
+g_irq_link_rx:
+	movem.l	d0-d1/a0-a1, -(sp)
+	jsr	x68k_link_rx_isr
+	movem.l	(sp)+, d0-d1/a0-a1
+	rte
+
+	align 2
+.global	g_irq_link_tx
+
+g_irq_link_tx:
+	movem.l	d0-d1/a0-a1, -(sp)
+	jsr	x68k_link_tx_isr
+	movem.l	(sp)+, d0-d1/a0-a1
+	rte
+
+	align 2
+.global	g_irq_link_special
+
+g_irq_link_special:
+	movem.l	d0-d1/a0-a1, -(sp)
+	jsr	x68k_link_special_isr
+	movem.l	(sp)+, d0-d1/a0-a1
+	rte
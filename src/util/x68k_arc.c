@@ -0,0 +1,156 @@
+#include "util/x68k_arc.h"
+#include "util/x68k_lz.h"
+#include <dos.h>
+
+#define ARC_HEADER_SIZE 16
+#define ARC_MAGIC 0x58415243  // 'XARC'
+#define ARC_VERSION 1
+
+uint32_t x68k_arc_hash(const char *name)
+{
+	uint32_t h = 0x811C9DC5;
+	while (*name)
+	{
+		uint8_t c = *name++;
+		if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+		h ^= c;
+		h *= 0x01000193;
+	}
+	return h;
+}
+
+static int arc_read_at(X68kArc *a, uint32_t offset, void *dst, uint32_t len)
+{
+	if (a->file_pos != offset)
+	{
+		const int ret = _dos_seek(a->fd, offset, 0);
+		if (ret < 0) return ret;
+		a->file_pos = offset;
+	}
+	const int ret = _dos_read(a->fd, (char *)dst, len);
+	if (ret < 0) return ret;
+	a->file_pos += ret;
+	return ((uint32_t)ret == len) ? 0 : -1;
+}
+
+int x68k_arc_open(X68kArc *a, const char *path, X68kArcEntry *index,
+                  uint16_t max_entries, uint8_t *staging,
+                  uint32_t staging_size)
+{
+	uint32_t header[ARC_HEADER_SIZE / 4];
+
+	a->fd = _dos_open(path, 0);
+	if (a->fd < 0) return a->fd;
+	a->file_pos = 0;
+	a->index = index;
+	a->num_entries = 0;
+	a->staging = staging;
+	a->staging_size = staging_size;
+
+	int ret = arc_read_at(a, 0, header, sizeof(header));
+	const uint16_t version = header[1] >> 16;
+	const uint16_t num_entries = header[1] & 0xFFFF;
+	if (!ret && (header[0] != ARC_MAGIC || version != ARC_VERSION ||
+	             num_entries > max_entries))
+	{
+		ret = -1;
+	}
+	if (!ret)
+	{
+		ret = arc_read_at(a, ARC_HEADER_SIZE, index,
+		                  num_entries * sizeof(X68kArcEntry));
+	}
+	if (ret)
+	{
+		x68k_arc_close(a);
+		return ret;
+	}
+	a->num_entries = num_entries;
+	return 0;
+}
+
+void x68k_arc_close(X68kArc *a)
+{
+	if (a->fd >= 0) _dos_close(a->fd);
+	a->fd = -1;
+}
+
+const X68kArcEntry *x68k_arc_find_hash(const X68kArc *a, uint32_t hash)
+{
+	int32_t lo = 0;
+	int32_t hi = (int32_t)a->num_entries - 1;
+	while (lo <= hi)
+	{
+		const int32_t mid = (lo + hi) >> 1;
+		const uint32_t h = a->index[mid].hash;
+		if (h == hash) return &a->index[mid];
+		if (h < hash) lo = mid + 1;
+		else hi = mid - 1;
+	}
+	return 0;
+}
+
+int x68k_arc_load(X68kArc *a, const X68kArcEntry *e, void *dst)
+{
+	if (!e) return -1;
+	if (!(e->flags & X68K_ARC_FLAG_LZ))
+	{
+		return arc_read_at(a, e->offset, dst, e->size);
+	}
+	if (e->size > a->staging_size) return -1;
+	// One read covering the whole entry, then the fastest decoder.
+	const int ret = arc_read_at(a, e->offset, a->staging, e->size);
+	if (ret) return ret;
+	x68k_lz_decode(a->staging, dst);
+	return 0;
+}
+
+int x68k_arc_load_begin(X68kArc *a, X68kArcLoad *l, const X68kArcEntry *e,
+                        void *dst)
+{
+	if (!e) return -1;
+	if ((e->flags & X68K_ARC_FLAG_LZ) && e->size > a->staging_size) return -1;
+	l->arc = a;
+	l->entry = e;
+	l->dst = (uint8_t *)dst;
+	l->pos = 0;
+	l->lz.src = 0;
+	return 0;
+}
+
+int x68k_arc_load_step(X68kArcLoad *l, uint16_t max_sectors)
+{
+	const X68kArcEntry *e = l->entry;
+	const int lz = (e->flags & X68K_ARC_FLAG_LZ) != 0;
+	uint32_t len = e->size - l->pos;
+	const uint32_t max_len = (uint32_t)max_sectors * X68K_ARC_SECTOR;
+	if (len > max_len) len = max_len;
+
+	if (len)
+	{
+		uint8_t *buf = lz ? l->arc->staging : l->dst;
+		const int ret = arc_read_at(l->arc, e->offset + l->pos,
+		                            buf + l->pos, len);
+		if (ret) return ret;
+		l->pos += len;
+	}
+	if (!lz) return (l->pos < e->size) ? 0 : 1;
+
+	if (!l->lz.src)
+	{
+		if (l->pos < 4) return 0;
+		x68k_lz_stream_init(&l->lz, l->arc->staging, l->dst, X68K_LZ_BYTE);
+	}
+
+	// Until the whole entry is in, stay within what has been read: a token
+	// takes at most 3 bytes of input per byte of output.
+	uint32_t out = max_len;
+	if (l->pos < e->size)
+	{
+		const uint32_t avail = (l->arc->staging + l->pos) - l->lz.src;
+		if (out > avail / 3) out = avail / 3;
+	}
+	if (out > 0xFFFF) out = 0xFFFF;
+	if (!out) return 0;
+	return x68k_lz_stream_run(&l->lz, out);
+}
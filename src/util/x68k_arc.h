@@ -0,0 +1,114 @@
+/*
+
+Indexed asset archive (arc)
+
+Packs many assets into one file so that a scene change costs one _OPEN and a
+handful of large reads instead of a directory lookup and small reads per file.
+Build archives with tools/arcpack.
+
+File layout (big-endian):
+
+	$00  'XARC'
+	$04  Version (1)
+	$06  Number of entries
+	$08  Reserved
+	$10  Entries, 16 bytes each, sorted by hash
+	...  Data. Every entry starts on an X68K_ARC_SECTOR boundary.
+
+Entry:
+
+	$00.l  Name hash (x68k_arc_hash())
+	$04.l  Offset of the data from the start of the file
+	$08.l  Size of the data in the archive
+	$0C.w  Flags (X68K_ARC_FLAG_*)
+	$0E.w  Reserved
+
+The index is read once by x68k_arc_open() and looked up by binary search.
+
+Entries flagged X68K_ARC_FLAG_LZ hold an x68k_lz stream. They are read into
+the staging buffer and decoded to the destination, so the staging buffer must
+be at least as large as the biggest compressed entry. Other entries are read
+straight to the destination.
+
+Loads can be made all at once with x68k_arc_load(), or spread out with
+X68kArcLoad, which reads a bounded number of sectors per call. Calling
+x68k_arc_load_step() once a frame during gameplay streams in the next stage
+without a loading screen. Compressed entries are decoded through an
+X68kLzStream as they arrive, at most a sector's worth of output per sector of
+budget, so no single step decodes the whole entry.
+
+Memory for the index and staging buffer is provided by the caller.
+
+*/
+#ifndef X68K_ARC_H
+#define X68K_ARC_H
+
+#include <stdint.h>
+
+#include "util/x68k_lz.h"
+
+#define X68K_ARC_SECTOR 1024
+
+#define X68K_ARC_FLAG_LZ 0x0001
+
+typedef struct X68kArcEntry
+{
+	uint32_t hash;
+	uint32_t offset;
+	uint32_t size;
+	uint16_t flags;
+	uint16_t reserved;
+} X68kArcEntry;
+
+typedef struct X68kArc
+{
+	int fd;
+	uint32_t file_pos;  // Tracked so redundant _SEEK calls are skipped
+	const X68kArcEntry *index;
+	uint16_t num_entries;
+	uint8_t *staging;
+	uint32_t staging_size;
+} X68kArc;
+
+typedef struct X68kArcLoad
+{
+	X68kArc *arc;
+	const X68kArcEntry *entry;
+	uint8_t *dst;
+	uint32_t pos;  // Bytes read so far
+	X68kLzStream lz;  // X68K_ARC_FLAG_LZ; src is NULL until the size is in
+} X68kArcLoad;
+
+// Case-insensitive FNV-1a hash of an entry name.
+uint32_t x68k_arc_hash(const char *name);
+
+// Opens an archive and reads its index into `index`, which has room for
+// `max_entries`. Returns a negative DOS error code or -1 if the file isn't an
+// archive or the index doesn't fit.
+int x68k_arc_open(X68kArc *a, const char *path, X68kArcEntry *index,
+                  uint16_t max_entries, uint8_t *staging,
+                  uint32_t staging_size);
+
+void x68k_arc_close(X68kArc *a);
+
+// Returns the entry for a name or hash, or NULL if there isn't one.
+const X68kArcEntry *x68k_arc_find_hash(const X68kArc *a, uint32_t hash);
+
+static inline const X68kArcEntry *x68k_arc_find(const X68kArc *a,
+                                                const char *name)
+{
+	return x68k_arc_find_hash(a, x68k_arc_hash(name));
+}
+
+// Loads an entry to dst in one go. Returns 0 or a negative error code.
+int x68k_arc_load(X68kArc *a, const X68kArcEntry *e, void *dst);
+
+// Incremental loading. x68k_arc_load_step() reads at most `max_sectors`
+// sectors, and for a compressed entry decodes at most that many sectors' worth
+// of output; it returns 1 when the entry is done, 0 while more remains, or a
+// negative error code.
+int x68k_arc_load_begin(X68kArc *a, X68kArcLoad *l, const X68kArcEntry *e,
+                        void *dst);
+int x68k_arc_load_step(X68kArcLoad *l, uint16_t max_sectors);
+
+#endif  // X68K_ARC_H
@@ -0,0 +1,372 @@
+#include "util/x68k_bench.h"
+#include "util/x68k_arc.h"
+#include "util/x68k_colmap.h"
+#include "util/x68k_display.h"
+#include "util/x68k_fix.h"
+#include "util/x68k_lz.h"
+#include "util/x68k_mem.h"
+#include "util/x68k_pcgload.h"
+#include "util/x68k_raster.h"
+#include "x68000/x68k_opm.h"
+#include "x68000/x68k_pcg.h"
+#include "x68000/x68k_vbl.h"
+#include "irq.h"
+#include <iocs.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Timer-D underflow count, incremented by g_irq_bench_timer_d.
+volatile uint32_t g_x68k_bench_ovf;
+
+// Results of timed code that the compiler could otherwise drop.
+static volatile uint8_t s_bench_sink;
+
+/*
+TCDCR:      0xE8801D
+---- ---- -ccc ---- Timer-C prescaler (owned by the system, keep as-is)
+---- ---- ---- -ddd Timer-D prescaler: 0 = stop, 1 = /4 (1us at 4MHz)
+*/
+#define TCDCR_C_MASK 0x0070
+#define TCDCR_D_DIV4 0x0001
+
+#ifdef X68K_BENCH_SIM
+
+#define SIM_CYCLES (*(volatile uint32_t *)X68K_BENCH_SIM_CYCLES)
+
+static uint32_t s_sim_start;
+
+int x68k_bench_init(void)
+{
+	return 0;
+}
+
+void x68k_bench_shutdown(void)
+{
+}
+
+void x68k_bench_start(void)
+{
+	s_sim_start = SIM_CYCLES;
+}
+
+static uint32_t bench_stop_cycles(void)
+{
+	return SIM_CYCLES - s_sim_start;
+}
+
+uint32_t x68k_bench_stop(void)
+{
+	return bench_stop_cycles() / X68K_BENCH_CPU_MHZ;
+}
+
+#else
+
+int x68k_bench_init(void)
+{
+	// 1us units, counter of 256.
+	return _iocs_timerdst(g_irq_bench_timer_d, 1, 0);
+}
+
+void x68k_bench_shutdown(void)
+{
+	_iocs_timerdst(0, 0, 0);
+}
+
+void x68k_bench_start(void)
+{
+	mfp.tcdcr &= TCDCR_C_MASK;
+	// Loading the data register while stopped loads the counter, too.
+	mfp.tddr = 0;
+	g_x68k_bench_ovf = 0;
+	mfp.tcdcr = (mfp.tcdcr & TCDCR_C_MASK) | TCDCR_D_DIV4;
+}
+
+uint32_t x68k_bench_stop(void)
+{
+	mfp.tcdcr &= TCDCR_C_MASK;
+	const uint8_t count = mfp.tddr & 0xFF;
+	return (g_x68k_bench_ovf << 8) + ((256 - count) & 0xFF);
+}
+
+static uint32_t bench_stop_cycles(void)
+{
+	return x68k_bench_us_to_cycles(x68k_bench_stop());
+}
+
+#endif
+
+static void bench_fn_empty(void *ctx, uint16_t items)
+{
+	(void)ctx;
+	(void)items;
+}
+
+// Best-of-reps time for one call, in cycles.
+static uint32_t measure(void (*fn)(void *, uint16_t), void *ctx,
+                        uint16_t items, int reps)
+{
+	uint32_t best = 0xFFFFFFFF;
+	for (int i = 0; i < reps; i++)
+	{
+		x68k_bench_start();
+		fn(ctx, items);
+		const uint32_t cycles = bench_stop_cycles();
+		if (cycles < best) best = cycles;
+	}
+	return best;
+}
+
+int x68k_bench_run(const X68kBenchCase *cases, int num_cases,
+                   X68kBenchResult *res, int reps)
+{
+	int regressions = 0;
+	const uint32_t overhead = measure(bench_fn_empty, 0, 0, reps);
+
+	for (int i = 0; i < num_cases; i++)
+	{
+		const X68kBenchCase *c = &cases[i];
+		X68kBenchResult *r = &res[i];
+		uint32_t cycles = measure(c->fn, c->ctx, c->items, reps);
+		cycles = (cycles > overhead) ? (cycles - overhead) : 0;
+
+		r->cycles = cycles;
+		r->cycles_item = c->items ? (cycles / c->items) : cycles;
+		r->regressed = (c->budget && cycles > c->budget);
+		if (r->regressed) regressions++;
+	}
+	return regressions;
+}
+
+void x68k_bench_print(const X68kBenchCase *cases, int num_cases,
+                      const X68kBenchResult *res)
+{
+	printf("name,items,cycles,cycles_per_item,budget,status\n");
+	for (int i = 0; i < num_cases; i++)
+	{
+		printf("%s,%u,%lu,%lu,%lu,%s\n", cases[i].name,
+		       (unsigned int)cases[i].items,
+		       (unsigned long)res[i].cycles,
+		       (unsigned long)res[i].cycles_item,
+		       (unsigned long)cases[i].budget,
+		       res[i].regressed ? "FAIL" : "ok");
+	}
+}
+
+// Stock cases for library routines ==========================================
+
+void x68k_bench_fn_pcg_add_sprite(void *ctx, uint16_t items)
+{
+	(void)ctx;
+	for (uint16_t i = 0; i < items; i++)
+	{
+		x68k_pcg_add_sprite(i, i, PCG_ATTR(0, 0, 1, i), 0);
+	}
+	x68k_pcg_finish_sprites();
+}
+
+void x68k_bench_fn_opm_write(void *ctx, uint16_t items)
+{
+	(void)ctx;
+	for (uint16_t i = 0; i < items; i++)
+	{
+		x68k_opm_write(OPM_CH_TL + 7 + (8 * 3), 0x7F);
+	}
+}
+
+void x68k_bench_fn_pcg_set_bg0_tile(void *ctx, uint16_t items)
+{
+	(void)ctx;
+	for (uint16_t i = 0; i < items; i++)
+	{
+		x68k_pcg_set_bg0_tile(i & 0x3F, 0, 0);
+	}
+}
+
+void x68k_bench_fn_display_switch(void *ctx, uint16_t items)
+{
+	X68kDisplay *d = (X68kDisplay *)ctx;
+	for (uint16_t i = 0; i < items; i++)
+	{
+		int next = d->current_mode + 1;
+		if (next >= d->num_modes) next = 0;
+		x68k_display_request_mode(d, next);
+		x68k_display_vblank(d);
+	}
+}
+
+void x68k_bench_fn_lz_decode(void *ctx, uint16_t items)
+{
+	const X68kBenchLz *lz = (const X68kBenchLz *)ctx;
+	(void)items;
+	x68k_lz_decode(lz->src, lz->dst);
+}
+
+void x68k_bench_fn_arc_find(void *ctx, uint16_t items)
+{
+	const X68kArc *a = (const X68kArc *)ctx;
+	if (!a->num_entries) return;
+	uint16_t idx = 0;
+	for (uint16_t i = 0; i < items; i++)
+	{
+		x68k_arc_find_hash(a, a->index[idx].hash);
+		if (++idx >= a->num_entries) idx = 0;
+	}
+}
+
+void x68k_bench_fn_arena_alloc(void *ctx, uint16_t items)
+{
+	X68kArena *a = (X68kArena *)ctx;
+	for (uint16_t i = 0; i < items; i++)
+	{
+		x68k_arena_alloc(a, 16);
+	}
+	x68k_arena_reset(a);
+}
+
+void x68k_bench_fn_pool_alloc_free(void *ctx, uint16_t items)
+{
+	X68kPool *p = (X68kPool *)ctx;
+	void *objs[64];
+	while (items)
+	{
+		const uint16_t n = (items > 64) ? 64 : items;
+		for (uint16_t i = 0; i < n; i++) objs[i] = x68k_pool_alloc(p);
+		for (uint16_t i = 0; i < n; i++)
+		{
+			if (objs[i]) x68k_pool_free(p, objs[i]);
+		}
+		items -= n;
+	}
+}
+
+void x68k_bench_fn_malloc_free(void *ctx, uint16_t items)
+{
+	(void)ctx;
+	void *objs[64];
+	while (items)
+	{
+		const uint16_t n = (items > 64) ? 64 : items;
+		for (uint16_t i = 0; i < n; i++) objs[i] = malloc(16);
+		for (uint16_t i = 0; i < n; i++) free(objs[i]);
+		items -= n;
+	}
+}
+
+void x68k_bench_fn_colmap_box(void *ctx, uint16_t items)
+{
+	const X68kColMap *m = (const X68kColMap *)ctx;
+	for (uint16_t i = 0; i < items; i++)
+	{
+		const uint16_t tx = i & 0x3F;
+		const uint16_t ty = (i >> 6) & 0x3F;
+		s_bench_sink = x68k_colmap_box_solid(m, tx, ty, tx + 1, ty + 2);
+	}
+}
+
+void x68k_bench_fn_colmap_box_pertile(void *ctx, uint16_t items)
+{
+	const X68kColProps *p = ((const X68kColMap *)ctx)->props;
+	volatile uint16_t *nt = (volatile uint16_t *)PCG_BG0_NAME;
+	for (uint16_t i = 0; i < items; i++)
+	{
+		const uint16_t tx = i & 0x3F;
+		const uint16_t ty = (i >> 6) & 0x3F;
+		uint8_t hit = 0;
+		for (uint16_t y = ty; y <= ty + 2 && !hit; y++)
+		{
+			for (uint16_t x = tx; x <= tx + 1 && !hit; x++)
+			{
+				const uint8_t pat = nt[((y & 0x3F) << 6) + (x & 0x3F)] & 0xFF;
+				hit = (p->solid[pat >> 5] >> (pat & 31)) & 1;
+			}
+		}
+		s_bench_sink = hit;
+	}
+}
+
+void x68k_bench_fn_pcgload(void *ctx, uint16_t items)
+{
+	x68k_pcgload_8x8(ctx, 0, items);
+}
+
+void x68k_bench_fn_pcgload_blanked(void *ctx, uint16_t items)
+{
+	x68k_pcg_set_disp_en(0);
+	x68k_pcgload_8x8(ctx, 0, items);
+	x68k_pcg_set_disp_en(1);
+}
+
+void x68k_bench_fn_opm_voice_load(void *ctx, uint16_t items)
+{
+	const X68kBenchOpmVoice *b = (const X68kBenchOpmVoice *)ctx;
+	for (uint16_t i = 0; i < items; i++)
+	{
+		x68k_opm_voice_load(7, b->voice[i & 1], X68K_OPM_PAN_BOTH_ENABLE);
+	}
+}
+
+void x68k_bench_fn_opm_voice_load_diff(void *ctx, uint16_t items)
+{
+	X68kBenchOpmVoice *b = (X68kBenchOpmVoice *)ctx;
+	for (uint16_t i = 0; i < items; i++)
+	{
+		x68k_opm_voice_load_diff(&b->cache, 7, b->voice[i & 1]);
+	}
+}
+
+void x68k_bench_fn_raster_tri(void *ctx, uint16_t items)
+{
+	const X68kRaster *r = (const X68kRaster *)ctx;
+	for (uint16_t i = 0; i < items; i++)
+	{
+		const int16_t x = (i * 37) & 0x1BF;
+		const int16_t y = (i * 91) & 0x1BF;
+		const X68kRasterPoint v[3] =
+		{
+			{x, y}, {x + 32, y + 8}, {x + 12, y + 32},
+		};
+		x68k_raster_tri(r, v, i);
+	}
+}
+
+void x68k_bench_fn_raster_span(void *ctx, uint16_t items)
+{
+	const X68kRaster *r = (const X68kRaster *)ctx;
+	for (uint16_t i = 0; i < items; i++)
+	{
+		const int16_t x = (i * 37) & 0x17F;
+		x68k_raster_hline(r, x, x + 63, i & 0x1FF, i);
+	}
+}
+
+void x68k_bench_fn_fix_bodies_step(void *ctx, uint16_t items)
+{
+	(void)items;
+	x68k_fix_bodies_step((X68kFixBodies *)ctx);
+}
+
+void x68k_bench_fn_fix_obj_step(void *ctx, uint16_t items)
+{
+	X68kBenchFixObj *o = (X68kBenchFixObj *)ctx;
+	for (uint16_t i = 0; i < items; i++, o++)
+	{
+		o->x_sub += o->vx;
+		o->x += o->x_sub >> 8;
+		o->x_sub &= 0xFF;
+		o->y_sub += o->vy;
+		o->y += o->y_sub >> 8;
+		o->y_sub &= 0xFF;
+	}
+}
+
+void x68k_bench_fn_cpu_copy(void *ctx, uint16_t items)
+{
+	const X68kBenchCpu *b = (const X68kBenchCpu *)ctx;
+	b->k->copy(b->dst, b->src, items);
+}
+
+void x68k_bench_fn_cpu_fill(void *ctx, uint16_t items)
+{
+	const X68kBenchCpu *b = (const X68kBenchCpu *)ctx;
+	b->k->fill(b->dst, 0x5555, items);
+}
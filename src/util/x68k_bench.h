@@ -0,0 +1,191 @@
+/*
+
+X68000 Routine Benchmarking (bench)
+
+Measures the cost of library routines on the machine itself, using MFP Timer-D
+as a free-running 1us stopwatch. Timer-D counts down from 256 at 1MHz (the MFP
+runs at 4MHz with a /4 prescaler), and an interrupt counts each underflow, so
+elapsed time is (underflows * 256) + (256 - TDDR).
+
+Timings are converted to CPU cycles with X68K_BENCH_CPU_MHZ, which should be
+set to the clock of the machine under test (10 for a stock X68000).
+
+A benchmark is a table of X68kBenchCase. Each case runs a routine over `items`
+items per call; the best of several repetitions is kept, minus the overhead of
+calling an empty case. The results are printed as a comma-separated table so
+that a host script can diff them against a previous run:
+
+name,items,cycles,cycles_per_item,budget,status
+
+A case with a nonzero budget is marked as a regression if its cycle count per
+call exceeds it. x68k_bench_run() returns the number of regressions, so a test
+program can return it as its exit code.
+
+Timer-D is claimed through IOCS _TIMERDST, so benchmarking can't be combined
+with anything else that uses it (e.g. PROCESS in CONFIG.SYS).
+
+Host runs: built with X68K_BENCH_SIM defined, a benchmark program runs under
+tools/sim68k, a cycle-counting 68000 with wait states for VRAM and I/O. The
+stopwatch then reads the simulator's cycle counter, so results are exact
+cycles, with no Timer-D rounding, and the same on every run. The program's
+exit code (the number of regressions) is sim68k's, for a host build to fail
+on.
+
+*/
+#ifndef X68K_BENCH_H
+#define X68K_BENCH_H
+
+#include <stdint.h>
+
+#include "util/x68k_opm_voice.h"
+#include "x68000/x68k_cpu.h"
+
+#ifndef X68K_BENCH_CPU_MHZ
+#define X68K_BENCH_CPU_MHZ 10
+#endif
+
+// tools/sim68k's cycle counter, a longword in the user I/O area.
+#define X68K_BENCH_SIM_CYCLES 0xECFFF0
+
+typedef struct X68kBenchCase
+{
+	const char *name;
+	// Runs the routine under test `items` times.
+	void (*fn)(void *ctx, uint16_t items);
+	void *ctx;
+	uint16_t items;
+	// Maximum cycles per call before the case counts as a regression.
+	// Zero disables the check.
+	uint32_t budget;
+} X68kBenchCase;
+
+typedef struct X68kBenchResult
+{
+	uint32_t cycles;       // Best cycles per call, overhead removed
+	uint32_t cycles_item;  // cycles / items
+	uint8_t regressed;
+} X68kBenchResult;
+
+// Claim Timer-D (nothing under sim68k). Returns nonzero if it is already in
+// use.
+int x68k_bench_init(void);
+
+// Release Timer-D.
+void x68k_bench_shutdown(void);
+
+// Stopwatch. x68k_bench_stop() returns microseconds since x68k_bench_start().
+void x68k_bench_start(void);
+uint32_t x68k_bench_stop(void);
+
+static inline uint32_t x68k_bench_us_to_cycles(uint32_t us)
+{
+	return us * X68K_BENCH_CPU_MHZ;
+}
+
+// Runs each case `reps` times, fills in `res` (one per case), and returns the
+// number of cases that went over budget.
+int x68k_bench_run(const X68kBenchCase *cases, int num_cases,
+                   X68kBenchResult *res, int reps);
+
+// Prints results as comma-separated lines, with a header line.
+void x68k_bench_print(const X68kBenchCase *cases, int num_cases,
+                      const X68kBenchResult *res);
+
+// Stock cases for library routines ==========================================
+
+// x68k_pcg_add_sprite() followed by x68k_pcg_finish_sprites(). ctx unused.
+void x68k_bench_fn_pcg_add_sprite(void *ctx, uint16_t items);
+
+// x68k_opm_write() to channel H OP4 TL (silent). ctx unused.
+void x68k_bench_fn_opm_write(void *ctx, uint16_t items);
+
+// x68k_pcg_set_bg0_tile() across a row. ctx unused.
+void x68k_bench_fn_pcg_set_bg0_tile(void *ctx, uint16_t items);
+
+// x68k_display_request_mode() of the next mode and x68k_display_vblank(),
+// which applies the precomputed transition; the same switch as
+// x68k_display_cycle_mode() without its wait for blanking. ctx is the
+// X68kDisplay to cycle.
+void x68k_bench_fn_display_switch(void *ctx, uint16_t items);
+
+// x68k_lz_decode() of a whole stream. ctx is an X68kBenchLz; set items to the
+// uncompressed size to get cycles per byte.
+typedef struct X68kBenchLz
+{
+	const void *src;
+	void *dst;
+} X68kBenchLz;
+void x68k_bench_fn_lz_decode(void *ctx, uint16_t items);
+
+// x68k_arc_find_hash() for each entry of an archive in turn. ctx is an open
+// X68kArc.
+void x68k_bench_fn_arc_find(void *ctx, uint16_t items);
+
+// Allocators, for comparison against the system allocator:
+// x68k_arena_alloc() of 16 bytes, then a reset. ctx is an X68kArena.
+void x68k_bench_fn_arena_alloc(void *ctx, uint16_t items);
+// x68k_pool_alloc() of up to 64 objects, then x68k_pool_free() of each, until
+// `items` have been done. ctx is an X68kPool with at least 64 objects; if it
+// runs out, the failed allocations are skipped and the timing is off.
+void x68k_bench_fn_pool_alloc_free(void *ctx, uint16_t items);
+// malloc() of 16 bytes and free(), `items` times. ctx unused.
+void x68k_bench_fn_malloc_free(void *ctx, uint16_t items);
+
+// Background collision, 2x3-tile box tests stepped across the map:
+// x68k_colmap_box_solid(). ctx is an X68kColMap.
+void x68k_bench_fn_colmap_box(void *ctx, uint16_t items);
+// The same tests done one tile at a time from PCG_BG0_NAME, for comparison.
+// ctx is an X68kColMap, for its X68kColProps.
+void x68k_bench_fn_colmap_box_pertile(void *ctx, uint16_t items);
+
+// x68k_pcgload_8x8() of `items` patterns from ctx to pattern 0 onwards, with
+// the display on, and with PCG output blanked. Comparing the two gives the
+// cost of uploading during active display. Overwrites PCG patterns.
+void x68k_bench_fn_pcgload(void *ctx, uint16_t items);
+void x68k_bench_fn_pcgload_blanked(void *ctx, uint16_t items);
+
+// OPM voice loads on channel H, alternating between two voices. Full loads
+// with x68k_opm_voice_load(), and loads through x68k_opm_voice_load_diff().
+// ctx is an X68kBenchOpmVoice.
+typedef struct X68kBenchOpmVoice
+{
+	X68kOpmVoiceCache cache;
+	const X68kOpmVoice *voice[2];
+} X68kBenchOpmVoice;
+void x68k_bench_fn_opm_voice_load(void *ctx, uint16_t items);
+void x68k_bench_fn_opm_voice_load_diff(void *ctx, uint16_t items);
+
+// Rasterizer throughput; ctx is an X68kRaster. Filled triangles about 32
+// pixels on a side, spread over the page, and 64-pixel spans.
+void x68k_bench_fn_raster_tri(void *ctx, uint16_t items);
+void x68k_bench_fn_raster_span(void *ctx, uint16_t items);
+
+// Object motion. x68k_fix_bodies_step() on an X68kFixBodies (ctx), with
+// items set to its count; and the same motion done the usual way, on an array
+// of `items` X68kBenchFixObj structs (ctx), for comparison.
+typedef struct X68kBenchFixObj
+{
+	int16_t x;
+	int16_t y;
+	int16_t x_sub;  // Fraction, 1/256 pixel
+	int16_t y_sub;
+	int16_t vx;     // 1/256 pixel per frame
+	int16_t vy;
+	uint8_t state[8];
+} X68kBenchFixObj;
+void x68k_bench_fn_fix_bodies_step(void *ctx, uint16_t items);
+void x68k_bench_fn_fix_obj_step(void *ctx, uint16_t items);
+
+// One MPU's copy and fill kernels, over `items` bytes (even). ctx is an
+// X68kBenchCpu; pick `k` with x68k_cpu_kernels() to compare the variants the
+// machine can run.
+typedef struct X68kBenchCpu
+{
+	const X68kCpuKernels *k;
+	volatile void *dst;
+	const void *src;
+} X68kBenchCpu;
+void x68k_bench_fn_cpu_copy(void *ctx, uint16_t items);
+void x68k_bench_fn_cpu_fill(void *ctx, uint16_t items);
+
+#endif  // X68K_BENCH_H
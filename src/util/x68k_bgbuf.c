@@ -0,0 +1,83 @@
+#include "util/x68k_bgbuf.h"
+#include "x68000/x68k_cpu.h"
+
+static void bgbuf_show(const X68kBgBuf *b)
+{
+	if (b->layer) x68k_pcg_set_bg1_txsel(b->front);
+	else x68k_pcg_set_bg0_txsel(b->front);
+}
+
+void x68k_bgbuf_init(X68kBgBuf *b, uint8_t layer, uint16_t budget)
+{
+	b->layer = layer ? 1 : 0;
+	b->front = 0;
+	b->flip_pending = 0;
+	b->budget = budget ? budget : X68K_BGBUF_ENTRIES;
+	b->src = 0;
+	b->src_w = 0;
+	b->src_h = 0;
+	b->fill = 0;
+	b->pos = X68K_BGBUF_ENTRIES;
+	b->frames = 0;
+	b->frames_peak = 0;
+
+	if (b->layer) x68k_pcg_set_bg0_enable(0);
+	else x68k_pcg_set_bg1_enable(0);
+	bgbuf_show(b);
+}
+
+void x68k_bgbuf_begin(X68kBgBuf *b, const uint16_t *src, uint16_t w,
+                      uint16_t h, uint16_t fill)
+{
+	b->flip_pending = 0;
+	b->src = src;
+	b->src_w = (w > X68K_BGBUF_COLS) ? X68K_BGBUF_COLS : w;
+	b->src_h = (h > X68K_BGBUF_ROWS) ? X68K_BGBUF_ROWS : h;
+	b->fill = fill;
+	b->pos = 0;
+	b->frames = 0;
+}
+
+int x68k_bgbuf_step(X68kBgBuf *b)
+{
+	if (b->pos >= X68K_BGBUF_ENTRIES) return 0;
+
+	volatile uint16_t *nt = x68k_bgbuf_back(b);
+	uint16_t left = b->budget;
+	// Work a row segment at a time, so each is one copy or fill kernel call.
+	while (left && b->pos < X68K_BGBUF_ENTRIES)
+	{
+		const uint16_t y = b->pos / X68K_BGBUF_COLS;
+		uint16_t x = b->pos % X68K_BGBUF_COLS;
+		volatile uint16_t *dst = &nt[b->pos];
+		uint16_t n;
+		if (y < b->src_h && x < b->src_w)
+		{
+			n = b->src_w - x;
+			if (n > left) n = left;
+			g_x68k_cpu->copy(dst, &b->src[y * b->src_w + x], n * 2);
+		}
+		else
+		{
+			n = X68K_BGBUF_COLS - x;
+			if (n > left) n = left;
+			g_x68k_cpu->fill(dst, b->fill, n * 2);
+		}
+		b->pos += n;
+		left -= n;
+	}
+
+	b->frames++;
+	if (b->pos < X68K_BGBUF_ENTRIES) return 0;
+	if (b->frames > b->frames_peak) b->frames_peak = b->frames;
+	b->flip_pending = 1;
+	return 1;
+}
+
+void x68k_bgbuf_vblank(X68kBgBuf *b)
+{
+	if (!b->flip_pending) return;
+	b->front ^= 1;
+	bgbuf_show(b);
+	b->flip_pending = 0;
+}
@@ -0,0 +1,88 @@
+/*
+
+Double-buffered BG nametable (bgbuf)
+
+Each BG layer shows one of the two nametables at PCG_BG0_NAME and
+PCG_BG1_NAME, picked by its TXsel bits in the BG control register. With only
+one BG layer in use, the other nametable can hold the next screen: it is
+filled in over as many frames as it takes, then shown by a single control
+register write in vertical blank. Room transitions and menu pages then change
+all at once, without tearing or a visible redraw.
+
+The layer not being double buffered is disabled by x68k_bgbuf_init(), as its
+nametable is being written over.
+
+Filling: x68k_bgbuf_begin() sets up a copy of a row-major map of PCG_ATTR
+words into the hidden nametable, with everything outside the map set to a
+fill value. x68k_bgbuf_step() copies up to `budget` entries each time it is
+called, e.g. once per frame. Once the copy is finished, x68k_bgbuf_vblank()
+shows it. The game can also write to x68k_bgbuf_back() directly and call
+x68k_bgbuf_flip().
+
+*/
+#ifndef X68K_BGBUF_H
+#define X68K_BGBUF_H
+
+#include <stdint.h>
+
+#include "x68000/x68k_pcg.h"
+
+#define X68K_BGBUF_COLS 64
+#define X68K_BGBUF_ROWS 64
+#define X68K_BGBUF_ENTRIES (X68K_BGBUF_COLS * X68K_BGBUF_ROWS)
+
+typedef struct X68kBgBuf
+{
+	uint8_t layer;  // BG layer being shown
+	uint8_t front;  // Nametable it shows (0 = PCG_BG0_NAME, 1 = PCG_BG1_NAME)
+	volatile uint8_t flip_pending;
+	uint16_t budget;  // Entries copied per x68k_bgbuf_step()
+
+	// Copy in progress
+	const uint16_t *src;
+	uint16_t src_w;
+	uint16_t src_h;
+	uint16_t fill;
+	uint16_t pos;  // Next entry; X68K_BGBUF_ENTRIES once done
+
+	// Statistics
+	uint16_t frames;       // Steps taken by the last copy
+	uint16_t frames_peak;
+} X68kBgBuf;
+
+// Shows nametable 0 on `layer` and disables the other BG layer. A budget of
+// 0 copies the whole nametable in one step.
+void x68k_bgbuf_init(X68kBgBuf *b, uint8_t layer, uint16_t budget);
+
+// The nametable not being shown.
+static inline volatile uint16_t *x68k_bgbuf_back(const X68kBgBuf *b)
+{
+	return (volatile uint16_t *)(b->front ? PCG_BG0_NAME : PCG_BG1_NAME);
+}
+
+// Starts copying a w x h map (at most 64 x 64) into the hidden nametable.
+// Anything outside the map is set to `fill`. Cancels a pending flip.
+void x68k_bgbuf_begin(X68kBgBuf *b, const uint16_t *src, uint16_t w,
+                      uint16_t h, uint16_t fill);
+
+// Copies up to `budget` more entries. Once the copy is finished, the flip is
+// requested, and this returns nonzero.
+int x68k_bgbuf_step(X68kBgBuf *b);
+
+// True while a copy is in progress or waiting to be shown.
+static inline uint8_t x68k_bgbuf_busy(const X68kBgBuf *b)
+{
+	return b->pos < X68K_BGBUF_ENTRIES || b->flip_pending;
+}
+
+// Requests that the hidden nametable be shown on the next x68k_bgbuf_vblank().
+static inline void x68k_bgbuf_flip(X68kBgBuf *b)
+{
+	b->flip_pending = 1;
+}
+
+// Shows the hidden nametable if a flip is pending. Call during vertical
+// blank.
+void x68k_bgbuf_vblank(X68kBgBuf *b);
+
+#endif  // X68K_BGBUF_H
@@ -0,0 +1,271 @@
+#include "util/x68k_colmap.h"
+
+#define COLMAP_WMASK (X68K_COLMAP_COLS - 1)
+#define COLMAP_HMASK (X68K_COLMAP_ROWS - 1)
+
+void x68k_colmap_init(X68kColMap *m, const X68kColProps *props,
+                      uint8_t tile_size, uint8_t *slope)
+{
+	m->props = props;
+	m->slope = slope;
+	m->tile_shift = (tile_size == 16) ? 4 : 3;
+	for (uint16_t y = 0; y < X68K_COLMAP_ROWS; y++)
+	{
+		m->bits[y][0] = 0;
+		m->bits[y][1] = 0;
+	}
+	if (slope)
+	{
+		for (uint16_t i = 0; i < X68K_COLMAP_COLS * X68K_COLMAP_ROWS; i++)
+		{
+			slope[i] = 0;
+		}
+	}
+}
+
+static inline uint8_t pattern_solid(const X68kColProps *p, uint16_t attr)
+{
+	const uint8_t pat = attr & 0xFF;
+	return (p->solid[pat >> 5] >> (pat & 31)) & 1;
+}
+
+void x68k_colmap_set_tile(X68kColMap *m, uint16_t tx, uint16_t ty,
+                          uint16_t attr)
+{
+	tx &= COLMAP_WMASK;
+	ty &= COLMAP_HMASK;
+	const uint32_t bit = 0x80000000UL >> (tx & 31);
+	uint32_t *word = &m->bits[ty][tx >> 5];
+	if (pattern_solid(m->props, attr)) *word |= bit;
+	else *word &= ~bit;
+	if (m->slope)
+	{
+		m->slope[ty * X68K_COLMAP_COLS + tx] =
+		    m->props->slope ? m->props->slope[attr & 0xFF] : 0;
+	}
+}
+
+void x68k_colmap_load_row(X68kColMap *m, const volatile uint16_t *nt,
+                          uint16_t ty)
+{
+	ty &= COLMAP_HMASK;
+	const volatile uint16_t *src = &nt[ty * X68K_COLMAP_COLS];
+	const X68kColProps *p = m->props;
+	// Whole longwords at a time; the slope pass is separate as it's rarer.
+	for (uint16_t w = 0; w < 2; w++)
+	{
+		uint32_t bits = 0;
+		for (uint16_t x = 0; x < 32; x++)
+		{
+			bits = (bits << 1) | pattern_solid(p, *src++);
+		}
+		m->bits[ty][w] = bits;
+	}
+	if (m->slope)
+	{
+		src = &nt[ty * X68K_COLMAP_COLS];
+		uint8_t *dst = &m->slope[ty * X68K_COLMAP_COLS];
+		for (uint16_t x = 0; x < X68K_COLMAP_COLS; x++)
+		{
+			dst[x] = p->slope ? p->slope[src[x] & 0xFF] : 0;
+		}
+	}
+}
+
+void x68k_colmap_load_col(X68kColMap *m, const volatile uint16_t *nt,
+                          uint16_t tx)
+{
+	tx &= COLMAP_WMASK;
+	for (uint16_t y = 0; y < X68K_COLMAP_ROWS; y++)
+	{
+		x68k_colmap_set_tile(m, tx, y, nt[y * X68K_COLMAP_COLS + tx]);
+	}
+}
+
+void x68k_colmap_load(X68kColMap *m, const volatile uint16_t *nt)
+{
+	for (uint16_t y = 0; y < X68K_COLMAP_ROWS; y++) x68k_colmap_load_row(m, nt, y);
+}
+
+// Masks ======================================================================
+
+// Bits a through b (0-31, a <= b), counting from the MSB.
+static inline uint32_t mask32(uint16_t a, uint16_t b)
+{
+	return (0xFFFFFFFFUL >> a) & (0xFFFFFFFFUL << (31 - b));
+}
+
+// Builds the two-longword mask for columns tx0 through tx1, wrapping at the
+// edge of the map.
+static void span_mask(uint16_t tx0, uint16_t tx1, uint32_t *m0, uint32_t *m1)
+{
+	const uint16_t len = tx1 - tx0;
+	*m0 = 0;
+	*m1 = 0;
+	if (len >= COLMAP_WMASK)
+	{
+		*m0 = 0xFFFFFFFFUL;
+		*m1 = 0xFFFFFFFFUL;
+		return;
+	}
+	uint16_t a = tx0 & COLMAP_WMASK;
+	uint16_t b = a + len;
+	if (b > COLMAP_WMASK)
+	{
+		// Wrapped; the part past the right edge starts again at column 0.
+		const uint16_t wb = b - X68K_COLMAP_COLS;
+		if (wb < 32) *m0 |= mask32(0, wb);
+		else
+		{
+			*m0 = 0xFFFFFFFFUL;
+			*m1 |= mask32(0, wb - 32);
+		}
+		b = COLMAP_WMASK;
+	}
+	if (a < 32)
+	{
+		*m0 |= mask32(a, (b < 32) ? b : 31);
+		if (b >= 32) *m1 |= mask32(0, b - 32);
+	}
+	else
+	{
+		*m1 |= mask32(a - 32, b - 32);
+	}
+}
+
+// Queries ===================================================================
+
+uint8_t x68k_colmap_span_solid(const X68kColMap *m, uint16_t ty, uint16_t tx0,
+                               uint16_t tx1)
+{
+	uint32_t m0, m1;
+	span_mask(tx0, tx1, &m0, &m1);
+	const uint32_t *row = m->bits[ty & COLMAP_HMASK];
+	return ((row[0] & m0) | (row[1] & m1)) != 0;
+}
+
+uint8_t x68k_colmap_box_solid(const X68kColMap *m, uint16_t tx0, uint16_t ty0,
+                              uint16_t tx1, uint16_t ty1)
+{
+	uint32_t m0, m1;
+	span_mask(tx0, tx1, &m0, &m1);
+	uint16_t rows = ty1 - ty0;
+	if (rows > COLMAP_HMASK) rows = COLMAP_HMASK;
+	uint16_t y = ty0;
+	do
+	{
+		const uint32_t *row = m->bits[y & COLMAP_HMASK];
+		if ((row[0] & m0) | (row[1] & m1)) return 1;
+		y++;
+	} while (rows--);
+	return 0;
+}
+
+uint16_t x68k_colmap_sweep_x(const X68kColMap *m, uint16_t tx0, uint16_t ty0,
+                             uint16_t tx1, uint16_t ty1, int8_t dir,
+                             uint16_t max)
+{
+	if (!max) return 0;
+	if (max > X68K_COLMAP_COLS) max = X68K_COLMAP_COLS;
+
+	// Collapse the rows the box covers into one row of occupancy.
+	uint32_t occ[2] = {0, 0};
+	uint16_t rows = ty1 - ty0;
+	if (rows > COLMAP_HMASK) rows = COLMAP_HMASK;
+	uint16_t y = ty0;
+	do
+	{
+		const uint32_t *row = m->bits[y & COLMAP_HMASK];
+		occ[0] |= row[0];
+		occ[1] |= row[1];
+		y++;
+	} while (rows--);
+
+	// Common case: nothing in the way over the whole distance.
+	const uint16_t start = (dir < 0) ? (tx0 - max) : (tx1 + 1);
+	uint32_t m0, m1;
+	span_mask(start, start + max - 1, &m0, &m1);
+	if (!((occ[0] & m0) | (occ[1] & m1))) return max;
+
+	uint16_t x = (dir < 0) ? (tx0 - 1) : (tx1 + 1);
+	for (uint16_t i = 0; i < max; i++)
+	{
+		const uint16_t c = x & COLMAP_WMASK;
+		if ((occ[c >> 5] >> (31 - (c & 31))) & 1) return i;
+		x += (dir < 0) ? -1 : 1;
+	}
+	return max;
+}
+
+uint16_t x68k_colmap_sweep_y(const X68kColMap *m, uint16_t tx0, uint16_t ty0,
+                             uint16_t tx1, uint16_t ty1, int8_t dir,
+                             uint16_t max)
+{
+	uint32_t m0, m1;
+	span_mask(tx0, tx1, &m0, &m1);
+	if (max > X68K_COLMAP_ROWS) max = X68K_COLMAP_ROWS;
+
+	uint16_t y = (dir < 0) ? (ty0 - 1) : (ty1 + 1);
+	for (uint16_t i = 0; i < max; i++)
+	{
+		const uint32_t *row = m->bits[y & COLMAP_HMASK];
+		if ((row[0] & m0) | (row[1] & m1)) return i;
+		y += (dir < 0) ? -1 : 1;
+	}
+	return max;
+}
+
+uint8_t x68k_colmap_raycast(const X68kColMap *m, int16_t x0, int16_t y0,
+                            int16_t x1, int16_t y1, uint16_t *hit_tx,
+                            uint16_t *hit_ty)
+{
+	const uint8_t s = m->tile_shift;
+	const int16_t size = 1 << s;
+	int16_t tx = x0 >> s;
+	int16_t ty = y0 >> s;
+	const int16_t ex = x1 >> s;
+	const int16_t ey = y1 >> s;
+	const int16_t step_x = (x1 < x0) ? -1 : 1;
+	const int16_t step_y = (y1 < y0) ? -1 : 1;
+	const int16_t adx = (x1 < x0) ? (x0 - x1) : (x1 - x0);
+	const int16_t ady = (y1 < y0) ? (y0 - y1) : (y1 - y0);
+
+	// Pixel distance to the next tile edge on each axis. Which edge comes
+	// first is decided by comparing bx / adx with by / ady, cross-multiplied
+	// so there's no division.
+	int16_t bx = (step_x > 0) ? (((tx + 1) << s) - x0) : (x0 - (tx << s));
+	int16_t by = (step_y > 0) ? (((ty + 1) << s) - y0) : (y0 - (ty << s));
+
+	int16_t n = ((ex > tx) ? (ex - tx) : (tx - ex)) +
+	            ((ey > ty) ? (ey - ty) : (ty - ey));
+	for (;;)
+	{
+		if (x68k_colmap_solid(m, tx, ty))
+		{
+			*hit_tx = tx & COLMAP_WMASK;
+			*hit_ty = ty & COLMAP_HMASK;
+			return 1;
+		}
+		if (n-- <= 0) break;
+		// On a tie the line is on both edges at once; it has entered the
+		// next tile only on an axis where it moves right or down. Never step
+		// past the end tile on an axis.
+		const int32_t tx_cross = (int32_t)bx * ady;
+		const int32_t ty_cross = (int32_t)by * adx;
+		const uint8_t step_on_x =
+		    (ty == ey) ||
+		    (tx != ex && (tx_cross < ty_cross ||
+		                  (tx_cross == ty_cross && step_x > 0)));
+		if (step_on_x)
+		{
+			tx += step_x;
+			bx += size;
+		}
+		else
+		{
+			ty += step_y;
+			by += size;
+		}
+	}
+	return 0;
+}
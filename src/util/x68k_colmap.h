@@ -0,0 +1,118 @@
+/*
+
+Background collision map (colmap)
+
+A one-bit-per-tile solidity map covering the same 64 x 64 tile window as a BG
+nametable, so collision checks don't need to decode PCG_BG0_NAME entries one
+tile at a time. Each row is two longwords, with column 0 in the most
+significant bit of the first, so a query tests up to 32 tiles with a single
+AND.
+
+Which patterns are solid is set by an X68kColProps: a 256-bit mask indexed by
+pattern number, and optionally a slope class per pattern. If the map has a
+slope buffer (one byte per tile), the class of each tile is kept there as
+well. Slope classes are game-defined; the map only stores them.
+
+Keeping in sync: coordinates wrap at 64 tiles, as the nametable does. When
+the game writes tiles into the nametable as the level scrolls, pass the same
+entries to x68k_colmap_set_tile() (or re-read a row or column that was just
+written with x68k_colmap_load_row() / x68k_colmap_load_col()), and the map
+tracks the visible window exactly.
+
+Queries take tile coordinates; the _px variants take pixels and use the
+tile size given at init (8 or 16).
+
+*/
+#ifndef X68K_COLMAP_H
+#define X68K_COLMAP_H
+
+#include <stdint.h>
+
+#define X68K_COLMAP_COLS 64
+#define X68K_COLMAP_ROWS 64
+
+typedef struct X68kColProps
+{
+	uint32_t solid[8];     // Pattern p is solid if bit (p & 31) of solid[p >> 5]
+	const uint8_t *slope;  // Slope class per pattern, or NULL
+} X68kColProps;
+
+typedef struct X68kColMap
+{
+	uint32_t bits[X68K_COLMAP_ROWS][2];
+	uint8_t *slope;  // X68K_COLMAP_COLS * X68K_COLMAP_ROWS, or NULL
+	const X68kColProps *props;
+	uint8_t tile_shift;
+} X68kColMap;
+
+// tile_size is 8 or 16. slope may be NULL.
+void x68k_colmap_init(X68kColMap *m, const X68kColProps *props,
+                      uint8_t tile_size, uint8_t *slope);
+
+// Rebuilds the whole map from a nametable (e.g. PCG_BG0_NAME).
+void x68k_colmap_load(X68kColMap *m, const volatile uint16_t *nt);
+
+// Re-reads one row or column from a nametable.
+void x68k_colmap_load_row(X68kColMap *m, const volatile uint16_t *nt,
+                          uint16_t ty);
+void x68k_colmap_load_col(X68kColMap *m, const volatile uint16_t *nt,
+                          uint16_t tx);
+
+// Updates one tile from a nametable entry (PCG_ATTR format).
+void x68k_colmap_set_tile(X68kColMap *m, uint16_t tx, uint16_t ty,
+                          uint16_t attr);
+
+// Queries ===================================================================
+
+static inline uint8_t x68k_colmap_solid(const X68kColMap *m, uint16_t tx,
+                                        uint16_t ty)
+{
+	tx &= X68K_COLMAP_COLS - 1;
+	ty &= X68K_COLMAP_ROWS - 1;
+	return (m->bits[ty][tx >> 5] >> (31 - (tx & 31))) & 1;
+}
+
+static inline uint8_t x68k_colmap_slope(const X68kColMap *m, uint16_t tx,
+                                        uint16_t ty)
+{
+	if (!m->slope) return 0;
+	return m->slope[((ty & (X68K_COLMAP_ROWS - 1)) * X68K_COLMAP_COLS) +
+	                (tx & (X68K_COLMAP_COLS - 1))];
+}
+
+// Is any tile from tx0 to tx1 (inclusive) on row ty solid?
+uint8_t x68k_colmap_span_solid(const X68kColMap *m, uint16_t ty, uint16_t tx0,
+                               uint16_t tx1);
+
+// Is any tile in the box solid?
+uint8_t x68k_colmap_box_solid(const X68kColMap *m, uint16_t tx0, uint16_t ty0,
+                              uint16_t tx1, uint16_t ty1);
+
+// How many tiles a box can move horizontally (dir < 0 left, else right),
+// up to max, before its leading edge enters a solid tile.
+uint16_t x68k_colmap_sweep_x(const X68kColMap *m, uint16_t tx0, uint16_t ty0,
+                             uint16_t tx1, uint16_t ty1, int8_t dir,
+                             uint16_t max);
+
+// The same, vertically (dir < 0 up, else down).
+uint16_t x68k_colmap_sweep_y(const X68kColMap *m, uint16_t tx0, uint16_t ty0,
+                             uint16_t tx1, uint16_t ty1, int8_t dir,
+                             uint16_t max);
+
+// Walks every tile along the line between two pixel positions. Returns 1 and
+// the first solid tile if one is hit, else 0.
+uint8_t x68k_colmap_raycast(const X68kColMap *m, int16_t x0, int16_t y0,
+                            int16_t x1, int16_t y1, uint16_t *hit_tx,
+                            uint16_t *hit_ty);
+
+// Pixel-coordinate box test. w and h are at least 1.
+static inline uint8_t x68k_colmap_rect_solid_px(const X68kColMap *m,
+                                                int16_t x, int16_t y,
+                                                int16_t w, int16_t h)
+{
+	const uint8_t s = m->tile_shift;
+	return x68k_colmap_box_solid(m, x >> s, y >> s, (x + w - 1) >> s,
+	                             (y + h - 1) >> s);
+}
+
+#endif  // X68K_COLMAP_H
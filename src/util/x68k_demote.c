@@ -0,0 +1,177 @@
+#include "util/x68k_demote.h"
+#include "x68000/x68k_pcg.h"
+#include <string.h>
+
+#define DEMOTE_PRW 2
+#define DEMOTE_PATTERNS 64
+#define DEMOTE_POS_MIN -16
+#define DEMOTE_POS_MAX 480
+#define DEMOTE_BG_MASK 511  // 64 8x8 tiles
+#define DEMOTE_NT_MASK (X68K_DEMOTE_NT_COLS - 1)
+#define DEMOTE_ATTR_KEEP 0xCF00  // Flips and color
+
+void x68k_demote_init(X68kDemote *d, X68kDemoteObj *objs, uint16_t count,
+                      uint16_t frames, uint16_t blank)
+{
+	memset(d, 0, sizeof(*d));
+	d->objs = objs;
+	d->count = (count > X68K_DEMOTE_MAX_OBJS) ? X68K_DEMOTE_MAX_OBJS : count;
+	d->frames = frames;
+	d->blank = blank;
+	d->nt = (volatile uint16_t *)PCG_BG1_NAME;
+	memset(objs, 0, d->count * sizeof(*objs));
+}
+
+// Entry k of the 2x2 block at `cell`, in 8x8 pattern order: top left, bottom
+// left, top right, bottom right. Wraps around the nametable.
+static inline uint16_t demote_cell(uint16_t cell, uint8_t k)
+{
+	const uint16_t cx = (cell + (k >> 1)) & DEMOTE_NT_MASK;
+	const uint16_t cy = ((cell >> 6) + (k & 1)) & DEMOTE_NT_MASK;
+	return (cy << 6) | cx;
+}
+
+static inline uint8_t demote_on_screen(const X68kDemoteObj *o)
+{
+	return o->x >= DEMOTE_POS_MIN && o->x <= DEMOTE_POS_MAX &&
+	       o->y >= DEMOTE_POS_MIN && o->y <= DEMOTE_POS_MAX;
+}
+
+static void demote_promote(X68kDemote *d, X68kDemoteObj *o)
+{
+	for (uint8_t k = 0; k < 4; k++)
+	{
+		const uint16_t c = demote_cell(o->cell, k);
+		d->nt[c] = o->saved[k];
+		d->owner[c] = 0;
+	}
+	o->demoted = 0;
+	d->stats.demoted--;
+	d->stats.promotions++;
+	d->stats.tiles_written += 4;
+}
+
+static void demote_try(X68kDemote *d, uint16_t i)
+{
+	X68kDemoteObj *o = &d->objs[i];
+	const uint16_t cell = ((o->bg_y >> 3) << 6) | (o->bg_x >> 3);
+	for (uint8_t k = 0; k < 4; k++)
+	{
+		const uint16_t c = demote_cell(cell, k);
+		if (d->owner[c] || d->nt[c] != d->blank)
+		{
+			// Try again in another `frames` frames.
+			o->still = 0;
+			return;
+		}
+	}
+
+	// With a flip, the blocks trade places as well as being flipped.
+	const uint16_t base = ((o->attr & 0xFF) << 2) |
+	                      (o->attr & DEMOTE_ATTR_KEEP);
+	const uint8_t flip = ((o->attr & 0x4000) ? 2 : 0) |
+	                     ((o->attr & 0x8000) ? 1 : 0);
+	for (uint8_t k = 0; k < 4; k++)
+	{
+		const uint16_t c = demote_cell(cell, k);
+		o->saved[k] = d->nt[c];
+		d->nt[c] = base | (k ^ flip);
+		d->owner[c] = i + 1;
+	}
+	o->cell = cell;
+	o->demoted = 1;
+
+	X68kDemoteStats *st = &d->stats;
+	st->demoted++;
+	if (st->demoted > st->demoted_peak) st->demoted_peak = st->demoted;
+	st->demotions++;
+	st->tiles_written += 4;
+}
+
+// A PRW 2 sprite is in front of BG1, so any demoted object with a lower
+// number (which it should be behind) under it has to become a sprite again.
+static void demote_check_overlap(X68kDemote *d, uint16_t j)
+{
+	const X68kDemoteObj *o = &d->objs[j];
+	const uint16_t cx0 = o->bg_x >> 3;
+	const uint16_t cx1 = (o->bg_x + 15) >> 3;
+	const uint16_t cy0 = o->bg_y >> 3;
+	const uint16_t cy1 = (o->bg_y + 15) >> 3;
+	for (uint16_t cy = cy0; cy <= cy1; cy++)
+	{
+		for (uint16_t cx = cx0; cx <= cx1; cx++)
+		{
+			const uint16_t c = ((cy & DEMOTE_NT_MASK) << 6) |
+			                   (cx & DEMOTE_NT_MASK);
+			const uint8_t owner = d->owner[c];
+			if (!owner || owner - 1 >= j) continue;
+			X68kDemoteObj *under = &d->objs[owner - 1];
+			demote_promote(d, under);
+			under->still = 0;
+		}
+	}
+}
+
+void x68k_demote_commit(X68kDemote *d, uint16_t scroll_x, uint16_t scroll_y)
+{
+	d->stats.tiles_written = 0;
+
+	// What changed, and what has to stop being part of BG1.
+	for (uint16_t i = 0; i < d->count; i++)
+	{
+		X68kDemoteObj *o = &d->objs[i];
+		const uint16_t bg_x = (o->x + scroll_x) & DEMOTE_BG_MASK;
+		const uint16_t bg_y = (o->y + scroll_y) & DEMOTE_BG_MASK;
+		if (!o->prio || bg_x != o->bg_x || bg_y != o->bg_y ||
+		    o->attr != o->last_attr || o->prio != o->last_prio)
+		{
+			if (o->demoted) demote_promote(d, o);
+			o->bg_x = bg_x;
+			o->bg_y = bg_y;
+			o->last_attr = o->attr;
+			o->last_prio = o->prio;
+			o->still = 0;
+			continue;
+		}
+		if (o->still < 0xFFFF) o->still++;
+		if (o->demoted && !demote_on_screen(o)) demote_promote(d, o);
+	}
+
+	// Objects that have been still long enough.
+	for (uint16_t i = 0; i < d->count; i++)
+	{
+		const X68kDemoteObj *o = &d->objs[i];
+		if (o->demoted || o->still < d->frames || o->prio != DEMOTE_PRW ||
+		    (o->attr & 0xFF) >= DEMOTE_PATTERNS ||
+		    ((o->bg_x | o->bg_y) & 7) || !demote_on_screen(o))
+		{
+			continue;
+		}
+		demote_try(d, i);
+	}
+
+	// Last to first, so an object promoted here is checked in turn.
+	for (uint16_t j = d->count; j-- > 0;)
+	{
+		const X68kDemoteObj *o = &d->objs[j];
+		if (o->demoted || o->prio != DEMOTE_PRW) continue;
+		demote_check_overlap(d, j);
+	}
+
+	for (uint16_t i = 0; i < d->count; i++)
+	{
+		const X68kDemoteObj *o = &d->objs[i];
+		if (!o->prio || o->demoted) continue;
+		x68k_pcg_add_sprite(o->x, o->y, o->attr, o->prio);
+	}
+}
+
+void x68k_demote_reset(X68kDemote *d)
+{
+	for (uint16_t i = 0; i < d->count; i++)
+	{
+		X68kDemoteObj *o = &d->objs[i];
+		if (o->demoted) demote_promote(d, o);
+		o->still = 0;
+	}
+}
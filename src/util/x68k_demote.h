@@ -0,0 +1,103 @@
+/*
+
+Sprite to BG demotion for static objects (demote)
+
+Pickups, doors and decorations that sit still on the background take a
+hardware sprite each, every frame, for as long as they're on screen. This
+layer manages a set of such objects, and any that have kept the same place
+on the background, pattern and priority for `frames` frames are drawn into
+the BG1 nametable instead. Their sprite slots go back to the rest of the
+game. When one moves, changes or is hidden, its tiles are put back the way
+they were and it is a sprite again in the same frame.
+
+Each frame the game sets the objects' screen positions, attributes and
+priorities (0 hides an object) as for x68k_pcg_add_sprite(), and calls
+x68k_demote_commit() with the BG1 scroll for that frame. It queues the
+objects that are still sprites, in order, and writes the nametable. Call it
+after every other x68k_pcg_add_sprite() of the frame and right before
+x68k_pcg_finish_sprites(), so both changes land in the same vertical blank.
+
+The screen looks exactly as if every object were a sprite, which limits what
+can be demoted:
+
+* 8x8 BG tiles (256 dot modes) only; BG1 doesn't exist with 16x16 tiles.
+  The BG1 nametable is the one at PCG_BG1_NAME.
+* PRW 2 objects only (between BG0 and BG1), which is where BG1 sits.
+* Patterns 0-63, since a 16x16 sprite pattern becomes four 8x8 tiles and BG
+  tiles only reach the first 256 of those.
+* On an 8-dot boundary of BG1, and within [-16, 480] on screen, where a
+  sprite and the wrapping 512-dot BG plane show the same thing.
+* Over four BG1 entries that hold `blank`, a fully transparent tile.
+* In front of no other managed PRW 2 object still drawn as a sprite: a
+  later object (behind it in the sprite table) overlapping a demoted one
+  brings it back as a sprite.
+
+Sprites from the rest of the game are queued first, so they stay in front of
+managed objects either way.
+
+Statistics: objects demoted right now (the sprite slots saved), the peak,
+and counts of demotions, promotions back to sprites, and nametable entries
+written last frame.
+
+*/
+#ifndef X68K_DEMOTE_H
+#define X68K_DEMOTE_H
+
+#include <stdint.h>
+
+#define X68K_DEMOTE_MAX_OBJS 255
+#define X68K_DEMOTE_NT_COLS 64
+#define X68K_DEMOTE_NT_ENTRIES (X68K_DEMOTE_NT_COLS * X68K_DEMOTE_NT_COLS)
+
+typedef struct X68kDemoteObj
+{
+	// Set by the game every frame.
+	int16_t x;
+	int16_t y;
+	uint16_t attr;
+	uint16_t prio;
+
+	// Internal
+	uint16_t bg_x;       // Position on BG1 last frame
+	uint16_t bg_y;
+	uint16_t last_attr;
+	uint16_t last_prio;
+	uint16_t still;      // Frames unchanged
+	uint16_t cell;       // Top left nametable entry, while demoted
+	uint8_t demoted;
+	uint16_t saved[4];   // Entries it covers, as they were
+} X68kDemoteObj;
+
+typedef struct X68kDemoteStats
+{
+	uint16_t demoted;       // Objects in BG1 now; sprite slots saved
+	uint16_t demoted_peak;
+	uint32_t demotions;
+	uint32_t promotions;
+	uint16_t tiles_written; // Last frame
+} X68kDemoteStats;
+
+typedef struct X68kDemote
+{
+	X68kDemoteObj *objs;
+	uint16_t count;
+	uint16_t frames;  // Unchanged frames before demotion
+	uint16_t blank;   // Empty BG1 entry
+	volatile uint16_t *nt;
+	// Object number + 1 for each demoted nametable entry, 0 for none.
+	uint8_t owner[X68K_DEMOTE_NT_ENTRIES];
+	X68kDemoteStats stats;
+} X68kDemote;
+
+// Sets up `count` objects (at most X68K_DEMOTE_MAX_OBJS), all hidden.
+void x68k_demote_init(X68kDemote *d, X68kDemoteObj *objs, uint16_t count,
+                      uint16_t frames, uint16_t blank);
+
+// Queues the objects that are sprites this frame and updates BG1.
+void x68k_demote_commit(X68kDemote *d, uint16_t scroll_x, uint16_t scroll_y);
+
+// Puts every demoted object's tiles back, e.g. before BG1 is redrawn. They
+// are sprites again from the next commit.
+void x68k_demote_reset(X68kDemote *d);
+
+#endif  // X68K_DEMOTE_H
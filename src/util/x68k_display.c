@@ -1,6 +1,12 @@
-#include "util/xt_display.h"
+#include "util/x68k_display.h"
 #include "x68000/x68k_vbl.h"
-#include <iocs.h>
+
+#define VIDCON_R0 ((volatile uint16_t *)0xE82400)
+#define VIDCON_R1 ((volatile uint16_t *)0xE82500)
+#define VIDCON_R2 ((volatile uint16_t *)0xE82600)
+#define PCG_TIMING ((volatile uint16_t *)PCG_HTOTAL)
+#define PCG_CTRL ((volatile uint16_t *)PCG_BG_CTRL)
+#define PCG_CTRL_DC 0x0200
 
 static void apply_mode(const X68kDisplayMode *mode)
 {
@@ -9,14 +15,98 @@ static void apply_mode(const X68kDisplayMode *mode)
 	x68k_pcg_init(&mode->pcg);
 }
 
+static void add_write(X68kDisplayTransition *t, volatile uint16_t *reg,
+                      uint16_t from, uint16_t to, int full)
+{
+	if (!full && from == to) return;
+	t->writes[t->num_writes].reg = reg;
+	t->writes[t->num_writes].val = to;
+	t->num_writes++;
+}
+
+// Works out the writes to go from one mode to another. With from == NULL,
+// every register is written.
+static void build_transition(const X68kDisplayMode *from,
+                             const X68kDisplayMode *to,
+                             X68kDisplayTransition *t)
+{
+	const int full = (from == 0);
+	if (full) from = to;
+
+	const uint16_t *crtc_from = &from->crtc.htotal;
+	const uint16_t *crtc_to = &to->crtc.htotal;
+	volatile uint16_t *crtc_reg = CRTC_BASE;
+
+	// R20 leads the timing registers when moving up in resolution.
+	const int r20_first = !full &&
+	                      ((to->crtc.flags & 0x1F) > (from->crtc.flags & 0x1F));
+
+	t->num_writes = 0;
+	if (r20_first)
+	{
+		add_write(t, &crtc_reg[20], from->crtc.flags, to->crtc.flags, full);
+		add_write(t, VIDCON_R0, from->vidcon.screen, to->vidcon.screen, full);
+	}
+	for (uint16_t i = 0; i <= 8; i++)
+	{
+		add_write(t, &crtc_reg[i], crtc_from[i], crtc_to[i], full);
+	}
+	if (!r20_first)
+	{
+		add_write(t, &crtc_reg[20], from->crtc.flags, to->crtc.flags, full);
+		add_write(t, VIDCON_R0, from->vidcon.screen, to->vidcon.screen, full);
+	}
+	add_write(t, VIDCON_R1, from->vidcon.prio, to->vidcon.prio, full);
+	add_write(t, VIDCON_R2, from->vidcon.flags, to->vidcon.flags, full);
+
+	t->pcg_start = t->num_writes;
+	add_write(t, &PCG_TIMING[0], from->pcg.htotal, to->pcg.htotal, full);
+	add_write(t, &PCG_TIMING[1], from->pcg.hdisp, to->pcg.hdisp, full);
+	add_write(t, &PCG_TIMING[2], from->pcg.vdisp, to->pcg.vdisp, full);
+	add_write(t, &PCG_TIMING[3], from->pcg.flags, to->pcg.flags, full);
+}
+
+// With `trace`, the PCG control register is read back after each write, for
+// x68k_display_check_transitions(). The normal path passes NULL.
+static inline void apply_transition(const X68kDisplayTransition *t,
+                                    uint16_t *trace)
+{
+	const X68kDisplayWrite *w = t->writes;
+	uint8_t i = 0;
+	for (; i < t->pcg_start; i++)
+	{
+		*w[i].reg = w[i].val;
+		if (trace) trace[i] = *PCG_CTRL;
+	}
+	if (i >= t->num_writes) return;
+
+	x68k_pcg_set_disp_en(0);
+	for (; i < t->num_writes; i++)
+	{
+		*w[i].reg = w[i].val;
+		if (trace) trace[i] = *PCG_CTRL;
+	}
+	x68k_pcg_set_disp_en(1);
+}
+
 // Initialize with a list of display modes. Mode 0 is applied to the video
 // chipset.
 void x68k_display_init(X68kDisplay *d, const X68kDisplayMode **modes,
-                     int16_t num_modes)
+                       int num_modes)
 {
+	if (num_modes > X68K_DISPLAY_MAX_MODES) num_modes = X68K_DISPLAY_MAX_MODES;
 	d->modes = modes;
 	d->num_modes = num_modes;
 	d->current_mode = 0;
+	d->pending_mode = -1;
+
+	for (int i = 0; i < num_modes; i++)
+	{
+		for (int j = 0; j < num_modes; j++)
+		{
+			build_transition(modes[i], modes[j], &d->transitions[i][j]);
+		}
+	}
 
 	apply_mode(d->modes[0]);
 }
@@ -26,13 +116,141 @@ const X68kDisplayMode *x68k_display_get_mode(const X68kDisplay *d)
 	return d->modes[d->current_mode];
 }
 
+static void switch_mode(X68kDisplay *d, int idx)
+{
+	apply_transition(&d->transitions[d->current_mode][idx], 0);
+	d->current_mode = idx;
+}
+
 // Go to the next display mode.
 void x68k_display_cycle_mode(X68kDisplay *d)
 {
-	d->current_mode++;
-	if (d->current_mode >= d->num_modes)
+	int next = d->current_mode + 1;
+	if (next >= d->num_modes)
 	{
-		d->current_mode = 0;
+		next = 0;
+	}
+	// Catch the leading edge of blanking to have all of it to work with.
+	x68k_vbl_wait_for_vdisp();
+	x68k_vbl_wait_for_vblank();
+	switch_mode(d, next);
+}
+
+void x68k_display_request_mode(X68kDisplay *d, int idx)
+{
+	if (idx < 0 || idx >= d->num_modes) return;
+	d->pending_mode = idx;
+}
+
+void x68k_display_vblank(X68kDisplay *d)
+{
+	const int idx = d->pending_mode;
+	if (idx < 0) return;
+	d->pending_mode = -1;
+	switch_mode(d, idx);
+}
+
+// Check =====================================================================
+
+// Register slots for the check, in the order a mode set writes them.
+#define CHECK_R00 0
+#define CHECK_R20 9
+#define CHECK_VC_R0 10
+#define CHECK_PCG 13
+
+static volatile uint16_t *check_reg(int k)
+{
+	volatile uint16_t *crtc_reg = CRTC_BASE;
+	if (k < CHECK_R20) return &crtc_reg[k];
+	if (k == CHECK_R20) return &crtc_reg[20];
+	if (k < CHECK_PCG) return VIDCON_R0 + 0x80 * (k - CHECK_VC_R0);
+	return &PCG_TIMING[k - CHECK_PCG];
+}
+
+static int check_slot(volatile uint16_t *reg)
+{
+	for (int k = 0; k < X68K_DISPLAY_MAX_WRITES; k++)
+	{
+		if (check_reg(k) == reg) return k;
+	}
+	return -1;
+}
+
+static void check_read(uint16_t *regs)
+{
+	for (int k = 0; k < X68K_DISPLAY_MAX_WRITES; k++) regs[k] = *check_reg(k);
+}
+
+// Write order for one transition: every write is to a register that changes,
+// once; R20 goes before R00-R08 moving up and after them moving down, with
+// vidcon R0 right behind it; PCG writes come last, with PCG display off.
+static int check_order(const X68kDisplayTransition *t, const uint16_t *from,
+                       const uint16_t *want, const uint16_t *trace)
+{
+	int slot[X68K_DISPLAY_MAX_WRITES];
+	int p20 = -1;
+	int pvc = -1;
+	uint32_t seen = 0;
+	for (int i = 0; i < t->num_writes; i++)
+	{
+		const int k = check_slot(t->writes[i].reg);
+		if (k < 0 || (seen & (1UL << k)) || from[k] == want[k]) return 0;
+		seen |= 1UL << k;
+		slot[i] = k;
+		if (k == CHECK_R20) p20 = i;
+		if (k == CHECK_VC_R0) pvc = i;
+	}
+
+	const int up = (want[CHECK_R20] & 0x1F) > (from[CHECK_R20] & 0x1F);
+	if (p20 >= 0 && pvc >= 0 && pvc != p20 + 1) return 0;
+
+	int pcg = 0;
+	for (int i = 0; i < t->num_writes; i++)
+	{
+		const int k = slot[i];
+		if (k >= CHECK_PCG)
+		{
+			if (trace[i] & PCG_CTRL_DC) return 0;
+			pcg = 1;
+			continue;
+		}
+		if (pcg) return 0;
+		if (k >= CHECK_R20 || p20 < 0) continue;
+		if (up ? (i < p20) : (i > p20)) return 0;
+	}
+	return 1;
+}
+
+int x68k_display_check_transitions(const X68kDisplay *d)
+{
+	int bad = 0;
+	for (int i = 0; i < d->num_modes; i++)
+	{
+		for (int j = 0; j < d->num_modes; j++)
+		{
+			uint16_t want[X68K_DISPLAY_MAX_WRITES];
+			uint16_t from[X68K_DISPLAY_MAX_WRITES];
+			uint16_t got[X68K_DISPLAY_MAX_WRITES];
+			uint16_t trace[X68K_DISPLAY_MAX_WRITES];
+
+			apply_mode(d->modes[j]);
+			check_read(want);
+			apply_mode(d->modes[i]);
+			check_read(from);
+
+			const X68kDisplayTransition *t = &d->transitions[i][j];
+			apply_transition(t, trace);
+			check_read(got);
+
+			int ok = check_order(t, from, want, trace) &&
+			         (*PCG_CTRL & PCG_CTRL_DC);
+			for (int k = 0; k < X68K_DISPLAY_MAX_WRITES; k++)
+			{
+				if (got[k] != want[k]) ok = 0;
+			}
+			if (!ok) bad++;
+		}
 	}
 	apply_mode(d->modes[d->current_mode]);
+	return bad;
 }
@@ -1,4 +1,21 @@
 // Utility functions for display mode management.
+//
+// On init, the register writes needed to go from each registered mode to each
+// other one are worked out ahead of time, leaving out any register that holds
+// the same value in both. Switching modes then only replays that list during
+// vertical blank, ordered so that the CRTC, video controller and PCG never
+// disagree for longer than they have to:
+//
+// * Going to a higher resolution / scan rate, CRTC R20 is written before the
+//   timing registers R00-R08; going to a lower one, it is written after them
+//   (Inside X68000).
+// * Video controller R0 mirrors bits 8-10 of R20, so it follows R20 directly.
+// * PCG timing and mode registers follow the CRTC, with PCG display turned off
+//   while they change.
+//
+// Mode changes can either be made on the spot with x68k_display_cycle_mode(),
+// which waits for blanking, or requested with x68k_display_request_mode() and
+// applied by x68k_display_vblank() from the vertical blank handler.
 #ifndef X68K_DISPLAY_H
 #define X68K_DISPLAY_H
 
@@ -8,6 +25,13 @@
 #include "x68000/x68k_crtc.h"
 #include "x68000/x68k_vidcon.h"
 
+#ifndef X68K_DISPLAY_MAX_MODES
+#define X68K_DISPLAY_MAX_MODES 4
+#endif
+
+// R00-R08 and R20, vidcon R0-R2, and the four PCG timing/mode registers.
+#define X68K_DISPLAY_MAX_WRITES 17
+
 typedef struct X68kDisplayMode
 {
 	X68kCrtcConfig crtc;
@@ -15,22 +39,55 @@ typedef struct X68kDisplayMode
 	X68kVidconConfig vidcon;
 } X68kDisplayMode;
 
+typedef struct X68kDisplayWrite
+{
+	volatile uint16_t *reg;
+	uint16_t val;
+} X68kDisplayWrite;
+
+typedef struct X68kDisplayTransition
+{
+	X68kDisplayWrite writes[X68K_DISPLAY_MAX_WRITES];
+	uint8_t num_writes;
+	// Index of the first PCG write; PCG display is off from there to the end.
+	uint8_t pcg_start;
+} X68kDisplayTransition;
+
 typedef struct X68kDisplay
 {
 	const X68kDisplayMode **modes;
 	int num_modes;
 	int current_mode;
+	volatile int pending_mode;  // -1 if none
+	X68kDisplayTransition transitions[X68K_DISPLAY_MAX_MODES]
+	                                 [X68K_DISPLAY_MAX_MODES];
 } X68kDisplay;
 
 // Initialize with a list of display modes. Mode 0 is applied to the video
-// chipset.
+// chipset. At most X68K_DISPLAY_MAX_MODES are used.
 void x68k_display_init(X68kDisplay *d, const X68kDisplayMode **modes,
                        int num_modes);
 
 // Get the current display mode information.
 const X68kDisplayMode *x68k_display_get_mode(const X68kDisplay *d);
 
-// Go to the next display mode.
+// Go to the next display mode. Waits for the start of vertical blank.
 void x68k_display_cycle_mode(X68kDisplay *d);
 
+// Queue a switch to mode `idx`, to be made by x68k_display_vblank().
+void x68k_display_request_mode(X68kDisplay *d, int idx);
+
+// Apply a pending mode switch, if there is one. Call during vertical blank.
+void x68k_display_vblank(X68kDisplay *d);
+
+// Checks every precomputed transition: for each pair of modes, the registers
+// a full mode set writes are captured, the first mode is set, the transition
+// is applied, and the result must match the capture. The write order is
+// checked against the rules above as well. Returns the number of transitions
+// that fail, and leaves the current mode set.
+//
+// This reads the video registers back, so it only means something where they
+// read back as written: on the host, as tools/dispcheck runs it.
+int x68k_display_check_transitions(const X68kDisplay *d);
+
 #endif  // X68K_DISPLAY.H
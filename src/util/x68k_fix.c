@@ -0,0 +1,112 @@
+#include "util/x68k_fix.h"
+
+// sin(i / 1024 turn) in 2.14, for the first quarter turn.
+const int16_t g_x68k_fix_sin_quarter[X68K_FIX_QUARTER + 1] =
+{
+	0, 101, 201, 302, 402, 503, 603, 704, 804, 904,
+	1005, 1105, 1205, 1306, 1406, 1506, 1606, 1706, 1806, 1906,
+	2006, 2105, 2205, 2305, 2404, 2503, 2603, 2702, 2801, 2900,
+	2999, 3098, 3196, 3295, 3393, 3492, 3590, 3688, 3786, 3883,
+	3981, 4078, 4176, 4273, 4370, 4467, 4563, 4660, 4756, 4852,
+	4948, 5044, 5139, 5235, 5330, 5425, 5520, 5614, 5708, 5803,
+	5897, 5990, 6084, 6177, 6270, 6363, 6455, 6547, 6639, 6731,
+	6823, 6914, 7005, 7096, 7186, 7276, 7366, 7456, 7545, 7635,
+	7723, 7812, 7900, 7988, 8076, 8163, 8250, 8337, 8423, 8509,
+	8595, 8680, 8765, 8850, 8935, 9019, 9102, 9186, 9269, 9352,
+	9434, 9516, 9598, 9679, 9760, 9841, 9921, 10001, 10080, 10159,
+	10238, 10316, 10394, 10471, 10549, 10625, 10702, 10778, 10853, 10928,
+	11003, 11077, 11151, 11224, 11297, 11370, 11442, 11514, 11585, 11656,
+	11727, 11797, 11866, 11935, 12004, 12072, 12140, 12207, 12274, 12340,
+	12406, 12472, 12537, 12601, 12665, 12729, 12792, 12854, 12916, 12978,
+	13039, 13100, 13160, 13219, 13279, 13337, 13395, 13453, 13510, 13567,
+	13623, 13678, 13733, 13788, 13842, 13896, 13949, 14001, 14053, 14104,
+	14155, 14206, 14256, 14305, 14354, 14402, 14449, 14497, 14543, 14589,
+	14635, 14680, 14724, 14768, 14811, 14854, 14896, 14937, 14978, 15019,
+	15059, 15098, 15137, 15175, 15213, 15250, 15286, 15322, 15357, 15392,
+	15426, 15460, 15493, 15525, 15557, 15588, 15619, 15649, 15679, 15707,
+	15736, 15763, 15791, 15817, 15843, 15868, 15893, 15917, 15941, 15964,
+	15986, 16008, 16029, 16049, 16069, 16088, 16107, 16125, 16143, 16160,
+	16176, 16192, 16207, 16221, 16235, 16248, 16261, 16273, 16284, 16295,
+	16305, 16315, 16324, 16332, 16340, 16347, 16353, 16359, 16364, 16369,
+	16373, 16376, 16379, 16381, 16383, 16384, 16384,
+};
+
+// atan(i / 256) in angle units, for slopes 0 to 1 (the first octant).
+static const uint8_t s_atan_octant[257] =
+{
+	0, 1, 1, 2, 3, 3, 4, 4, 5, 6, 6, 7, 8, 8, 9, 10,
+	10, 11, 11, 12, 13, 13, 14, 15, 15, 16, 16, 17, 18, 18, 19, 20,
+	20, 21, 22, 22, 23, 23, 24, 25, 25, 26, 27, 27, 28, 28, 29, 30,
+	30, 31, 31, 32, 33, 33, 34, 34, 35, 36, 36, 37, 38, 38, 39, 39,
+	40, 41, 41, 42, 42, 43, 44, 44, 45, 45, 46, 46, 47, 48, 48, 49,
+	49, 50, 51, 51, 52, 52, 53, 53, 54, 55, 55, 56, 56, 57, 57, 58,
+	58, 59, 60, 60, 61, 61, 62, 62, 63, 63, 64, 65, 65, 66, 66, 67,
+	67, 68, 68, 69, 69, 70, 70, 71, 71, 72, 72, 73, 74, 74, 75, 75,
+	76, 76, 77, 77, 78, 78, 79, 79, 80, 80, 81, 81, 82, 82, 83, 83,
+	84, 84, 84, 85, 85, 86, 86, 87, 87, 88, 88, 89, 89, 90, 90, 91,
+	91, 91, 92, 92, 93, 93, 94, 94, 95, 95, 96, 96, 96, 97, 97, 98,
+	98, 99, 99, 99, 100, 100, 101, 101, 102, 102, 102, 103, 103, 104, 104, 104,
+	105, 105, 106, 106, 106, 107, 107, 108, 108, 108, 109, 109, 110, 110, 110, 111,
+	111, 112, 112, 112, 113, 113, 113, 114, 114, 115, 115, 115, 116, 116, 116, 117,
+	117, 118, 118, 118, 119, 119, 119, 120, 120, 120, 121, 121, 121, 122, 122, 122,
+	123, 123, 123, 124, 124, 124, 125, 125, 125, 126, 126, 126, 127, 127, 127, 128,
+	128,
+};
+
+uint16_t x68k_fix_atan2(int16_t y, int16_t x)
+{
+	if (!x && !y) return 0;
+
+	// Fold into the first octant, remembering how to unfold.
+	const uint8_t neg_x = x < 0;
+	const uint8_t neg_y = y < 0;
+	uint16_t ax = neg_x ? -x : x;
+	uint16_t ay = neg_y ? -y : y;
+	const uint8_t steep = ay > ax;
+	if (steep)
+	{
+		const uint16_t t = ax;
+		ax = ay;
+		ay = t;
+	}
+
+	// The slope in 0.8, rounded to nearest. It is at most 256, so one divu.w
+	// does it; in C this would be a 32-bit divide, which is a library call.
+	uint32_t slope = ((uint32_t)ay << 8) + (ax >> 1);
+	__asm__ ("divu.w %1, %0" : "+d" (slope) : "dm" (ax) : "cc");
+	slope &= 0xFFFF;
+	uint16_t angle = s_atan_octant[slope];
+
+	if (steep) angle = X68K_FIX_QUARTER - angle;
+	if (neg_x) angle = (X68K_FIX_ANGLES / 2) - angle;
+	if (neg_y) angle = X68K_FIX_ANGLES - angle;
+	return angle & X68K_FIX_ANGLE_MASK;
+}
+
+// Batches ===================================================================
+
+void x68k_fix_bodies_step(X68kFixBodies *b)
+{
+	X68kFix16 *x = b->x;
+	X68kFix16 *y = b->y;
+	const X68kFix16 *vx = b->vx;
+	const X68kFix16 *vy = b->vy;
+	// Separate passes keep two pointers live per loop, all in registers.
+	for (uint16_t n = b->count; n > 0; n--) *x++ += *vx++;
+	for (uint16_t n = b->count; n > 0; n--) *y++ += *vy++;
+}
+
+void x68k_fix_bodies_accel(X68kFixBodies *b, X68kFix16 ax, X68kFix16 ay)
+{
+	X68kFix16 *vx = b->vx;
+	X68kFix16 *vy = b->vy;
+	for (uint16_t n = b->count; n > 0; n--) *vx++ += ax;
+	for (uint16_t n = b->count; n > 0; n--) *vy++ += ay;
+}
+
+// PCG coordinates ===========================================================
+
+void x68k_fix16_to_pcg_n(const X68kFix16 *v, uint16_t *out, uint16_t n)
+{
+	while (n--) *out++ = x68k_fix16_to_pcg(*v++);
+}
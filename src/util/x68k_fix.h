@@ -0,0 +1,160 @@
+/*
+
+Fixed-point math (fix)
+
+Subpixel positions, velocities and angles, built around the 68000's 16 x 16
+-> 32 bit muls/mulu so nothing needs a 32-bit multiply routine.
+
+Formats:
+
+	X68kFix8    8.8 in an int16_t. Speeds, small offsets, scale factors.
+	X68kFix16   16.16 in an int32_t. Positions, and velocities that get
+	            added to them every frame.
+	Angles      uint16_t, X68K_FIX_ANGLES (1024) to a full turn, counting
+	            clockwise on screen from +X. Only the low 10 bits are used,
+	            so angles wrap for free.
+	Sine        2.14 (X68K_FIX_ONE_14 is 1.0), from a quarter-wave table.
+
+x68k_fix_atan2() folds a vector into the first octant, does one divu to get
+the slope, rounded to 1/256, and reads the angle from a 257-entry table. The
+result is within 0.82 of an angle step of the exact angle.
+
+X68kFixBodies keeps positions and velocities as separate arrays (struct of
+arrays), so x68k_fix_bodies_step() advances any number of objects with a
+tight add loop that never touches the rest of each object.
+
+x68k_fix16_to_pcg() converts a position to sprite table coordinates,
+including the 16 pixel offset that x68k_pcg_set_sprite() adds.
+
+*/
+#ifndef X68K_FIX_H
+#define X68K_FIX_H
+
+#include <stdint.h>
+
+typedef int16_t X68kFix8;
+typedef int32_t X68kFix16;
+
+#define X68K_FIX8(n) ((X68kFix8)((n) * 256))
+#define X68K_FIX16(n) ((X68kFix16)((n) * 65536))
+#define X68K_FIX_ONE_14 16384
+
+#define X68K_FIX_ANGLES 1024
+#define X68K_FIX_ANGLE_MASK (X68K_FIX_ANGLES - 1)
+#define X68K_FIX_QUARTER (X68K_FIX_ANGLES / 4)
+
+typedef struct X68kVec8
+{
+	X68kFix8 x;
+	X68kFix8 y;
+} X68kVec8;
+
+typedef struct X68kVec16
+{
+	X68kFix16 x;
+	X68kFix16 y;
+} X68kVec16;
+
+// Multiplies ================================================================
+
+// 8.8 x 8.8 -> 8.8; a single muls.
+static inline X68kFix8 x68k_fix8_mul(X68kFix8 a, X68kFix8 b)
+{
+	return ((int32_t)a * b) >> 8;
+}
+
+// 16.16 x 8.8 -> 16.16, as two muls. The fraction is cut to 15 bits so it
+// fits a signed multiply.
+static inline X68kFix16 x68k_fix16_mul8(X68kFix16 a, X68kFix8 b)
+{
+	const int16_t hi = a >> 16;
+	const int16_t lo = (a & 0xFFFF) >> 1;
+	return ((int32_t)hi * b << 8) + (((int32_t)lo * b) >> 7);
+}
+
+static inline X68kFix16 x68k_fix8_to_16(X68kFix8 v)
+{
+	return (X68kFix16)v << 8;
+}
+
+static inline int16_t x68k_fix16_int(X68kFix16 v)
+{
+	return v >> 16;
+}
+
+// Trigonometry ==============================================================
+
+extern const int16_t g_x68k_fix_sin_quarter[X68K_FIX_QUARTER + 1];
+
+// 2.14
+static inline int16_t x68k_fix_sin(uint16_t angle)
+{
+	angle &= X68K_FIX_ANGLE_MASK;
+	const uint16_t q = angle & (X68K_FIX_QUARTER - 1);
+	switch (angle >> 8)
+	{
+		default:
+		case 0: return g_x68k_fix_sin_quarter[q];
+		case 1: return g_x68k_fix_sin_quarter[X68K_FIX_QUARTER - q];
+		case 2: return -g_x68k_fix_sin_quarter[q];
+		case 3: return -g_x68k_fix_sin_quarter[X68K_FIX_QUARTER - q];
+	}
+}
+
+static inline int16_t x68k_fix_cos(uint16_t angle)
+{
+	return x68k_fix_sin(angle + X68K_FIX_QUARTER);
+}
+
+// Angle of (x, y), 0 - 1023. (0, 0) gives 0.
+uint16_t x68k_fix_atan2(int16_t y, int16_t x);
+
+// A vector `length` (8.8) long at `angle`, as a 16.16 velocity.
+static inline X68kVec16 x68k_fix_polar(uint16_t angle, X68kFix8 length)
+{
+	X68kVec16 ret;
+	ret.x = ((int32_t)x68k_fix_cos(angle) * length) >> 6;
+	ret.y = ((int32_t)x68k_fix_sin(angle) * length) >> 6;
+	return ret;
+}
+
+// Rotates an 8.8 vector.
+static inline X68kVec8 x68k_fix_rotate(X68kVec8 v, uint16_t angle)
+{
+	const int16_t s = x68k_fix_sin(angle);
+	const int16_t c = x68k_fix_cos(angle);
+	X68kVec8 ret;
+	ret.x = ((int32_t)v.x * c - (int32_t)v.y * s) >> 14;
+	ret.y = ((int32_t)v.x * s + (int32_t)v.y * c) >> 14;
+	return ret;
+}
+
+// Batches ===================================================================
+
+typedef struct X68kFixBodies
+{
+	X68kFix16 *x;
+	X68kFix16 *y;
+	X68kFix16 *vx;
+	X68kFix16 *vy;
+	uint16_t count;
+} X68kFixBodies;
+
+// Adds each velocity to its position.
+void x68k_fix_bodies_step(X68kFixBodies *b);
+
+// Adds an acceleration to every velocity (e.g. gravity).
+void x68k_fix_bodies_accel(X68kFixBodies *b, X68kFix16 ax, X68kFix16 ay);
+
+// PCG coordinates ===========================================================
+
+// Sprite table coordinate for a 16.16 screen position.
+static inline uint16_t x68k_fix16_to_pcg(X68kFix16 v)
+{
+	return ((v >> 16) + 16) & 0x3FF;
+}
+
+// Converts `n` positions into sprite table coordinates.
+void x68k_fix16_to_pcg_n(const X68kFix16 *v, uint16_t *out, uint16_t n);
+
+#endif  // X68K_FIX_H
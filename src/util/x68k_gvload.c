@@ -0,0 +1,164 @@
+#include "util/x68k_gvload.h"
+#include "x68000/x68k_cpu.h"
+#include "x68000/x68k_crtc.h"
+#include <dos.h>
+#include <string.h>
+
+#define GVLOAD_HEADER_SIZE 16
+#define GVLOAD_MAGIC 0x58473136  // 'XG16'
+#define GVLOAD_VERSION 1
+#define GVLOAD_PITCH 512  // Words per GVRAM line
+
+static int gvload_read(X68kGvLoad *l, void *dst, uint32_t len)
+{
+	const int ret = _dos_read(l->fd, (char *)dst, len);
+	if (ret < 0) return ret;
+	return ((uint32_t)ret == len) ? 0 : -1;
+}
+
+// Most compressed input a line can take: all literals, a token every 127
+// bytes, and the rest of a match token started on the line before.
+static uint32_t gvload_lz_worst(const X68kGvLoad *l)
+{
+	const uint32_t line_bytes = (uint32_t)l->w * 2;
+	return line_bytes + line_bytes / 127 + 4;
+}
+
+int x68k_gvload_open(X68kGvLoad *l, const char *path, uint16_t x, uint16_t y,
+                     uint8_t *buf, uint32_t buf_size, X68kLzStream *lz)
+{
+	uint32_t header[GVLOAD_HEADER_SIZE / 4];
+
+	l->fd = _dos_open(path, 0);
+	if (l->fd < 0) return l->fd;
+	l->buf = buf;
+	l->buf_size = buf_size;
+	l->lz = lz;
+	l->line = 0;
+	l->data_read = 0;
+	l->buf_end = buf;
+
+	int ret = gvload_read(l, header, sizeof(header));
+	const uint16_t version = header[1] >> 16;
+	l->flags = header[1] & 0xFFFF;
+	l->w = header[2] >> 16;
+	l->h = header[2] & 0xFFFF;
+	if (!ret && (header[0] != GVLOAD_MAGIC || version != GVLOAD_VERSION ||
+	             !l->w || !l->h || x + l->w > GVLOAD_PITCH ||
+	             y + l->h > GVLOAD_PITCH))
+	{
+		ret = -1;
+	}
+
+	if (!ret && (l->flags & X68K_GVLOAD_FLAG_LZ))
+	{
+		// The compressed size is whatever follows the header.
+		const int end = _dos_seek(l->fd, 0, 2);
+		l->data_size = end - GVLOAD_HEADER_SIZE;
+		if (end < 0) ret = end;
+		else if (!lz || end < GVLOAD_HEADER_SIZE ||
+		         gvload_lz_worst(l) + 4 > buf_size)
+		{
+			ret = -1;
+		}
+		else
+		{
+			ret = _dos_seek(l->fd, GVLOAD_HEADER_SIZE, 0);
+			if (ret > 0) ret = 0;
+		}
+	}
+	else if (!ret && (uint32_t)l->w * 2 > buf_size)
+	{
+		ret = -1;
+	}
+	if (ret)
+	{
+		x68k_gvload_close(l);
+		return ret;
+	}
+
+	l->dst = (volatile uint16_t *)GVRAM_BASE + (uint32_t)y * GVLOAD_PITCH + x;
+	return 0;
+}
+
+void x68k_gvload_close(X68kGvLoad *l)
+{
+	if (l->fd >= 0) _dos_close(l->fd);
+	l->fd = -1;
+}
+
+static int gvload_step_raw(X68kGvLoad *l, uint16_t lines)
+{
+	const uint32_t line_bytes = (uint32_t)l->w * 2;
+	const uint16_t fit = l->buf_size / line_bytes;
+	if (lines > fit) lines = fit;
+
+	const int ret = gvload_read(l, l->buf, lines * line_bytes);
+	if (ret) return ret;
+	const uint16_t *src = (const uint16_t *)l->buf;
+	for (uint16_t i = 0; i < lines; i++)
+	{
+		g_x68k_cpu->copy(l->dst, src, line_bytes);
+		src += l->w;
+		l->dst += GVLOAD_PITCH;
+	}
+	l->line += lines;
+	return 0;
+}
+
+static int gvload_step_lz(X68kGvLoad *l, uint16_t lines)
+{
+	const uint16_t line_bytes = l->w * 2;
+	const uint32_t worst = gvload_lz_worst(l);
+	const uint16_t fit = (l->buf_size - 4) / worst;
+	if (lines > fit) lines = fit;
+	X68kLzStream *s = l->lz;
+
+	// Have enough in the buffer for every line of this step, moving what's
+	// left to the front if the rest won't fit after it. The stream is set up
+	// once its size (the first 4 bytes) is in.
+	const uint8_t *src = l->line ? s->src : l->buf;
+	const uint32_t want = worst * lines + (l->line ? 0 : 4);
+	const uint32_t have = l->buf_end - src;
+	if (have < want && l->data_read < l->data_size)
+	{
+		if (src + want > l->buf + l->buf_size)
+		{
+			memmove(l->buf, src, have);
+			l->buf_end = l->buf + have;
+			s->src = l->buf;
+		}
+		uint32_t len = want - have;
+		if (len > l->data_size - l->data_read)
+		{
+			len = l->data_size - l->data_read;
+		}
+		const int ret = gvload_read(l, l->buf_end, len);
+		if (ret) return ret;
+		l->buf_end += len;
+		l->data_read += len;
+	}
+	if (!l->line) x68k_lz_stream_init(s, l->buf, l->dst, X68K_LZ_WORD);
+
+	for (uint16_t i = 0; i < lines; i++)
+	{
+		x68k_lz_stream_run(s, line_bytes);
+		l->dst += GVLOAD_PITCH;
+		s->dst = (volatile uint8_t *)l->dst;
+	}
+	l->line += lines;
+	return 0;
+}
+
+int x68k_gvload_step(X68kGvLoad *l, uint16_t max_lines)
+{
+	uint16_t lines = l->h - l->line;
+	if (lines > max_lines) lines = max_lines;
+	if (lines)
+	{
+		const int ret = (l->flags & X68K_GVLOAD_FLAG_LZ) ?
+		                gvload_step_lz(l, lines) : gvload_step_raw(l, lines);
+		if (ret) return ret;
+	}
+	return (l->line >= l->h) ? 1 : 0;
+}
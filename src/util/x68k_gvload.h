@@ -0,0 +1,82 @@
+/*
+
+65536 color image loader (gvload)
+
+Streams a full color image from disk into the graphic screen a few lines at a
+time, so a loading screen can keep its music and animation going while a
+512 x 512 picture comes in. Convert images with tools/gvconv.
+
+The graphic screen has to be in 65536 color mode (CRTC R20 and vidcon screen
+color depth 3), where GVRAM_BASE is a single 512 x 512 page and each pixel is
+one word in the palette format:
+
+	GGGG GRRR RRBB BBBI   5 bits each of green, red and blue, and an
+	                      intensity bit that adds half a step to all three
+
+File layout (big-endian):
+
+	$00  'XG16'
+	$04  Version (1)
+	$06  Flags (X68K_GVLOAD_FLAG_*)
+	$08  Width, 1 - 512
+	$0A  Height, 1 - 512
+	$0C  Reserved
+	$10  Pixels, a line at a time with no padding; with X68K_GVLOAD_FLAG_LZ,
+	     an x68k_lz stream of them instead
+
+x68k_gvload_step() writes at most `max_lines` lines per call, so calling it
+once a frame bounds both the disk read and the copy:
+
+* Uncompressed images are read straight into the staging buffer, as many
+  lines as fit (at most `max_lines`), and copied to GVRAM with the g_x68k_cpu
+  copy kernel.
+* Compressed images are decoded into GVRAM with an X68kLzStream, from a
+  staging buffer that is topped up with as much as the step's lines can
+  take. What the stream hasn't reached yet is moved back to the start of the
+  buffer when the rest wouldn't fit after it. The buffer needs room for one
+  line's worst case, 2 * w + 2 * w / 127 + 8 bytes, and more lets a step
+  decode more lines.
+
+The staging buffer and stream are provided by the caller; the buffer must be
+word-aligned.
+
+*/
+#ifndef X68K_GVLOAD_H
+#define X68K_GVLOAD_H
+
+#include <stdint.h>
+
+#include "util/x68k_lz.h"
+
+#define X68K_GVLOAD_FLAG_LZ 0x0001
+
+typedef struct X68kGvLoad
+{
+	int fd;
+	uint16_t w;
+	uint16_t h;
+	uint16_t flags;
+	uint16_t line;           // Lines written so far
+	volatile uint16_t *dst;  // Start of the next line
+	uint8_t *buf;
+	uint32_t buf_size;
+	X68kLzStream *lz;        // Only for compressed images
+	uint32_t data_size;      // Compressed size
+	uint32_t data_read;      // Compressed bytes read so far
+	uint8_t *buf_end;        // End of the compressed bytes in buf
+} X68kGvLoad;
+
+// Opens an image to be placed with its top left corner at (x, y). `lz` may be
+// NULL if the image isn't compressed. Returns a negative DOS error code, or -1
+// if the file isn't an image, doesn't fit on the screen or doesn't fit in the
+// staging buffer.
+int x68k_gvload_open(X68kGvLoad *l, const char *path, uint16_t x, uint16_t y,
+                     uint8_t *buf, uint32_t buf_size, X68kLzStream *lz);
+
+// Writes up to `max_lines` more lines. Returns 1 once the image is complete,
+// 0 while more remains, or a negative error code.
+int x68k_gvload_step(X68kGvLoad *l, uint16_t max_lines);
+
+void x68k_gvload_close(X68kGvLoad *l);
+
+#endif  // X68K_GVLOAD_H
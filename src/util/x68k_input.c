@@ -0,0 +1,175 @@
+#include "util/x68k_input.h"
+#include "irq.h"
+#include <iocs.h>
+
+typedef enum InputMode
+{
+	INPUT_MODE_LIVE,
+	INPUT_MODE_RECORD,
+	INPUT_MODE_REPLAY,
+} InputMode;
+
+// Both pads, port 0 in the upper byte, written as one word so the update
+// never sees half of a sample.
+static volatile uint16_t s_latched;
+static uint16_t s_raster_line;
+static uint16_t s_key_groups;
+
+static X68kInputFrame s_cur;
+static X68kInputFrame s_prev;
+
+static uint8_t s_history[X68K_INPUT_HISTORY][2];
+static uint8_t s_history_pos;
+
+static InputMode s_mode;
+static X68kInputFrame *s_rec_frames;
+static const X68kInputFrame *s_play_frames;
+static uint16_t s_rec_len;
+static uint16_t s_rec_pos;
+
+int x68k_input_init(uint16_t raster_line, uint16_t key_groups)
+{
+	s_raster_line = 0;
+	s_key_groups = key_groups;
+	s_mode = INPUT_MODE_LIVE;
+	s_latched = 0;
+	s_history_pos = 0;
+	for (uint8_t i = 0; i < X68K_INPUT_HISTORY; i++)
+	{
+		s_history[i][0] = 0;
+		s_history[i][1] = 0;
+	}
+	for (uint8_t i = 0; i < X68K_INPUT_KEY_GROUPS; i++)
+	{
+		s_cur.key[i] = 0;
+		s_prev.key[i] = 0;
+	}
+	s_cur.pad[0] = s_cur.pad[1] = 0;
+	s_prev.pad[0] = s_prev.pad[1] = 0;
+
+	if (!raster_line) return 0;
+	// Only claim the raster once it's ours; until then update samples itself.
+	const int ret = _iocs_crtcras(g_irq_input_raster, raster_line);
+	if (!ret) s_raster_line = raster_line;
+	return ret;
+}
+
+void x68k_input_shutdown(void)
+{
+	if (s_raster_line) _iocs_crtcras(0, 0);
+	s_raster_line = 0;
+}
+
+void x68k_input_sample(void)
+{
+	const uint8_t p0 = ~x68k_joy_read(0) & X68K_INPUT_PAD_MASK;
+	const uint8_t p1 = ~x68k_joy_read(1) & X68K_INPUT_PAD_MASK;
+	s_latched = (p0 << 8) | p1;
+}
+
+static void sample_keys(X68kInputFrame *f)
+{
+	uint16_t groups = s_key_groups;
+	for (uint8_t i = 0; i < X68K_INPUT_KEY_GROUPS; i++)
+	{
+		f->key[i] = (groups & 1) ? _iocs_bitsns(i) : 0;
+		groups >>= 1;
+	}
+}
+
+void x68k_input_update(void)
+{
+	s_prev = s_cur;
+
+	if (s_mode == INPUT_MODE_REPLAY)
+	{
+		s_cur = s_play_frames[s_rec_pos++];
+		if (s_rec_pos >= s_rec_len) s_mode = INPUT_MODE_LIVE;
+	}
+	else
+	{
+		if (!s_raster_line) x68k_input_sample();
+		const uint16_t latched = s_latched;
+		s_cur.pad[0] = latched >> 8;
+		s_cur.pad[1] = latched & 0xFF;
+		sample_keys(&s_cur);
+
+		if (s_mode == INPUT_MODE_RECORD)
+		{
+			s_rec_frames[s_rec_pos++] = s_cur;
+			if (s_rec_pos >= s_rec_len) s_mode = INPUT_MODE_LIVE;
+		}
+	}
+
+	s_history_pos = (s_history_pos + 1) & (X68K_INPUT_HISTORY - 1);
+	s_history[s_history_pos][0] = s_cur.pad[0];
+	s_history[s_history_pos][1] = s_cur.pad[1];
+}
+
+// Joypads ===================================================================
+
+uint8_t x68k_input_held(uint8_t pad)
+{
+	return s_cur.pad[pad ? 1 : 0];
+}
+
+uint8_t x68k_input_pressed(uint8_t pad)
+{
+	pad = pad ? 1 : 0;
+	return s_cur.pad[pad] & ~s_prev.pad[pad];
+}
+
+uint8_t x68k_input_released(uint8_t pad)
+{
+	pad = pad ? 1 : 0;
+	return ~s_cur.pad[pad] & s_prev.pad[pad];
+}
+
+uint8_t x68k_input_held_ago(uint8_t pad, uint8_t ago)
+{
+	const uint8_t idx = (s_history_pos - ago) & (X68K_INPUT_HISTORY - 1);
+	return s_history[idx][pad ? 1 : 0];
+}
+
+// Keyboard ==================================================================
+
+uint8_t x68k_input_key_held(uint8_t code)
+{
+	return (s_cur.key[(code >> 3) & 0xF] >> (code & 7)) & 1;
+}
+
+uint8_t x68k_input_key_pressed(uint8_t code)
+{
+	const uint8_t g = (code >> 3) & 0xF;
+	return ((s_cur.key[g] & ~s_prev.key[g]) >> (code & 7)) & 1;
+}
+
+uint8_t x68k_input_key_released(uint8_t code)
+{
+	const uint8_t g = (code >> 3) & 0xF;
+	return ((~s_cur.key[g] & s_prev.key[g]) >> (code & 7)) & 1;
+}
+
+// Record / replay ===========================================================
+
+void x68k_input_record(X68kInputFrame *frames, uint16_t num_frames)
+{
+	s_rec_frames = frames;
+	s_rec_len = num_frames;
+	s_rec_pos = 0;
+	s_mode = num_frames ? INPUT_MODE_RECORD : INPUT_MODE_LIVE;
+}
+
+void x68k_input_replay(const X68kInputFrame *frames, uint16_t num_frames)
+{
+	s_play_frames = frames;
+	s_rec_len = num_frames;
+	s_rec_pos = 0;
+	s_mode = num_frames ? INPUT_MODE_REPLAY : INPUT_MODE_LIVE;
+}
+
+uint16_t x68k_input_stop(void)
+{
+	s_mode = INPUT_MODE_LIVE;
+	return s_rec_pos;
+}
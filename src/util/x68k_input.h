@@ -0,0 +1,106 @@
+/*
+
+Latched Input (input)
+
+Samples both joypad ports and the keyboard once per frame, so that every
+subsystem sees the same state for the whole frame, and publishes held,
+pressed and released bitmasks for each.
+
+Joypads can be sampled by a CRTC raster interrupt at a chosen line. The best
+line is the last one that still gives the sampling handler time to finish
+before the game loop runs its logic, which is usually a few lines above the
+end of the active display (CRTC R07). That makes the sample as fresh as
+possible when the frame it affects is built. With a raster line of zero, pads
+are sampled in x68k_input_update() instead.
+
+The joypad ports are active-low; this module inverts them, so a set bit in
+an X68kJoyBits mask means the button is down.
+
+The keyboard is read through IOCS _BITSNS from x68k_input_update(), as it is
+not safe to make IOCS calls from the raster interrupt. Only the key groups
+selected in the init mask are scanned. Key codes are the scan codes used by
+_BITSNS: group = code >> 3, bit = code & 7.
+
+A ring of the last X68K_INPUT_HISTORY frames of pad state is kept for
+buffered inputs like motion commands.
+
+Record and replay take a caller-provided array of X68kInputFrame. While
+recording, each published frame is appended; while replaying, frames are read
+from the array in place of the hardware. Both stop when the array runs out.
+
+Usage:
+
+	x68k_input_init(500, 0x0001);  // Sample pads at line 500, keys ESC-BS
+	for (;;)
+	{
+		x68k_wait_for_vsync();
+		x68k_input_update();
+		if (x68k_input_pressed(0) & KEY_A) jump();
+	}
+
+*/
+#ifndef X68K_INPUT_H
+#define X68K_INPUT_H
+
+#include <stdint.h>
+
+#include "x68000/x68k_joy.h"
+
+// Must be a power of two.
+#ifndef X68K_INPUT_HISTORY
+#define X68K_INPUT_HISTORY 16
+#endif
+
+#define X68K_INPUT_KEY_GROUPS 16
+
+#define X68K_INPUT_PAD_MASK (KEY_UP | KEY_DOWN | KEY_LEFT | KEY_RIGHT | \
+                             KEY_A | KEY_B)
+
+// One frame of raw input, as stored for record and replay.
+typedef struct X68kInputFrame
+{
+	uint8_t pad[2];
+	uint8_t key[X68K_INPUT_KEY_GROUPS];
+} X68kInputFrame;
+
+// Set up sampling. raster_line is the CRTC raster at which pads are sampled
+// (0 to sample in x68k_input_update()). key_groups has a bit set for each
+// _BITSNS group to scan. Returns nonzero if the raster interrupt is taken,
+// in which case pads are sampled in x68k_input_update() instead.
+int x68k_input_init(uint16_t raster_line, uint16_t key_groups);
+
+// Releases the raster interrupt.
+void x68k_input_shutdown(void);
+
+// Latches the pad ports. Called from the raster interrupt; may also be
+// called by hand.
+void x68k_input_sample(void);
+
+// Publishes the latched state for this frame. Call once per frame.
+void x68k_input_update(void);
+
+// Joypads ===================================================================
+
+uint8_t x68k_input_held(uint8_t pad);
+uint8_t x68k_input_pressed(uint8_t pad);
+uint8_t x68k_input_released(uint8_t pad);
+
+// Held mask from `ago` frames back (0 = this frame). `ago` is limited to
+// X68K_INPUT_HISTORY - 1.
+uint8_t x68k_input_held_ago(uint8_t pad, uint8_t ago);
+
+// Keyboard ==================================================================
+
+uint8_t x68k_input_key_held(uint8_t code);
+uint8_t x68k_input_key_pressed(uint8_t code);
+uint8_t x68k_input_key_released(uint8_t code);
+
+// Record / replay ===========================================================
+
+void x68k_input_record(X68kInputFrame *frames, uint16_t num_frames);
+void x68k_input_replay(const X68kInputFrame *frames, uint16_t num_frames);
+
+// Ends recording or replay, and returns the number of frames processed.
+uint16_t x68k_input_stop(void);
+
+#endif  // X68K_INPUT_H
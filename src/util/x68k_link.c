@@ -0,0 +1,445 @@
+#include "util/x68k_link.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef X68K_LINK_HOST
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include "x68000/x68k_scc.h"
+#include "irq.h"
+#include <iocs.h>
+#endif
+
+#define LINK_SYNC 0xA5
+#define LINK_HEADER 6  // Sync to count
+#define LINK_MASK (X68K_LINK_HISTORY - 1)
+#define LINK_NONE 0xFFFF  // Frame before 0
+
+static X68kLink *s_link;
+
+static uint8_t ring_used(const X68kLinkRing *r)
+{
+	return r->head - r->tail;
+}
+
+// Port ======================================================================
+
+#ifdef X68K_LINK_HOST
+
+// Writes as much of tx as the descriptor takes.
+static void link_kick(X68kLink *l)
+{
+	X68kLinkRing *r = &l->tx;
+	while (r->head != r->tail)
+	{
+		const uint8_t tail = r->tail;
+		// Up to the end of the buffer or the head, whichever comes first.
+		const uint16_t run = (r->head > tail) ? r->head - tail :
+		                     X68K_LINK_RING - tail;
+		const ssize_t ret = write(l->fd, &r->buf[tail], run);
+		if (ret <= 0) break;
+		r->tail = tail + ret;
+	}
+}
+
+static void link_fill(X68kLink *l)
+{
+	X68kLinkRing *r = &l->rx;
+	uint8_t buf[X68K_LINK_RING];
+	const uint8_t space = (X68K_LINK_RING - 1) - ring_used(r);
+	if (!space) return;
+	const ssize_t ret = read(l->fd, buf, space);
+	for (ssize_t i = 0; i < ret; i++) r->buf[r->head++] = buf[i];
+}
+
+#else
+
+// If the SCC is idle, the first byte goes out here and the rest follow from
+// the transmit interrupt. tx_busy is only clear once the interrupt has reset
+// its pending state, so no transmit interrupt comes before this write. One
+// can come right after it, though, and it sends from tail: tail has to be
+// past this byte by then.
+static void link_kick(X68kLink *l)
+{
+	X68kLinkRing *r = &l->tx;
+	if (l->tx_busy || r->head == r->tail) return;
+	l->tx_busy = 1;
+	const uint8_t tail = r->tail;
+	const uint8_t b = r->buf[tail];
+	r->tail = tail + 1;
+	*SCC_A_DATA = b;
+}
+
+static void link_fill(X68kLink *l)
+{
+	(void)l;
+}
+
+void x68k_link_rx_isr(void)
+{
+	X68kLink *l = s_link;
+	X68kLinkRing *r = &l->rx;
+	while (x68k_scc_a_rr0() & SCC_RR0_RX_AVAILABLE)
+	{
+		x68k_scc_delay();
+		const uint8_t b = *SCC_A_DATA;
+		x68k_scc_delay();
+		if ((uint8_t)(r->head + 1) == r->tail) l->stats.overruns++;
+		else r->buf[r->head++] = b;
+	}
+	x68k_scc_a_command(SCC_CMD_RESET_IUS);
+}
+
+void x68k_link_tx_isr(void)
+{
+	X68kLink *l = s_link;
+	X68kLinkRing *r = &l->tx;
+	if (r->head != r->tail)
+	{
+		*SCC_A_DATA = r->buf[r->tail++];
+		x68k_scc_delay();
+	}
+	else
+	{
+		x68k_scc_a_command(SCC_CMD_RESET_TX_INT);
+		l->tx_busy = 0;
+	}
+	x68k_scc_a_command(SCC_CMD_RESET_IUS);
+}
+
+// Overrun or framing error. The byte is dropped; the packet check catches
+// whatever it belonged to.
+void x68k_link_special_isr(void)
+{
+	X68kLink *l = s_link;
+	*SCC_A_CTRL = 1;
+	x68k_scc_delay();
+	const uint8_t rr1 = *SCC_A_CTRL;
+	x68k_scc_delay();
+	(void)*SCC_A_DATA;
+	x68k_scc_delay();
+	if (rr1 & SCC_RR1_OVERRUN) l->stats.overruns++;
+	else l->stats.line_errors++;
+	x68k_scc_a_command(SCC_CMD_ERROR_RESET);
+	x68k_scc_a_command(SCC_CMD_RESET_IUS);
+}
+
+#endif
+
+// Setup =====================================================================
+
+static void link_reset(X68kLink *l)
+{
+	memset(l, 0, sizeof(*l));
+	l->local_frame = LINK_NONE;
+	l->local_acked = LINK_NONE;
+	l->remote_confirmed = LINK_NONE;
+	// Tags for frames long gone, so nothing matches before it arrives.
+	for (uint16_t i = 0; i < X68K_LINK_HISTORY; i++)
+	{
+		l->remote_tag[i] = i - X68K_LINK_HISTORY;
+		l->predicted_tag[i] = i - X68K_LINK_HISTORY;
+	}
+	l->stats.rtt_min = 0xFFFF;
+}
+
+#ifdef X68K_LINK_HOST
+
+int x68k_link_init(X68kLink *l, int fd)
+{
+	link_reset(l);
+	l->fd = fd;
+	s_link = l;
+	const int flags = fcntl(fd, F_GETFL);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) return -1;
+	return 0;
+}
+
+void x68k_link_shutdown(X68kLink *l)
+{
+	(void)l;
+	s_link = NULL;
+}
+
+#else
+
+// 1 stop bit, no parity, 8 bits, no XON/XOFF, 9600bps (replaced below).
+#define LINK_MODE_8N1 0x4C07
+
+int x68k_link_init(X68kLink *l, X68kLinkSpeed speed)
+{
+	link_reset(l);
+	s_link = l;
+
+	l->old_mode = _iocs_set232c(LINK_MODE_8N1);
+	x68k_scc_a_write(12, speed);
+	x68k_scc_a_write(13, 0);
+
+	// Nothing left over from before.
+	x68k_scc_a_command(SCC_CMD_RESET_TX_INT);
+	x68k_scc_a_command(SCC_CMD_ERROR_RESET);
+	while (x68k_scc_a_rr0() & SCC_RR0_RX_AVAILABLE)
+	{
+		x68k_scc_delay();
+		(void)*SCC_A_DATA;
+		x68k_scc_delay();
+	}
+
+	l->old_vectors[0] = _iocs_b_intvcs(SCC_A_VECTOR_TX, g_irq_link_tx);
+	l->old_vectors[1] = _iocs_b_intvcs(SCC_A_VECTOR_RX, g_irq_link_rx);
+	l->old_vectors[2] = _iocs_b_intvcs(SCC_A_VECTOR_SPECIAL,
+	                                   g_irq_link_special);
+	x68k_scc_a_write(1, SCC_WR1_RX_INT_ALL | SCC_WR1_TX_INT);
+	return 0;
+}
+
+void x68k_link_shutdown(X68kLink *l)
+{
+	x68k_scc_a_write(1, 0);
+	_iocs_b_intvcs(SCC_A_VECTOR_TX, l->old_vectors[0]);
+	_iocs_b_intvcs(SCC_A_VECTOR_RX, l->old_vectors[1]);
+	_iocs_b_intvcs(SCC_A_VECTOR_SPECIAL, l->old_vectors[2]);
+	// Sets the channel up again the way IOCS expects it.
+	_iocs_set232c(l->old_mode);
+	s_link = NULL;
+}
+
+#endif
+
+// Packets ===================================================================
+
+static uint8_t link_crc(const uint8_t *p, uint8_t len)
+{
+	uint8_t crc = 0;
+	while (len--)
+	{
+		crc ^= *p++;
+		for (uint8_t i = 0; i < 8; i++)
+		{
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+		}
+	}
+	return crc;
+}
+
+void x68k_link_send(X68kLink *l, uint16_t frame, uint8_t input)
+{
+	l->local[frame & LINK_MASK] = input;
+	l->local_frame = frame;
+
+	// Unacknowledged inputs, oldest first, so the other side can go on
+	// confirming frames even if it has fallen behind by more than a packet.
+	// The frame itself goes out even if it has been acknowledged already.
+	uint16_t count = frame - l->local_acked;
+	if (!count) count = 1;
+	if (count > X68K_LINK_REDUNDANCY)
+	{
+		count = X68K_LINK_REDUNDANCY;
+		frame = l->local_acked + count;
+	}
+
+	uint8_t pkt[X68K_LINK_PACKET_MAX];
+	const uint16_t ack = l->remote_confirmed;
+	pkt[0] = LINK_SYNC;
+	pkt[1] = frame >> 8;
+	pkt[2] = frame;
+	pkt[3] = ack >> 8;
+	pkt[4] = ack;
+	pkt[5] = count;
+	uint8_t len = LINK_HEADER;
+	for (uint16_t f = frame - (count - 1); len < LINK_HEADER + count; f++)
+	{
+		pkt[len++] = l->local[f & LINK_MASK];
+	}
+	pkt[len] = link_crc(&pkt[1], len - 1);
+	len++;
+
+	// A packet that doesn't fit is left out; the next one repeats its input.
+	X68kLinkRing *r = &l->tx;
+	if ((X68K_LINK_RING - 1) - ring_used(r) < len)
+	{
+		l->stats.tx_dropped++;
+		return;
+	}
+	for (uint8_t i = 0; i < len; i++) r->buf[(uint8_t)(r->head + i)] = pkt[i];
+	r->head += len;
+	l->stats.tx_bytes += len;
+	l->stats.tx_packets++;
+	link_kick(l);
+}
+
+static void link_confirm(X68kLink *l, uint16_t frame)
+{
+	const uint8_t slot = frame & LINK_MASK;
+	l->remote_confirmed = frame;
+	if (l->predicted_tag[slot] != frame ||
+	    l->predicted[slot] == l->remote[slot])
+	{
+		return;
+	}
+	l->stats.mispredicts++;
+	if (!l->mispredict_pending || (int16_t)(frame - l->mispredict_frame) < 0)
+	{
+		l->mispredict_frame = frame;
+		l->mispredict_pending = 1;
+	}
+}
+
+static void link_ack(X68kLink *l, uint16_t ack)
+{
+	// Acks only move forward, and never past what was sent.
+	if ((int16_t)(ack - l->local_acked) <= 0 ||
+	    (int16_t)(l->local_frame - ack) < 0)
+	{
+		return;
+	}
+	l->local_acked = ack;
+
+	X68kLinkStats *st = &l->stats;
+	const uint16_t rtt = l->local_frame - ack;
+	if (st->rtt_samples)
+	{
+		const int16_t d = (rtt > st->rtt_last) ? rtt - st->rtt_last :
+		                  st->rtt_last - rtt;
+		st->jitter16 += ((d << 4) - (int16_t)st->jitter16) / 16;
+	}
+	st->rtt_last = rtt;
+	if (rtt < st->rtt_min) st->rtt_min = rtt;
+	if (rtt > st->rtt_max) st->rtt_max = rtt;
+	st->rtt_total += rtt;
+	st->rtt_samples++;
+}
+
+static void link_packet(X68kLink *l, const uint8_t *p)
+{
+	const uint16_t frame = (p[1] << 8) | p[2];
+	const uint16_t ack = (p[3] << 8) | p[4];
+	const uint8_t count = p[5];
+
+	for (uint8_t i = 0; i < count; i++)
+	{
+		const uint16_t f = frame - (count - 1) + i;
+		// Already confirmed, or too far ahead to keep.
+		const int16_t ahead = f - l->remote_confirmed;
+		if (ahead <= 0 || ahead >= X68K_LINK_HISTORY) continue;
+		l->remote[f & LINK_MASK] = p[LINK_HEADER + i];
+		l->remote_tag[f & LINK_MASK] = f;
+	}
+	for (;;)
+	{
+		const uint16_t next = l->remote_confirmed + 1;
+		if (l->remote_tag[next & LINK_MASK] != next) break;
+		link_confirm(l, next);
+	}
+
+	link_ack(l, ack);
+	l->stats.rx_packets++;
+}
+
+// Drops `n` bytes from the packet buffer and anything up to the next sync.
+static void link_drop(X68kLink *l, uint8_t n)
+{
+	while (n < l->pkt_len && l->pkt[n] != LINK_SYNC) n++;
+	l->pkt_len -= n;
+	memmove(l->pkt, &l->pkt[n], l->pkt_len);
+}
+
+// Handles the packet buffer once it may hold a whole packet.
+static uint8_t link_parse(X68kLink *l)
+{
+	uint8_t accepted = 0;
+	while (l->pkt_len >= LINK_HEADER)
+	{
+		const uint8_t count = l->pkt[5];
+		if (count && count <= X68K_LINK_REDUNDANCY)
+		{
+			const uint8_t len = LINK_HEADER + count + 1;
+			if (l->pkt_len < len) break;
+			if (link_crc(&l->pkt[1], len - 2) == l->pkt[len - 1])
+			{
+				link_packet(l, l->pkt);
+				accepted++;
+				link_drop(l, len);
+				continue;
+			}
+		}
+		l->stats.bad_packets++;
+		link_drop(l, 1);
+	}
+	return accepted;
+}
+
+uint16_t x68k_link_poll(X68kLink *l)
+{
+	X68kLinkRing *r = &l->rx;
+	uint16_t accepted = 0;
+	link_fill(l);
+	while (r->tail != r->head)
+	{
+		const uint8_t b = r->buf[r->tail++];
+		l->stats.rx_bytes++;
+		if (!l->pkt_len && b != LINK_SYNC) continue;
+		l->pkt[l->pkt_len++] = b;
+		accepted += link_parse(l);
+	}
+	link_kick(l);
+	return accepted;
+}
+
+// Inputs ====================================================================
+
+uint8_t x68k_link_remote(X68kLink *l, uint16_t frame, uint8_t *input)
+{
+	const uint8_t slot = frame & LINK_MASK;
+	if (l->remote_tag[slot] == frame)
+	{
+		*input = l->remote[slot];
+		return 1;
+	}
+
+	// The last confirmed input carries on.
+	const uint16_t last = l->remote_confirmed;
+	const uint8_t guess = (l->remote_tag[last & LINK_MASK] == last) ?
+	                      l->remote[last & LINK_MASK] : 0;
+	if (l->predicted_tag[slot] != frame)
+	{
+		l->predicted_tag[slot] = frame;
+		l->predicted[slot] = guess;
+		l->stats.predictions++;
+	}
+	*input = l->predicted[slot];
+	return 0;
+}
+
+uint8_t x68k_link_mispredict(X68kLink *l, uint16_t *frame)
+{
+	if (!l->mispredict_pending) return 0;
+	l->mispredict_pending = 0;
+	*frame = l->mispredict_frame;
+	return 1;
+}
+
+// Statistics ================================================================
+
+void x68k_link_print(const X68kLink *l)
+{
+	const X68kLinkStats *st = &l->stats;
+	printf("tx_bytes,tx_packets,tx_dropped,rx_bytes,rx_packets,bad_packets,"
+	       "overruns,line_errors\n");
+	printf("%lu,%lu,%u,%lu,%lu,%u,%u,%u\n", (unsigned long)st->tx_bytes,
+	       (unsigned long)st->tx_packets, (unsigned int)st->tx_dropped,
+	       (unsigned long)st->rx_bytes, (unsigned long)st->rx_packets,
+	       (unsigned int)st->bad_packets, (unsigned int)st->overruns,
+	       (unsigned int)st->line_errors);
+	printf("rtt_last,rtt_min,rtt_max,rtt_avg16,jitter16,predictions,"
+	       "mispredicts\n");
+	printf("%u,%u,%u,%lu,%u,%u,%u\n", (unsigned int)st->rtt_last,
+	       (unsigned int)(st->rtt_samples ? st->rtt_min : 0),
+	       (unsigned int)st->rtt_max,
+	       (unsigned long)(st->rtt_samples ?
+	                       st->rtt_total * 16 / st->rtt_samples : 0),
+	       (unsigned int)st->jitter16, (unsigned int)st->predictions,
+	       (unsigned int)st->mispredicts);
+}
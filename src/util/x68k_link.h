@@ -0,0 +1,169 @@
+/*
+
+Two-machine input link over RS-232C (link)
+
+Exchanges per-frame pad input with a second machine over the serial port, for
+two-cabinet versus play. Bytes move through ring buffers filled and drained
+by SCC channel A interrupts, so sending costs a few stores and nothing waits
+on the line; IOCS _INP232C/_OUT232C aren't used.
+
+Every frame, x68k_link_send() sends the local input for that frame in a small
+packet, along with the inputs the other side hasn't acknowledged yet, so a
+damaged packet is covered by the next one instead of a resend. A packet holds
+up to X68K_LINK_REDUNDANCY inputs; past that, it carries the oldest ones.
+
+	$A5             Sync
+	frame.w         Newest frame in the packet
+	ack.w           Newest frame received from the other side, with all
+	                frames before it
+	count.b         Input bytes that follow, 1 - X68K_LINK_REDUNDANCY
+	input.b[count]  Oldest first, ending with `frame`
+	crc.b           CRC-8 (polynomial $07) of everything from frame on
+
+Input bytes are X68kJoyBits, active high (as in X68kInputFrame), so bits 6-7
+are free for game use. Packets that fail the check are dropped and the parser
+looks for the next sync byte.
+
+x68k_link_poll() takes in whatever has arrived. x68k_link_remote() then
+returns the other side's input for a frame, and whether it has actually
+arrived:
+
+* Lockstep: poll until x68k_link_remote() confirms the frame, then run it.
+* Rollback: run the frame with the predicted input (the last confirmed one)
+  right away. When a prediction turns out wrong, x68k_link_mispredict()
+  returns the earliest frame that has to be run again.
+
+Frame numbers are 16 bits and wrap; both sides start at 0. Only the last
+X68K_LINK_HISTORY frames are kept in either direction, so neither side may
+get further ahead of the other's confirmed input than that; a rollback game
+would limit how far it predicts well before then.
+
+Statistics: bytes and packets each way, packets dropped for lack of room,
+damaged packets, receive overruns and framing errors, and round trip time -
+the frames from sending an input until it is acknowledged - as last, min, max
+and average, with jitter as the smoothed change between samples (as in RTP),
+in 1/16 frames.
+
+Host build: with X68K_LINK_HOST defined, the port is a file descriptor, such
+as one end of a pty or a socket pair, read and written in x68k_link_poll()
+and x68k_link_send(). tools/linkbench runs two ends against each other.
+
+*/
+#ifndef X68K_LINK_H
+#define X68K_LINK_H
+
+#include <stdint.h>
+
+#define X68K_LINK_RING 256      // Bytes each way; indices wrap as uint8_t
+#define X68K_LINK_HISTORY 32    // Frames kept each way; a power of 2
+#define X68K_LINK_REDUNDANCY 8  // Most inputs in one packet
+#define X68K_LINK_PACKET_MAX (7 + X68K_LINK_REDUNDANCY)
+
+// SCC time constants, for a 5MHz clock and 16x sampling. All are 1.7% fast,
+// which is well within what the receivers accept.
+typedef enum X68kLinkSpeed
+{
+	X68K_LINK_9600 = 14,
+	X68K_LINK_19200 = 6,
+	X68K_LINK_38400 = 2,
+} X68kLinkSpeed;
+
+typedef struct X68kLinkRing
+{
+	uint8_t buf[X68K_LINK_RING];
+	volatile uint8_t head;  // Written by the producer
+	volatile uint8_t tail;  // Written by the consumer
+} X68kLinkRing;
+
+typedef struct X68kLinkStats
+{
+	uint32_t tx_bytes;
+	uint32_t rx_bytes;
+	uint32_t tx_packets;
+	uint32_t rx_packets;
+	uint16_t tx_dropped;   // Packets that didn't fit in the ring
+	uint16_t bad_packets;  // Failed the check or malformed
+	uint16_t overruns;     // Bytes lost on the way in
+	uint16_t line_errors;  // Framing errors
+	uint16_t predictions;  // Remote inputs handed out before they arrived
+	uint16_t mispredicts;  // ...that turned out wrong
+	uint16_t rtt_last;     // Round trip, in frames
+	uint16_t rtt_min;
+	uint16_t rtt_max;
+	uint32_t rtt_total;
+	uint32_t rtt_samples;
+	uint16_t jitter16;     // In 1/16 frames
+} X68kLinkStats;
+
+typedef struct X68kLink
+{
+	X68kLinkRing rx;
+	X68kLinkRing tx;
+	volatile uint8_t tx_busy;  // The SCC is sending from tx
+#ifdef X68K_LINK_HOST
+	int fd;
+#else
+	int old_mode;
+	void *old_vectors[3];
+#endif
+
+	// Local inputs
+	uint8_t local[X68K_LINK_HISTORY];
+	uint16_t local_frame;  // Newest sent
+	uint16_t local_acked;  // Newest the other side has
+
+	// Remote inputs; a slot holds frame f if remote_tag[slot] == f.
+	uint8_t remote[X68K_LINK_HISTORY];
+	uint16_t remote_tag[X68K_LINK_HISTORY];
+	uint8_t predicted[X68K_LINK_HISTORY];
+	uint16_t predicted_tag[X68K_LINK_HISTORY];
+	uint16_t remote_confirmed;  // Newest with all frames before it
+	uint8_t mispredict_pending;
+	uint16_t mispredict_frame;
+
+	// Packet being received
+	uint8_t pkt[X68K_LINK_PACKET_MAX];
+	uint8_t pkt_len;
+
+	X68kLinkStats stats;
+} X68kLink;
+
+#ifdef X68K_LINK_HOST
+// Uses `fd` as the port and makes it non-blocking. Returns -1 on failure.
+int x68k_link_init(X68kLink *l, int fd);
+#else
+// Sets up channel A for 8N1 at `speed` and takes over its interrupts. Only
+// one link can be active.
+int x68k_link_init(X68kLink *l, X68kLinkSpeed speed);
+#endif
+
+// Gives the port back to IOCS.
+void x68k_link_shutdown(X68kLink *l);
+
+// Stores the local input for `frame` and sends it with any inputs still
+// unacknowledged. Frames are expected one at a time, in order; sending the
+// latest frame again is fine.
+void x68k_link_send(X68kLink *l, uint16_t frame, uint8_t input);
+
+// Takes in received packets. Returns the number accepted.
+uint16_t x68k_link_poll(X68kLink *l);
+
+// Stores the other side's input for `frame` in *input. Returns 1 if it has
+// arrived; otherwise returns 0 and stores the prediction.
+uint8_t x68k_link_remote(X68kLink *l, uint16_t frame, uint8_t *input);
+
+// Returns 1 and the earliest frame whose remote input was mispredicted, if
+// any since the last call.
+uint8_t x68k_link_mispredict(X68kLink *l, uint16_t *frame);
+
+// Prints the statistics as comma-separated lines, with a header line.
+void x68k_link_print(const X68kLink *l);
+
+#ifndef X68K_LINK_HOST
+// Interrupt handlers for channel A, called from src/irq.s.
+void x68k_link_rx_isr(void);
+void x68k_link_tx_isr(void);
+void x68k_link_special_isr(void);
+#endif
+
+#endif  // X68K_LINK_H
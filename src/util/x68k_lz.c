@@ -0,0 +1,106 @@
+#include "util/x68k_lz.h"
+
+#include <stddef.h>
+
+#define WINDOW_MASK (X68K_LZ_WINDOW - 1)
+
+#ifndef X68K_LZ_HOST
+// x68k_lz_stream.s works from these offsets.
+_Static_assert(offsetof(X68kLzStream, remaining) == 8, "X68kLzStream");
+_Static_assert(offsetof(X68kLzStream, run) == 12, "X68kLzStream");
+_Static_assert(offsetof(X68kLzStream, dist) == 14, "X68kLzStream");
+_Static_assert(offsetof(X68kLzStream, wpos) == 16, "X68kLzStream");
+_Static_assert(offsetof(X68kLzStream, target) == 18, "X68kLzStream");
+_Static_assert(offsetof(X68kLzStream, window) == 20, "X68kLzStream");
+#endif
+
+void x68k_lz_stream_init(X68kLzStream *s, const void *src, volatile void *dst,
+                         X68kLzTarget target)
+{
+	s->remaining = x68k_lz_size(src);
+	s->src = (const uint8_t *)src + 4;
+	s->dst = (volatile uint8_t *)dst;
+	s->run = 0;
+	s->dist = 0;
+	s->wpos = 0;
+	s->target = target;
+}
+
+#ifdef X68K_LZ_HOST
+
+// Model of x68k_lz_stream.s. A word's first byte waits at an even window
+// position, and the pair is read back from there.
+static inline void put(X68kLzStream *s, uint8_t b)
+{
+	const uint16_t pos = s->wpos;
+	s->window[pos] = b;
+	s->wpos = (pos + 1) & WINDOW_MASK;
+
+	switch (s->target)
+	{
+		default:
+		case X68K_LZ_BYTE:
+			*s->dst++ = b;
+			break;
+		case X68K_LZ_WORD:
+			if (pos & 1)
+			{
+				*(volatile uint16_t *)s->dst = (s->window[pos - 1] << 8) | b;
+				s->dst += 2;
+			}
+			break;
+		case X68K_LZ_PIXEL:
+			*(volatile uint16_t *)s->dst = b;
+			s->dst += 2;
+			break;
+	}
+	s->remaining--;
+}
+
+int x68k_lz_stream_run(X68kLzStream *s, uint16_t max_bytes)
+{
+	while (max_bytes)
+	{
+		if (!s->run)
+		{
+			const uint8_t t = *s->src++;
+			if (!t)
+			{
+				// Flush an odd trailing byte.
+				if (s->target == X68K_LZ_WORD && (s->wpos & 1))
+				{
+					*(volatile uint16_t *)s->dst = s->window[s->wpos - 1] << 8;
+				}
+				s->src--;  // Stay on the end token if called again
+				return 1;
+			}
+			if (t & 0x80)
+			{
+				uint16_t len = (t >> 4) & 7;
+				s->dist = (((t & 0x0F) << 8) | *s->src++) + 1;
+				if (len == 7) len += *s->src++;
+				s->run = len + 3;
+			}
+			else
+			{
+				s->run = t;
+				s->dist = 0;
+			}
+		}
+
+		uint16_t n = (s->run < max_bytes) ? s->run : max_bytes;
+		s->run -= n;
+		max_bytes -= n;
+		if (s->dist)
+		{
+			while (n--) put(s, s->window[(s->wpos - s->dist) & WINDOW_MASK]);
+		}
+		else
+		{
+			while (n--) put(s, *s->src++);
+		}
+	}
+	return 0;
+}
+
+#endif  // X68K_LZ_HOST
@@ -0,0 +1,95 @@
+/*
+
+LZ decompression (lz)
+
+A small byte-aligned LZ77 format meant to be cheap to decode on a 68000:
+tokens are whole bytes, lengths and offsets come out of shifts and masks, and
+there are no tables. Compress with tools/lzpack.
+
+Stream layout:
+
+	$00.l     Uncompressed size, big-endian
+	$04       Tokens
+
+Tokens:
+
+	0LLL LLLL                   Literal run of L bytes (1 - 127), which follow
+	0000 0000                   End of stream
+	1LLL OOOO oooo oooo [e]     Match: copy from OOOOoooooooo + 1 bytes back.
+	                            Length is L + 3 (3 - 9); if L is 7, a further
+	                            byte e is added (10 - 265).
+
+Offsets reach back at most X68K_LZ_WINDOW bytes, so a stream can be decoded
+with only that much history kept around.
+
+x68k_lz_decode() unpacks a whole stream into main RAM in one go, and is the
+fastest way to decode.
+
+X68kLzStream decodes up to a given number of output bytes per call, for
+spreading work over several frames, and can write to video memory that has to
+be written a word at a time:
+
+	X68K_LZ_BYTE   Plain memory.
+	X68K_LZ_WORD   Pairs of bytes are written as words: PCG_TILE_DATA, the BG
+	               nametables, or any word-only register window.
+	X68K_LZ_PIXEL  Each byte is one pixel, written as a word: GVRAM_BASE in
+	               16 and 256 color modes.
+
+History is kept in a window inside the stream struct, so video memory is
+never read back. x68k_lz_stream_run() is assembly with a literal and a match
+loop for each target; with X68K_LZ_WORD, a word's first byte waits in the
+window until its second arrives.
+
+Host build: with X68K_LZ_HOST defined, x68k_lz_stream_run() is a C model of
+the assembly, and x68k_lz_decode() is not available.
+
+*/
+#ifndef X68K_LZ_H
+#define X68K_LZ_H
+
+#include <stdint.h>
+
+#define X68K_LZ_WINDOW 4096
+
+typedef enum X68kLzTarget
+{
+	X68K_LZ_BYTE,
+	X68K_LZ_WORD,
+	X68K_LZ_PIXEL,
+} X68kLzTarget;
+
+typedef struct X68kLzStream
+{
+	const uint8_t *src;
+	volatile uint8_t *dst;
+	uint32_t remaining;   // Bytes left to output
+	uint16_t run;         // Bytes left in the current literal run or match
+	uint16_t dist;        // Match distance, or 0 in a literal run
+	uint16_t wpos;        // Window write position
+	uint16_t target;      // X68kLzTarget
+	uint8_t window[X68K_LZ_WINDOW];  // Word aligned
+} X68kLzStream;
+
+// Uncompressed size of a stream.
+static inline uint32_t x68k_lz_size(const void *src)
+{
+	const uint8_t *s = (const uint8_t *)src;
+	return ((uint32_t)s[0] << 24) | ((uint32_t)s[1] << 16) |
+	       ((uint32_t)s[2] << 8) | s[3];
+}
+
+#ifndef X68K_LZ_HOST
+// Decodes a whole stream into RAM. Returns the end of the output.
+uint8_t *x68k_lz_decode(const void *src, void *dst);  // <-- x68k_lz_decode.s
+#endif
+
+// Set up incremental decoding of `src` into `dst`.
+void x68k_lz_stream_init(X68kLzStream *s, const void *src, volatile void *dst,
+                         X68kLzTarget target);
+
+// Decodes up to `max_bytes` of output. Returns nonzero once the stream is
+// finished.
+int x68k_lz_stream_run(X68kLzStream *s,
+                       uint16_t max_bytes);  // <-- x68k_lz_stream.s
+
+#endif  // X68K_LZ_H
@@ -0,0 +1,56 @@
+; uint8_t *x68k_lz_decode(const void *src, void *dst);
+; See x68k_lz.h for the stream format.
+;
+; d0 = token / offset
+; d1 = extension byte
+; d2 = length (for dbra)
+; a0 = src, a1 = dst, a2 = match source
+
+	align 2
+.global	x68k_lz_decode
+
+x68k_lz_decode:
+	move.l	4(sp), a0
+	move.l	8(sp), a1
+	movem.l	d2/a2, -(sp)
+	addq.l	#4, a0			; Skip size
+
+.token:
+	moveq	#0, d0
+	move.b	(a0)+, d0
+	bmi.s	.match
+	beq.s	.done
+
+	subq.w	#1, d0
+.literal:
+	move.b	(a0)+, (a1)+
+	dbra	d0, .literal
+	bra.s	.token
+
+.match:
+	move.w	d0, d2
+	lsr.w	#4, d2
+	andi.w	#7, d2			; d2 = L
+	andi.w	#$0F, d0
+	lsl.w	#8, d0
+	move.b	(a0)+, d0		; d0 = offset - 1
+	cmpi.w	#7, d2
+	bne.s	.short
+	moveq	#0, d1
+	move.b	(a0)+, d1
+	add.w	d1, d2
+.short:
+	addq.w	#2, d2			; Length is L + 3; one less for dbra
+	movea.l	a1, a2
+	suba.w	d0, a2
+	subq.l	#1, a2
+.copy:
+	move.b	(a2)+, (a1)+
+	dbra	d2, .copy
+	bra.s	.token
+
+.done:
+	move.l	a1, d0
+	movea.l	a1, a0
+	movem.l	(sp)+, d2/a2
+	rts
@@ -0,0 +1,228 @@
+; int x68k_lz_stream_run(X68kLzStream *s, uint16_t max_bytes);
+; See x68k_lz.h. The state is loaded into registers and each chunk of a run
+; is cut where the window wraps, so the loops for each output target only
+; move bytes through pointers. Everything is stored back on the way out, and
+; the next call carries on mid-run.
+;
+; With X68K_LZ_WORD, the window doubles as the pending byte: a word's high
+; byte sits at an even window position, its low byte goes in after it, and
+; the pair is written out from there.
+;
+; X68kLzStream offsets:
+;	0 src, 4 dst, 8 remaining, 12 run, 14 dist, 16 wpos, 18 target,
+;	20 window
+;
+; d0 = token / byte / loop offset, d1 = bytes left in this call (max_bytes in
+; the upper word), d2 = run, d3 = bytes in this piece (for dbra), d4 = wpos,
+; d6 = bytes left in this chunk, d7 = target loop offset
+; a0 = src, a1 = dst, a2 = s, a3 = window, a4 = window write
+; a5 = window read (matches), a6 = window end
+
+WINDOW		equ	4096
+WINDOW_MASK	equ	WINDOW-1
+
+	align 2
+.global	x68k_lz_stream_run
+
+x68k_lz_stream_run:
+	movem.l	d2-d7/a2-a6, -(sp)
+	movea.l	48(sp), a2
+	move.w	54(sp), d1
+	swap	d1
+	move.w	54(sp), d1
+	movea.l	(a2), a0
+	movea.l	4(a2), a1
+	move.w	12(a2), d2
+	move.w	16(a2), d4
+	lea	20(a2), a3
+	lea	WINDOW(a3), a6
+
+	move.w	18(a2), d7
+	cmpi.w	#2, d7
+	bls.s	.target
+	moveq	#0, d7
+.target:
+	lsl.w	#3, d7
+
+.next:
+	tst.w	d1
+	beq	.pause
+	tst.w	d2
+	bne.s	.chunk
+	moveq	#0, d0
+	move.b	(a0)+, d0
+	bmi.s	.match_token
+	beq	.end
+	move.w	d0, d2			; Literal run
+	clr.w	14(a2)
+	bra.s	.chunk
+.match_token:
+	move.w	d0, d2
+	lsr.w	#4, d2
+	andi.w	#7, d2			; d2 = L
+	andi.w	#$0F, d0
+	lsl.w	#8, d0
+	move.b	(a0)+, d0
+	addq.w	#1, d0
+	move.w	d0, 14(a2)		; dist = offset
+	cmpi.w	#7, d2
+	bne.s	.short
+	moveq	#0, d0
+	move.b	(a0)+, d0
+	add.w	d0, d2
+.short:
+	addq.w	#3, d2
+
+.chunk:
+	move.w	d2, d6			; As much of the run as this call allows
+	cmp.w	d1, d6
+	bls.s	.chunk_len
+	move.w	d1, d6
+.chunk_len:
+	sub.w	d6, d2
+	sub.w	d6, d1
+	lea	0(a3,d4.w), a4
+	move.w	d4, d0
+	sub.w	14(a2), d0
+	andi.w	#WINDOW_MASK, d0
+	lea	0(a3,d0.w), a5
+
+.piece:
+	move.l	a6, d3			; Up to the end of the window
+	sub.l	a4, d3
+	move.w	d7, d0
+	tst.w	14(a2)
+	beq.s	.piece_len
+	move.l	a6, d0
+	sub.l	a5, d0
+	cmp.w	d0, d3
+	bls.s	.piece_match
+	move.w	d0, d3
+.piece_match:
+	move.w	d7, d0
+	addq.w	#4, d0
+.piece_len:
+	cmp.w	d6, d3
+	bls.s	.piece_go
+	move.w	d6, d3
+.piece_go:
+	sub.w	d3, d6
+	subq.w	#1, d3
+	jmp	.loops(pc,d0.w)
+.loops:
+	bra.w	.lit_byte
+	bra.w	.match_byte
+	bra.w	.lit_word
+	bra.w	.match_word
+	bra.w	.lit_pixel
+	bra.w	.match_pixel
+
+.piece_end:
+	cmpa.l	a6, a4
+	bne.s	.piece_read
+	movea.l	a3, a4
+.piece_read:
+	cmpa.l	a6, a5
+	bne.s	.piece_more
+	movea.l	a3, a5
+.piece_more:
+	move.l	a4, d4
+	sub.l	a3, d4
+	tst.w	d6
+	bne.s	.piece
+	bra	.next
+
+; X68K_LZ_BYTE
+
+.lit_byte:
+	move.b	(a0)+, d0
+	move.b	d0, (a1)+
+	move.b	d0, (a4)+
+	dbra	d3, .lit_byte
+	bra.s	.piece_end
+
+.match_byte:
+	move.b	(a5)+, d0
+	move.b	d0, (a1)+
+	move.b	d0, (a4)+
+	dbra	d3, .match_byte
+	bra.s	.piece_end
+
+; X68K_LZ_WORD: the window write position says which half comes next.
+
+.lit_word:
+	btst	#0, d4
+	bne.s	.lit_word_lo
+.lit_word_hi:
+	move.b	(a0)+, (a4)+
+	dbra	d3, .lit_word_lo
+	bra.s	.piece_end
+.lit_word_lo:
+	move.b	(a0)+, (a4)+
+	move.w	-2(a4), (a1)+
+	dbra	d3, .lit_word_hi
+	bra.s	.piece_end
+
+.match_word:
+	btst	#0, d4
+	bne.s	.match_word_lo
+.match_word_hi:
+	move.b	(a5)+, (a4)+
+	dbra	d3, .match_word_lo
+	bra	.piece_end
+.match_word_lo:
+	move.b	(a5)+, (a4)+
+	move.w	-2(a4), (a1)+
+	dbra	d3, .match_word_hi
+	bra	.piece_end
+
+; X68K_LZ_PIXEL: the high byte of d0 stays clear.
+
+.lit_pixel:
+	moveq	#0, d0
+.lit_pixel_loop:
+	move.b	(a0)+, d0
+	move.w	d0, (a1)+
+	move.b	d0, (a4)+
+	dbra	d3, .lit_pixel_loop
+	bra	.piece_end
+
+.match_pixel:
+	moveq	#0, d0
+.match_pixel_loop:
+	move.b	(a5)+, d0
+	move.w	d0, (a1)+
+	move.b	d0, (a4)+
+	dbra	d3, .match_pixel_loop
+	bra	.piece_end
+
+.end:
+	subq.l	#1, a0			; Stay on the end token if called again
+	cmpi.w	#1, 18(a2)
+	bne.s	.end_flushed
+	btst	#0, d4
+	beq.s	.end_flushed
+	moveq	#0, d0			; Flush an odd trailing byte
+	move.b	-1(a3,d4.w), d0
+	lsl.w	#8, d0
+	move.w	d0, (a1)
+.end_flushed:
+	moveq	#1, d7
+	bra.s	.store
+
+.pause:
+	moveq	#0, d7
+
+.store:
+	move.l	a0, (a2)
+	move.l	a1, 4(a2)
+	move.l	d1, d0			; Bytes output this call
+	swap	d0
+	sub.w	d1, d0
+	andi.l	#$FFFF, d0
+	sub.l	d0, 8(a2)
+	move.w	d2, 12(a2)
+	move.w	d4, 16(a2)
+	move.l	d7, d0
+	movem.l	(sp)+, d2-d7/a2-a6
+	rts
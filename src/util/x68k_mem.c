@@ -0,0 +1,138 @@
+#include "util/x68k_mem.h"
+#include <dos.h>
+
+// _MALLOC returns $81xxxxxx (xxxxxx = largest free block) or $82000000 when
+// it can't satisfy a request.
+#define DOS_MALLOC_FAILED(p) ((uint32_t)(p) >= 0x81000000)
+#define DOS_MALLOC_MAX 0x00FFFFFF
+
+// Arenas ====================================================================
+
+int x68k_arena_init(X68kArena *a, uint32_t size)
+{
+	void *block = _dos_malloc(size);
+	if (DOS_MALLOC_FAILED(block))
+	{
+		x68k_arena_init_buf(a, 0, 0);
+		return -1;
+	}
+	x68k_arena_init_buf(a, block, size);
+	a->from_dos = 1;
+	return 0;
+}
+
+void x68k_arena_init_buf(X68kArena *a, void *buf, uint32_t size)
+{
+	a->base = (uint8_t *)buf;
+	a->size = size;
+	a->used = 0;
+	a->high_water = 0;
+	a->padding = 0;
+	a->from_dos = 0;
+}
+
+void x68k_arena_free(X68kArena *a)
+{
+	if (a->from_dos && a->base) _dos_mfree(a->base);
+	x68k_arena_init_buf(a, 0, 0);
+}
+
+void *x68k_arena_alloc_aligned(X68kArena *a, uint32_t size, uint16_t align)
+{
+	// Keep the next allocation word-aligned, as x68k_arena_alloc() does.
+	size = (size + 1) & ~1;
+	const uint32_t addr = (uint32_t)(a->base + a->used);
+	const uint32_t pad = (align - (addr & (align - 1))) & (align - 1);
+	if (size + pad > a->size - a->used) return 0;
+
+	void *ret = a->base + a->used + pad;
+	a->used += size + pad;
+	a->padding += pad;
+	if (a->used > a->high_water) a->high_water = a->used;
+	return ret;
+}
+
+void *x68k_arena_alloc(X68kArena *a, uint32_t size)
+{
+	// Keep the next allocation word-aligned.
+	size = (size + 1) & ~1;
+	if (size > a->size - a->used) return 0;
+
+	void *ret = a->base + a->used;
+	a->used += size;
+	if (a->used > a->high_water) a->high_water = a->used;
+	return ret;
+}
+
+// Frame arenas ==============================================================
+
+int x68k_frame_arena_init(X68kFrameArena *f, uint32_t size)
+{
+	f->cur = 0;
+	size &= ~3;
+	if (x68k_arena_init(&f->half[0], size))
+	{
+		x68k_arena_init_buf(&f->half[1], 0, 0);
+		return -1;
+	}
+	// The second half shares the DOS block; only the first one frees it.
+	x68k_arena_init_buf(&f->half[1], f->half[0].base + size / 2, size / 2);
+	f->half[0].size = size / 2;
+	return 0;
+}
+
+void x68k_frame_arena_free(X68kFrameArena *f)
+{
+	x68k_arena_free(&f->half[0]);
+	x68k_arena_init_buf(&f->half[1], 0, 0);
+}
+
+void x68k_frame_arena_flip(X68kFrameArena *f)
+{
+	f->cur ^= 1;
+	x68k_arena_reset(&f->half[f->cur]);
+}
+
+// Pools =====================================================================
+
+int x68k_pool_init(X68kPool *p, X68kArena *a, uint16_t obj_size,
+                   uint16_t count)
+{
+	// Room for the free list link, and word-aligned.
+	if (obj_size < sizeof(void *)) obj_size = sizeof(void *);
+	obj_size = (obj_size + 1) & ~1;
+
+	p->base = (uint8_t *)x68k_arena_alloc(a, (uint32_t)obj_size * count);
+	p->obj_size = obj_size;
+	p->count = p->base ? count : 0;
+	p->high_water = 0;
+	x68k_pool_reset(p);
+	return p->base ? 0 : -1;
+}
+
+void x68k_pool_reset(X68kPool *p)
+{
+	p->free_list = 0;
+	p->in_use = 0;
+	// Built back to front so objects come out in address order.
+	for (uint16_t i = p->count; i > 0; i--)
+	{
+		void **obj = (void **)(p->base + (uint32_t)(i - 1) * p->obj_size);
+		*obj = p->free_list;
+		p->free_list = obj;
+	}
+}
+
+// DOS heap ==================================================================
+
+uint32_t x68k_mem_dos_largest_free(void)
+{
+	// Asking for more than there could ever be reports the largest block.
+	const uint32_t ret = (uint32_t)_dos_malloc(DOS_MALLOC_MAX);
+	if (!DOS_MALLOC_FAILED(ret))
+	{
+		_dos_mfree((void *)ret);
+		return DOS_MALLOC_MAX;
+	}
+	return (ret & 0xFF000000) == 0x81000000 ? (ret & 0x00FFFFFF) : 0;
+}
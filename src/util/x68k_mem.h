@@ -0,0 +1,149 @@
+/*
+
+Memory arenas and pools (mem)
+
+Keeps per-level and per-frame allocations out of the DOS heap, which is small
+and fragments quickly, and makes the cost of an allocation a few
+instructions.
+
+X68kArena: a bump allocator over one block. The block comes from DOS _MALLOC
+with x68k_arena_init(), or from the caller with x68k_arena_init_buf(). Freeing
+everything is O(1) with x68k_arena_reset(); x68k_arena_mark() and
+x68k_arena_release() free back to an earlier point. Use one for each level or
+scene, and reset it on scene change.
+
+X68kFrameArena: two arenas used on alternate frames. x68k_frame_arena_flip()
+at the start of each frame resets the half that is about to be reused, so data
+allocated in one frame stays valid through the next one. That leaves time for
+DMA or vertical blank commits to use it.
+
+X68kPool: fixed-size objects (sprites, bullets, queue nodes) on a free list,
+carved out of an arena. Alloc and free are O(1) and never fragment.
+
+All allocations are word-aligned, as the 68000 requires for word and long
+access.
+
+Statistics: arenas track their high-water mark and the bytes lost to
+alignment padding; pools track how many objects are in use and their
+high-water mark. x68k_mem_dos_largest_free() reports the largest block DOS can
+still hand out, which shows how fragmented the DOS heap itself is.
+
+*/
+#ifndef X68K_MEM_H
+#define X68K_MEM_H
+
+#include <stdint.h>
+
+typedef struct X68kArena
+{
+	uint8_t *base;
+	uint32_t size;
+	uint32_t used;
+	uint32_t high_water;
+	uint32_t padding;  // Bytes lost to alignment since the last reset
+	uint8_t from_dos;
+} X68kArena;
+
+typedef struct X68kFrameArena
+{
+	X68kArena half[2];
+	uint8_t cur;
+} X68kFrameArena;
+
+typedef struct X68kPool
+{
+	uint8_t *base;
+	void *free_list;
+	uint16_t obj_size;
+	uint16_t count;
+	uint16_t in_use;
+	uint16_t high_water;
+} X68kPool;
+
+// Arenas ====================================================================
+
+// Reserves `size` bytes with DOS _MALLOC. Returns nonzero on failure.
+int x68k_arena_init(X68kArena *a, uint32_t size);
+
+// Uses caller memory instead.
+void x68k_arena_init_buf(X68kArena *a, void *buf, uint32_t size);
+
+// Returns the block to DOS, if it came from there.
+void x68k_arena_free(X68kArena *a);
+
+// Returns NULL when out of space.
+void *x68k_arena_alloc(X68kArena *a, uint32_t size);
+
+// `align` must be a power of two.
+void *x68k_arena_alloc_aligned(X68kArena *a, uint32_t size, uint16_t align);
+
+static inline void x68k_arena_reset(X68kArena *a)
+{
+	a->used = 0;
+	a->padding = 0;
+}
+
+static inline uint32_t x68k_arena_mark(const X68kArena *a)
+{
+	return a->used;
+}
+
+static inline void x68k_arena_release(X68kArena *a, uint32_t mark)
+{
+	if (mark < a->used) a->used = mark;
+}
+
+static inline uint32_t x68k_arena_remaining(const X68kArena *a)
+{
+	return a->size - a->used;
+}
+
+// Frame arenas ==============================================================
+
+// Splits `size` bytes from DOS _MALLOC into two halves. Returns nonzero on
+// failure.
+int x68k_frame_arena_init(X68kFrameArena *f, uint32_t size);
+
+void x68k_frame_arena_free(X68kFrameArena *f);
+
+// Call at the start of each frame.
+void x68k_frame_arena_flip(X68kFrameArena *f);
+
+static inline void *x68k_frame_arena_alloc(X68kFrameArena *f, uint32_t size)
+{
+	return x68k_arena_alloc(&f->half[f->cur], size);
+}
+
+// Pools =====================================================================
+
+// Carves `count` objects of `obj_size` bytes from an arena. Returns nonzero if
+// the arena doesn't have room.
+int x68k_pool_init(X68kPool *p, X68kArena *a, uint16_t obj_size,
+                   uint16_t count);
+
+// Returns NULL when the pool is empty.
+static inline void *x68k_pool_alloc(X68kPool *p)
+{
+	void **obj = (void **)p->free_list;
+	if (!obj) return 0;
+	p->free_list = *obj;
+	if (++p->in_use > p->high_water) p->high_water = p->in_use;
+	return obj;
+}
+
+static inline void x68k_pool_free(X68kPool *p, void *obj)
+{
+	*(void **)obj = p->free_list;
+	p->free_list = obj;
+	p->in_use--;
+}
+
+// Puts every object back on the free list.
+void x68k_pool_reset(X68kPool *p);
+
+// DOS heap ==================================================================
+
+// Size of the largest block DOS _MALLOC can currently provide.
+uint32_t x68k_mem_dos_largest_free(void);
+
+#endif  // X68K_MEM_H
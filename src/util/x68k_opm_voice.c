@@ -0,0 +1,109 @@
+#include "util/x68k_opm_voice.h"
+#include "x68000/x68k_opm.h"
+
+#define BANK_MAGIC 0x584F504D  // 'XOPM'
+#define BANK_VERSION 1
+
+// Register for each voice byte, before adding the channel.
+static const uint8_t s_voice_reg[X68K_OPM_VOICE_REGS] =
+{
+	OPM_CH_PAN_FL_CON, OPM_CH_PMS_AMS,
+	0x40, 0x48, 0x50, 0x58,
+	0x60, 0x68, 0x70, 0x78,
+	0x80, 0x88, 0x90, 0x98,
+	0xA0, 0xA8, 0xB0, 0xB8,
+	0xC0, 0xC8, 0xD0, 0xD8,
+	0xE0, 0xE8, 0xF0, 0xF8,
+};
+
+// One busy wait per register; the OPM is only busy after a data write.
+static inline void opm_put(uint8_t reg, uint8_t val)
+{
+	while (x68k_opm_busy()) __asm__ volatile ("nop");
+	*OPM_ADDRESS = reg;
+	*OPM_DATA = val;
+}
+
+int x68k_opm_bank_check(const void *bank)
+{
+	const uint16_t *w = (const uint16_t *)bank;
+	if (*(const uint32_t *)bank != BANK_MAGIC || w[2] != BANK_VERSION)
+	{
+		return -1;
+	}
+	return w[3];
+}
+
+void x68k_opm_voice_load(uint8_t channel, const X68kOpmVoice *v, uint8_t pan)
+{
+	const uint8_t *src = &v->fl_con;
+	opm_put(OPM_CH_PAN_FL_CON + channel, *src++ | pan);
+	for (uint8_t i = 1; i < X68K_OPM_VOICE_REGS; i++)
+	{
+		opm_put(s_voice_reg[i] + channel, *src++);
+	}
+}
+
+void x68k_opm_voice_cache_init(X68kOpmVoiceCache *c)
+{
+	for (uint8_t ch = 0; ch < X68K_OPM_NUM_CHANNELS; ch++)
+	{
+		c->pan[ch] = X68K_OPM_PAN_BOTH_ENABLE;
+	}
+	c->valid = 0;
+}
+
+uint8_t x68k_opm_voice_load_diff(X68kOpmVoiceCache *c, uint8_t channel,
+                                 const X68kOpmVoice *v)
+{
+	const uint8_t *src = &v->fl_con;
+	uint8_t *regs = c->regs[channel];
+	const uint8_t bit = 1 << channel;
+
+	if (!(c->valid & bit))
+	{
+		x68k_opm_voice_load(channel, v, c->pan[channel]);
+		regs[0] = src[0] | c->pan[channel];
+		for (uint8_t i = 1; i < X68K_OPM_VOICE_REGS; i++) regs[i] = src[i];
+		c->valid |= bit;
+		return X68K_OPM_VOICE_REGS;
+	}
+
+	uint8_t written = 0;
+	const uint8_t fl_con = src[0] | c->pan[channel];
+	if (regs[0] != fl_con)
+	{
+		opm_put(OPM_CH_PAN_FL_CON + channel, fl_con);
+		regs[0] = fl_con;
+		written++;
+	}
+	for (uint8_t i = 1; i < X68K_OPM_VOICE_REGS; i++)
+	{
+		if (regs[i] == src[i]) continue;
+		opm_put(s_voice_reg[i] + channel, src[i]);
+		regs[i] = src[i];
+		written++;
+	}
+	return written;
+}
+
+void x68k_opm_voice_set_pan(X68kOpmVoiceCache *c, uint8_t channel,
+                            uint8_t pan)
+{
+	c->pan[channel] = pan;
+	if (!(c->valid & (1 << channel))) return;
+	const uint8_t fl_con = (c->regs[channel][0] & 0x3F) | pan;
+	if (fl_con == c->regs[channel][0]) return;
+	opm_put(OPM_CH_PAN_FL_CON + channel, fl_con);
+	c->regs[channel][0] = fl_con;
+}
+
+void x68k_opm_voice_key_on(uint8_t channel, const X68kOpmVoice *v)
+{
+	opm_put(OPM_REG_KEY_ON, channel | (v->slots << 3));
+}
+
+void x68k_opm_voice_key_off(uint8_t channel)
+{
+	opm_put(OPM_REG_KEY_ON, channel);
+}
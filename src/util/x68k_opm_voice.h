@@ -0,0 +1,102 @@
+/*
+
+OPM voice banks (opm_voice)
+
+Instruments stored as the register bytes they load, so a patch change is a
+run of plain writes instead of 26 calls to the x68k_opm_set_* inlines that
+each pack their own fields.
+
+Each X68kOpmVoice holds, in write order:
+
+	fl_con    $20+ch  Feedback and connection; pan comes from the channel
+	pms_ams   $38+ch
+	op[0][]   $40+ch  DT1/MUL for M1, M2, C1, C2 ($40, $48, $50, $58)
+	op[1][]   $60+ch  TL
+	op[2][]   $80+ch  KS/AR
+	op[3][]   $A0+ch  AME/D1R
+	op[4][]   $C0+ch  DT2/D2R
+	op[5][]   $E0+ch  D1L/RR
+
+followed by the slot mask used for key-on and a pad byte. Register addresses
+are implicit, and relative to the channel, so one voice loads on any channel.
+
+Writes wait for the busy flag once per register: the OPM only goes busy after
+a data write, so the address can follow the wait straight away.
+
+X68kOpmVoiceCache keeps the bytes last loaded on each channel. Loading
+through x68k_opm_voice_load_diff() only writes the registers that differ,
+which for instruments sharing an envelope is a handful of writes. If a
+channel's registers are written some other way (e.g. TL for volume), call
+x68k_opm_voice_invalidate() or update the cache.
+
+Bank files (from tools/opmconv):
+
+	+0  'XOPM'
+	+4  Version (1), big-endian word
+	+6  Number of voices, big-endian word
+	+8  X68kOpmVoice records, 28 bytes each
+
+*/
+#ifndef X68K_OPM_VOICE_H
+#define X68K_OPM_VOICE_H
+
+#include <stdint.h>
+
+#define X68K_OPM_VOICE_REGS 26
+#define X68K_OPM_NUM_CHANNELS 8
+
+typedef struct X68kOpmVoice
+{
+	uint8_t fl_con;
+	uint8_t pms_ams;
+	uint8_t op[6][4];
+	uint8_t slots;  // Key-on slot mask (SN), 0 - F
+	uint8_t pad;
+} X68kOpmVoice;
+
+typedef struct X68kOpmVoiceCache
+{
+	uint8_t regs[X68K_OPM_NUM_CHANNELS][X68K_OPM_VOICE_REGS];
+	uint8_t pan[X68K_OPM_NUM_CHANNELS];  // X68K_OPM_PAN_* bits
+	uint8_t valid;  // One bit per channel
+} X68kOpmVoiceCache;
+
+// Banks =====================================================================
+
+// Returns the number of voices, or -1 if `bank` isn't a voice bank.
+int x68k_opm_bank_check(const void *bank);
+
+static inline const X68kOpmVoice *x68k_opm_bank_voice(const void *bank,
+                                                      uint16_t idx)
+{
+	return (const X68kOpmVoice *)((const uint8_t *)bank + 8) + idx;
+}
+
+// Loading ===================================================================
+
+// Writes all of a voice's registers. pan is X68K_OPM_PAN_* bits.
+void x68k_opm_voice_load(uint8_t channel, const X68kOpmVoice *v, uint8_t pan);
+
+// Sets all channels centered and invalid.
+void x68k_opm_voice_cache_init(X68kOpmVoiceCache *c);
+
+// Writes only the registers that differ from what the cache says is loaded.
+// Returns the number of registers written.
+uint8_t x68k_opm_voice_load_diff(X68kOpmVoiceCache *c, uint8_t channel,
+                                 const X68kOpmVoice *v);
+
+// Sets a channel's pan, rewriting $20+ch if it's changed.
+void x68k_opm_voice_set_pan(X68kOpmVoiceCache *c, uint8_t channel,
+                            uint8_t pan);
+
+static inline void x68k_opm_voice_invalidate(X68kOpmVoiceCache *c,
+                                             uint8_t channel)
+{
+	c->valid &= ~(1 << channel);
+}
+
+// Keys the voice's slots on, or all slots off.
+void x68k_opm_voice_key_on(uint8_t channel, const X68kOpmVoice *v);
+void x68k_opm_voice_key_off(uint8_t channel);
+
+#endif  // X68K_OPM_VOICE_H
@@ -0,0 +1,125 @@
+#include "util/x68k_pcgload.h"
+#include "x68000/x68k_pcg.h"
+
+#define PCGLOAD_BLOCK_MASK (X68K_PCGLOAD_BLOCK - 1)
+
+static inline volatile uint8_t *pcg_data(uint16_t offset)
+{
+	return (volatile uint8_t *)PCG_TILE_DATA + offset;
+}
+
+// Immediate copies ==========================================================
+
+void x68k_pcgload_8x8(const void *src, uint16_t first, uint16_t count)
+{
+	x68k_pcgload_copy(src, pcg_data(first * 32), count);
+}
+
+void x68k_pcgload_16x16(const void *src, uint16_t first, uint16_t count)
+{
+	x68k_pcgload_copy(src, pcg_data(first * 128), count * 4);
+}
+
+// Scheduled copies ==========================================================
+
+void x68k_pcgload_init(X68kPcgLoad *l, uint16_t budget,
+                       uint16_t bulk_threshold)
+{
+	l->head = 0;
+	l->count = 0;
+	l->scene_change = 0;
+	l->budget = budget & ~PCGLOAD_BLOCK_MASK;
+	l->bulk_threshold = bulk_threshold & ~PCGLOAD_BLOCK_MASK;
+	l->bytes_frame = 0;
+	l->bytes_peak = 0;
+	l->bytes_total = 0;
+	l->blanked_loads = 0;
+}
+
+static int pcgload_queue(X68kPcgLoad *l, const void *src, uint16_t offset,
+                         uint16_t size)
+{
+	if (l->count >= X68K_PCGLOAD_QUEUE_LEN) return -1;
+	if (!size) return 0;
+	X68kPcgLoadXfer *x =
+	    &l->queue[(l->head + l->count) % X68K_PCGLOAD_QUEUE_LEN];
+	x->src = (const uint8_t *)src;
+	x->offset = offset;
+	x->size = size;
+	l->count++;
+	return 0;
+}
+
+int x68k_pcgload_queue_8x8(X68kPcgLoad *l, const void *src, uint16_t first,
+                           uint16_t count)
+{
+	return pcgload_queue(l, src, first * 32, count * 32);
+}
+
+int x68k_pcgload_queue_16x16(X68kPcgLoad *l, const void *src, uint16_t first,
+                             uint16_t count)
+{
+	return pcgload_queue(l, src, first * 128, count * 128);
+}
+
+// Copies up to `max` bytes of the transfer at the head of the queue, and
+// retires it once it's done. Returns the bytes copied.
+static uint16_t pcgload_step(X68kPcgLoad *l, uint16_t max)
+{
+	X68kPcgLoadXfer *x = &l->queue[l->head];
+	const uint16_t len = (x->size < max) ? x->size : max;
+	x68k_pcgload_copy(x->src, pcg_data(x->offset), len / X68K_PCGLOAD_BLOCK);
+	x->src += len;
+	x->offset += len;
+	x->size -= len;
+	if (!x->size)
+	{
+		l->head = (l->head + 1) % X68K_PCGLOAD_QUEUE_LEN;
+		l->count--;
+	}
+	return len;
+}
+
+static uint16_t pcgload_blanked(X68kPcgLoad *l, uint8_t all)
+{
+	uint16_t bytes = 0;
+	x68k_pcg_set_disp_en(0);
+	do
+	{
+		bytes += pcgload_step(l, l->queue[l->head].size);
+	} while (all && l->count);
+	x68k_pcg_set_disp_en(1);
+	l->blanked_loads++;
+	return bytes;
+}
+
+void x68k_pcgload_vblank(X68kPcgLoad *l)
+{
+	uint16_t left = l->budget;
+	uint16_t bytes = 0;
+	while (l->count)
+	{
+		const X68kPcgLoadXfer *x = &l->queue[l->head];
+		if (l->scene_change && x->size > l->bulk_threshold)
+		{
+			bytes += pcgload_blanked(l, 0);
+			continue;
+		}
+		if (!left) break;
+		const uint16_t len = pcgload_step(l, left);
+		left -= len;
+		bytes += len;
+	}
+	l->bytes_frame = bytes;
+	if (bytes > l->bytes_peak) l->bytes_peak = bytes;
+	l->bytes_total += bytes;
+}
+
+void x68k_pcgload_flush(X68kPcgLoad *l)
+{
+	if (!l->count) return;
+	const uint16_t bytes = pcgload_blanked(l, 1);
+	l->bytes_frame = bytes;
+	if (bytes > l->bytes_peak) l->bytes_peak = bytes;
+	l->bytes_total += bytes;
+}
@@ -0,0 +1,102 @@
+/*
+
+PCG pattern upload (pcgload)
+
+Copies pattern data into PCG_TILE_DATA with unrolled movem.l bursts, and
+schedules larger loads so they don't need ad-hoc loops at each call site.
+
+Patterns are expected in the PCG_TILE_DATA layout, as written by
+tools/pcgconv: 32 bytes per 8x8 pattern, and 128 bytes per 16x16 pattern
+(four 8x8 blocks). Pattern numbers are in the given size, so 16x16 pattern n
+starts at 8x8 pattern n * 4.
+
+Immediate copies: x68k_pcgload_8x8() and x68k_pcgload_16x16() write right
+away, with the display as it is.
+
+Scheduled copies: x68k_pcgload_queue_8x8() and x68k_pcgload_queue_16x16() add
+a transfer to an X68kPcgLoad, and x68k_pcgload_vblank() works through the
+queue once per frame. Each frame gets a budget of bytes to copy with the
+display on, which should fit in vertical blank; transfers bigger than that
+are split across frames.
+
+While a scene change is in progress (x68k_pcgload_set_scene_change()), any
+transfer larger than the bulk threshold is instead done all at once with PCG
+output blanked through x68k_pcg_set_disp_en(), where CPU access to PCG memory
+doesn't wait on the display. The screen is dark for a frame or so, which is
+usually fine between scenes. x68k_pcgload_flush() does the same for the whole
+queue.
+
+Statistics: the bytes copied in the last frame and the peak since init, to
+tune the per-frame budget against what the game actually uploads.
+
+*/
+#ifndef X68K_PCGLOAD_H
+#define X68K_PCGLOAD_H
+
+#include <stdint.h>
+
+#define X68K_PCGLOAD_QUEUE_LEN 16
+#define X68K_PCGLOAD_BLOCK 32  // One 8x8 pattern
+
+typedef struct X68kPcgLoadXfer
+{
+	const uint8_t *src;
+	uint16_t offset;  // Bytes into PCG_TILE_DATA
+	uint16_t size;    // Bytes left; a multiple of X68K_PCGLOAD_BLOCK
+} X68kPcgLoadXfer;
+
+typedef struct X68kPcgLoad
+{
+	X68kPcgLoadXfer queue[X68K_PCGLOAD_QUEUE_LEN];
+	uint8_t head;
+	uint8_t count;
+	uint8_t scene_change;
+	uint16_t budget;          // Bytes per frame with the display on
+	uint16_t bulk_threshold;  // Bigger transfers blank during scene changes
+
+	// Statistics
+	uint16_t bytes_frame;  // Copied in the last x68k_pcgload_vblank()
+	uint16_t bytes_peak;
+	uint32_t bytes_total;
+	uint16_t blanked_loads;
+} X68kPcgLoad;
+
+// Copies 32-byte blocks to PCG memory.
+void x68k_pcgload_copy(const void *src, volatile void *dst,
+                       uint16_t blocks);  // <-- x68k_pcgload_copy.s
+
+// Immediate copies ==========================================================
+
+void x68k_pcgload_8x8(const void *src, uint16_t first, uint16_t count);
+void x68k_pcgload_16x16(const void *src, uint16_t first, uint16_t count);
+
+// Scheduled copies ==========================================================
+
+// budget and bulk_threshold are in bytes, and are rounded down to whole 8x8
+// patterns.
+void x68k_pcgload_init(X68kPcgLoad *l, uint16_t budget,
+                       uint16_t bulk_threshold);
+
+// Returns nonzero if the queue is full.
+int x68k_pcgload_queue_8x8(X68kPcgLoad *l, const void *src, uint16_t first,
+                           uint16_t count);
+int x68k_pcgload_queue_16x16(X68kPcgLoad *l, const void *src, uint16_t first,
+                             uint16_t count);
+
+static inline void x68k_pcgload_set_scene_change(X68kPcgLoad *l, uint8_t on)
+{
+	l->scene_change = on;
+}
+
+// Call once per frame, during vertical blank.
+void x68k_pcgload_vblank(X68kPcgLoad *l);
+
+// Copies everything queued now, with PCG output blanked.
+void x68k_pcgload_flush(X68kPcgLoad *l);
+
+static inline uint8_t x68k_pcgload_pending(const X68kPcgLoad *l)
+{
+	return l->count;
+}
+
+#endif  // X68K_PCGLOAD_H
@@ -0,0 +1,44 @@
+; void x68k_pcgload_copy(const void *src, volatile void *dst, uint16_t blocks);
+; Copies `blocks` 32-byte blocks (one 8x8 pattern each), 128 bytes per loop.
+;
+; d0 = blocks left over after the 128-byte loop
+; d1 = 128-byte loop count
+; d2-d7/a2-a3 = one block in flight
+; a0 = src, a1 = dst
+
+	align 2
+.global	x68k_pcgload_copy
+
+x68k_pcgload_copy:
+	move.l	4(sp), a0
+	move.l	8(sp), a1
+	move.w	14(sp), d0
+	movem.l	d2-d7/a2-a3, -(sp)
+	move.w	d0, d1
+	lsr.w	#2, d1
+	andi.w	#3, d0
+	bra.s	.quad_next
+
+.quad:
+	movem.l	(a0)+, d2-d7/a2-a3
+	movem.l	d2-d7/a2-a3, (a1)
+	movem.l	(a0)+, d2-d7/a2-a3
+	movem.l	d2-d7/a2-a3, 32(a1)
+	movem.l	(a0)+, d2-d7/a2-a3
+	movem.l	d2-d7/a2-a3, 64(a1)
+	movem.l	(a0)+, d2-d7/a2-a3
+	movem.l	d2-d7/a2-a3, 96(a1)
+	lea	128(a1), a1
+.quad_next:
+	dbra	d1, .quad
+	bra.s	.one_next
+
+.one:
+	movem.l	(a0)+, d2-d7/a2-a3
+	movem.l	d2-d7/a2-a3, (a1)
+	lea	32(a1), a1
+.one_next:
+	dbra	d0, .one
+
+	movem.l	(sp)+, d2-d7/a2-a3
+	rts
@@ -0,0 +1,298 @@
+#include "util/x68k_raster.h"
+#include "x68000/x68k_cpu.h"
+#include "x68000/x68k_crtc.h"
+
+#define RASTER_PAGE_SIZE 0x80000
+
+void x68k_raster_init(X68kRaster *r, X68kRasterMode mode, uint8_t page)
+{
+	switch (mode)
+	{
+		default:
+		case X68K_RASTER_16:
+			r->base = (volatile uint16_t *)(GVRAM_BASE +
+			                                (page & 3) * RASTER_PAGE_SIZE);
+			r->pitch_shift = 9;
+			r->mask = 0x0F;
+			break;
+		case X68K_RASTER_256:
+			r->base = (volatile uint16_t *)(GVRAM_BASE +
+			                                (page & 1) * RASTER_PAGE_SIZE);
+			r->pitch_shift = 9;
+			r->mask = 0xFF;
+			break;
+		case X68K_RASTER_16_1024:
+			r->base = (volatile uint16_t *)GVRAM_BASE;
+			r->pitch_shift = 10;
+			r->mask = 0x0F;
+			break;
+	}
+	const int16_t last = (1 << r->pitch_shift) - 1;
+	x68k_raster_set_clip(r, 0, 0, last, last);
+}
+
+void x68k_raster_set_clip(X68kRaster *r, int16_t x0, int16_t y0, int16_t x1,
+                          int16_t y1)
+{
+	// Anything past the page would be drawn into the next one, or past the
+	// end of GVRAM.
+	const int16_t last = (1 << r->pitch_shift) - 1;
+	if (x0 < 0) x0 = 0;
+	if (y0 < 0) y0 = 0;
+	if (x1 > last) x1 = last;
+	if (y1 > last) y1 = last;
+	r->clip_x0 = x0;
+	r->clip_y0 = y0;
+	r->clip_x1 = x1;
+	r->clip_y1 = y1;
+}
+
+// Divides rounding toward negative or positive infinity; den > 0.
+static inline int32_t floor_div(int32_t num, int32_t den)
+{
+	const int32_t q = num / den;
+	return (q * den > num) ? q - 1 : q;
+}
+
+static inline int32_t ceil_div(int32_t num, int32_t den)
+{
+	const int32_t q = num / den;
+	return (q * den < num) ? q + 1 : q;
+}
+
+// Spans =====================================================================
+
+// x0 through x1, already clipped.
+static void raster_span(const X68kRaster *r, int16_t y, int16_t x0,
+                        int16_t x1, uint16_t color)
+{
+	g_x68k_cpu->fill(r->base + ((int32_t)y << r->pitch_shift) + x0, color,
+	                 (uint32_t)(x1 - x0 + 1) * 2);
+}
+
+void x68k_raster_hline(const X68kRaster *r, int16_t x0, int16_t x1, int16_t y,
+                       uint16_t color)
+{
+	if (y < r->clip_y0 || y > r->clip_y1) return;
+	if (x0 > x1)
+	{
+		const int16_t t = x0;
+		x0 = x1;
+		x1 = t;
+	}
+	if (x0 < r->clip_x0) x0 = r->clip_x0;
+	if (x1 > r->clip_x1) x1 = r->clip_x1;
+	if (x0 > x1) return;
+	raster_span(r, y, x0, x1, color & r->mask);
+}
+
+// Lines =====================================================================
+
+void x68k_raster_line(const X68kRaster *r, int16_t x0, int16_t y0,
+                      int16_t x1, int16_t y1, uint16_t color)
+{
+	const int16_t dx = (x1 < x0) ? (x0 - x1) : (x1 - x0);
+	const int16_t dy = (y1 < y0) ? (y0 - y1) : (y1 - y0);
+	const int16_t sx = (x1 < x0) ? -1 : 1;
+	const int16_t sy = (y1 < y0) ? -1 : 1;
+	const uint8_t x_major = dx >= dy;
+
+	// A single point; the stepping below would divide by zero.
+	if (!dx && !dy)
+	{
+		if (x0 < r->clip_x0 || x0 > r->clip_x1 || y0 < r->clip_y0 ||
+		    y0 > r->clip_y1)
+		{
+			return;
+		}
+		r->base[((int32_t)y0 << r->pitch_shift) + x0] = color & r->mask;
+		return;
+	}
+
+	// Work in terms of the major axis (a) and the minor one (b).
+	const int16_t major = x_major ? dx : dy;
+	const int16_t minor = x_major ? dy : dx;
+	const int16_t a0 = x_major ? x0 : y0;
+	const int16_t b0 = x_major ? y0 : x0;
+	const int16_t sa = x_major ? sx : sy;
+	const int16_t sb = x_major ? sy : sx;
+	const int16_t amin = x_major ? r->clip_x0 : r->clip_y0;
+	const int16_t amax = x_major ? r->clip_x1 : r->clip_y1;
+	const int16_t bmin = x_major ? r->clip_y0 : r->clip_x0;
+	const int16_t bmax = x_major ? r->clip_y1 : r->clip_x1;
+
+	// Steps i = 0 .. major that land inside the viewport on the major axis.
+	int32_t i_lo = (sa > 0) ? (amin - a0) : (a0 - amax);
+	int32_t i_hi = (sa > 0) ? (amax - a0) : (a0 - amin);
+	if (i_lo < 0) i_lo = 0;
+	if (i_hi > major) i_hi = major;
+
+	// Minor offsets k = 0 .. minor inside it on the minor axis, and the steps
+	// that produce them.
+	int32_t k_lo = (sb > 0) ? (bmin - b0) : (b0 - bmax);
+	int32_t k_hi = (sb > 0) ? (bmax - b0) : (b0 - bmin);
+	if (k_lo < 0) k_lo = 0;
+	if (k_hi > minor) k_hi = minor;
+	if (k_lo > k_hi) return;
+	if (minor)
+	{
+		const int32_t lo = ceil_div(2 * (int32_t)major * k_lo - major,
+		                            2 * (int32_t)minor);
+		const int32_t hi = floor_div(2 * (int32_t)major * (k_hi + 1) -
+		                             major - 1, 2 * (int32_t)minor);
+		if (lo > i_lo) i_lo = lo;
+		if (hi < i_hi) i_hi = hi;
+	}
+	if (i_lo > i_hi) return;
+
+	// Error term at the first step drawn.
+	const int32_t den = 2 * (int32_t)major;
+	const int32_t t = 2 * i_lo * minor + major;
+	int32_t k = t / den;
+	int32_t rem = t - k * den;
+
+	const int16_t a = a0 + sa * (int16_t)i_lo;
+	const int16_t b = b0 + sb * (int16_t)k;
+	const int16_t px = x_major ? a : b;
+	const int16_t py = x_major ? b : a;
+	volatile uint16_t *p = r->base + ((int32_t)py << r->pitch_shift) + px;
+	const int32_t line = (int32_t)1 << r->pitch_shift;
+	const int32_t step_a = x_major ? sa : sa * line;
+	const int32_t step_b = x_major ? sb * line : sb;
+	const int16_t rem_step = 2 * minor;
+	color &= r->mask;
+
+	for (int16_t n = i_hi - i_lo; n >= 0; n--)
+	{
+		*p = color;
+		p += step_a;
+		rem += rem_step;
+		if (rem >= den)
+		{
+			rem -= den;
+			p += step_b;
+		}
+	}
+}
+
+// Triangles =================================================================
+
+// An edge, stepped one scanline at a time. q is the first pixel whose center
+// is at or right of the edge.
+typedef struct RasterEdge
+{
+	int16_t q;
+	int16_t q_step;
+	int32_t rem;
+	int32_t rem_step;
+	int32_t den;
+} RasterEdge;
+
+// Sets up an edge from (xa, ya) to (xb, yb), with yb > ya, at scanline ys.
+static void edge_init(RasterEdge *e, int16_t xa, int16_t ya, int16_t xb,
+                      int16_t yb, int16_t ys)
+{
+	const int32_t dx = xb - xa;
+	const int32_t dy = yb - ya;
+	// Pixel px is right of the edge at the center of line ys if
+	// (2 * px + 1) * dy >= 2 * xa * dy + (2 * ys + 1 - 2 * ya) * dx.
+	const int32_t num = 2 * xa * dy + (2 * (int32_t)ys + 1 - 2 * ya) * dx - dy;
+	e->den = 2 * dy;
+	e->q = ceil_div(num, e->den);
+	e->rem = (int32_t)e->q * e->den - num;
+	e->q_step = floor_div(2 * dx, e->den);
+	e->rem_step = 2 * dx - (int32_t)e->q_step * e->den;
+}
+
+static inline void edge_step(RasterEdge *e)
+{
+	e->q += e->q_step;
+	e->rem -= e->rem_step;
+	if (e->rem < 0)
+	{
+		e->rem += e->den;
+		e->q++;
+	}
+}
+
+// Fills lines y_top to y_bot - 1 between two edges.
+static void raster_section(const X68kRaster *r, const X68kRasterPoint *l0,
+                           const X68kRasterPoint *l1,
+                           const X68kRasterPoint *r0,
+                           const X68kRasterPoint *r1, int16_t y_top,
+                           int16_t y_bot, uint16_t color)
+{
+	if (y_top < r->clip_y0) y_top = r->clip_y0;
+	if (y_bot > r->clip_y1 + 1) y_bot = r->clip_y1 + 1;
+	if (y_top >= y_bot) return;
+
+	RasterEdge le, re;
+	edge_init(&le, l0->x, l0->y, l1->x, l1->y, y_top);
+	edge_init(&re, r0->x, r0->y, r1->x, r1->y, y_top);
+	for (int16_t y = y_top; y < y_bot; y++)
+	{
+		int16_t xl = le.q;
+		int16_t xr = re.q - 1;
+		if (xl < r->clip_x0) xl = r->clip_x0;
+		if (xr > r->clip_x1) xr = r->clip_x1;
+		if (xl <= xr) raster_span(r, y, xl, xr, color);
+		edge_step(&le);
+		edge_step(&re);
+	}
+}
+
+void x68k_raster_tri(const X68kRaster *r, const X68kRasterPoint *v,
+                     uint16_t color)
+{
+	// Sort top to bottom.
+	const X68kRasterPoint *p0 = &v[0];
+	const X68kRasterPoint *p1 = &v[1];
+	const X68kRasterPoint *p2 = &v[2];
+	const X68kRasterPoint *t;
+	if (p1->y < p0->y) { t = p0; p0 = p1; p1 = t; }
+	if (p2->y < p1->y) { t = p1; p1 = p2; p2 = t; }
+	if (p1->y < p0->y) { t = p0; p0 = p1; p1 = t; }
+	if (p0->y == p2->y) return;
+
+	// Which side of the long edge p0-p2 the middle vertex is on.
+	const int32_t cross = (int32_t)(p1->x - p0->x) * (p2->y - p0->y) -
+	                      (int32_t)(p1->y - p0->y) * (p2->x - p0->x);
+	if (!cross) return;
+	color &= r->mask;
+
+	if (cross > 0)
+	{
+		raster_section(r, p0, p2, p0, p1, p0->y, p1->y, color);
+		raster_section(r, p0, p2, p1, p2, p1->y, p2->y, color);
+	}
+	else
+	{
+		raster_section(r, p0, p1, p0, p2, p0->y, p1->y, color);
+		raster_section(r, p1, p2, p0, p2, p1->y, p2->y, color);
+	}
+}
+
+void x68k_raster_quad(const X68kRaster *r, const X68kRasterPoint *v,
+                      uint16_t color)
+{
+	const X68kRasterPoint second[3] = {v[0], v[2], v[3]};
+	x68k_raster_tri(r, v, color);
+	x68k_raster_tri(r, second, color);
+}
+
+void x68k_raster_tri_outline(const X68kRaster *r, const X68kRasterPoint *v,
+                             uint16_t color)
+{
+	x68k_raster_line(r, v[0].x, v[0].y, v[1].x, v[1].y, color);
+	x68k_raster_line(r, v[1].x, v[1].y, v[2].x, v[2].y, color);
+	x68k_raster_line(r, v[2].x, v[2].y, v[0].x, v[0].y, color);
+}
+
+void x68k_raster_quad_outline(const X68kRaster *r, const X68kRasterPoint *v,
+                              uint16_t color)
+{
+	x68k_raster_line(r, v[0].x, v[0].y, v[1].x, v[1].y, color);
+	x68k_raster_line(r, v[1].x, v[1].y, v[2].x, v[2].y, color);
+	x68k_raster_line(r, v[2].x, v[2].y, v[3].x, v[3].y, color);
+	x68k_raster_line(r, v[3].x, v[3].y, v[0].x, v[0].y, color);
+}
@@ -0,0 +1,89 @@
+/*
+
+Graphic plane rasterizer (raster)
+
+Filled triangles and quads, horizontal spans and lines drawn straight into
+GVRAM, for when IOCS _LINE / _FILL are too slow to animate with.
+
+Layouts: in the 16 and 256 color modes every pixel is one word of GVRAM,
+holding the color in its low 4 or 8 bits. A 512 x 512 page has 512 pixels
+per line; 16 color pages are $80000 bytes apart (GP0-GP3), as are the two 256
+color pages. X68K_RASTER_16_1024 is the 1024 x 1024 real screen, with 1024
+pixels per line. Spans are filled with the g_x68k_cpu fill kernel.
+
+Clipping: everything is clipped to the viewport given to
+x68k_raster_set_clip(), inclusive on all sides, which defaults to the whole
+page and is kept within it. Coordinates outside it are fine, from -4096 to
+4095.
+
+Fill rules, which tools/rastref reproduces exactly:
+
+* A pixel is covered by a triangle if its center is inside it. Centers on a
+  left edge are covered; on a right edge they aren't. Triangles sharing an
+  edge never overlap or leave a gap.
+* Quads are drawn as the triangles (v0, v1, v2) and (v0, v2, v3).
+* Lines are Bresenham lines with both ends drawn. Along the major axis, step
+  i has its minor coordinate offset by (2 * i * minor + major) / (2 * major),
+  rounded down.
+
+Triangle edges are stepped with an integer quotient and remainder per
+scanline, set up with one divide per edge, so the inner loops never divide.
+Clipping is exact: a clipped primitive draws the same pixels as the unclipped
+one would inside the viewport.
+
+*/
+#ifndef X68K_RASTER_H
+#define X68K_RASTER_H
+
+#include <stdint.h>
+
+typedef enum X68kRasterMode
+{
+	X68K_RASTER_16,
+	X68K_RASTER_256,
+	X68K_RASTER_16_1024,
+} X68kRasterMode;
+
+typedef struct X68kRaster
+{
+	volatile uint16_t *base;
+	uint8_t pitch_shift;  // log2 of pixels per line
+	uint16_t mask;        // Color bits
+	int16_t clip_x0;
+	int16_t clip_y0;
+	int16_t clip_x1;
+	int16_t clip_y1;
+} X68kRaster;
+
+typedef struct X68kRasterPoint
+{
+	int16_t x;
+	int16_t y;
+} X68kRasterPoint;
+
+// `page` picks GP0-GP3 in X68K_RASTER_16, or 0-1 in X68K_RASTER_256.
+void x68k_raster_init(X68kRaster *r, X68kRasterMode mode, uint8_t page);
+
+// Clamped to the page; a viewport entirely off the page draws nothing.
+void x68k_raster_set_clip(X68kRaster *r, int16_t x0, int16_t y0, int16_t x1,
+                          int16_t y1);
+
+// Fills x0 through x1 (inclusive) of line y.
+void x68k_raster_hline(const X68kRaster *r, int16_t x0, int16_t x1, int16_t y,
+                       uint16_t color);
+
+void x68k_raster_line(const X68kRaster *r, int16_t x0, int16_t y0,
+                      int16_t x1, int16_t y1, uint16_t color);
+
+void x68k_raster_tri(const X68kRaster *r, const X68kRasterPoint *v,
+                     uint16_t color);
+void x68k_raster_quad(const X68kRaster *r, const X68kRasterPoint *v,
+                      uint16_t color);
+
+// Outlines, with lines between successive points.
+void x68k_raster_tri_outline(const X68kRaster *r, const X68kRasterPoint *v,
+                             uint16_t color);
+void x68k_raster_quad_outline(const X68kRaster *r, const X68kRasterPoint *v,
+                              uint16_t color);
+
+#endif  // X68K_RASTER_H
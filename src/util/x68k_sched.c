@@ -0,0 +1,239 @@
+#include "util/x68k_sched.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef X68K_SCHED_HOST
+#include <time.h>
+#else
+#include "x68000/x68k_vbl.h"
+#include "irq.h"
+#include <iocs.h>
+#endif
+
+static X68kSched *s_sched;
+
+// Timing ====================================================================
+
+#ifdef X68K_SCHED_HOST
+
+static struct timespec s_frame_start;
+
+static void sched_restart_timer(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &s_frame_start);
+}
+
+uint32_t x68k_sched_now(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - s_frame_start.tv_sec) * 1000000 +
+	       (now.tv_nsec - s_frame_start.tv_nsec) / 1000;
+}
+
+static void sched_wait_vblank(uint8_t late)
+{
+	(void)late;
+}
+
+static void sched_switch(X68kSchedCtx *save, const X68kSchedCtx *load)
+{
+	swapcontext(&save->uc, &load->uc);
+}
+
+#else
+
+// Timer-D underflow count, incremented by g_irq_sched_timer_d.
+volatile uint32_t g_x68k_sched_ovf;
+
+// See x68k_bench.c.
+#define TCDCR_C_MASK 0x0070
+#define TCDCR_D_DIV4 0x0001
+
+static void sched_restart_timer(void)
+{
+	mfp.tcdcr &= TCDCR_C_MASK;
+	mfp.tddr = 0;
+	g_x68k_sched_ovf = 0;
+	mfp.tcdcr = (mfp.tcdcr & TCDCR_C_MASK) | TCDCR_D_DIV4;
+}
+
+// Timer-D counts down from 256 at 1MHz. The underflow count is read again
+// until it holds still across the counter read.
+uint32_t x68k_sched_now(void)
+{
+	uint32_t ovf;
+	uint8_t count;
+	do
+	{
+		ovf = g_x68k_sched_ovf;
+		count = mfp.tddr & 0xFF;
+	} while (ovf != g_x68k_sched_ovf);
+	return (ovf << 8) + ((256 - count) & 0xFF);
+}
+
+// Waits for the start of vertical blank. If the last frame ran late and it's
+// already blanking, the frame starts now instead of a whole frame later.
+static void sched_wait_vblank(uint8_t late)
+{
+	if (late && !(mfp.gpdr & GPIP_VDISP)) return;
+	x68k_vbl_wait_for_vdisp();
+	x68k_vbl_wait_for_vblank();
+}
+
+#define sched_switch x68k_sched_switch
+
+#endif
+
+// Setup =====================================================================
+
+int x68k_sched_init(X68kSched *s, uint16_t frame_us, uint16_t margin_us)
+{
+	memset(s, 0, sizeof(*s));
+	s->frame_us = frame_us;
+	s->deadline_us = (margin_us < frame_us) ? frame_us - margin_us : 0;
+#ifndef X68K_SCHED_HOST
+	// 1us units, counter of 256. Someone else has Timer-D if this fails, so
+	// the active scheduler (if any) is left alone.
+	const int ret = _iocs_timerdst(g_irq_sched_timer_d, 1, 0);
+	if (ret) return ret;
+#endif
+	s_sched = s;
+	return 0;
+}
+
+void x68k_sched_shutdown(X68kSched *s)
+{
+	(void)s;
+	s_sched = NULL;
+#ifndef X68K_SCHED_HOST
+	_iocs_timerdst(0, 0, 0);
+#endif
+}
+
+// Every task starts here, on its own stack.
+static void sched_entry(void)
+{
+	X68kSchedTask *t = s_sched->current;
+	t->cfg->fn(t->cfg->arg);
+	t->state = X68K_SCHED_DONE;
+	sched_switch(&t->ctx, &s_sched->main_ctx);
+}
+
+void x68k_sched_add(X68kSched *s, X68kSchedTask *t,
+                    const X68kSchedTaskConfig *c)
+{
+	memset(t, 0, sizeof(*t));
+	t->cfg = c;
+	t->state = X68K_SCHED_NEXT_FRAME;
+
+#ifdef X68K_SCHED_HOST
+	getcontext(&t->ctx.uc);
+	t->ctx.uc.uc_stack.ss_sp = c->stack;
+	t->ctx.uc.uc_stack.ss_size = c->stack_size;
+	t->ctx.uc.uc_link = NULL;
+	makecontext(&t->ctx.uc, sched_entry, 0);
+#else
+	// As if sched_entry() had been called and then switched away at once:
+	// a return address it never uses, the address x68k_sched_switch()
+	// returns to, and d2-d7/a2-a6.
+	uint32_t *sp = (uint32_t *)(((uint32_t)c->stack + c->stack_size) & ~3);
+	*--sp = 0;
+	*--sp = (uint32_t)sched_entry;
+	sp -= 11;
+	memset(sp, 0, 11 * sizeof(uint32_t));
+	t->ctx.sp = sp;
+#endif
+
+	// After any tasks of the same priority.
+	X68kSchedTask **link = &s->tasks;
+	while (*link && (*link)->cfg->prio <= c->prio) link = &(*link)->next;
+	t->next = *link;
+	*link = t;
+}
+
+// Running ===================================================================
+
+uint16_t x68k_sched_frame(X68kSched *s)
+{
+	sched_wait_vblank(s->last_us > s->frame_us);
+	sched_restart_timer();
+	s->frames++;
+	if (s->vblank) s->vblank(s->vblank_ctx);
+
+	uint16_t live = 0;
+	for (X68kSchedTask *t = s->tasks; t; t = t->next)
+	{
+		if (t->state == X68K_SCHED_DONE) continue;
+		live++;
+		if (t->cfg->background && x68k_sched_now() >= s->deadline_us)
+		{
+			continue;
+		}
+
+		t->state = X68K_SCHED_READY;
+		t->used_us = 0;
+		s->current = t;
+		s->slice_start = x68k_sched_now();
+		sched_switch(&s->main_ctx, &t->ctx);
+		const uint32_t end = x68k_sched_now();
+		s->current = NULL;
+
+		t->used_us = end - s->slice_start;
+		t->total_us += t->used_us;
+		if (t->used_us > t->peak_us) t->peak_us = t->used_us;
+		t->frames++;
+		if (end > s->frame_us) t->misses++;
+		if (t->state == X68K_SCHED_DONE) live--;
+	}
+
+	const uint32_t used = x68k_sched_now();
+	s->last_us = (used > 0xFFFF) ? 0xFFFF : used;
+	if (s->last_us > s->peak_us) s->peak_us = s->last_us;
+	if (s->last_us > s->frame_us) s->late_frames++;
+	return live;
+}
+
+void x68k_sched_yield(void)
+{
+	X68kSched *s = s_sched;
+	X68kSchedTask *t = s->current;
+	const uint32_t now = x68k_sched_now();
+	const X68kSchedTaskConfig *c = t->cfg;
+	if (c->budget_us && now - s->slice_start >= c->budget_us)
+	{
+		t->over_budget++;
+	}
+	else if (!c->background || now < s->deadline_us)
+	{
+		return;
+	}
+	// Still X68K_SCHED_READY; it carries on from here next frame.
+	sched_switch(&t->ctx, &s->main_ctx);
+}
+
+void x68k_sched_wait_frame(void)
+{
+	X68kSched *s = s_sched;
+	X68kSchedTask *t = s->current;
+	t->state = X68K_SCHED_NEXT_FRAME;
+	sched_switch(&t->ctx, &s->main_ctx);
+}
+
+// Statistics ================================================================
+
+void x68k_sched_print(const X68kSched *s)
+{
+	printf("name,prio,budget_us,frames,avg_us,peak_us,over_budget,misses\n");
+	for (const X68kSchedTask *t = s->tasks; t; t = t->next)
+	{
+		printf("%s,%u,%u,%lu,%lu,%u,%u,%u\n", t->cfg->name,
+		       (unsigned int)t->cfg->prio, (unsigned int)t->cfg->budget_us,
+		       (unsigned long)t->frames,
+		       (unsigned long)(t->frames ? t->total_us / t->frames : 0),
+		       (unsigned int)t->peak_us, (unsigned int)t->over_budget,
+		       (unsigned int)t->misses);
+	}
+	printf("frames,%lu,peak_us,%u,late,%u\n", (unsigned long)s->frames,
+	       (unsigned int)s->peak_us, (unsigned int)s->late_frames);
+}
@@ -0,0 +1,157 @@
+/*
+
+Frame-synchronized cooperative scheduler (sched)
+
+Runs several jobs (game logic, streaming, decompression, AI...) in the time
+between vertical blanks, without turning each of them into a hand-written
+state machine. Every task is a plain function with a stack of its own; it
+gives the CPU back by calling x68k_sched_yield() now and then, and
+x68k_sched_wait_frame() when it's done for the frame.
+
+x68k_sched_frame() is the main loop body. It waits for the start of vertical
+blank, calls the vblank hook, and then runs the tasks in priority order (lower
+prio values first), each until it waits for the next frame, or until it is
+suspended at a yield:
+
+* A task with a budget is suspended once it has used budget_us this frame.
+* A background task is also suspended once the frame deadline approaches
+  (frame_us - margin_us after the start of vertical blank), and isn't started
+  at all past it. The margin should cover the longest stretch a background
+  task goes without yielding.
+
+A suspended task resumes from its yield in the next frame. Yields that don't
+suspend cost a timer read and a compare, so long loops can yield every
+iteration.
+
+Time is measured in microseconds (10 CPU cycles on a stock X68000) with MFP
+Timer-D, restarted at each vertical blank. Timer-D is claimed through IOCS
+_TIMERDST, so the scheduler can't be used together with x68k_bench.
+
+Statistics per task: time used in the last frame, the peak and the total,
+frames suspended for the budget, and deadline misses - slices that were still
+running when frame_us had passed. The scheduler counts late frames, where the
+work of a frame didn't fit before the next vertical blank. x68k_sched_print()
+prints all of it as a comma-separated table.
+
+Stacks: a task's stack also takes any interrupt that arrives while it runs,
+so leave room for IOCS handlers on top of the task's own use; 1KB is a
+reasonable minimum.
+
+Host build: with X68K_SCHED_HOST defined, tasks switch with ucontext, time
+comes from clock_gettime() and frames start right away, so task code can be
+exercised on a PC.
+
+*/
+#ifndef X68K_SCHED_H
+#define X68K_SCHED_H
+
+#include <stdint.h>
+
+#ifdef X68K_SCHED_HOST
+#include <ucontext.h>
+#endif
+
+// Frame lengths, vertical blank to vertical blank.
+#define X68K_SCHED_FRAME_US_15K 16270  // 61.46Hz
+#define X68K_SCHED_FRAME_US_31K 18031  // 55.46Hz
+
+typedef enum X68kSchedState
+{
+	X68K_SCHED_READY,
+	X68K_SCHED_NEXT_FRAME,  // Waiting for the next frame
+	X68K_SCHED_DONE,        // Returned
+} X68kSchedState;
+
+typedef struct X68kSchedCtx
+{
+#ifdef X68K_SCHED_HOST
+	ucontext_t uc;
+#else
+	void *sp;  // Registers are saved on the stack
+#endif
+} X68kSchedCtx;
+
+typedef struct X68kSchedTaskConfig
+{
+	const char *name;
+	void (*fn)(void *arg);
+	void *arg;
+	void *stack;
+	uint32_t stack_size;
+	uint8_t prio;        // Lower values run first
+	uint8_t background;  // Suspended near the frame deadline
+	uint16_t budget_us;  // Per frame; 0 for none
+} X68kSchedTaskConfig;
+
+typedef struct X68kSchedTask
+{
+	X68kSchedCtx ctx;
+	const X68kSchedTaskConfig *cfg;
+	struct X68kSchedTask *next;  // In priority order
+	uint8_t state;
+
+	// Statistics
+	uint16_t used_us;      // In the last frame it ran
+	uint16_t peak_us;
+	uint32_t total_us;
+	uint32_t frames;       // Frames it ran in
+	uint16_t over_budget;  // Frames it was suspended for its budget
+	uint16_t misses;       // Slices that ran past frame_us
+} X68kSchedTask;
+
+typedef struct X68kSched
+{
+	X68kSchedTask *tasks;
+	X68kSchedTask *current;
+	X68kSchedCtx main_ctx;
+	uint16_t frame_us;
+	uint16_t deadline_us;  // Background tasks stop here
+	uint32_t slice_start;
+
+	// Called at the start of every frame, before any task.
+	void (*vblank)(void *ctx);
+	void *vblank_ctx;
+
+	// Statistics
+	uint32_t frames;
+	uint16_t last_us;  // Time the last frame's work took
+	uint16_t peak_us;
+	uint16_t late_frames;
+} X68kSched;
+
+// Only one scheduler can be active. Claims Timer-D; returns nonzero if it is
+// already in use.
+int x68k_sched_init(X68kSched *s, uint16_t frame_us, uint16_t margin_us);
+
+// Releases Timer-D.
+void x68k_sched_shutdown(X68kSched *s);
+
+// Adds a task, which starts in the next frame. `c` must stay valid while the
+// task exists.
+void x68k_sched_add(X68kSched *s, X68kSchedTask *t,
+                    const X68kSchedTaskConfig *c);
+
+// Runs one frame. Returns the number of tasks that haven't returned yet.
+uint16_t x68k_sched_frame(X68kSched *s);
+
+// Microseconds since the current frame started.
+uint32_t x68k_sched_now(void);
+
+// Prints per-task statistics as comma-separated lines, with a header line.
+void x68k_sched_print(const X68kSched *s);
+
+// From within a task ========================================================
+
+// Gives the CPU back if the task is out of time for this frame.
+void x68k_sched_yield(void);
+
+// Suspends the task until the next frame.
+void x68k_sched_wait_frame(void);
+
+#ifndef X68K_SCHED_HOST
+// Saves the callee-saved registers to `save` and loads them from `load`.
+void x68k_sched_switch(X68kSchedCtx *save,
+                       const X68kSchedCtx *load);  // <-- x68k_sched_switch.s
+#endif
+
+#endif  // X68K_SCHED_H
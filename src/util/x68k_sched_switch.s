@@ -0,0 +1,21 @@
+; void x68k_sched_switch(X68kSchedCtx *save, const X68kSchedCtx *load);
+; Pushes the callee-saved registers, stores sp in save, loads sp from load
+; and pops the registers saved there. The rts then returns into whatever
+; called x68k_sched_switch() on the other stack.
+;
+; A new task's stack is set up to look like it was saved here, with the
+; task entry point as the return address (see x68k_sched_add()).
+;
+; a0 = save, a1 = load
+
+	align 2
+.global	x68k_sched_switch
+
+x68k_sched_switch:
+	move.l	4(sp), a0
+	move.l	8(sp), a1
+	movem.l	d2-d7/a2-a6, -(sp)
+	move.l	sp, (a0)
+	movea.l	(a1), sp
+	movem.l	(sp)+, d2-d7/a2-a6
+	rts
@@ -0,0 +1,228 @@
+/*
+
+Compile-time display timing generator (timing)
+
+Builds X68kCrtcConfig, X68kPcgConfig and X68kVidconConfig initializers from
+sync, porch and active area sizes, using the R00 - R07 formulas from Inside
+X68000 (see x68k_crtc.h) and the PCG derivations from x68k_pcg.h. Everything
+is a constant expression, so the tables cost nothing at runtime, and a bad
+configuration fails to compile instead of showing up on a monitor.
+
+A timing is a list of ten values:
+
+	hsync, hbp, hdisp, hfp,   Horizontal, in dots (multiples of 8)
+	vsync, vbp, vdisp, vfp,   Vertical, in CRTC lines
+	r08,                      External H adjust (R08), passed through
+	r20                       CRTC R20; build it with X68K_TIMING_R20()
+
+It is usually kept in a macro of its own and passed along whole:
+
+	#define MY_TIMING 80, 96, 512, 48, 6, 35, 512, 15, 0x1B, \
+	                  X68K_TIMING_R20(1, 1, 1, 0, 0)
+
+	static const X68kDisplayMode s_mode =
+	    X68K_TIMING_MODE(0x12E4, 0x007F, MY_TIMING);
+
+Checks made at compile time:
+
+* Horizontal values are whole character clocks (8 dots).
+* H-total in characters is even, so R00 (and PCG H-total) is odd.
+* The R20 horizontal resolution matches the active width.
+* R20 does not select the invalid resolution or color settings.
+* For the PCG (and so X68K_TIMING_MODE), 768-dot modes are rejected.
+
+The video controller screen register is always taken from R20, and the PCG
+mode register from R20's lower byte, so they can't disagree.
+
+Presets reproducing the sample tables from Inside X68000 are provided below.
+
+*/
+#ifndef X68K_TIMING_H
+#define X68K_TIMING_H
+
+#include "util/x68k_display.h"
+
+// Fails to compile if `cond` is false; otherwise evaluates to zero.
+#define X68K_TIMING_CHECK(cond) (0 * (int)sizeof(char[(cond) ? 1 : -1]))
+
+// CRTC R20.
+// hi:    0 = 15KHz, 1 = 31KHz
+// vres:  0 = 256 lines, 1 = 512 lines
+// hres:  0 = 256 dots, 1 = 512 dots, 3 = 768 dots
+// color: 0 = 16 colors, 1 = 256 colors, 3 = 65536 colors
+// big:   0 = 512 dot plane, 1 = 1024 dot plane
+#define X68K_TIMING_R20(hi, vres, hres, color, big) \
+	(((big) << 10) | ((color) << 8) | ((hi) << 4) | ((vres) << 2) | (hres))
+
+// Register values ===========================================================
+
+#define X68K_TIMING_R00_(hs, hbp, hd, hfp) (((hs) + (hbp) + (hd) + (hfp)) / 8 - 1)
+#define X68K_TIMING_R01_(hs) ((hs) / 8 - 1)
+#define X68K_TIMING_R02_(hs, hbp) (((hs) + (hbp)) / 8 - 5)
+#define X68K_TIMING_R03_(hs, hbp, hd) (X68K_TIMING_R02_(hs, hbp) + (hd) / 8)
+#define X68K_TIMING_R04_(vs, vbp, vd, vfp) ((vs) + (vbp) + (vd) + (vfp) - 1)
+#define X68K_TIMING_R05_(vs) ((vs) - 1)
+#define X68K_TIMING_R06_(vs, vbp) ((vs) + (vbp) - 1)
+#define X68K_TIMING_R07_(vs, vbp, vd) (X68K_TIMING_R06_(vs, vbp) + (vd))
+
+#define X68K_TIMING_HRES_(r20) ((r20) & 0x03)
+#define X68K_TIMING_VRES_(r20) (((r20) >> 2) & 0x03)
+#define X68K_TIMING_COLOR_(r20) (((r20) >> 8) & 0x03)
+
+#define X68K_TIMING_CRTC_OK_(hs, hbp, hd, hfp, r20) \
+	(X68K_TIMING_CHECK((((hs) | (hbp) | (hd) | (hfp)) & 7) == 0) + \
+	 X68K_TIMING_CHECK((X68K_TIMING_R00_(hs, hbp, hd, hfp) & 1) == 1) + \
+	 X68K_TIMING_CHECK(X68K_TIMING_R02_(hs, hbp) >= 0) + \
+	 X68K_TIMING_CHECK(X68K_TIMING_HRES_(r20) != 2) + \
+	 X68K_TIMING_CHECK(X68K_TIMING_VRES_(r20) < 2) + \
+	 X68K_TIMING_CHECK(X68K_TIMING_COLOR_(r20) != 2) + \
+	 X68K_TIMING_CHECK((hd) == ((X68K_TIMING_HRES_(r20) == 3) ? 768 : \
+	                            256 * (X68K_TIMING_HRES_(r20) + 1))))
+
+#define X68K_TIMING_PCG_OK_(r20) \
+	X68K_TIMING_CHECK(X68K_TIMING_HRES_(r20) < 2)
+
+// H-total follows R00 only in 15KHz 256 x 256; otherwise it is $FF.
+#define X68K_TIMING_PCG_HTOTAL_(hs, hbp, hd, hfp, r20) \
+	((((r20) & 0x1F) == 0) ? X68K_TIMING_R00_(hs, hbp, hd, hfp) : 0xFF)
+#define X68K_TIMING_PCG_HDISP_(hs, hbp) (X68K_TIMING_R02_(hs, hbp) + 4)
+#define X68K_TIMING_PCG_VDISP_(vs, vbp) X68K_TIMING_R06_(vs, vbp)
+#define X68K_TIMING_PCG_FLAGS_(r20) ((r20) & 0xFF)
+#define X68K_TIMING_SCREEN_(r20) (((r20) >> 8) & 0x07)
+
+// Initializers ==============================================================
+
+#define X68K_TIMING_CRTC(...) X68K_TIMING_CRTC_(__VA_ARGS__)
+#define X68K_TIMING_CRTC_(hs, hbp, hd, hfp, vs, vbp, vd, vfp, r08, r20) \
+{ \
+	.htotal = X68K_TIMING_R00_(hs, hbp, hd, hfp) + \
+	          X68K_TIMING_CRTC_OK_(hs, hbp, hd, hfp, r20), \
+	.hsync_length = X68K_TIMING_R01_(hs), \
+	.hdisp_start = X68K_TIMING_R02_(hs, hbp), \
+	.hdisp_end = X68K_TIMING_R03_(hs, hbp, hd), \
+	.vtotal = X68K_TIMING_R04_(vs, vbp, vd, vfp), \
+	.vsync_length = X68K_TIMING_R05_(vs), \
+	.vdisp_start = X68K_TIMING_R06_(vs, vbp), \
+	.vdisp_end = X68K_TIMING_R07_(vs, vbp, vd), \
+	.ext_h_adjust = (r08), \
+	.flags = (r20), \
+}
+
+#define X68K_TIMING_PCG(...) X68K_TIMING_PCG_(__VA_ARGS__)
+#define X68K_TIMING_PCG_(hs, hbp, hd, hfp, vs, vbp, vd, vfp, r08, r20) \
+{ \
+	.htotal = X68K_TIMING_PCG_HTOTAL_(hs, hbp, hd, hfp, r20) + \
+	          X68K_TIMING_CRTC_OK_(hs, hbp, hd, hfp, r20) + \
+	          X68K_TIMING_PCG_OK_(r20), \
+	.hdisp = X68K_TIMING_PCG_HDISP_(hs, hbp), \
+	.vdisp = X68K_TIMING_PCG_VDISP_(vs, vbp), \
+	.flags = X68K_TIMING_PCG_FLAGS_(r20), \
+}
+
+#define X68K_TIMING_VIDCON(prio_, flags_, ...) \
+	X68K_TIMING_VIDCON_(prio_, flags_, __VA_ARGS__)
+#define X68K_TIMING_VIDCON_(prio_, flags_, hs, hbp, hd, hfp, vs, vbp, vd, \
+                            vfp, r08, r20) \
+{ \
+	.screen = X68K_TIMING_SCREEN_(r20), \
+	.prio = (prio_), \
+	.flags = (flags_), \
+}
+
+#define X68K_TIMING_MODE(prio_, flags_, ...) \
+{ \
+	.crtc = X68K_TIMING_CRTC(__VA_ARGS__), \
+	.pcg = X68K_TIMING_PCG(__VA_ARGS__), \
+	.vidcon = X68K_TIMING_VIDCON(prio_, flags_, __VA_ARGS__), \
+}
+
+// Presets from Inside X68000 ================================================
+// These are 16-color, 512 dot plane. High-resolution 256-line modes are line
+// doubled, so they still scan 512 CRTC lines.
+
+#define X68K_TIMING_HI_768x512 \
+	120, 144, 768, 72, 6, 35, 512, 15, 0x1B, X68K_TIMING_R20(1, 1, 3, 0, 0)
+#define X68K_TIMING_HI_512x512 \
+	80, 96, 512, 48, 6, 35, 512, 15, 0x1B, X68K_TIMING_R20(1, 1, 1, 0, 0)
+#define X68K_TIMING_HI_512x256 \
+	80, 96, 512, 48, 6, 35, 512, 15, 0x1B, X68K_TIMING_R20(1, 0, 1, 0, 0)
+#define X68K_TIMING_HI_256x256 \
+	40, 48, 256, 24, 6, 35, 512, 15, 0x1B, X68K_TIMING_R20(1, 0, 0, 0, 0)
+#define X68K_TIMING_LO_512x512 \
+	32, 48, 512, 16, 3, 14, 240, 3, 0x2C, X68K_TIMING_R20(0, 1, 1, 0, 0)
+#define X68K_TIMING_LO_512x256 \
+	32, 48, 512, 16, 3, 14, 240, 3, 0x2C, X68K_TIMING_R20(0, 0, 1, 0, 0)
+#define X68K_TIMING_LO_256x256 \
+	16, 24, 256, 8, 3, 14, 240, 3, 0x24, X68K_TIMING_R20(0, 0, 0, 0, 0)
+
+// Register values from the sample tables, R00 - R08 then R20. A preset that
+// drifts from its row fails to compile.
+#define X68K_TIMING_MATCHES(...) X68K_TIMING_MATCHES_(__VA_ARGS__)
+#define X68K_TIMING_MATCHES_(hs, hbp, hd, hfp, vs, vbp, vd, vfp, r08, r20, \
+                             e00, e01, e02, e03, e04, e05, e06, e07, e08, \
+                             e20) \
+	(X68K_TIMING_R00_(hs, hbp, hd, hfp) == (e00) && \
+	 X68K_TIMING_R01_(hs) == (e01) && \
+	 X68K_TIMING_R02_(hs, hbp) == (e02) && \
+	 X68K_TIMING_R03_(hs, hbp, hd) == (e03) && \
+	 X68K_TIMING_R04_(vs, vbp, vd, vfp) == (e04) && \
+	 X68K_TIMING_R05_(vs) == (e05) && \
+	 X68K_TIMING_R06_(vs, vbp) == (e06) && \
+	 X68K_TIMING_R07_(vs, vbp, vd) == (e07) && \
+	 (r08) == (e08) && (r20) == (e20))
+
+_Static_assert(X68K_TIMING_MATCHES(X68K_TIMING_HI_768x512,
+               0x89, 0x0E, 0x1C, 0x7C, 0x237, 0x05, 0x28, 0x228, 0x1B, 0x17),
+               "X68K_TIMING_HI_768x512");
+_Static_assert(X68K_TIMING_MATCHES(X68K_TIMING_HI_512x512,
+               0x5B, 0x09, 0x11, 0x51, 0x237, 0x05, 0x28, 0x228, 0x1B, 0x15),
+               "X68K_TIMING_HI_512x512");
+_Static_assert(X68K_TIMING_MATCHES(X68K_TIMING_HI_512x256,
+               0x5B, 0x09, 0x11, 0x51, 0x237, 0x05, 0x28, 0x228, 0x1B, 0x11),
+               "X68K_TIMING_HI_512x256");
+_Static_assert(X68K_TIMING_MATCHES(X68K_TIMING_HI_256x256,
+               0x2D, 0x04, 0x06, 0x26, 0x237, 0x05, 0x28, 0x228, 0x1B, 0x10),
+               "X68K_TIMING_HI_256x256");
+_Static_assert(X68K_TIMING_MATCHES(X68K_TIMING_LO_512x512,
+               0x4B, 0x03, 0x05, 0x45, 0x103, 0x02, 0x10, 0x100, 0x2C, 0x05),
+               "X68K_TIMING_LO_512x512");
+_Static_assert(X68K_TIMING_MATCHES(X68K_TIMING_LO_512x256,
+               0x4B, 0x03, 0x05, 0x45, 0x103, 0x02, 0x10, 0x100, 0x2C, 0x01),
+               "X68K_TIMING_LO_512x256");
+_Static_assert(X68K_TIMING_MATCHES(X68K_TIMING_LO_256x256,
+               0x25, 0x01, 0x00, 0x20, 0x103, 0x02, 0x10, 0x100, 0x24, 0x00),
+               "X68K_TIMING_LO_256x256");
+
+// PCG values from the table in x68k_pcg.h (H-Total, H-Disp, V-Disp, Flags),
+// then the video controller screen register. 768 x 512 has no PCG row.
+#define X68K_TIMING_PCG_MATCHES(...) X68K_TIMING_PCG_MATCHES_(__VA_ARGS__)
+#define X68K_TIMING_PCG_MATCHES_(hs, hbp, hd, hfp, vs, vbp, vd, vfp, r08, \
+                                 r20, eht, ehd, evd, eflags, escreen) \
+	(X68K_TIMING_PCG_HTOTAL_(hs, hbp, hd, hfp, r20) == (eht) && \
+	 X68K_TIMING_PCG_HDISP_(hs, hbp) == (ehd) && \
+	 X68K_TIMING_PCG_VDISP_(vs, vbp) == (evd) && \
+	 X68K_TIMING_PCG_FLAGS_(r20) == (eflags) && \
+	 X68K_TIMING_SCREEN_(r20) == (escreen))
+
+_Static_assert(X68K_TIMING_SCREEN_(X68K_TIMING_R20(1, 1, 3, 0, 0)) == 0,
+               "X68K_TIMING_HI_768x512 screen");
+_Static_assert(X68K_TIMING_PCG_MATCHES(X68K_TIMING_HI_512x512,
+               0xFF, 0x15, 0x28, 0x15, 0x00),
+               "X68K_TIMING_HI_512x512 PCG");
+_Static_assert(X68K_TIMING_PCG_MATCHES(X68K_TIMING_HI_512x256,
+               0xFF, 0x15, 0x28, 0x11, 0x00),
+               "X68K_TIMING_HI_512x256 PCG");
+_Static_assert(X68K_TIMING_PCG_MATCHES(X68K_TIMING_HI_256x256,
+               0xFF, 0x0A, 0x28, 0x10, 0x00),
+               "X68K_TIMING_HI_256x256 PCG");
+_Static_assert(X68K_TIMING_PCG_MATCHES(X68K_TIMING_LO_512x512,
+               0xFF, 0x09, 0x10, 0x05, 0x00),
+               "X68K_TIMING_LO_512x512 PCG");
+_Static_assert(X68K_TIMING_PCG_MATCHES(X68K_TIMING_LO_512x256,
+               0xFF, 0x09, 0x10, 0x01, 0x00),
+               "X68K_TIMING_LO_512x256 PCG");
+_Static_assert(X68K_TIMING_PCG_MATCHES(X68K_TIMING_LO_256x256,
+               0x25, 0x04, 0x10, 0x00, 0x00),
+               "X68K_TIMING_LO_256x256 PCG");
+
+#endif  // X68K_TIMING_H
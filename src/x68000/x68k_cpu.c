@@ -0,0 +1,194 @@
+#include "x68000/x68k_cpu.h"
+
+#ifdef X68K_CPU_HOST
+#include <string.h>
+#else
+#include <iocs.h>
+#endif
+
+// Kernels ===================================================================
+
+#ifdef X68K_CPU_HOST
+
+// Models of the assembly, block for block. Host pointers needn't be aligned,
+// so longwords go through memcpy.
+
+static void cpu_copy_tail(uint8_t *d, const uint8_t *s, uint32_t bytes)
+{
+	for (uint16_t longs = (bytes & 31) >> 2; longs; longs--)
+	{
+		memcpy(d, s, 4);
+		d += 4;
+		s += 4;
+	}
+	if (bytes & 2) memcpy(d, s, 2);
+}
+
+static void cpu_fill_tail(uint8_t *d, const uint8_t *v, uint32_t bytes)
+{
+	for (uint16_t longs = (bytes & 31) >> 2; longs; longs--)
+	{
+		memcpy(d, v, 4);
+		d += 4;
+	}
+	if (bytes & 2) memcpy(d, v, 2);
+}
+
+// movem.l (a0)+, d1-d7/a2 / movem.l d1-d7/a2, (a1): loads all eight
+// longwords before storing any.
+static void x68k_cpu_copy_000(volatile void *dst, const void *src,
+                              uint32_t bytes)
+{
+	uint8_t *d = (uint8_t *)dst;
+	const uint8_t *s = (const uint8_t *)src;
+	for (uint32_t blocks = bytes >> 5; blocks; blocks--)
+	{
+		uint32_t regs[8];
+		memcpy(regs, s, 32);
+		memcpy(d, regs, 32);
+		d += 32;
+		s += 32;
+	}
+	cpu_copy_tail(d, s, bytes);
+}
+
+static void x68k_cpu_fill_000(volatile void *dst, uint16_t value,
+                              uint32_t bytes)
+{
+	uint8_t *d = (uint8_t *)dst;
+	uint16_t regs[16];
+	for (uint8_t i = 0; i < 16; i++) regs[i] = value;
+	for (uint32_t blocks = bytes >> 5; blocks; blocks--)
+	{
+		memcpy(d, regs, 32);
+		d += 32;
+	}
+	cpu_fill_tail(d, (const uint8_t *)regs, bytes);
+}
+
+// Eight move.l (a0)+, (a1)+ per loop.
+static void x68k_cpu_copy_020(volatile void *dst, const void *src,
+                              uint32_t bytes)
+{
+	uint8_t *d = (uint8_t *)dst;
+	const uint8_t *s = (const uint8_t *)src;
+	for (uint32_t blocks = bytes >> 5; blocks; blocks--)
+	{
+		for (uint8_t i = 0; i < 8; i++)
+		{
+			memcpy(d, s, 4);
+			d += 4;
+			s += 4;
+		}
+	}
+	cpu_copy_tail(d, s, bytes);
+}
+
+static void x68k_cpu_fill_020(volatile void *dst, uint16_t value,
+                              uint32_t bytes)
+{
+	uint8_t *d = (uint8_t *)dst;
+	const uint16_t v[2] = {value, value};
+	for (uint32_t blocks = bytes >> 5; blocks; blocks--)
+	{
+		for (uint8_t i = 0; i < 8; i++)
+		{
+			memcpy(d, v, 4);
+			d += 4;
+		}
+	}
+	cpu_fill_tail(d, (const uint8_t *)v, bytes);
+}
+
+#define CPU_MOVE16_MIN 64
+#define CPU_IO_START 0xC00000
+#define CPU_IO_END 0x1000000
+
+static uint8_t cpu_is_io(uintptr_t a)
+{
+	return a >= CPU_IO_START && a < CPU_IO_END;
+}
+
+// move16 (a0)+, (a1)+ a line at a time, then the 68020 code for the rest.
+static void x68k_cpu_copy_040(volatile void *dst, const void *src,
+                              uint32_t bytes)
+{
+	uint8_t *d = (uint8_t *)dst;
+	const uint8_t *s = (const uint8_t *)src;
+	if (bytes < CPU_MOVE16_MIN || (((uintptr_t)d | (uintptr_t)s) & 15) ||
+	    cpu_is_io((uintptr_t)d) || cpu_is_io((uintptr_t)s))
+	{
+		x68k_cpu_copy_020(dst, src, bytes);
+		return;
+	}
+	for (uint32_t lines = bytes >> 4; lines; lines--)
+	{
+		memcpy(d, s, 16);
+		d += 16;
+		s += 16;
+	}
+	x68k_cpu_copy_020(d, s, bytes & 15);
+}
+
+#endif
+
+static const X68kCpuKernels s_kernels_000 =
+{
+	"68000", x68k_cpu_copy_000, x68k_cpu_fill_000
+};
+
+static const X68kCpuKernels s_kernels_020 =
+{
+	"68020/68030", x68k_cpu_copy_020, x68k_cpu_fill_020
+};
+
+static const X68kCpuKernels s_kernels_040 =
+{
+	"68040/68060", x68k_cpu_copy_040, x68k_cpu_fill_020
+};
+
+const X68kCpuKernels *g_x68k_cpu = &s_kernels_000;
+
+const X68kCpuKernels *x68k_cpu_kernels(uint8_t type)
+{
+	if (type >= X68K_CPU_68040) return &s_kernels_040;
+	if (type >= X68K_CPU_68020) return &s_kernels_020;
+	return &s_kernels_000;
+}
+
+// Detection =================================================================
+
+#ifndef X68K_CPU_HOST
+
+#define CPU_ROMVER_1_3 0x13000000
+#define CPU_SYS_STAT_VECTOR 0x6B0  // IOCS call table entry for $AC
+#define CPU_ROM_START 0xFC0000
+#define CPU_ROM_END 0x1000000
+
+// IOCS calls the ROM doesn't have point back into the ROM; a driver that adds
+// _SYS_STAT points it at RAM.
+static uint8_t cpu_has_sys_stat(void)
+{
+	if ((uint32_t)_iocs_romver() >= CPU_ROMVER_1_3) return 1;
+	const uint32_t vec = _iocs_b_lpeek((const void *)CPU_SYS_STAT_VECTOR);
+	return vec < CPU_ROM_START || vec >= CPU_ROM_END;
+}
+
+#endif
+
+void x68k_cpu_init(X68kCpuInfo *info)
+{
+	X68kCpuInfo found = {X68K_CPU_68000, 0, 0, 0};
+#ifndef X68K_CPU_HOST
+	if (cpu_has_sys_stat())
+	{
+		const uint32_t st = _iocs_sys_stat(0);
+		found.type = st & 0xFF;
+		found.fpu = (st >> 15) & 1;
+		found.mmu = (st >> 14) & 1;
+		found.clock = st >> 16;
+	}
+#endif
+	g_x68k_cpu = x68k_cpu_kernels(found.type);
+	if (info) *info = found;
+}
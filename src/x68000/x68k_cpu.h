@@ -0,0 +1,90 @@
+/*
+
+MPU detection and per-CPU kernels (cpu)
+
+The same program runs on a stock 10MHz X68000, on an X68030, and on 68040 or
+68060 accelerator boards, and the fastest way to move memory is different on
+each. x68k_cpu_init() finds out which MPU is fitted and points g_x68k_cpu at
+the matching set of kernels, which the library's hot loops call:
+
+	copy  Sprite table commit (x68k_pcg_finish_sprites), nametable rows
+	      (x68k_bgbuf_step), GVRAM lines (x68k_gvload)
+	fill  Nametable fill (x68k_bgbuf_step), GVRAM spans (x68k_raster)
+
+Variants:
+
+* 68000/68010: 32 bytes per movem.l pair. On a 16-bit bus with no cache,
+  movem has the least instruction fetch per byte moved.
+* 68020/68030: unrolled move.l loops. movem saves nothing once the loop is in
+  the instruction cache, and doesn't need registers saved.
+* 68040/68060: as 68020/68030, but copies between 16-byte aligned blocks of
+  main memory use move16, which moves a cache line per instruction without
+  filling the data cache. The video and sprite memory on the motherboard
+  bus always gets move.l.
+
+Detection: the MPU type, FPU, MMU and clock come from IOCS _SYS_STAT. That
+call only exists from ROM IOCS 1.3 (the X68030) on, or when an accelerator's
+driver has installed it; otherwise the machine is taken to be a 68000.
+
+Kernels take word-aligned addresses and an even byte count under 1MB, and the
+two sides of a copy mustn't overlap. g_x68k_cpu starts out at the 68000 set,
+which runs on anything.
+
+Host build: with X68K_CPU_HOST defined, every variant is a C model that
+splits the work into the same blocks as the assembly, so tools/kernref can
+check each against a plain reference on a PC.
+
+*/
+#ifndef _X68K_CPU_H
+#define _X68K_CPU_H
+
+#include <stdint.h>
+
+// _SYS_STAT MPU types.
+typedef enum X68kCpuType
+{
+	X68K_CPU_68000 = 0,
+	X68K_CPU_68010 = 1,
+	X68K_CPU_68020 = 2,
+	X68K_CPU_68030 = 3,
+	X68K_CPU_68040 = 4,
+	X68K_CPU_68060 = 6,
+} X68kCpuType;
+
+typedef struct X68kCpuInfo
+{
+	uint8_t type;    // X68kCpuType
+	uint8_t fpu;
+	uint8_t mmu;
+	uint16_t clock;  // In 0.1MHz units; 0 if unknown
+} X68kCpuInfo;
+
+typedef struct X68kCpuKernels
+{
+	const char *name;
+	void (*copy)(volatile void *dst, const void *src, uint32_t bytes);
+	void (*fill)(volatile void *dst, uint16_t value, uint32_t bytes);
+} X68kCpuKernels;
+
+extern const X68kCpuKernels *g_x68k_cpu;
+
+// Detects the MPU, fills in `info` if it isn't NULL, and selects its kernels.
+void x68k_cpu_init(X68kCpuInfo *info);
+
+// Kernels for a given MPU type, e.g. to benchmark one against another.
+const X68kCpuKernels *x68k_cpu_kernels(uint8_t type);
+
+#ifndef X68K_CPU_HOST
+void x68k_cpu_copy_000(volatile void *dst, const void *src,
+                       uint32_t bytes);  // <-- x68k_cpu_000.s
+void x68k_cpu_fill_000(volatile void *dst, uint16_t value,
+                       uint32_t bytes);  // <-- x68k_cpu_000.s
+void x68k_cpu_copy_020(volatile void *dst, const void *src,
+                       uint32_t bytes);  // <-- x68k_cpu_020.s
+void x68k_cpu_fill_020(volatile void *dst, uint16_t value,
+                       uint32_t bytes);  // <-- x68k_cpu_020.s
+void x68k_cpu_copy_040(volatile void *dst, const void *src,
+                       uint32_t bytes);  // <-- x68k_cpu_040.s
+#endif
+
+#endif // _X68K_CPU_H
@@ -0,0 +1,95 @@
+; 68000 kernels: 32 bytes per movem.l pair, then longwords and a word.
+; See x68k_cpu.h.
+
+; void x68k_cpu_copy_000(volatile void *dst, const void *src, uint32_t bytes);
+;
+; d0 = 32-byte blocks, then longwords
+; d1-d7/a2 = one block in flight
+; a0 = src, a1 = dst, a3 = bytes
+
+	align 2
+.global	x68k_cpu_copy_000
+
+x68k_cpu_copy_000:
+	movem.l	d2-d7/a2-a3, -(sp)
+	movea.l	36(sp), a1
+	movea.l	40(sp), a0
+	move.l	44(sp), d0
+	movea.l	d0, a3
+	lsr.l	#5, d0
+	bra.s	.copy_block_next
+
+.copy_block:
+	movem.l	(a0)+, d1-d7/a2
+	movem.l	d1-d7/a2, (a1)
+	lea	32(a1), a1
+.copy_block_next:
+	dbra	d0, .copy_block
+
+	move.w	a3, d0
+	andi.w	#31, d0
+	lsr.w	#2, d0
+	bra.s	.copy_long_next
+.copy_long:
+	move.l	(a0)+, (a1)+
+.copy_long_next:
+	dbra	d0, .copy_long
+
+	move.w	a3, d0
+	btst	#1, d0
+	beq.s	.copy_done
+	move.w	(a0), (a1)
+.copy_done:
+	movem.l	(sp)+, d2-d7/a2-a3
+	rts
+
+; void x68k_cpu_fill_000(volatile void *dst, uint16_t value, uint32_t bytes);
+;
+; d0 = 32-byte blocks, then longwords
+; d1-d7/a2 = value in both halves
+; a1 = dst, a3 = bytes
+
+	align 2
+.global	x68k_cpu_fill_000
+
+x68k_cpu_fill_000:
+	movem.l	d2-d7/a2-a3, -(sp)
+	movea.l	36(sp), a1
+	move.w	42(sp), d1
+	move.w	d1, d2
+	swap	d1
+	move.w	d2, d1
+	move.l	d1, d2
+	move.l	d1, d3
+	move.l	d1, d4
+	move.l	d1, d5
+	move.l	d1, d6
+	move.l	d1, d7
+	movea.l	d1, a2
+	move.l	44(sp), d0
+	movea.l	d0, a3
+	lsr.l	#5, d0
+	bra.s	.fill_block_next
+
+.fill_block:
+	movem.l	d1-d7/a2, (a1)
+	lea	32(a1), a1
+.fill_block_next:
+	dbra	d0, .fill_block
+
+	move.w	a3, d0
+	andi.w	#31, d0
+	lsr.w	#2, d0
+	bra.s	.fill_long_next
+.fill_long:
+	move.l	d1, (a1)+
+.fill_long_next:
+	dbra	d0, .fill_long
+
+	move.w	a3, d0
+	btst	#1, d0
+	beq.s	.fill_done
+	move.w	d1, (a1)
+.fill_done:
+	movem.l	(sp)+, d2-d7/a2-a3
+	rts
@@ -0,0 +1,98 @@
+; 68020/68030 kernels: eight move.l per loop, then longwords and a word. The
+; loops fit in the instruction cache, where movem no longer saves anything.
+; See x68k_cpu.h.
+
+; void x68k_cpu_copy_020(volatile void *dst, const void *src, uint32_t bytes);
+;
+; d0 = 32-byte blocks, then longwords
+; d1 = bytes
+; a0 = src, a1 = dst
+
+	align 2
+.global	x68k_cpu_copy_020
+
+x68k_cpu_copy_020:
+	movea.l	4(sp), a1
+	movea.l	8(sp), a0
+	move.l	12(sp), d1
+.global	x68k_cpu_copy_020_regs
+; Entry with the arguments already in d1/a0/a1, for x68k_cpu_copy_040.
+x68k_cpu_copy_020_regs:
+	move.l	d1, d0
+	lsr.l	#5, d0
+	bra.s	.copy_block_next
+
+.copy_block:
+	move.l	(a0)+, (a1)+
+	move.l	(a0)+, (a1)+
+	move.l	(a0)+, (a1)+
+	move.l	(a0)+, (a1)+
+	move.l	(a0)+, (a1)+
+	move.l	(a0)+, (a1)+
+	move.l	(a0)+, (a1)+
+	move.l	(a0)+, (a1)+
+.copy_block_next:
+	dbra	d0, .copy_block
+
+	move.w	d1, d0
+	andi.w	#31, d0
+	lsr.w	#2, d0
+	bra.s	.copy_long_next
+.copy_long:
+	move.l	(a0)+, (a1)+
+.copy_long_next:
+	dbra	d0, .copy_long
+
+	btst	#1, d1
+	beq.s	.copy_done
+	move.w	(a0), (a1)
+.copy_done:
+	rts
+
+; void x68k_cpu_fill_020(volatile void *dst, uint16_t value, uint32_t bytes);
+;
+; d0 = 32-byte blocks, then longwords
+; d1 = value in both halves
+; a0 = bytes, a1 = dst
+
+	align 2
+.global	x68k_cpu_fill_020
+
+x68k_cpu_fill_020:
+	movea.l	4(sp), a1
+	move.w	10(sp), d1
+	move.w	d1, d0
+	swap	d1
+	move.w	d0, d1
+	movea.l	12(sp), a0
+	move.l	a0, d0
+	lsr.l	#5, d0
+	bra.s	.fill_block_next
+
+.fill_block:
+	move.l	d1, (a1)+
+	move.l	d1, (a1)+
+	move.l	d1, (a1)+
+	move.l	d1, (a1)+
+	move.l	d1, (a1)+
+	move.l	d1, (a1)+
+	move.l	d1, (a1)+
+	move.l	d1, (a1)+
+.fill_block_next:
+	dbra	d0, .fill_block
+
+	move.w	a0, d0
+	andi.w	#31, d0
+	lsr.w	#2, d0
+	bra.s	.fill_long_next
+.fill_long:
+	move.l	d1, (a1)+
+.fill_long_next:
+	dbra	d0, .fill_long
+
+	move.w	a0, d0
+	btst	#1, d0
+	beq.s	.fill_done
+	move.w	d1, (a1)
+.fill_done:
+	rts
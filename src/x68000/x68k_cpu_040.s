@@ -0,0 +1,51 @@
+; 68040/68060 copy: move16 for 16-byte aligned main memory, a cache line per
+; instruction without filling the data cache. Anything else, and the
+; remainder, goes through the 68020 copy. See x68k_cpu.h.
+
+	machine	68040
+
+	.extern	x68k_cpu_copy_020_regs
+
+; void x68k_cpu_copy_040(volatile void *dst, const void *src, uint32_t bytes);
+;
+; d0 = lines, then scratch
+; d1 = bytes
+; a0 = src, a1 = dst
+
+MOVE16_MIN	equ	64
+IO_START	equ	$C00000
+IO_END	equ	$1000000
+
+	align 2
+.global	x68k_cpu_copy_040
+
+x68k_cpu_copy_040:
+	movea.l	4(sp), a1
+	movea.l	8(sp), a0
+	move.l	12(sp), d1
+	cmpi.l	#MOVE16_MIN, d1
+	bcs.s	.other
+	move.l	a0, d0
+	or.l	a1, d0
+	andi.w	#15, d0
+	bne.s	.other
+	; Neither side may be in the I/O area.
+	cmpa.l	#IO_START, a1
+	bcs.s	.dst_ok
+	cmpa.l	#IO_END, a1
+	bcs.s	.other
+.dst_ok:
+	cmpa.l	#IO_START, a0
+	bcs.s	.src_ok
+	cmpa.l	#IO_END, a0
+	bcs.s	.other
+.src_ok:
+	move.l	d1, d0
+	lsr.l	#4, d0
+	subq.l	#1, d0
+.line:
+	move16	(a0)+, (a1)+
+	dbra	d0, .line
+	andi.l	#15, d1
+.other:
+	jmp	x68k_cpu_copy_020_regs
@@ -1,10 +1,25 @@
 #include "x68000/x68k_pcg.h"
+#include "x68000/x68k_cpu.h"
 
 static uint16_t x68k_pcg_ctrl;
 static volatile uint16_t *x68k_pcg_ctrl_r = (volatile uint16_t *)PCG_BG_CTRL;
 
-static uint8_t s_spr_next = 0;
+#define SPR_HW_COUNT 128
+#define SPR_NO_BAND 0xFF
+#define SPR_TWO_BANDS 0x80
+
+// Sprites queued for this frame, in sprite table format.
+static X68kPcgSprite s_spr_queue[X68K_PCG_SPR_QUEUE_LEN];
+static uint8_t s_spr_rank[X68K_PCG_SPR_QUEUE_LEN];
+// First band touched, with SPR_TWO_BANDS set if it runs into the next one.
+static uint8_t s_spr_band[X68K_PCG_SPR_QUEUE_LEN];
+static uint8_t s_spr_drop[X68K_PCG_SPR_QUEUE_LEN];
+static uint8_t s_band_count[X68K_PCG_NUM_BANDS];
+static uint16_t s_spr_rot[X68K_PCG_NUM_RANKS];
+static uint16_t s_spr_next = 0;
+static uint16_t s_spr_submitted = 0;
 static uint8_t s_spr_count_prev = 0;
+static X68kPcgSpriteStats s_spr_stats;
 
 /*
 Control:    0xEB0808
@@ -64,8 +79,7 @@ void x68k_pcg_set_bg1_txsel(uint8_t t)
 }
 void x68k_pcg_set_bg0_txsel(uint8_t t)
 {
-	
-	x68k_pcg_ctrl &= ~(0x0030);
+	x68k_pcg_ctrl &= ~(0x0006);
 	x68k_pcg_ctrl |= (t & 0x03) << 1;
 	*x68k_pcg_ctrl_r = x68k_pcg_ctrl;
 }
@@ -84,20 +98,150 @@ void x68k_pcg_set_bg0_enable(uint8_t en)
 	*x68k_pcg_ctrl_r = x68k_pcg_ctrl;
 }
 
-void x68k_pcg_add_sprite(int16_t x, int16_t y, uint16_t attr, uint16_t prio)
+void x68k_pcg_add_sprite_ranked(int16_t x, int16_t y, uint16_t attr,
+                                uint16_t prio, uint8_t rank)
+{
+	s_spr_submitted++;
+	if (s_spr_next >= X68K_PCG_SPR_QUEUE_LEN) return;
+	const uint16_t idx = s_spr_next++;
+	X68kPcgSprite *spr = &s_spr_queue[idx];
+	spr->x = x + 16;
+	spr->y = y + 16;
+	spr->attr = attr;
+	spr->prio = prio;
+	s_spr_rank[idx] = (rank < X68K_PCG_NUM_RANKS) ? rank : X68K_PCG_RANK_HIGH;
+	s_spr_drop[idx] = 0;
+
+	// Hidden and off-screen sprites don't take up any line time.
+	int16_t top = y;
+	int16_t bottom = y + 15;
+	if (!prio || bottom < 0 || top >= (X68K_PCG_NUM_BANDS << X68K_PCG_BAND_SHIFT))
+	{
+		s_spr_band[idx] = SPR_NO_BAND;
+		return;
+	}
+	if (top < 0) top = 0;
+	if (bottom >= (X68K_PCG_NUM_BANDS << X68K_PCG_BAND_SHIFT))
+	{
+		bottom = (X68K_PCG_NUM_BANDS << X68K_PCG_BAND_SHIFT) - 1;
+	}
+	const uint8_t b0 = top >> X68K_PCG_BAND_SHIFT;
+	const uint8_t b1 = bottom >> X68K_PCG_BAND_SHIFT;
+	s_band_count[b0]++;
+	if (b1 != b0)
+	{
+		s_band_count[b1]++;
+		s_spr_band[idx] = b0 | SPR_TWO_BANDS;
+	}
+	else
+	{
+		s_spr_band[idx] = b0;
+	}
+}
+
+static inline uint8_t spr_band_over(uint8_t band)
+{
+	if (band == SPR_NO_BAND) return 0;
+	const uint8_t b0 = band & ~SPR_TWO_BANDS;
+	if (s_band_count[b0] > X68K_PCG_LINE_LIMIT) return 1;
+	return (band & SPR_TWO_BANDS) &&
+	       s_band_count[b0 + 1] > X68K_PCG_LINE_LIMIT;
+}
+
+// Removes a sprite from the band counts, and returns how many bands it took
+// back under the limit.
+static inline uint8_t spr_band_release(uint8_t band)
 {
-	while (s_spr_count_prev > 0)
+	if (band == SPR_NO_BAND) return 0;
+	uint8_t ret = 0;
+	const uint8_t b0 = band & ~SPR_TWO_BANDS;
+	if (s_band_count[b0]-- == X68K_PCG_LINE_LIMIT + 1) ret++;
+	if ((band & SPR_TWO_BANDS) &&
+	    s_band_count[b0 + 1]-- == X68K_PCG_LINE_LIMIT + 1)
 	{
-		s_spr_count_prev--;
-		volatile X68kPcgSprite *spr = x68k_pcg_get_sprite(s_spr_count_prev);
-		spr->x = 0;
+		ret++;
 	}
-	if (s_spr_next >= 128) return;
-	x68k_pcg_set_sprite(s_spr_next++, x, y, attr, prio);
+	return ret;
 }
 
 void x68k_pcg_finish_sprites(void)
 {
-	s_spr_count_prev = s_spr_next;
+	const uint16_t num = s_spr_next;
+	uint16_t shown = num;
+
+	X68kPcgSpriteStats *st = &s_spr_stats;
+	st->submitted = s_spr_submitted;
+	st->bands_over = 0;
+	st->peak = 0;
+	st->peak_band = 0;
+	for (uint8_t b = 0; b < X68K_PCG_NUM_BANDS; b++)
+	{
+		const uint8_t count = s_band_count[b];
+		if (count > X68K_PCG_LINE_LIMIT) st->bands_over++;
+		if (count > st->peak)
+		{
+			st->peak = count;
+			st->peak_band = b;
+		}
+	}
+
+	// Drop sprites, lowest rank first, until every band fits and the rest
+	// fit in the table. Each rank picks up where it left off last frame.
+	uint8_t over = st->bands_over;
+	for (uint8_t rank = 0; rank < X68K_PCG_NUM_RANKS; rank++)
+	{
+		if (!over && shown <= SPR_HW_COUNT) break;
+		uint16_t i = s_spr_rot[rank];
+		if (i >= num) i = 0;
+		for (uint16_t n = 0; n < num; n++)
+		{
+			if (s_spr_rank[i] == rank && !s_spr_drop[i] &&
+			    (shown > SPR_HW_COUNT || spr_band_over(s_spr_band[i])))
+			{
+				s_spr_drop[i] = 1;
+				shown--;
+				over -= spr_band_release(s_spr_band[i]);
+				s_spr_rot[rank] = i + 1;
+				if (!over && shown <= SPR_HW_COUNT) break;
+			}
+			if (++i >= num) i = 0;
+		}
+	}
+
+	// Write out what's left, a run of kept sprites at a time, and hide
+	// anything left over from last frame.
+	volatile X68kPcgSprite *spr = x68k_pcg_get_sprite(0);
+	uint8_t count = 0;
+	for (uint16_t i = 0; i < num;)
+	{
+		if (s_spr_drop[i])
+		{
+			i++;
+			continue;
+		}
+		const uint16_t start = i;
+		while (i < num && !s_spr_drop[i]) i++;
+		const uint16_t run = i - start;
+		g_x68k_cpu->copy(spr, &s_spr_queue[start],
+		                 run * sizeof(X68kPcgSprite));
+		spr += run;
+		count += run;
+	}
+	for (uint8_t i = count; i < s_spr_count_prev; i++)
+	{
+		spr->prio = 0;
+		spr++;
+	}
+
+	st->shown = count;
+	st->dropped = s_spr_submitted - count;
+	s_spr_count_prev = count;
 	s_spr_next = 0;
+	s_spr_submitted = 0;
+	for (uint8_t b = 0; b < X68K_PCG_NUM_BANDS; b++) s_band_count[b] = 0;
+}
+
+const X68kPcgSpriteStats *x68k_pcg_get_sprite_stats(void)
+{
+	return &s_spr_stats;
 }
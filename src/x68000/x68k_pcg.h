@@ -266,8 +266,68 @@ static inline void x68k_pcg_clear_sprites(void)
 	}
 }
 
-// Sprite drawing routines using an internal last-sprite variable.
-void x68k_pcg_add_sprite(int16_t x, int16_t y, uint16_t attr, uint16_t prio);
+/* Sprite queue and overflow handling:
+
+Only so many sprites can be drawn on one raster line (X68K_PCG_LINE_LIMIT);
+past that, the hardware silently drops the rest. x68k_pcg_add_sprite() queues
+sprites for the frame and keeps a count of sprites touching each 16-line band
+of the screen. x68k_pcg_finish_sprites() then drops sprites from any band
+that's over the limit (and anything past the 128 hardware slots) before
+writing the sprite table.
+
+Sprites with a lower rank are dropped first. Within a rank, the sprites
+dropped are rotated each frame, starting after the last one dropped the
+frame before, so an overloaded band flickers evenly instead of losing the
+same sprites every frame.
+
+Sprites keep their submission order in the table, so earlier sprites are
+still drawn in front of later ones.
+
+*/
+
+#ifndef X68K_PCG_LINE_LIMIT
+#define X68K_PCG_LINE_LIMIT 32
+#endif
+
+// Sprites that can be queued in one frame, including those that get dropped.
+#ifndef X68K_PCG_SPR_QUEUE_LEN
+#define X68K_PCG_SPR_QUEUE_LEN 192
+#endif
+
+#define X68K_PCG_BAND_SHIFT 4
+#define X68K_PCG_NUM_BANDS (512 >> X68K_PCG_BAND_SHIFT)
+
+// Ranks for x68k_pcg_add_sprite_ranked(). Lower ranks are dropped first.
+#define X68K_PCG_RANK_LOW 0
+#define X68K_PCG_RANK_NORMAL 1
+#define X68K_PCG_RANK_HIGH 2
+#define X68K_PCG_NUM_RANKS 3
+
+typedef struct X68kPcgSpriteStats
+{
+	uint16_t submitted;   // Sprites queued last frame
+	uint16_t shown;       // Sprites written to the table
+	uint16_t dropped;     // submitted - shown
+	uint8_t bands_over;   // Bands that were over the limit before dropping
+	uint8_t peak;         // Most sprites queued in any one band
+	uint8_t peak_band;    // Which band that was
+} X68kPcgSpriteStats;
+
+// Sprite drawing routines using an internal sprite queue.
+void x68k_pcg_add_sprite_ranked(int16_t x, int16_t y, uint16_t attr,
+                                uint16_t prio, uint8_t rank);
+
+static inline void x68k_pcg_add_sprite(int16_t x, int16_t y, uint16_t attr,
+                                       uint16_t prio)
+{
+	x68k_pcg_add_sprite_ranked(x, y, attr, prio, X68K_PCG_RANK_NORMAL);
+}
+
+// Resolves overflow and writes the queue to the sprite table. Call once per
+// frame, ideally during vertical blank.
 void x68k_pcg_finish_sprites(void);
 
+// Statistics for the last x68k_pcg_finish_sprites().
+const X68kPcgSpriteStats *x68k_pcg_get_sprite_stats(void);
+
 #endif
@@ -0,0 +1,57 @@
+#ifndef _X68K_SCC_H
+#define _X68K_SCC_H
+
+#include <stdint.h>
+
+// Z8530 SCC. Channel A is the RS-232C port; channel B is the mouse.
+#define SCC_BASE 0xE98000
+
+#define SCC_A_CTRL (volatile uint8_t *)(SCC_BASE + 5)
+#define SCC_A_DATA (volatile uint8_t *)(SCC_BASE + 7)
+
+// The SCC needs a few cycles between accesses; a read from the joystick port
+// takes long enough.
+#define x68k_scc_delay() do { (void)*(volatile uint8_t *)0xE9A001; } while(0)
+
+// WR0 with no register pointer is a command; RR0 is read the same way.
+#define x68k_scc_a_command(cmd) do { \
+	*SCC_A_CTRL = (cmd); \
+	x68k_scc_delay(); \
+} while(0)
+
+#define x68k_scc_a_write(reg, data) do \
+{ \
+	*SCC_A_CTRL = (reg); \
+	x68k_scc_delay(); \
+	*SCC_A_CTRL = (data); \
+	x68k_scc_delay(); \
+} while(0)
+
+#define x68k_scc_a_rr0() (*SCC_A_CTRL)
+
+// Exception vectors for channel A, with the vector base IOCS sets (0x50)
+// and status affecting the vector.
+#define SCC_A_VECTOR_TX 0x58
+#define SCC_A_VECTOR_EXT 0x5A
+#define SCC_A_VECTOR_RX 0x5C
+#define SCC_A_VECTOR_SPECIAL 0x5E
+
+// RR0
+#define SCC_RR0_RX_AVAILABLE 0x01
+#define SCC_RR0_TX_EMPTY     0x04
+
+// RR1
+#define SCC_RR1_PARITY       0x10
+#define SCC_RR1_OVERRUN      0x20
+#define SCC_RR1_FRAMING      0x40
+
+// WR0 commands
+#define SCC_CMD_RESET_TX_INT   0x28
+#define SCC_CMD_ERROR_RESET    0x30
+#define SCC_CMD_RESET_IUS      0x38  // Reset highest interrupt under service
+
+// WR1
+#define SCC_WR1_TX_INT         0x02
+#define SCC_WR1_RX_INT_ALL     0x10  // On every character and special condition
+
+#endif // _X68K_SCC_H
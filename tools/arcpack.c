@@ -0,0 +1,246 @@
+/*
+
+arcpack: builds x68k_arc archives (host tool)
+
+Build:
+	cc -O2 -o arcpack arcpack.c
+
+Usage:
+	arcpack -o out.arc [-C dir] file ...
+	arcpack -l archive.arc
+
+Each file is stored under its path as given on the command line, relative to
+-C if set. Files ending in .lz (from lzpack) are flagged as compressed and
+stored under their name without the .lz, so they are looked up by the name of
+the original asset.
+
+Names are hashed case-insensitively, as Human68k treats file names; two names
+with the same hash are an error. -l lists an archive's index.
+
+See src/util/x68k_arc.h for the format.
+
+*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SECTOR 1024
+#define HEADER_SIZE 16
+#define ENTRY_SIZE 16
+#define FLAG_LZ 0x0001
+
+typedef struct Entry
+{
+	char name[256];
+	const char *path;
+	uint32_t hash;
+	uint32_t offset;
+	uint32_t size;
+	uint16_t flags;
+} Entry;
+
+// Must match x68k_arc_hash().
+static uint32_t arc_hash(const char *name)
+{
+	uint32_t h = 0x811C9DC5;
+	while (*name)
+	{
+		uint8_t c = *name++;
+		if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+		h ^= c;
+		h *= 0x01000193;
+	}
+	return h;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static void put16(uint8_t *p, uint16_t v)
+{
+	p[0] = v >> 8;
+	p[1] = v;
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static int cmp_hash(const void *a, const void *b)
+{
+	const Entry *ea = a;
+	const Entry *eb = b;
+	return (ea->hash > eb->hash) - (ea->hash < eb->hash);
+}
+
+static uint32_t align_sector(uint32_t v)
+{
+	return (v + SECTOR - 1) & ~(uint32_t)(SECTOR - 1);
+}
+
+static int list(const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f)
+	{
+		perror(path);
+		return 1;
+	}
+	uint8_t header[HEADER_SIZE];
+	if (fread(header, 1, HEADER_SIZE, f) != HEADER_SIZE ||
+	    memcmp(header, "XARC", 4))
+	{
+		fprintf(stderr, "%s: not an archive\n", path);
+		fclose(f);
+		return 1;
+	}
+	const int num = (header[6] << 8) | header[7];
+	printf("hash      offset    size      flags\n");
+	for (int i = 0; i < num; i++)
+	{
+		uint8_t e[ENTRY_SIZE];
+		if (fread(e, 1, ENTRY_SIZE, f) != ENTRY_SIZE) break;
+		printf("%08X  %08X  %08X  %s\n", get32(e), get32(e + 4),
+		       get32(e + 8), (e[13] & FLAG_LZ) ? "lz" : "");
+	}
+	fclose(f);
+	return 0;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: arcpack -o out.arc [-C dir] file ...\n"
+	                "       arcpack -l archive.arc\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *out_path = NULL;
+	const char *dir = NULL;
+	int c;
+	while ((c = getopt(argc, argv, "o:C:l:")) != -1)
+	{
+		switch (c)
+		{
+			case 'o':
+				out_path = optarg;
+				break;
+			case 'C':
+				dir = optarg;
+				break;
+			case 'l':
+				return list(optarg);
+			default:
+				usage();
+				return 1;
+		}
+	}
+	const int num = argc - optind;
+	if (!out_path || num <= 0 || num > 0xFFFF)
+	{
+		usage();
+		return 1;
+	}
+
+	Entry *entries = calloc(num, sizeof(Entry));
+	for (int i = 0; i < num; i++)
+	{
+		Entry *e = &entries[i];
+		e->path = argv[optind + i];
+		snprintf(e->name, sizeof(e->name), "%s", e->path);
+		const size_t len = strlen(e->name);
+		if (len > 3 && !strcmp(&e->name[len - 3], ".lz"))
+		{
+			e->name[len - 3] = '\0';
+			e->flags |= FLAG_LZ;
+		}
+		e->hash = arc_hash(e->name);
+	}
+	qsort(entries, num, sizeof(Entry), cmp_hash);
+	for (int i = 1; i < num; i++)
+	{
+		if (entries[i].hash != entries[i - 1].hash) continue;
+		fprintf(stderr, "hash collision: %s and %s\n", entries[i - 1].name,
+		        entries[i].name);
+		return 1;
+	}
+
+	FILE *out = fopen(out_path, "wb");
+	if (!out)
+	{
+		perror(out_path);
+		return 1;
+	}
+
+	if (dir && chdir(dir))
+	{
+		perror(dir);
+		return 1;
+	}
+
+	// Data first, leaving room for the index.
+	uint32_t pos = align_sector(HEADER_SIZE + num * ENTRY_SIZE);
+	for (int i = 0; i < num; i++)
+	{
+		Entry *e = &entries[i];
+		FILE *f = fopen(e->path, "rb");
+		if (!f)
+		{
+			perror(e->path);
+			return 1;
+		}
+		fseek(f, 0, SEEK_END);
+		e->size = ftell(f);
+		fseek(f, 0, SEEK_SET);
+		uint8_t *data = malloc(e->size ? e->size : 1);
+		if (fread(data, 1, e->size, f) != e->size)
+		{
+			fprintf(stderr, "%s: short read\n", e->path);
+			return 1;
+		}
+		fclose(f);
+
+		e->offset = pos;
+		fseek(out, pos, SEEK_SET);
+		fwrite(data, 1, e->size, out);
+		free(data);
+		pos = align_sector(pos + e->size);
+	}
+	// Pad out the last sector so sector-sized reads never run short.
+	fseek(out, pos - 1, SEEK_SET);
+	fputc(0, out);
+
+	uint8_t header[HEADER_SIZE] = {'X', 'A', 'R', 'C'};
+	put16(&header[4], 1);
+	put16(&header[6], num);
+	fseek(out, 0, SEEK_SET);
+	fwrite(header, 1, HEADER_SIZE, out);
+	for (int i = 0; i < num; i++)
+	{
+		uint8_t raw[ENTRY_SIZE] = {0};
+		put32(&raw[0], entries[i].hash);
+		put32(&raw[4], entries[i].offset);
+		put32(&raw[8], entries[i].size);
+		put16(&raw[12], entries[i].flags);
+		fwrite(raw, 1, ENTRY_SIZE, out);
+	}
+
+	const int err = ferror(out);
+	fclose(out);
+	if (err)
+	{
+		fprintf(stderr, "%s: write error\n", out_path);
+		return 1;
+	}
+	printf("%s: %d entries, %u bytes\n", out_path, num, pos);
+	free(entries);
+	return 0;
+}
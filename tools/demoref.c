@@ -0,0 +1,460 @@
+/*
+
+demoref: checks x68k_demote against plain sprites (host tool)
+
+Build:
+	cc -O2 -I../src -o demoref demoref.c ../src/util/x68k_demote.c
+
+Usage:
+	demoref [-n frames] [-o objects] [-f frames] [-s seed]
+
+Plays a made-up scene through src/util/x68k_demote.c (-n frames, default
+600) and draws every frame twice: once with all the objects as sprites, and
+once the way x68k_demote left it, with some of them in the BG1 nametable.
+The two must match pixel for pixel. The screen is 256 x 256 with 8x8 BG
+tiles, composed with the same rules as tools/vidcomp (front to back: PRW 3
+sprites, BG0, PRW 2 sprites, BG1, PRW 1 sprites; lower numbered sprites in
+front).
+
+Both are drawn as if any number of sprites fit on a line, since that is the
+picture the scene asks for. The hardware shows only the first 32 sprites on
+each line, as vidcomp does. Lines holding more than that are counted for
+both versions, and for the x68k_demote one the pixels the limit loses are
+counted too. Those are reported rather than failed: demotion frees up lines,
+but nothing guarantees it frees enough.
+
+The scene, on a random PCG and BG0 with a camera that pans and stops:
+
+* Objects on the 8-dot grid that stay put, some flipped, some blinking,
+  some hopping a tile now and then, some over BG1 tiles that aren't blank
+  or with patterns past 63
+* Objects off the grid that stay put
+* Objects moving about at every PRW, in front of and behind the others
+* A few sprites of the game's own, queued before the managed ones
+
+At the end, x68k_demote_reset() must leave BG1 as it started.
+
+Prints:
+
+	frames,objects,bad_frames,bad_pixels,avg_demoted,peak_demoted,
+	demotions,promotions,full_lines_sprites,full_lines_demoted,lost_pixels
+
+and exits with 1 if anything differed.
+
+*/
+#include "util/x68k_demote.h"
+#include "x68000/x68k_pcg.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define VIEW 256
+#define BG_SIZE 512
+#define NT_ENTRIES (64 * 64)
+#define MAX_SPRITES (X68K_DEMOTE_MAX_OBJS + OWN_SPRITES)
+#define OWN_SPRITES 4
+#define SPR_LINE_LIMIT 32
+
+typedef struct Sprite
+{
+	int16_t x;
+	int16_t y;
+	uint16_t attr;
+	uint16_t prio;
+} Sprite;
+
+typedef enum Kind
+{
+	KIND_STILL,
+	KIND_BLINK,
+	KIND_HOP,
+	KIND_OFF_GRID,
+	KIND_MOVER,
+} Kind;
+
+typedef struct Obj
+{
+	uint8_t kind;
+	int16_t wx;  // Position on BG1
+	int16_t wy;
+	int16_t vx;
+	int16_t vy;
+	uint16_t attr;
+	uint16_t prio;
+	uint16_t phase;
+} Obj;
+
+static uint8_t s_pcg[0x8000];
+static uint16_t s_bg0[NT_ENTRIES];
+static uint16_t s_bg1[NT_ENTRIES];
+static uint16_t s_bg1_orig[NT_ENTRIES];
+
+// Sprites queued through x68k_pcg_add_sprite().
+static Sprite s_queue[MAX_SPRITES];
+static int s_queued;
+
+// Sprites on each line of the view, front first.
+static const Sprite *s_line_spr[VIEW][MAX_SPRITES];
+static int s_line_count[VIEW];
+
+static uint32_t s_rand = 1;
+
+static uint32_t rnd(void)
+{
+	s_rand ^= s_rand << 13;
+	s_rand ^= s_rand >> 17;
+	s_rand ^= s_rand << 5;
+	return s_rand;
+}
+
+void x68k_pcg_add_sprite_ranked(int16_t x, int16_t y, uint16_t attr,
+                                uint16_t prio, uint8_t rank)
+{
+	(void)rank;
+	if (s_queued >= MAX_SPRITES) return;
+	s_queue[s_queued++] = (Sprite){x, y, attr, prio};
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+	        "usage: demoref [-n frames] [-o objects] [-f frames] [-s seed]\n"
+	        "  -n  frames to play (default 600)\n"
+	        "  -o  managed objects (default 100)\n"
+	        "  -f  still frames before demotion (default 8)\n"
+	        "  -s  random seed (default 1)\n");
+	exit(2);
+}
+
+// Drawing ===================================================================
+
+// Pixel of a 16x16 pattern (tile16) or an 8x8 one, as in vidcomp.
+static inline uint8_t pcg_pixel(int pattern, int tile16, int px, int py)
+{
+	const uint8_t *p;
+	if (tile16)
+	{
+		p = &s_pcg[pattern * 128 + ((px >> 3) * 2 + (py >> 3)) * 32 +
+		           (py & 7) * 4 + ((px & 7) >> 1)];
+	}
+	else
+	{
+		p = &s_pcg[pattern * 32 + py * 4 + (px >> 1)];
+	}
+	return (px & 1) ? (*p & 0x0F) : (*p >> 4);
+}
+
+static uint8_t bg_pixel(const uint16_t *nt, int sx, int sy, int x, int y)
+{
+	const int bx = (x + sx) & (BG_SIZE - 1);
+	const int by = (y + sy) & (BG_SIZE - 1);
+	const uint16_t attr = nt[(by >> 3) * 64 + (bx >> 3)];
+	const int px = (attr & 0x4000) ? (7 - (bx & 7)) : (bx & 7);
+	const int py = (attr & 0x8000) ? (7 - (by & 7)) : (by & 7);
+	const uint8_t c = pcg_pixel(attr & 0xFF, 0, px, py);
+	return c ? ((attr >> 4) & 0xF0) | c : 0;
+}
+
+// Sorts the sprites into lines, keeping only the first SPR_LINE_LIMIT on
+// each if `limit` is set, as vidcomp's sprite_lines() does. Returns the
+// number of lines with more than that.
+static int sort_lines(const Sprite *spr, int n, int limit)
+{
+	int total[VIEW] = {0};
+	memset(s_line_count, 0, sizeof(s_line_count));
+	int full = 0;
+	for (int i = 0; i < n; i++)
+	{
+		const Sprite *s = &spr[i];
+		if (!(s->prio & 3)) continue;
+		const int sy = ((s->y + 16) & 0x3FF) - 16;
+		for (int y = (sy < 0) ? 0 : sy; y < sy + 16 && y < VIEW; y++)
+		{
+			if (total[y]++ == SPR_LINE_LIMIT) full++;
+			if (limit && s_line_count[y] >= SPR_LINE_LIMIT) continue;
+			s_line_spr[y][s_line_count[y]++] = s;
+		}
+	}
+	return full;
+}
+
+// Frontmost sprite pixel at PRW `prw`, as the table would show it.
+static uint8_t spr_pixel(int prw, int x, int y)
+{
+	for (int i = 0; i < s_line_count[y]; i++)
+	{
+		const Sprite *s = s_line_spr[y][i];
+		if ((s->prio & 3) != prw) continue;
+		const int sx = ((s->x + 16) & 0x3FF) - 16;
+		if (x < sx || x >= sx + 16) continue;
+		const int sy = ((s->y + 16) & 0x3FF) - 16;
+		const int px = (s->attr & 0x4000) ? (15 - (x - sx)) : (x - sx);
+		const int py = (s->attr & 0x8000) ? (15 - (y - sy)) : (y - sy);
+		const uint8_t c = pcg_pixel(s->attr & 0xFF, 1, px, py);
+		if (c) return ((s->attr >> 4) & 0xF0) | c;
+	}
+	return 0;
+}
+
+// Returns the number of lines with more sprites than the hardware shows.
+static int draw(uint8_t *out, const Sprite *spr, int n, int limit,
+                const uint16_t *bg1, int bg0_x, int bg0_y, int bg1_x,
+                int bg1_y)
+{
+	const int full = sort_lines(spr, n, limit);
+	for (int y = 0; y < VIEW; y++)
+	{
+		for (int x = 0; x < VIEW; x++)
+		{
+			uint8_t c = spr_pixel(3, x, y);
+			if (!c) c = bg_pixel(s_bg0, bg0_x, bg0_y, x, y);
+			if (!c) c = spr_pixel(2, x, y);
+			if (!c) c = bg_pixel(bg1, bg1_x, bg1_y, x, y);
+			if (!c) c = spr_pixel(1, x, y);
+			out[y * VIEW + x] = c;
+		}
+	}
+	return full;
+}
+
+// Scene =====================================================================
+
+static void make_pcg(void)
+{
+	for (size_t i = 0; i < sizeof(s_pcg); i++)
+	{
+		// About a third of the pixels transparent.
+		uint8_t b = rnd();
+		if (!(rnd() % 3)) b &= 0x0F;
+		if (!(rnd() % 3)) b &= 0xF0;
+		s_pcg[i] = b;
+	}
+	// 8x8 pattern 0 is the blank tile.
+	memset(s_pcg, 0, 32);
+}
+
+static void make_bgs(void)
+{
+	for (int i = 0; i < NT_ENTRIES; i++)
+	{
+		s_bg0[i] = (rnd() % 3) ? 0 :
+		           PCG_ATTR(rnd(), rnd(), rnd(), 1 + rnd() % 255);
+		s_bg1[i] = (rnd() % 16) ? 0 :
+		           PCG_ATTR(rnd(), rnd(), rnd(), 1 + rnd() % 255);
+	}
+	memcpy(s_bg1_orig, s_bg1, sizeof(s_bg1));
+}
+
+static void make_obj(Obj *o)
+{
+	memset(o, 0, sizeof(*o));
+	const uint32_t r = rnd() % 20;
+	o->kind = (r < 9) ? KIND_STILL : (r < 11) ? KIND_BLINK :
+	          (r < 13) ? KIND_HOP : (r < 15) ? KIND_OFF_GRID : KIND_MOVER;
+	o->wx = rnd() % BG_SIZE;
+	o->wy = rnd() % BG_SIZE;
+	if (o->kind != KIND_OFF_GRID && o->kind != KIND_MOVER)
+	{
+		o->wx &= ~7;
+		o->wy &= ~7;
+	}
+	// Mostly demotable patterns and PRW 2, with some that aren't.
+	const uint16_t pattern = (rnd() % 8) ? rnd() % 64 : rnd() % 256;
+	o->attr = PCG_ATTR(rnd(), rnd(), rnd(), pattern);
+	o->prio = (rnd() % 8) ? 2 : 1 + rnd() % 3;
+	o->phase = rnd();
+	if (o->kind == KIND_MOVER)
+	{
+		o->vx = (int16_t)(rnd() % 7) - 3;
+		o->vy = (int16_t)(rnd() % 7) - 3;
+		o->prio = 1 + rnd() % 3;
+	}
+}
+
+static void step_obj(Obj *o, uint32_t frame)
+{
+	switch (o->kind)
+	{
+		case KIND_HOP:
+			if (!((frame + o->phase) % 97)) o->wx += 8;
+			break;
+		case KIND_MOVER:
+			o->wx += o->vx;
+			o->wy += o->vy;
+			break;
+		default:
+			break;
+	}
+	o->wx &= BG_SIZE - 1;
+	o->wy &= BG_SIZE - 1;
+}
+
+// Screen position of a point on BG1, nearest to the view.
+static int16_t to_screen(int16_t w, int16_t scroll)
+{
+	int16_t s = (w - scroll) & (BG_SIZE - 1);
+	if (s > BG_SIZE - 32) s -= BG_SIZE;
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t frames = 600;
+	uint32_t count = 100;
+	uint32_t still = 8;
+	int c;
+	while ((c = getopt(argc, argv, "n:o:f:s:")) != -1)
+	{
+		switch (c)
+		{
+			case 'n':
+				frames = strtoul(optarg, NULL, 0);
+				break;
+			case 'o':
+				count = strtoul(optarg, NULL, 0);
+				break;
+			case 'f':
+				still = strtoul(optarg, NULL, 0);
+				break;
+			case 's':
+				s_rand = strtoul(optarg, NULL, 0);
+				if (!s_rand) s_rand = 1;
+				break;
+			default:
+				usage();
+		}
+	}
+	if (optind != argc || !count || count > X68K_DEMOTE_MAX_OBJS) usage();
+
+	make_pcg();
+	make_bgs();
+	Obj *objs = calloc(count, sizeof(*objs));
+	X68kDemoteObj *dobjs = calloc(count, sizeof(*dobjs));
+	static X68kDemote demote;
+	static Sprite all[MAX_SPRITES];
+	static uint8_t want[VIEW * VIEW];
+	static uint8_t got[VIEW * VIEW];
+	static uint8_t shown[VIEW * VIEW];
+	if (!objs || !dobjs)
+	{
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	for (uint32_t i = 0; i < count; i++) make_obj(&objs[i]);
+	x68k_demote_init(&demote, dobjs, count, still, 0);
+	demote.nt = s_bg1;
+
+	int16_t cam_x = 0;
+	int16_t cam_y = 0;
+	int16_t cam_vx = 1;
+	int16_t cam_vy = 0;
+	uint32_t bad_frames = 0;
+	uint64_t bad_pixels = 0;
+	uint64_t demoted_total = 0;
+	uint64_t full_sprites = 0;
+	uint64_t full_demoted = 0;
+	uint64_t lost_pixels = 0;
+
+	for (uint32_t f = 0; f < frames; f++)
+	{
+		// The camera pans, changes direction and stops now and then.
+		if (!(f % 60))
+		{
+			const uint32_t r = rnd() % 4;
+			cam_vx = r ? (int16_t)(rnd() % 5) - 2 : 0;
+			cam_vy = r ? (int16_t)(rnd() % 3) - 1 : 0;
+		}
+		cam_x = (cam_x + cam_vx) & (BG_SIZE - 1);
+		cam_y = (cam_y + cam_vy) & (BG_SIZE - 1);
+		const int bg0_x = (cam_x / 2) & 0x3FF;
+		const int bg0_y = (cam_y / 2) & 0x3FF;
+
+		// The game's own sprites, queued first.
+		int n = 0;
+		s_queued = 0;
+		for (int i = 0; i < OWN_SPRITES; i++)
+		{
+			const int16_t x = 64 + i * 40 + ((f * (i + 1)) % 64);
+			const int16_t y = 96 + i * 24;
+			const uint16_t attr = PCG_ATTR(0, 0, i, 64 + i);
+			const uint16_t prio = 1 + i % 3;
+			x68k_pcg_add_sprite(x, y, attr, prio);
+			all[n++] = (Sprite){x, y, attr, prio};
+		}
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			Obj *o = &objs[i];
+			step_obj(o, f);
+			X68kDemoteObj *d = &dobjs[i];
+			d->x = to_screen(o->wx, cam_x);
+			d->y = to_screen(o->wy, cam_y);
+			d->attr = o->attr;
+			d->prio = o->prio;
+			if (o->kind == KIND_BLINK && ((f + o->phase) % 50) < 10)
+			{
+				d->prio = 0;
+			}
+			if (d->prio) all[n++] = (Sprite){d->x, d->y, d->attr, d->prio};
+		}
+		x68k_demote_commit(&demote, cam_x, cam_y);
+
+		full_sprites += draw(want, all, n, 0, s_bg1_orig, bg0_x, bg0_y,
+		                     cam_x, cam_y);
+		const int full = draw(got, s_queue, s_queued, 0, s_bg1, bg0_x, bg0_y,
+		                      cam_x, cam_y);
+		uint32_t bad = 0;
+		for (int i = 0; i < VIEW * VIEW; i++) bad += want[i] != got[i];
+		if (full)
+		{
+			// What the screen would actually show.
+			full_demoted += full;
+			draw(shown, s_queue, s_queued, 1, s_bg1, bg0_x, bg0_y, cam_x,
+			     cam_y);
+			for (int i = 0; i < VIEW * VIEW; i++)
+			{
+				lost_pixels += shown[i] != got[i];
+			}
+		}
+		if (bad)
+		{
+			if (!bad_frames)
+			{
+				fprintf(stderr, "frame %u: %u pixels differ\n", f, bad);
+			}
+			bad_frames++;
+			bad_pixels += bad;
+		}
+		if (n - s_queued != demote.stats.demoted)
+		{
+			fprintf(stderr, "frame %u: %d sprites saved, %u demoted\n", f,
+			        n - s_queued, demote.stats.demoted);
+			bad_frames++;
+		}
+		demoted_total += demote.stats.demoted;
+	}
+
+	x68k_demote_reset(&demote);
+	if (memcmp(s_bg1, s_bg1_orig, sizeof(s_bg1)))
+	{
+		fprintf(stderr, "BG1 not restored\n");
+		bad_frames++;
+	}
+
+	const X68kDemoteStats *st = &demote.stats;
+	printf("frames,objects,bad_frames,bad_pixels,avg_demoted,peak_demoted,"
+	       "demotions,promotions,full_lines_sprites,full_lines_demoted,"
+	       "lost_pixels\n");
+	printf("%u,%u,%u,%llu,%.1f,%u,%u,%u,%llu,%llu,%llu\n", frames, count,
+	       bad_frames, (unsigned long long)bad_pixels,
+	       frames ? (double)demoted_total / frames : 0.0,
+	       st->demoted_peak, st->demotions, st->promotions,
+	       (unsigned long long)full_sprites, (unsigned long long)full_demoted,
+	       (unsigned long long)lost_pixels);
+	free(objs);
+	free(dobjs);
+	return bad_frames ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+/*
+
+dispcheck: checks the mode transitions of x68k_display (host tool)
+
+Build:
+	cc -O2 -DX68K_CPU_HOST -DX68K_DISPLAY_MAX_MODES=8 -I../src \
+		-o dispcheck dispcheck.c ../src/util/x68k_display.c \
+		../src/x68000/x68k_crtc.c ../src/x68000/x68k_vidcon.c \
+		../src/x68000/x68k_pcg.c ../src/x68000/x68k_cpu.c
+
+Usage:
+	dispcheck [-v]
+
+Maps host memory over the video registers ($E80000 - $EBFFFF), so the
+library's register writes land somewhere they can be read back, then sets up
+x68k_display with the Inside X68000 presets from x68k_timing.h (every one the
+PCG can show, 15KHz and 31KHz) and runs x68k_display_check_transitions().
+
+To show that the check can fail, it is then run again on damaged copies of
+the transition tables: once with the last write of every transition dropped,
+and once with every transition's writes reversed. Each damaged transition
+that still passes is reported.
+
+Prints a line per run:
+
+	run,transitions,failed
+
+and exits with 1 if the real tables fail or damage goes unnoticed.
+
+*/
+#include "util/x68k_display.h"
+#include "util/x68k_timing.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define IO_BASE 0xE80000
+#define IO_SIZE 0x40000
+
+static const X68kDisplayMode s_modes[] =
+{
+	X68K_TIMING_MODE(0x12E4, 0x007F, X68K_TIMING_HI_512x512),
+	X68K_TIMING_MODE(0x12E4, 0x007F, X68K_TIMING_HI_512x256),
+	X68K_TIMING_MODE(0x12E4, 0x007F, X68K_TIMING_HI_256x256),
+	X68K_TIMING_MODE(0x12E4, 0x007F, X68K_TIMING_LO_512x512),
+	X68K_TIMING_MODE(0x12E4, 0x007F, X68K_TIMING_LO_512x256),
+	X68K_TIMING_MODE(0x06E4, 0x003F, X68K_TIMING_LO_256x256),
+};
+
+#define NUM_MODES ((int)(sizeof(s_modes) / sizeof(s_modes[0])))
+
+static X68kDisplay s_display;
+static int s_verbose;
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: dispcheck [-v]\n");
+	exit(2);
+}
+
+static void drop_last(X68kDisplayTransition *t)
+{
+	if (t->num_writes == 0) return;
+	t->num_writes--;
+	if (t->pcg_start > t->num_writes) t->pcg_start = t->num_writes;
+}
+
+static void reverse(X68kDisplayTransition *t)
+{
+	for (int a = 0, b = t->num_writes - 1; a < b; a++, b--)
+	{
+		const X68kDisplayWrite w = t->writes[a];
+		t->writes[a] = t->writes[b];
+		t->writes[b] = w;
+	}
+}
+
+// Damages each transition in turn, and counts the ones the check misses.
+// Transitions the damage leaves unchanged are skipped.
+static int damage(const char *name, void (*fn)(X68kDisplayTransition *))
+{
+	int tried = 0;
+	int missed = 0;
+	for (int i = 0; i < NUM_MODES; i++)
+	{
+		for (int j = 0; j < NUM_MODES; j++)
+		{
+			X68kDisplayTransition *t = &s_display.transitions[i][j];
+			const X68kDisplayTransition good = *t;
+			fn(t);
+			if (memcmp(&good, t, sizeof(good)) == 0) continue;
+			tried++;
+			if (x68k_display_check_transitions(&s_display) == 0)
+			{
+				missed++;
+				if (s_verbose) printf("missed %s %d -> %d\n", name, i, j);
+			}
+			*t = good;
+		}
+	}
+	printf("%s,%d,%d\n", name, tried, tried - missed);
+	return missed;
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+	while ((opt = getopt(argc, argv, "v")) != -1)
+	{
+		switch (opt)
+		{
+			case 'v':
+				s_verbose = 1;
+				break;
+			default:
+				usage();
+		}
+	}
+	if (optind != argc) usage();
+
+	void *io = mmap((void *)IO_BASE, IO_SIZE, PROT_READ | PROT_WRITE,
+	                MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+	if (io != (void *)IO_BASE)
+	{
+		fprintf(stderr, "dispcheck: can't map $%X\n", IO_BASE);
+		return 1;
+	}
+
+	const X68kDisplayMode *modes[NUM_MODES];
+	for (int i = 0; i < NUM_MODES; i++) modes[i] = &s_modes[i];
+	x68k_display_init(&s_display, modes, NUM_MODES);
+
+	printf("run,transitions,failed\n");
+	const int bad = x68k_display_check_transitions(&s_display);
+	printf("tables,%d,%d\n", NUM_MODES * NUM_MODES, bad);
+
+	int missed = 0;
+	missed += damage("drop_last", drop_last);
+	missed += damage("reverse", reverse);
+	return (bad || missed) ? 1 : 0;
+}
@@ -0,0 +1,453 @@
+/*
+
+gvconv: true color images to x68k_gvload files (host tool)
+
+Build:
+	cc -O2 -o gvconv gvconv.c png_io.c lz_codec.c -lpng -lpthread
+
+Usage:
+	gvconv [-d fs|ordered|none] [-x] [-z] [-p] [-o outdir] [-j jobs] file ...
+
+Converts each PNG (up to 512 x 512) to the 65536 color pixel format and
+writes <outdir>/<name>.g16 (outdir defaults to the input's directory). See
+src/util/x68k_gvload.h for the format.
+
+Each channel has 5 bits, plus an intensity bit shared by all three, so every
+pixel is quantized to 6-bit levels whose lowest bits have to agree: the
+intensity bit is set if most of them are odd, and the odd one out is moved to
+the neighboring level nearer its true value. -x leaves the intensity bit
+clear, for 5 bits per channel.
+
+Dithering (-d):
+
+	fs        Floyd-Steinberg error diffusion, in serpentine order (default)
+	ordered   8 x 8 Bayer matrix; no pattern crawl when images are
+	          animated or cross-faded
+	none      Nearest level
+
+Pixels with alpha below 128 become color 0, which is transparent.
+
+-z compresses the pixels with the x68k_lz format, using lzpack's encoder
+(greedy parse, as lzpack without -O). -p also writes <name>.g16.png, showing
+the result as the monitor would.
+
+Images are converted in parallel, one per thread (-j, default all cores).
+The ordered dither works on four pixels at a time with GCC vector
+extensions, which compile to SIMD instructions on hosts that have them.
+
+*/
+#include "lz_codec.h"
+#include "png_io.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_SIZE 512
+#define VERSION 1
+#define FLAG_LZ 0x0001
+
+
+enum { DITHER_FS, DITHER_ORDERED, DITHER_NONE };
+
+typedef struct Options
+{
+	int dither;
+	int no_intensity;
+	int compress;
+	int preview;
+	const char *outdir;
+} Options;
+
+typedef int32_t Vec4i __attribute__((vector_size(16)));
+
+static const uint8_t s_bayer[8][8] =
+{
+	{ 0, 32,  8, 40,  2, 34, 10, 42},
+	{48, 16, 56, 24, 50, 18, 58, 26},
+	{12, 44,  4, 36, 14, 46,  6, 38},
+	{60, 28, 52, 20, 62, 30, 54, 22},
+	{ 3, 35, 11, 43,  1, 33,  9, 41},
+	{51, 19, 59, 27, 49, 17, 57, 25},
+	{15, 47,  7, 39, 13, 45,  5, 37},
+	{63, 31, 55, 23, 61, 29, 53, 21},
+};
+
+// Quantizing ================================================================
+
+// 6-bit level to 8 bits, as the video DAC sees it.
+static inline int level_expand(int l)
+{
+	return (l << 2) | (l >> 4);
+}
+
+static inline uint16_t pack(int r, int g, int b, int i)
+{
+	return ((g >> 1) << 11) | ((r >> 1) << 6) | ((b >> 1) << 1) | i;
+}
+
+static inline int clamp(int v, int lo, int hi)
+{
+	return (v < lo) ? lo : (v > hi) ? hi : v;
+}
+
+// Nearest levels for (r, g, b) in 0 - 255 (possibly out of range after error
+// diffusion), with the intensity rule described above. Fills in the 8-bit
+// result.
+static uint16_t quantize(const float *v, int no_intensity, int *out)
+{
+	int q[3];
+	int odd = 0;
+	for (int c = 0; c < 3; c++)
+	{
+		q[c] = clamp((int)(v[c] * 63.0f / 255.0f + 0.5f), 0, 63);
+		odd += q[c] & 1;
+	}
+	const int i = no_intensity ? 0 : (odd >= 2);
+	for (int c = 0; c < 3; c++)
+	{
+		if ((q[c] & 1) != i)
+		{
+			const int up = (q[c] == 0) ||
+			               (q[c] < 63 && v[c] >= level_expand(q[c]));
+			q[c] += up ? 1 : -1;
+		}
+		out[c] = level_expand(q[c]);
+	}
+	return pack(q[0], q[1], q[2], i);
+}
+
+static void dither_fs(const uint8_t *rgba, int w, int h, int no_intensity,
+                      uint16_t *out)
+{
+	// Error for this line and the next, with a pixel of padding either side.
+	float *err = calloc((size_t)(w + 2) * 3 * 2, sizeof(float));
+	float *cur = err;
+	float *next = err + (w + 2) * 3;
+	for (int y = 0; y < h; y++)
+	{
+		const int dir = (y & 1) ? -1 : 1;
+		memset(next, 0, sizeof(float) * (w + 2) * 3);
+		for (int n = 0; n < w; n++)
+		{
+			const int x = (dir > 0) ? n : w - 1 - n;
+			const uint8_t *p = &rgba[((size_t)y * w + x) * 4];
+			float v[3];
+			for (int c = 0; c < 3; c++) v[c] = p[c] + cur[(x + 1) * 3 + c];
+			int got[3];
+			const uint16_t px = quantize(v, no_intensity, got);
+			out[(size_t)y * w + x] = (p[3] < 128) ? 0 : px;
+			for (int c = 0; c < 3; c++)
+			{
+				const float e = v[c] - got[c];
+				cur[(x + 1 + dir) * 3 + c] += e * 7.0f / 16.0f;
+				next[(x + 1 - dir) * 3 + c] += e * 3.0f / 16.0f;
+				next[(x + 1) * 3 + c] += e * 5.0f / 16.0f;
+				next[(x + 1 + dir) * 3 + c] += e * 1.0f / 16.0f;
+			}
+		}
+		float *t = cur;
+		cur = next;
+		next = t;
+	}
+	free(err);
+}
+
+static void dither_none(const uint8_t *rgba, int w, int h, int no_intensity,
+                        uint16_t *out)
+{
+	for (size_t i = 0; i < (size_t)w * h; i++)
+	{
+		const uint8_t *p = &rgba[i * 4];
+		const float v[3] = {p[0], p[1], p[2]};
+		int got[3];
+		const uint16_t px = quantize(v, no_intensity, got);
+		out[i] = (p[3] < 128) ? 0 : px;
+	}
+}
+
+static inline Vec4i vsel(Vec4i mask, Vec4i a, Vec4i b)
+{
+	return (a & mask) | (b & ~mask);
+}
+
+// Ordered dither of one channel for 4 pixels: v in 0 - 255, t the Bayer
+// thresholds. Level q = floor(v * 63 / 255 + (t + 0.5) / 64).
+static inline Vec4i ordered_level(Vec4i v, Vec4i t)
+{
+	const Vec4i q = (v * (63 * 128) + (2 * t + 1) * 255) / (255 * 128);
+	return vsel(q > 63, (Vec4i){0} + 63, q);
+}
+
+// Moves levels whose low bit isn't i to the neighbor nearer v.
+static inline Vec4i ordered_fix(Vec4i q, Vec4i v, Vec4i i)
+{
+	const Vec4i wrong = (q & 1) != i;
+	const Vec4i up = v * 126 >= (2 * q + 1) * 255;
+	Vec4i fixed = q + vsel(up, (Vec4i){0} + 1, (Vec4i){0} - 1);
+	fixed = vsel(fixed < 0, (Vec4i){0} + 1, fixed);
+	fixed = vsel(fixed > 63, (Vec4i){0} + 62, fixed);
+	return vsel(wrong, fixed, q);
+}
+
+static void dither_ordered(const uint8_t *rgba, int w, int h,
+                           int no_intensity, uint16_t *out)
+{
+	for (int y = 0; y < h; y++)
+	{
+		for (int x0 = 0; x0 < w; x0 += 4)
+		{
+			Vec4i r, g, b, a, t;
+			for (int k = 0; k < 4; k++)
+			{
+				const int x = (x0 + k < w) ? x0 + k : w - 1;
+				const uint8_t *p = &rgba[((size_t)y * w + x) * 4];
+				r[k] = p[0];
+				g[k] = p[1];
+				b[k] = p[2];
+				a[k] = p[3];
+				t[k] = s_bayer[y & 7][x & 7];
+			}
+			Vec4i qr = ordered_level(r, t);
+			Vec4i qg = ordered_level(g, t);
+			Vec4i qb = ordered_level(b, t);
+			const Vec4i odd = (qr & 1) + (qg & 1) + (qb & 1);
+			const Vec4i i = no_intensity ? (Vec4i){0} : ((odd >= 2) & 1);
+			qr = ordered_fix(qr, r, i);
+			qg = ordered_fix(qg, g, i);
+			qb = ordered_fix(qb, b, i);
+			const Vec4i px = ((qg >> 1) << 11) | ((qr >> 1) << 6) |
+			                 ((qb >> 1) << 1) | i;
+			const Vec4i opaque = a >= 128;
+			for (int k = 0; k < 4 && x0 + k < w; k++)
+			{
+				out[(size_t)y * w + x0 + k] = opaque[k] ? px[k] : 0;
+			}
+		}
+	}
+}
+
+// Files =====================================================================
+
+static int write_file(const char *path, const uint8_t *data, size_t len)
+{
+	FILE *f = fopen(path, "wb");
+	if (!f || fwrite(data, 1, len, f) != len)
+	{
+		perror(path);
+		if (f) fclose(f);
+		return -1;
+	}
+	fclose(f);
+	return 0;
+}
+
+static int convert(const Options *opt, const char *path)
+{
+	PngImage img;
+	if (png_io_load(path, &img))
+	{
+		fprintf(stderr, "%s: can't load\n", path);
+		return -1;
+	}
+	if (img.w > MAX_SIZE || img.h > MAX_SIZE)
+	{
+		fprintf(stderr, "%s: %d x %d is larger than %d x %d\n", path, img.w,
+		        img.h, MAX_SIZE, MAX_SIZE);
+		png_io_free(&img);
+		return -1;
+	}
+
+	const int w = img.w;
+	const int h = img.h;
+	const size_t n = (size_t)w * h;
+	uint16_t *px = malloc(sizeof(uint16_t) * n);
+	switch (opt->dither)
+	{
+		default:
+		case DITHER_FS:
+			dither_fs(img.rgba, w, h, opt->no_intensity, px);
+			break;
+		case DITHER_ORDERED:
+			dither_ordered(img.rgba, w, h, opt->no_intensity, px);
+			break;
+		case DITHER_NONE:
+			dither_none(img.rgba, w, h, opt->no_intensity, px);
+			break;
+	}
+	png_io_free(&img);
+
+	// Header and big-endian pixels, compressed with -z.
+	const size_t raw_len = n * 2;
+	uint8_t *raw = malloc(raw_len);
+	for (size_t i = 0; i < n; i++)
+	{
+		raw[i * 2] = px[i] >> 8;
+		raw[i * 2 + 1] = px[i] & 0xFF;
+	}
+	LzOut lz = {raw, raw_len};
+	if (opt->compress) lz = lz_codec_compress(raw, raw_len, 0);
+	uint8_t *file = malloc(16 + lz.len);
+	const uint16_t flags = opt->compress ? FLAG_LZ : 0;
+	const uint8_t header[16] = {'X', 'G', '1', '6', 0, VERSION,
+	                            flags >> 8, flags & 0xFF, w >> 8, w & 0xFF,
+	                            h >> 8, h & 0xFF};
+	memcpy(file, header, sizeof(header));
+	memcpy(&file[16], lz.data, lz.len);
+	const size_t len = 16 + lz.len;
+	if (lz.data != raw) free(lz.data);
+
+	char out_path[4096];
+	const char *base = strrchr(path, '/');
+	base = base ? base + 1 : path;
+	const char *dot = strrchr(base, '.');
+	const int stem = dot ? (int)(dot - base) : (int)strlen(base);
+	if (opt->outdir)
+	{
+		snprintf(out_path, sizeof(out_path), "%s/%.*s.g16", opt->outdir, stem,
+		         base);
+	}
+	else
+	{
+		snprintf(out_path, sizeof(out_path), "%.*s.g16",
+		         (int)(base - path) + stem, path);
+	}
+	int ret = write_file(out_path, file, len);
+
+	if (!ret && opt->preview)
+	{
+		uint8_t *rgba = malloc(n * 4);
+		for (size_t i = 0; i < n; i++)
+		{
+			const int c = px[i];
+			const int lsb = c & 1;
+			rgba[i * 4 + 0] = level_expand((((c >> 6) & 31) << 1) | lsb);
+			rgba[i * 4 + 1] = level_expand((((c >> 11) & 31) << 1) | lsb);
+			rgba[i * 4 + 2] = level_expand((((c >> 1) & 31) << 1) | lsb);
+			rgba[i * 4 + 3] = c ? 0xFF : 0;
+		}
+		char prev_path[4200];
+		snprintf(prev_path, sizeof(prev_path), "%s.png", out_path);
+		ret = png_io_save_rgba(prev_path, rgba, w, h);
+		if (ret) fprintf(stderr, "%s: can't save\n", prev_path);
+		free(rgba);
+	}
+	if (!ret)
+	{
+		printf("%s: %d x %d, %zu bytes (%.1f%%)\n", out_path, w, h, len,
+		       100.0 * len / (raw_len + 16));
+	}
+
+	free(file);
+	free(raw);
+	free(px);
+	return ret;
+}
+
+typedef struct Jobs
+{
+	const Options *opt;
+	char **files;
+	int num_files;
+	int next;
+	int failed;
+	pthread_mutex_t lock;
+} Jobs;
+
+static void *worker(void *arg)
+{
+	Jobs *j = arg;
+	for (;;)
+	{
+		pthread_mutex_lock(&j->lock);
+		const int idx = j->next++;
+		pthread_mutex_unlock(&j->lock);
+		if (idx >= j->num_files) break;
+
+		if (convert(j->opt, j->files[idx]))
+		{
+			pthread_mutex_lock(&j->lock);
+			j->failed++;
+			pthread_mutex_unlock(&j->lock);
+		}
+	}
+	return NULL;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: gvconv [-d fs|ordered|none] [-x] [-z] [-p] "
+	                "[-o outdir] [-j jobs] file ...\n");
+}
+
+int main(int argc, char **argv)
+{
+	Options opt = {DITHER_FS, 0, 0, 0, NULL};
+	int jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	int c;
+	while ((c = getopt(argc, argv, "d:xzpo:j:")) != -1)
+	{
+		switch (c)
+		{
+			case 'd':
+				if (!strcmp(optarg, "fs")) opt.dither = DITHER_FS;
+				else if (!strcmp(optarg, "ordered")) opt.dither = DITHER_ORDERED;
+				else if (!strcmp(optarg, "none")) opt.dither = DITHER_NONE;
+				else
+				{
+					usage();
+					return 1;
+				}
+				break;
+			case 'x':
+				opt.no_intensity = 1;
+				break;
+			case 'z':
+				opt.compress = 1;
+				break;
+			case 'p':
+				opt.preview = 1;
+				break;
+			case 'o':
+				opt.outdir = optarg;
+				break;
+			case 'j':
+				jobs = atoi(optarg);
+				break;
+			default:
+				usage();
+				return 1;
+		}
+	}
+	if (optind >= argc)
+	{
+		usage();
+		return 1;
+	}
+
+	Jobs j;
+	j.opt = &opt;
+	j.files = &argv[optind];
+	j.num_files = argc - optind;
+	j.next = 0;
+	j.failed = 0;
+	pthread_mutex_init(&j.lock, NULL);
+
+	if (jobs < 1) jobs = 1;
+	if (jobs > j.num_files) jobs = j.num_files;
+	pthread_t *threads = malloc(sizeof(pthread_t) * jobs);
+	for (int i = 0; i < jobs; i++)
+	{
+		pthread_create(&threads[i], NULL, worker, &j);
+	}
+	for (int i = 0; i < jobs; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	free(threads);
+	pthread_mutex_destroy(&j.lock);
+	return j.failed ? 1 : 0;
+}
@@ -0,0 +1,176 @@
+/*
+
+kernref: checks the per-CPU kernels of x68k_cpu (host tool)
+
+Build:
+	cc -O2 -DX68K_CPU_HOST -I../src -o kernref kernref.c \
+		../src/x68000/x68k_cpu.c
+
+Usage:
+	kernref [-n trials] [-s seed]
+
+Runs the copy and fill kernels of every MPU variant (as the C models built
+with X68K_CPU_HOST, which split the work into the same blocks as the
+assembly) over random lengths and alignments, and compares each result byte
+for byte against memcpy() and a plain word loop. Guard bytes on both sides of
+the destination catch writes past either end.
+
+Prints a line per variant and kernel:
+
+	variant,kernel,trials,bytes,failures
+
+and exits with 1 if anything failed.
+
+*/
+#include "x68000/x68k_cpu.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BUF_SIZE (256 * 1024)
+#define GUARD 64
+#define GUARD_BYTE 0xA5
+
+typedef struct Tally
+{
+	uint32_t trials;
+	uint64_t bytes;
+	uint32_t failures;
+} Tally;
+
+static void usage(void)
+{
+	fprintf(stderr,
+	        "usage: kernref [-n trials] [-s seed]\n"
+	        "  -n  trials per variant and kernel (default 20000)\n"
+	        "  -s  random seed (default 1)\n");
+	exit(2);
+}
+
+static uint32_t s_rand = 1;
+
+static uint32_t rnd(void)
+{
+	s_rand ^= s_rand << 13;
+	s_rand ^= s_rand >> 17;
+	s_rand ^= s_rand << 5;
+	return s_rand;
+}
+
+// Mostly short runs, like sprite and nametable segments, with some long ones
+// for GVRAM lines and whole pages.
+static uint32_t pick_bytes(void)
+{
+	switch (rnd() & 3)
+	{
+		case 0:
+			return (rnd() % 64) * 2;
+		case 1:
+			return (rnd() % 1024) * 2;
+		case 2:
+			return (rnd() % (BUF_SIZE / 2 - GUARD)) & ~1u;
+		default:
+			return (1 + rnd() % 64) * 32;
+	}
+}
+
+// Even offsets within 32 bytes cover every word, longword and line
+// alignment the kernels tell apart.
+static uint32_t pick_offset(void)
+{
+	return (rnd() % 16) * 2;
+}
+
+static int check(const uint8_t *got, const uint8_t *want, uint32_t len)
+{
+	for (uint32_t i = 0; i < GUARD; i++)
+	{
+		if (got[i] != GUARD_BYTE || got[GUARD + len + i] != GUARD_BYTE)
+		{
+			return 0;
+		}
+	}
+	return !memcmp(got + GUARD, want, len);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t trials = 20000;
+	int c;
+	while ((c = getopt(argc, argv, "n:s:")) != -1)
+	{
+		switch (c)
+		{
+			case 'n':
+				trials = strtoul(optarg, NULL, 0);
+				break;
+			case 's':
+				s_rand = strtoul(optarg, NULL, 0);
+				if (!s_rand) s_rand = 1;
+				break;
+			default:
+				usage();
+		}
+	}
+	if (optind != argc) usage();
+
+	// The sources sit at 16-byte aligned addresses plus the offset, so the
+	// move16 path is taken whenever both offsets are multiples of 16.
+	uint8_t *src = aligned_alloc(16, BUF_SIZE);
+	uint8_t *dst = aligned_alloc(16, BUF_SIZE + 2 * GUARD + 32);
+	uint8_t *want = malloc(BUF_SIZE);
+	if (!src || !dst || !want)
+	{
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	static const uint8_t types[] =
+	{
+		X68K_CPU_68000, X68K_CPU_68030, X68K_CPU_68060
+	};
+	int failed = 0;
+	printf("variant,kernel,trials,bytes,failures\n");
+	for (size_t t = 0; t < sizeof(types); t++)
+	{
+		const X68kCpuKernels *k = x68k_cpu_kernels(types[t]);
+		Tally copy = {0, 0, 0};
+		Tally fill = {0, 0, 0};
+		for (uint32_t i = 0; i < trials; i++)
+		{
+			const uint32_t len = pick_bytes();
+			// dst + d_off - GUARD is 16-byte aligned when d_off is.
+			const uint32_t s_off = pick_offset();
+			const uint32_t d_off = pick_offset();
+			uint8_t *d = dst + d_off;
+			for (uint32_t j = 0; j < len; j++) src[s_off + j] = rnd();
+
+			memset(d, GUARD_BYTE, len + 2 * GUARD);
+			k->copy(d + GUARD, src + s_off, len);
+			copy.trials++;
+			copy.bytes += len;
+			if (!check(d, src + s_off, len)) copy.failures++;
+
+			const uint16_t value = rnd();
+			for (uint32_t j = 0; j < len; j += 2) memcpy(want + j, &value, 2);
+			memset(d, GUARD_BYTE, len + 2 * GUARD);
+			k->fill(d + GUARD, value, len);
+			fill.trials++;
+			fill.bytes += len;
+			if (!check(d, want, len)) fill.failures++;
+		}
+		printf("%s,copy,%u,%llu,%u\n", k->name, copy.trials,
+		       (unsigned long long)copy.bytes, copy.failures);
+		printf("%s,fill,%u,%llu,%u\n", k->name, fill.trials,
+		       (unsigned long long)fill.bytes, fill.failures);
+		if (copy.failures || fill.failures) failed = 1;
+	}
+
+	free(src);
+	free(dst);
+	free(want);
+	return failed;
+}
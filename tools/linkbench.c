@@ -0,0 +1,261 @@
+/*
+
+linkbench: runs x68k_link over a pty (host tool)
+
+Build:
+	cc -O2 -DX68K_LINK_HOST -I../src -o linkbench linkbench.c \
+		../src/util/x68k_link.c
+
+Usage:
+	linkbench [-n frames] [-r fps] [-l | -w window] [-p device -s side]
+
+Without -p, opens a pty pair, forks, and runs one end of the link on each
+side. With -p, runs a single end on `device` (a serial port, or one end of a
+`socat -d -d pty,raw pty,raw` pair) as side 0 or 1, so two instances can be
+started by hand.
+
+Each side sends a made-up input sequence (which changes every 8 frames, so
+some predictions hold) at `fps` frames a second (0 for as fast as possible)
+and checks everything it receives against what the other side must have
+sent.
+
+* Rollback (default): frames run at once on predicted input; mispredicted
+  frames are counted as rollbacks. A side that gets more than `window`
+  frames ahead of the other's confirmed input waits, as a game would.
+* Lockstep (-l): each frame waits until the other side's input is in.
+
+At the end each side prints the link statistics and a summary line:
+
+	side,frames,wrong,rollbacks,stall_us,us_per_frame
+
+*/
+#define _GNU_SOURCE  // posix_openpt(), cfmakeraw()
+
+#include "util/x68k_link.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+typedef struct Options
+{
+	uint32_t frames;
+	uint32_t fps;
+	int lockstep;
+	uint32_t window;
+	const char *device;
+	int side;
+} Options;
+
+static void usage(void)
+{
+	fprintf(stderr,
+	        "usage: linkbench [-n frames] [-r fps] [-l | -w window] "
+	        "[-p device -s side]\n"
+	        "  -n  frames to run (default 3600)\n"
+	        "  -r  frames a second, 0 for no limit (default 60)\n"
+	        "  -l  lockstep instead of rollback\n"
+	        "  -w  frames a side may predict ahead (default 8)\n"
+	        "  -p  run one side on a serial device or pty\n"
+	        "  -s  side for -p, 0 or 1\n");
+	exit(2);
+}
+
+static uint64_t now_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint8_t make_input(int side, uint32_t frame)
+{
+	uint32_t h = (frame >> 3) * 2654435761u + side * 40503u;
+	h ^= h >> 15;
+	h *= 2246822519u;
+	h ^= h >> 13;
+	return h & 0x3F;
+}
+
+static int set_raw(int fd)
+{
+	struct termios t;
+	if (tcgetattr(fd, &t) < 0) return 0;  // Not a tty; nothing to do
+	cfmakeraw(&t);
+	return tcsetattr(fd, TCSANOW, &t);
+}
+
+static int run_side(const Options *o, int side, int fd)
+{
+	X68kLink link;
+	if (set_raw(fd) < 0 || x68k_link_init(&link, fd) < 0)
+	{
+		perror("link");
+		return 1;
+	}
+
+	const int other = side ^ 1;
+	const uint64_t frame_us = o->fps ? 1000000 / o->fps : 0;
+	uint32_t wrong = 0;
+	uint32_t rollbacks = 0;
+	uint64_t stall_us = 0;
+	const uint64_t start = now_us();
+
+	for (uint32_t f = 0; f < o->frames; f++)
+	{
+		const uint16_t frame = f;
+		x68k_link_send(&link, frame, make_input(side, f));
+		x68k_link_poll(&link);
+
+		// The newest frame that can run now.
+		const uint16_t limit = o->lockstep ? frame : frame - o->window;
+		const uint64_t t = now_us();
+		while ((int16_t)(limit - link.remote_confirmed) > 0)
+		{
+			usleep(100);
+			x68k_link_poll(&link);
+		}
+		stall_us += now_us() - t;
+
+		uint8_t input;
+		if (o->lockstep)
+		{
+			x68k_link_remote(&link, frame, &input);
+			if (input != make_input(other, f)) wrong++;
+		}
+		else
+		{
+			x68k_link_remote(&link, frame, &input);
+			uint16_t from;
+			if (x68k_link_mispredict(&link, &from)) rollbacks++;
+		}
+
+		if (frame_us)
+		{
+			const uint64_t due = start + (f + 1) * frame_us;
+			const uint64_t t = now_us();
+			if (due > t) usleep(due - t);
+		}
+	}
+	const uint64_t elapsed = now_us() - start;
+
+	// Keep sending the last frame until both sides have everything, or a
+	// second passes.
+	const uint16_t last = o->frames - 1;
+	const uint64_t give_up = now_us() + 1000000;
+	while ((link.remote_confirmed != last || link.local_acked != last) &&
+	       now_us() < give_up)
+	{
+		x68k_link_send(&link, last, make_input(side, o->frames - 1));
+		usleep(1000);
+		x68k_link_poll(&link);
+	}
+	uint16_t from;
+	if (x68k_link_mispredict(&link, &from)) rollbacks++;
+
+	// Whatever is still in the history has to match too.
+	const uint32_t kept = (o->frames < X68K_LINK_HISTORY) ?
+	                      o->frames : X68K_LINK_HISTORY;
+	for (uint32_t f = o->frames - kept; f < o->frames; f++)
+	{
+		uint8_t input;
+		if (!x68k_link_remote(&link, f, &input) ||
+		    input != make_input(other, f))
+		{
+			wrong++;
+		}
+	}
+
+	x68k_link_print(&link);
+	printf("side,frames,wrong,rollbacks,stall_us,us_per_frame\n");
+	printf("%d,%u,%u,%u,%llu,%llu\n", side, o->frames, wrong, rollbacks,
+	       (unsigned long long)stall_us,
+	       (unsigned long long)(o->frames ? elapsed / o->frames : 0));
+	fflush(stdout);
+	x68k_link_shutdown(&link);
+	return wrong ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	Options o = {3600, 60, 0, 8, NULL, -1};
+	int c;
+	while ((c = getopt(argc, argv, "n:r:lw:p:s:")) != -1)
+	{
+		switch (c)
+		{
+			case 'n':
+				o.frames = strtoul(optarg, NULL, 0);
+				break;
+			case 'r':
+				o.fps = strtoul(optarg, NULL, 0);
+				break;
+			case 'l':
+				o.lockstep = 1;
+				break;
+			case 'w':
+				o.window = strtoul(optarg, NULL, 0);
+				break;
+			case 'p':
+				o.device = optarg;
+				break;
+			case 's':
+				o.side = atoi(optarg);
+				break;
+			default:
+				usage();
+		}
+	}
+	if (optind != argc || !o.frames || o.window >= X68K_LINK_HISTORY) usage();
+
+	if (o.device)
+	{
+		if (o.side != 0 && o.side != 1) usage();
+		const int fd = open(o.device, O_RDWR | O_NOCTTY);
+		if (fd < 0)
+		{
+			perror(o.device);
+			return 1;
+		}
+		return run_side(&o, o.side, fd);
+	}
+
+	const int master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0)
+	{
+		perror("pty");
+		return 1;
+	}
+	const int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+	if (slave < 0)
+	{
+		perror("pty");
+		return 1;
+	}
+	// The slave side has to be raw before either end writes.
+	set_raw(slave);
+
+	const pid_t pid = fork();
+	if (pid < 0)
+	{
+		perror("fork");
+		return 1;
+	}
+	if (!pid)
+	{
+		close(master);
+		exit(run_side(&o, 1, slave));
+	}
+	close(slave);
+	int ret = run_side(&o, 0, master);
+	int status;
+	waitpid(pid, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status)) ret = 1;
+	return ret;
+}
@@ -0,0 +1,271 @@
+#include "lz_codec.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define WINDOW 4096
+#define MIN_MATCH 3
+#define MAX_MATCH 265
+#define MAX_LITERALS 127
+#define HASH_BITS 16
+#define CHAIN_GREEDY 32
+#define CHAIN_OPTIMAL 1024
+
+// Match finding =============================================================
+
+typedef struct Matcher
+{
+	const uint8_t *buf;
+	size_t len;
+	int32_t head[1 << HASH_BITS];
+	int32_t *prev;
+	int depth;
+} Matcher;
+
+static uint32_t hash3(const uint8_t *p)
+{
+	return ((p[0] << 16 | p[1] << 8 | p[2]) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void matcher_init(Matcher *m, const uint8_t *buf, size_t len,
+                         int depth)
+{
+	m->buf = buf;
+	m->len = len;
+	m->depth = depth;
+	m->prev = malloc(sizeof(int32_t) * (len ? len : 1));
+	for (int i = 0; i < (1 << HASH_BITS); i++) m->head[i] = -1;
+}
+
+static void matcher_insert(Matcher *m, size_t pos)
+{
+	if (pos + MIN_MATCH > m->len) return;
+	const uint32_t h = hash3(&m->buf[pos]);
+	m->prev[pos] = m->head[h];
+	m->head[h] = pos;
+}
+
+// Longest match at pos among the positions already inserted.
+static int matcher_find(const Matcher *m, size_t pos, int *dist)
+{
+	if (pos + MIN_MATCH > m->len) return 0;
+	size_t max = m->len - pos;
+	if (max > MAX_MATCH) max = MAX_MATCH;
+
+	int best = 0;
+	int32_t cand = m->head[hash3(&m->buf[pos])];
+	for (int i = 0; i < m->depth && cand >= 0; i++)
+	{
+		if (pos - cand > WINDOW) break;
+		size_t l = 0;
+		while (l < max && m->buf[cand + l] == m->buf[pos + l]) l++;
+		if ((int)l > best)
+		{
+			best = l;
+			*dist = pos - cand;
+			if (l == max) break;
+		}
+		cand = m->prev[cand];
+	}
+	return (best >= MIN_MATCH) ? best : 0;
+}
+
+// Encoding ==================================================================
+
+static void emit_literals(LzOut *o, const uint8_t *src, size_t n)
+{
+	while (n)
+	{
+		const size_t run = (n > MAX_LITERALS) ? MAX_LITERALS : n;
+		o->data[o->len++] = run;
+		memcpy(&o->data[o->len], src, run);
+		o->len += run;
+		src += run;
+		n -= run;
+	}
+}
+
+static void emit_match(LzOut *o, int len, int dist)
+{
+	const int l = len - MIN_MATCH;
+	const int off = dist - 1;
+	o->data[o->len++] = 0x80 | ((l < 7 ? l : 7) << 4) | (off >> 8);
+	o->data[o->len++] = off & 0xFF;
+	if (l >= 7) o->data[o->len++] = l - 7;
+}
+
+static int match_cost(int len)
+{
+	return (len - MIN_MATCH >= 7) ? 3 : 2;
+}
+
+// Parse steps: len[i] >= MIN_MATCH is a match from dist[i] back, otherwise
+// one literal.
+static void parse_greedy(Matcher *m, int *len, int *dist)
+{
+	for (size_t i = 0; i < m->len;)
+	{
+		int d = 0;
+		const int l = matcher_find(m, i, &d);
+		if (l)
+		{
+			len[i] = l;
+			dist[i] = d;
+			for (int k = 0; k < l; k++) matcher_insert(m, i + k);
+			i += l;
+		}
+		else
+		{
+			len[i] = 1;
+			matcher_insert(m, i);
+			i++;
+		}
+	}
+}
+
+// Backwards DP. cost[i]: best cost from i with no restriction.
+// mcost[i]: best cost from i when the next token isn't a literal run, so
+// that literal runs are never split needlessly.
+static void parse_optimal(Matcher *m, int *len, int *dist)
+{
+	const size_t n = m->len;
+	int *best_len = calloc(n + 1, sizeof(int));
+	int *best_dist = calloc(n + 1, sizeof(int));
+	for (size_t i = 0; i < n; i++)
+	{
+		best_len[i] = matcher_find(m, i, &best_dist[i]);
+		matcher_insert(m, i);
+	}
+
+	uint32_t *cost = malloc(sizeof(uint32_t) * (n + 1));
+	uint32_t *mcost = malloc(sizeof(uint32_t) * (n + 1));
+	int *choice = malloc(sizeof(int) * (n + 1));   // > 0 match, < 0 literals
+	int *mchoice = malloc(sizeof(int) * (n + 1));
+	cost[n] = mcost[n] = 1;  // End token
+	choice[n] = mchoice[n] = 0;
+
+	for (size_t i = n; i-- > 0;)
+	{
+		mcost[i] = UINT32_MAX;
+		mchoice[i] = 0;
+		for (int l = MIN_MATCH; l <= best_len[i]; l++)
+		{
+			const uint32_t c = match_cost(l) + cost[i + l];
+			if (c < mcost[i])
+			{
+				mcost[i] = c;
+				mchoice[i] = l;
+			}
+		}
+
+		cost[i] = mcost[i];
+		choice[i] = mchoice[i];
+		for (size_t r = 1; r <= MAX_LITERALS && i + r <= n; r++)
+		{
+			// Only a full run may be followed by another run.
+			const uint32_t next = (r == MAX_LITERALS) ? cost[i + r]
+			                                          : mcost[i + r];
+			if (next == UINT32_MAX) continue;
+			const uint32_t c = 1 + r + next;
+			if (c < cost[i])
+			{
+				cost[i] = c;
+				choice[i] = -(int)r;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < n;)
+	{
+		if (choice[i] > 0)
+		{
+			len[i] = choice[i];
+			dist[i] = best_dist[i];
+			i += choice[i];
+		}
+		else
+		{
+			for (int r = 0; r < -choice[i]; r++) len[i + r] = 1;
+			i += -choice[i];
+		}
+	}
+
+	free(best_len);
+	free(best_dist);
+	free(cost);
+	free(mcost);
+	free(choice);
+	free(mchoice);
+}
+
+LzOut lz_codec_compress(const uint8_t *src, size_t n, int optimal)
+{
+	LzOut o;
+	// Worst case is all literals.
+	o.data = malloc(4 + n + n / MAX_LITERALS + 2);
+	o.len = 0;
+	o.data[o.len++] = n >> 24;
+	o.data[o.len++] = n >> 16;
+	o.data[o.len++] = n >> 8;
+	o.data[o.len++] = n;
+
+	Matcher *m = malloc(sizeof(Matcher));
+	matcher_init(m, src, n, optimal ? CHAIN_OPTIMAL : CHAIN_GREEDY);
+	int *len = calloc(n + 1, sizeof(int));
+	int *dist = calloc(n + 1, sizeof(int));
+	if (optimal) parse_optimal(m, len, dist);
+	else parse_greedy(m, len, dist);
+
+	size_t lit_start = 0;
+	size_t i = 0;
+	while (i < n)
+	{
+		if (len[i] >= MIN_MATCH)
+		{
+			emit_literals(&o, &src[lit_start], i - lit_start);
+			emit_match(&o, len[i], dist[i]);
+			i += len[i];
+			lit_start = i;
+		}
+		else
+		{
+			i++;
+		}
+	}
+	emit_literals(&o, &src[lit_start], n - lit_start);
+	o.data[o.len++] = 0x00;
+
+	free(len);
+	free(dist);
+	free(m->prev);
+	free(m);
+	return o;
+}
+
+int lz_codec_decompress(const uint8_t *src, size_t src_len, uint8_t *dst,
+                        size_t dst_len)
+{
+	size_t s = 4, d = 0;
+	while (s < src_len)
+	{
+		const uint8_t t = src[s++];
+		if (!t) return d == dst_len ? 0 : -1;
+		if (t & 0x80)
+		{
+			int l = (t >> 4) & 7;
+			const size_t dist = (((t & 0x0F) << 8) | src[s++]) + 1;
+			if (l == 7) l += src[s++];
+			l += MIN_MATCH;
+			if (dist > d || d + l > dst_len) return -1;
+			for (int k = 0; k < l; k++, d++) dst[d] = dst[d - dist];
+		}
+		else
+		{
+			if (d + t > dst_len) return -1;
+			memcpy(&dst[d], &src[s], t);
+			s += t;
+			d += t;
+		}
+	}
+	return -1;
+}
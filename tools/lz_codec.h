@@ -0,0 +1,24 @@
+// x68k_lz encoding shared by the host tools.
+#ifndef LZ_CODEC_H
+#define LZ_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct LzOut
+{
+	uint8_t *data;  // malloc()ed
+	size_t len;
+} LzOut;
+
+// Compresses n bytes into a complete stream, size first. Matches are chosen
+// greedily, or with `optimal` by the parse with the smallest output over the
+// whole input, which is slower but usually a few percent smaller.
+LzOut lz_codec_compress(const uint8_t *src, size_t n, int optimal);
+
+// Reference decoder, matching x68k_lz_decode(). Returns 0 if the stream
+// decodes to exactly dst_len bytes.
+int lz_codec_decompress(const uint8_t *src, size_t src_len, uint8_t *dst,
+                        size_t dst_len);
+
+#endif  // LZ_CODEC_H
@@ -0,0 +1,181 @@
+/*
+
+lzpack: compressor for the x68k_lz format (host tool)
+
+Build:
+	cc -O2 -o lzpack lzpack.c lz_codec.c -lpthread
+
+Usage:
+	lzpack [-O] [-o outdir] [-j jobs] file ...
+
+Writes <outdir>/<file>.lz for each input (outdir defaults to the input's
+directory) and prints the compression ratio. Every output is decoded again
+and checked against the input before it is written.
+
+By default matches are chosen greedily. -O picks the parse with the smallest
+output over the whole file, which is slower but usually a few percent
+smaller. Files are compressed in parallel, one per thread (-j, default all
+cores).
+
+See src/util/x68k_lz.h for the format.
+
+*/
+#include "lz_codec.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct Options
+{
+	int optimal;
+	const char *outdir;
+} Options;
+
+// Files =====================================================================
+
+static int pack_file(const Options *opt, const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f)
+	{
+		perror(path);
+		return -1;
+	}
+	fseek(f, 0, SEEK_END);
+	const long n = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	uint8_t *src = malloc(n ? n : 1);
+	const size_t got = fread(src, 1, n, f);
+	fclose(f);
+	if ((long)got != n)
+	{
+		fprintf(stderr, "%s: short read\n", path);
+		free(src);
+		return -1;
+	}
+
+	LzOut o = lz_codec_compress(src, n, opt->optimal);
+	uint8_t *check = malloc(n ? n : 1);
+	int ret = lz_codec_decompress(o.data, o.len, check, n);
+	if (ret || memcmp(check, src, n))
+	{
+		fprintf(stderr, "%s: verification failed\n", path);
+		ret = -1;
+	}
+	free(check);
+
+	if (!ret)
+	{
+		char out_path[4096];
+		if (opt->outdir)
+		{
+			const char *base = strrchr(path, '/');
+			base = base ? base + 1 : path;
+			snprintf(out_path, sizeof(out_path), "%s/%s.lz", opt->outdir, base);
+		}
+		else
+		{
+			snprintf(out_path, sizeof(out_path), "%s.lz", path);
+		}
+		FILE *of = fopen(out_path, "wb");
+		if (!of || fwrite(o.data, 1, o.len, of) != o.len)
+		{
+			perror(out_path);
+			ret = -1;
+		}
+		if (of) fclose(of);
+		printf("%s: %ld -> %zu (%.1f%%)\n", path, n, o.len,
+		       n ? 100.0 * o.len / n : 0.0);
+	}
+	free(o.data);
+	free(src);
+	return ret;
+}
+
+typedef struct Jobs
+{
+	const Options *opt;
+	char **files;
+	int num_files;
+	int next;
+	int failed;
+	pthread_mutex_t lock;
+} Jobs;
+
+static void *worker(void *arg)
+{
+	Jobs *j = arg;
+	for (;;)
+	{
+		pthread_mutex_lock(&j->lock);
+		const int idx = j->next++;
+		pthread_mutex_unlock(&j->lock);
+		if (idx >= j->num_files) break;
+
+		if (pack_file(j->opt, j->files[idx]))
+		{
+			pthread_mutex_lock(&j->lock);
+			j->failed++;
+			pthread_mutex_unlock(&j->lock);
+		}
+	}
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	Options opt = {0, NULL};
+	int jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	int c;
+	while ((c = getopt(argc, argv, "Oo:j:")) != -1)
+	{
+		switch (c)
+		{
+			case 'O':
+				opt.optimal = 1;
+				break;
+			case 'o':
+				opt.outdir = optarg;
+				break;
+			case 'j':
+				jobs = atoi(optarg);
+				break;
+			default:
+				fprintf(stderr, "usage: lzpack [-O] [-o outdir] [-j jobs] "
+				                "file ...\n");
+				return 1;
+		}
+	}
+	if (optind >= argc)
+	{
+		fprintf(stderr, "usage: lzpack [-O] [-o outdir] [-j jobs] file ...\n");
+		return 1;
+	}
+
+	Jobs j;
+	j.opt = &opt;
+	j.files = &argv[optind];
+	j.num_files = argc - optind;
+	j.next = 0;
+	j.failed = 0;
+	pthread_mutex_init(&j.lock, NULL);
+
+	if (jobs < 1) jobs = 1;
+	if (jobs > j.num_files) jobs = j.num_files;
+	pthread_t *threads = malloc(sizeof(pthread_t) * jobs);
+	for (int i = 0; i < jobs; i++)
+	{
+		pthread_create(&threads[i], NULL, worker, &j);
+	}
+	for (int i = 0; i < jobs; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	free(threads);
+	pthread_mutex_destroy(&j.lock);
+	return j.failed ? 1 : 0;
+}
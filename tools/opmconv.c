@@ -0,0 +1,322 @@
+/*
+
+opmconv: OPM patches to x68k_opm_voice banks (host tool)
+
+Build:
+	cc -O2 -o opmconv opmconv.c
+
+Usage:
+	opmconv -o out.bnk [-l] file ...
+
+Reads voices from:
+
+	*.opm   VOPM text patches (@:n, CH:, M1:, C1:, M2:, C2: lines)
+	*.mdx   The voice table of an MXDRV song
+
+Within a file, a voice keeps its own number as its index in the bank. Each
+further file goes after the last voice of the files before it, and the index
+of its first voice is printed. Unused indices are left silent (TL 127).
+-l also lists every voice.
+
+See src/util/x68k_opm_voice.h for the format.
+
+*/
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#define MAX_VOICES 256
+#define VOICE_SIZE 28
+#define VERSION 1
+
+// Operators in register order.
+enum { OP_M1, OP_M2, OP_C1, OP_C2 };
+
+enum
+{
+	REG_DT1_MUL,
+	REG_TL,
+	REG_KS_AR,
+	REG_AME_D1R,
+	REG_DT2_D2R,
+	REG_D1L_RR,
+};
+
+typedef struct Voice
+{
+	uint8_t fl_con;
+	uint8_t pms_ams;
+	uint8_t op[6][4];
+	uint8_t slots;
+	int used;
+} Voice;
+
+static Voice s_bank[MAX_VOICES];
+static int s_num;
+
+static void voice_silent(Voice *v)
+{
+	memset(v, 0, sizeof(*v));
+	for (int op = 0; op < 4; op++) v->op[REG_TL][op] = 0x7F;
+}
+
+static Voice *voice_at(int base, int num, const char *path)
+{
+	const int idx = base + num;
+	if (num < 0 || idx >= MAX_VOICES)
+	{
+		fprintf(stderr, "%s: voice %d doesn't fit in the bank\n", path, num);
+		return NULL;
+	}
+	while (s_num <= idx) voice_silent(&s_bank[s_num++]);
+	if (s_bank[idx].used)
+	{
+		fprintf(stderr, "%s: voice %d defined twice\n", path, num);
+		return NULL;
+	}
+	s_bank[idx].used = 1;
+	return &s_bank[idx];
+}
+
+// VOPM ======================================================================
+
+// AR D1R D2R RR D1L TL KS MUL DT1 DT2 AMS-EN
+static void vopm_op(Voice *v, int op, const int *p)
+{
+	v->op[REG_DT1_MUL][op] = ((p[8] & 7) << 4) | (p[7] & 15);
+	v->op[REG_TL][op] = p[5] & 0x7F;
+	v->op[REG_KS_AR][op] = ((p[6] & 3) << 6) | (p[0] & 31);
+	v->op[REG_AME_D1R][op] = (p[10] ? 0x80 : 0) | (p[1] & 31);
+	v->op[REG_DT2_D2R][op] = ((p[9] & 3) << 6) | (p[2] & 31);
+	v->op[REG_D1L_RR][op] = ((p[4] & 15) << 4) | (p[3] & 15);
+}
+
+static int parse_ints(const char *s, int *out, int max)
+{
+	int n = 0;
+	while (n < max)
+	{
+		char *end;
+		const long v = strtol(s, &end, 10);
+		if (end == s) break;
+		out[n++] = (int)v;
+		s = end;
+	}
+	return n;
+}
+
+static int load_vopm(FILE *f, const char *path, int base)
+{
+	char line[512];
+	Voice *v = NULL;
+	int lineno = 0;
+	while (fgets(line, sizeof(line), f))
+	{
+		lineno++;
+		const char *s = line;
+		while (isspace((unsigned char)*s)) s++;
+		if (!*s || (s[0] == '/' && s[1] == '/')) continue;
+
+		int p[16];
+		if (!strncmp(s, "@:", 2))
+		{
+			v = voice_at(base, atoi(s + 2), path);
+			if (!v) return -1;
+			continue;
+		}
+		if (!v) continue;
+
+		static const struct { const char *tag; int op; } ops[] =
+		{
+			{"M1:", OP_M1}, {"C1:", OP_C1}, {"M2:", OP_M2}, {"C2:", OP_C2},
+		};
+		int matched = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			if (strncmp(s, ops[i].tag, 3)) continue;
+			matched = 1;
+			if (parse_ints(s + 3, p, 11) != 11)
+			{
+				fprintf(stderr, "%s:%d: expected 11 operator values\n", path,
+				        lineno);
+				return -1;
+			}
+			vopm_op(v, ops[i].op, p);
+		}
+		if (matched) continue;
+
+		// PAN FL CON AMS PMS SLOT NE
+		if (!strncmp(s, "CH:", 3))
+		{
+			if (parse_ints(s + 3, p, 7) < 6)
+			{
+				fprintf(stderr, "%s:%d: expected channel values\n", path,
+				        lineno);
+				return -1;
+			}
+			v->fl_con = ((p[1] & 7) << 3) | (p[2] & 7);
+			v->pms_ams = ((p[4] & 7) << 4) | (p[3] & 3);
+			v->slots = (p[5] >> 3) & 15;
+		}
+	}
+	return 0;
+}
+
+// MDX =======================================================================
+
+// Each voice is 27 bytes: number, FL/CON, slot mask, and then the operator
+// registers in register order.
+static int load_mdx(FILE *f, const char *path, int base)
+{
+	fseek(f, 0, SEEK_END);
+	const long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	uint8_t *buf = malloc(size ? size : 1);
+	if (fread(buf, 1, size, f) != (size_t)size)
+	{
+		fprintf(stderr, "%s: short read\n", path);
+		free(buf);
+		return -1;
+	}
+
+	// Title, ended by CR LF EOF, then the PDX name, ended by NUL.
+	long pos = 0;
+	while (pos + 2 < size &&
+	       !(buf[pos] == 0x0D && buf[pos + 1] == 0x0A && buf[pos + 2] == 0x1A))
+	{
+		pos++;
+	}
+	pos += 3;
+	while (pos < size && buf[pos]) pos++;
+	pos++;
+	if (pos + 2 > size)
+	{
+		fprintf(stderr, "%s: not an MDX file\n", path);
+		free(buf);
+		return -1;
+	}
+
+	const long tbl = pos + ((buf[pos] << 8) | buf[pos + 1]);
+	int ret = 0;
+	for (long p = tbl; p + 27 <= size; p += 27)
+	{
+		const uint8_t *r = &buf[p];
+		Voice *v = voice_at(base, r[0], path);
+		if (!v)
+		{
+			ret = -1;
+			break;
+		}
+		v->fl_con = r[1] & 0x3F;
+		v->slots = (r[2] > 15) ? ((r[2] >> 3) & 15) : r[2];
+		memcpy(v->op, &r[3], 24);
+	}
+	free(buf);
+	return ret;
+}
+
+// Output ====================================================================
+
+static void list(void)
+{
+	printf("idx  con fl  slots  tl\n");
+	for (int i = 0; i < s_num; i++)
+	{
+		const Voice *v = &s_bank[i];
+		if (!v->used) continue;
+		printf("%3d  %d   %d   %X      %3d %3d %3d %3d\n", i, v->fl_con & 7,
+		       (v->fl_con >> 3) & 7, v->slots, v->op[REG_TL][OP_M1],
+		       v->op[REG_TL][OP_C1], v->op[REG_TL][OP_M2],
+		       v->op[REG_TL][OP_C2]);
+	}
+}
+
+static int write_bank(const char *path)
+{
+	FILE *out = fopen(path, "wb");
+	if (!out)
+	{
+		perror(path);
+		return -1;
+	}
+	const uint8_t header[8] = {'X', 'O', 'P', 'M', 0, VERSION,
+	                           (uint8_t)(s_num >> 8), (uint8_t)s_num};
+	fwrite(header, 1, sizeof(header), out);
+	for (int i = 0; i < s_num; i++)
+	{
+		const Voice *v = &s_bank[i];
+		uint8_t raw[VOICE_SIZE] = {0};
+		raw[0] = v->fl_con;
+		raw[1] = v->pms_ams;
+		memcpy(&raw[2], v->op, 24);
+		raw[26] = v->slots;
+		fwrite(raw, 1, VOICE_SIZE, out);
+	}
+	const int err = ferror(out);
+	fclose(out);
+	if (err)
+	{
+		fprintf(stderr, "%s: write error\n", path);
+		return -1;
+	}
+	return 0;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: opmconv -o out.bnk [-l] file ...\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *out_path = NULL;
+	int show = 0;
+	int c;
+	while ((c = getopt(argc, argv, "o:l")) != -1)
+	{
+		switch (c)
+		{
+			case 'o':
+				out_path = optarg;
+				break;
+			case 'l':
+				show = 1;
+				break;
+			default:
+				usage();
+				return 1;
+		}
+	}
+	if (!out_path || optind >= argc)
+	{
+		usage();
+		return 1;
+	}
+
+	for (int i = optind; i < argc; i++)
+	{
+		const char *path = argv[i];
+		FILE *f = fopen(path, "rb");
+		if (!f)
+		{
+			perror(path);
+			return 1;
+		}
+		const int base = s_num;
+		const size_t len = strlen(path);
+		const int mdx = len > 4 && !strcasecmp(&path[len - 4], ".mdx");
+		const int ret = mdx ? load_mdx(f, path, base) : load_vopm(f, path, base);
+		fclose(f);
+		if (ret) return 1;
+		printf("%s: voices from %d\n", path, base);
+	}
+
+	if (show) list();
+	if (write_bank(out_path)) return 1;
+	printf("%s: %d voices\n", out_path, s_num);
+	return 0;
+}
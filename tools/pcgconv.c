@@ -0,0 +1,711 @@
+/*
+
+pcgconv: PNG to PCG patterns, nametables and palettes (host tool)
+
+Build:
+	cc -O2 -o pcgconv pcgconv.c png_io.c -lpng -lpthread
+
+Usage:
+	pcgconv [-s 8|16] [-o outdir] [-j jobs] [-f] image.png ...
+
+Each image is cut into 8x8 or 16x16 tiles, and for each one writes:
+
+	<name>.pat   4bpp patterns in the PCG_TILE_DATA layout. 16x16 patterns are
+	             four 8x8 blocks: top-left, bottom-left, top-right,
+	             bottom-right.
+	<name>.nam   One PCG_ATTR word per tile, row-major, big-endian.
+	<name>.pal   Up to 16 palettes of 16 PAL_RGB5 words, big-endian.
+	<name>.hash  Content hash of the input and options.
+
+Colors are reduced to RGB5. Pixels with alpha below 50% use color 0
+(transparent). Indexed images whose tiles each stay within one block of 16
+palette entries keep their palette layout; anything else is packed into 16
+palettes of 15 colors, merging colors within a tile or between palettes when
+they don't fit.
+
+Patterns are deduplicated by hash, including H, V and HV flipped matches,
+which are written as flip bits in the nametable entry. At most 256 patterns
+can be addressed.
+
+Images are converted in parallel, one per thread (-j, default all cores). An
+image is skipped when its .hash file matches the input; -f forces a rebuild.
+
+*/
+#include "png_io.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAX_PALETTES 16
+#define MAX_PATTERNS 256
+#define COLORS_PER_PAL 15  // Color 0 is transparent
+#define TRANSPARENT 0xFFFF
+
+typedef struct Options
+{
+	int tile;
+	const char *outdir;
+	int force;
+} Options;
+
+typedef struct Palette
+{
+	uint16_t c[COLORS_PER_PAL];  // RGB5 as r << 10 | g << 5 | b
+	int n;
+} Palette;
+
+typedef struct Tile
+{
+	uint16_t rgb[16 * 16];   // RGB5 or TRANSPARENT
+	uint8_t px[16 * 16];     // Palette color index (0 - 15)
+	uint16_t colors[16 * 16];
+	int num_colors;
+	int pal;
+} Tile;
+
+// Hashing ===================================================================
+
+static uint64_t fnv1a(uint64_t h, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	for (size_t i = 0; i < len; i++)
+	{
+		h ^= p[i];
+		h *= 0x100000001B3ULL;
+	}
+	return h;
+}
+
+#define FNV_INIT 0xCBF29CE484222325ULL
+
+// Colors ====================================================================
+
+static int color_dist(uint16_t a, uint16_t b)
+{
+	const int dr = ((a >> 10) & 0x1F) - ((b >> 10) & 0x1F);
+	const int dg = ((a >> 5) & 0x1F) - ((b >> 5) & 0x1F);
+	const int db = (a & 0x1F) - (b & 0x1F);
+	return 2 * dr * dr + 4 * dg * dg + db * db;
+}
+
+static uint16_t to_rgb5(const uint8_t *rgba)
+{
+	if (rgba[3] < 128) return TRANSPARENT;
+	return ((rgba[0] >> 3) << 10) | ((rgba[1] >> 3) << 5) | (rgba[2] >> 3);
+}
+
+static uint16_t to_pal_rgb5(uint16_t c)
+{
+	const uint16_t r = (c >> 10) & 0x1F;
+	const uint16_t g = (c >> 5) & 0x1F;
+	const uint16_t b = c & 0x1F;
+	return (r << 6) | (g << 11) | (b << 1);
+}
+
+static int palette_find(const Palette *p, uint16_t c)
+{
+	for (int i = 0; i < p->n; i++)
+	{
+		if (p->c[i] == c) return i;
+	}
+	return -1;
+}
+
+static int palette_nearest(const Palette *p, uint16_t c)
+{
+	int best = 0;
+	int best_d = 1 << 30;
+	for (int i = 0; i < p->n; i++)
+	{
+		const int d = color_dist(p->c[i], c);
+		if (d < best_d)
+		{
+			best_d = d;
+			best = i;
+		}
+	}
+	return best;
+}
+
+// Collects distinct colors in a tile, merging the closest pair until the
+// tile fits in one palette.
+static void tile_reduce_colors(Tile *t, int npx)
+{
+	int counts[16 * 16];
+	t->num_colors = 0;
+	for (int i = 0; i < npx; i++)
+	{
+		const uint16_t c = t->rgb[i];
+		if (c == TRANSPARENT) continue;
+		int j;
+		for (j = 0; j < t->num_colors; j++)
+		{
+			if (t->colors[j] == c) break;
+		}
+		if (j == t->num_colors)
+		{
+			t->colors[j] = c;
+			counts[j] = 0;
+			t->num_colors++;
+		}
+		counts[j]++;
+	}
+
+	while (t->num_colors > COLORS_PER_PAL)
+	{
+		int ba = 0, bb = 1;
+		int best_d = 1 << 30;
+		for (int a = 0; a < t->num_colors; a++)
+		{
+			for (int b = a + 1; b < t->num_colors; b++)
+			{
+				const int d = color_dist(t->colors[a], t->colors[b]);
+				if (d < best_d)
+				{
+					best_d = d;
+					ba = a;
+					bb = b;
+				}
+			}
+		}
+		// Keep the more common color of the pair.
+		const uint16_t keep = (counts[ba] >= counts[bb]) ? t->colors[ba]
+		                                                 : t->colors[bb];
+		const uint16_t drop = (counts[ba] >= counts[bb]) ? t->colors[bb]
+		                                                 : t->colors[ba];
+		for (int i = 0; i < npx; i++)
+		{
+			if (t->rgb[i] == drop) t->rgb[i] = keep;
+		}
+		t->colors[ba] = keep;
+		counts[ba] += counts[bb];
+		t->num_colors--;
+		t->colors[bb] = t->colors[t->num_colors];
+		counts[bb] = counts[t->num_colors];
+	}
+}
+
+// Number of tile colors missing from a palette.
+static int palette_missing(const Palette *p, const Tile *t)
+{
+	int missing = 0;
+	for (int i = 0; i < t->num_colors; i++)
+	{
+		if (palette_find(p, t->colors[i]) < 0) missing++;
+	}
+	return missing;
+}
+
+static int palette_error(const Palette *p, const Tile *t)
+{
+	int err = 0;
+	for (int i = 0; i < t->num_colors; i++)
+	{
+		err += color_dist(p->c[palette_nearest(p, t->colors[i])],
+		                  t->colors[i]);
+	}
+	return err;
+}
+
+static int cmp_tile_colors(const void *a, const void *b)
+{
+	const Tile *ta = *(const Tile *const *)a;
+	const Tile *tb = *(const Tile *const *)b;
+	return tb->num_colors - ta->num_colors;
+}
+
+// Assigns each tile a palette, largest color sets first.
+static int assign_palettes(Tile *tiles, int num_tiles, Palette *pals)
+{
+	int num_pals = 0;
+	Tile **order = malloc(sizeof(Tile *) * num_tiles);
+	for (int i = 0; i < num_tiles; i++) order[i] = &tiles[i];
+	qsort(order, num_tiles, sizeof(Tile *), cmp_tile_colors);
+
+	for (int i = 0; i < num_tiles; i++)
+	{
+		Tile *t = order[i];
+		int best = -1;
+		int best_missing = COLORS_PER_PAL + 1;
+		for (int p = 0; p < num_pals; p++)
+		{
+			const int missing = palette_missing(&pals[p], t);
+			if (pals[p].n + missing > COLORS_PER_PAL) continue;
+			if (missing < best_missing)
+			{
+				best_missing = missing;
+				best = p;
+			}
+		}
+		if (best < 0 && num_pals < MAX_PALETTES)
+		{
+			best = num_pals++;
+			pals[best].n = 0;
+		}
+		if (best < 0)
+		{
+			// Out of palettes; settle for the closest one.
+			int best_err = 1 << 30;
+			for (int p = 0; p < num_pals; p++)
+			{
+				const int err = palette_error(&pals[p], t);
+				if (err < best_err)
+				{
+					best_err = err;
+					best = p;
+				}
+			}
+		}
+
+		Palette *pal = &pals[best];
+		for (int c = 0; c < t->num_colors; c++)
+		{
+			if (pal->n >= COLORS_PER_PAL) break;
+			if (palette_find(pal, t->colors[c]) < 0)
+			{
+				pal->c[pal->n++] = t->colors[c];
+			}
+		}
+		t->pal = best;
+	}
+	free(order);
+	return num_pals;
+}
+
+static void map_tile(Tile *t, const Palette *pal, int npx)
+{
+	for (int i = 0; i < npx; i++)
+	{
+		const uint16_t c = t->rgb[i];
+		t->px[i] = (c == TRANSPARENT) ? 0 : 1 + palette_nearest(pal, c);
+	}
+}
+
+// Uses the source palette layout if every tile keeps to one 16-color block.
+static int indexed_palettes(const PngImage *img, Tile *tiles, int tw, int th,
+                            int ts, Palette *pals)
+{
+	if (!img->index) return -1;
+	int used[MAX_PALETTES] = {0};
+	uint16_t colors[MAX_PALETTES][16];
+	memset(colors, 0, sizeof(colors));
+
+	for (int ty = 0; ty < th; ty++)
+	{
+		for (int tx = 0; tx < tw; tx++)
+		{
+			Tile *t = &tiles[ty * tw + tx];
+			t->pal = -1;
+			for (int y = 0; y < ts; y++)
+			{
+				for (int x = 0; x < ts; x++)
+				{
+					const int src = (ty * ts + y) * img->w + tx * ts + x;
+					const uint8_t idx = img->index[src];
+					const int bank = idx >> 4;
+					t->px[y * ts + x] = idx & 0xF;
+					if (!(idx & 0xF)) continue;
+					if (t->pal >= 0 && t->pal != bank) return -1;
+					t->pal = bank;
+					used[bank] = 1;
+					colors[bank][idx & 0xF] = to_rgb5(&img->rgba[src * 4]);
+				}
+			}
+			if (t->pal < 0) t->pal = 0;
+		}
+	}
+
+	int num_pals = 0;
+	for (int b = 0; b < MAX_PALETTES; b++)
+	{
+		if (!used[b]) continue;
+		num_pals = b + 1;
+	}
+	for (int b = 0; b < num_pals; b++)
+	{
+		pals[b].n = COLORS_PER_PAL;
+		for (int c = 0; c < COLORS_PER_PAL; c++)
+		{
+			const uint16_t v = colors[b][c + 1];
+			pals[b].c[c] = (used[b] && v != TRANSPARENT) ? v : 0;
+		}
+	}
+	return num_pals;
+}
+
+// Patterns ==================================================================
+
+typedef struct PatternSet
+{
+	uint8_t px[MAX_PATTERNS][16 * 16];
+	uint64_t hash[MAX_PATTERNS];
+	int n;
+} PatternSet;
+
+static void flip_pattern(const uint8_t *src, uint8_t *dst, int ts,
+                         int xf, int yf)
+{
+	for (int y = 0; y < ts; y++)
+	{
+		for (int x = 0; x < ts; x++)
+		{
+			const int sx = xf ? (ts - 1 - x) : x;
+			const int sy = yf ? (ts - 1 - y) : y;
+			dst[y * ts + x] = src[sy * ts + sx];
+		}
+	}
+}
+
+static int pattern_find(const PatternSet *s, const uint8_t *px, int npx)
+{
+	const uint64_t h = fnv1a(FNV_INIT, px, npx);
+	for (int i = 0; i < s->n; i++)
+	{
+		if (s->hash[i] == h && !memcmp(s->px[i], px, npx)) return i;
+	}
+	return -1;
+}
+
+// Returns a nametable entry for the tile, adding a pattern if needed, or -1
+// when out of patterns.
+static int pattern_add(PatternSet *s, const Tile *t, int ts)
+{
+	const int npx = ts * ts;
+	uint8_t flipped[16 * 16];
+	for (int f = 0; f < 4; f++)
+	{
+		const int xf = f & 1;
+		const int yf = f >> 1;
+		// If flip(P) is stored as Q, then P is Q drawn with the same flip.
+		flip_pattern(t->px, flipped, ts, xf, yf);
+		const int idx = pattern_find(s, flipped, npx);
+		if (idx >= 0)
+		{
+			return (yf << 15) | (xf << 14) | ((t->pal & 0xF) << 8) | idx;
+		}
+	}
+	if (s->n >= MAX_PATTERNS) return -1;
+	memcpy(s->px[s->n], t->px, npx);
+	s->hash[s->n] = fnv1a(FNV_INIT, t->px, npx);
+	return ((t->pal & 0xF) << 8) | s->n++;
+}
+
+// Packs an 8x8 block, two pixels per byte, left pixel in the high nibble.
+static void pack_block(const uint8_t *px, int stride, uint8_t *out)
+{
+	for (int y = 0; y < 8; y++)
+	{
+		for (int x = 0; x < 8; x += 2)
+		{
+			*out++ = (px[y * stride + x] << 4) | px[y * stride + x + 1];
+		}
+	}
+}
+
+static void pack_pattern(const uint8_t *px, int ts, uint8_t *out)
+{
+	if (ts == 8)
+	{
+		pack_block(px, 8, out);
+		return;
+	}
+	pack_block(px, 16, out);
+	pack_block(px + 8 * 16, 16, out + 32);
+	pack_block(px + 8, 16, out + 64);
+	pack_block(px + 8 * 16 + 8, 16, out + 96);
+}
+
+// Files =====================================================================
+
+static int write_be16(FILE *f, uint16_t v)
+{
+	const uint8_t b[2] = {v >> 8, v & 0xFF};
+	return fwrite(b, 1, 2, f) == 2 ? 0 : -1;
+}
+
+static char *out_path(const Options *o, const char *in, const char *ext)
+{
+	const char *base = strrchr(in, '/');
+	base = base ? base + 1 : in;
+	const char *dot = strrchr(base, '.');
+	const int len = dot ? (int)(dot - base) : (int)strlen(base);
+	const size_t size = strlen(o->outdir) + len + strlen(ext) + 2;
+	char *p = malloc(size);
+	snprintf(p, size, "%s/%.*s%s", o->outdir, len, base, ext);
+	return p;
+}
+
+static uint64_t hash_file(const char *path, const Options *o, int *err)
+{
+	uint64_t h = fnv1a(FNV_INIT, &o->tile, sizeof(o->tile));
+	FILE *f = fopen(path, "rb");
+	if (!f)
+	{
+		*err = 1;
+		return 0;
+	}
+	uint8_t buf[65536];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0) h = fnv1a(h, buf, n);
+	fclose(f);
+	*err = 0;
+	return h;
+}
+
+static int up_to_date(const Options *o, const char *in, uint64_t h)
+{
+	static const char *exts[] = {".pat", ".nam", ".pal"};
+	for (int i = 0; i < 3; i++)
+	{
+		char *p = out_path(o, in, exts[i]);
+		const int ok = (access(p, F_OK) == 0);
+		free(p);
+		if (!ok) return 0;
+	}
+	char *p = out_path(o, in, ".hash");
+	FILE *f = fopen(p, "r");
+	free(p);
+	if (!f) return 0;
+	unsigned long long stored = 0;
+	const int ok = (fscanf(f, "%llx", &stored) == 1);
+	fclose(f);
+	return ok && stored == h;
+}
+
+// Conversion ================================================================
+
+static int convert(const Options *o, const char *in)
+{
+	int err;
+	const uint64_t h = hash_file(in, o, &err);
+	if (err)
+	{
+		fprintf(stderr, "%s: %s\n", in, strerror(errno));
+		return -1;
+	}
+	if (!o->force && up_to_date(o, in, h))
+	{
+		printf("%s: up to date\n", in);
+		return 0;
+	}
+
+	PngImage img;
+	if (png_io_load(in, &img))
+	{
+		fprintf(stderr, "%s: can't load PNG\n", in);
+		return -1;
+	}
+
+	const int ts = o->tile;
+	const int npx = ts * ts;
+	const int tw = img.w / ts;
+	const int th = img.h / ts;
+	if (img.w % ts || img.h % ts)
+	{
+		fprintf(stderr, "%s: %dx%d is not a multiple of %d; edges dropped\n",
+		        in, img.w, img.h, ts);
+	}
+
+	Tile *tiles = calloc(tw * th, sizeof(Tile));
+	Palette pals[MAX_PALETTES];
+	memset(pals, 0, sizeof(pals));
+	int num_pals = indexed_palettes(&img, tiles, tw, th, ts, pals);
+	if (num_pals < 0)
+	{
+		for (int ty = 0; ty < th; ty++)
+		{
+			for (int tx = 0; tx < tw; tx++)
+			{
+				Tile *t = &tiles[ty * tw + tx];
+				for (int y = 0; y < ts; y++)
+				{
+					for (int x = 0; x < ts; x++)
+					{
+						const int src = (ty * ts + y) * img.w + tx * ts + x;
+						t->rgb[y * ts + x] = to_rgb5(&img.rgba[src * 4]);
+					}
+				}
+				tile_reduce_colors(t, npx);
+			}
+		}
+		num_pals = assign_palettes(tiles, tw * th, pals);
+		for (int i = 0; i < tw * th; i++)
+		{
+			map_tile(&tiles[i], &pals[tiles[i].pal], npx);
+		}
+	}
+	png_io_free(&img);
+
+	PatternSet *set = calloc(1, sizeof(PatternSet));
+	uint16_t *nam = malloc(sizeof(uint16_t) * tw * th);
+	int ret = 0;
+	for (int i = 0; i < tw * th; i++)
+	{
+		const int entry = pattern_add(set, &tiles[i], ts);
+		if (entry < 0)
+		{
+			fprintf(stderr, "%s: more than %d unique patterns\n", in,
+			        MAX_PATTERNS);
+			ret = -1;
+			break;
+		}
+		nam[i] = entry;
+	}
+	free(tiles);
+
+	if (!ret)
+	{
+		char *p_pat = out_path(o, in, ".pat");
+		char *p_nam = out_path(o, in, ".nam");
+		char *p_pal = out_path(o, in, ".pal");
+		char *p_hash = out_path(o, in, ".hash");
+		FILE *f_pat = fopen(p_pat, "wb");
+		FILE *f_nam = fopen(p_nam, "wb");
+		FILE *f_pal = fopen(p_pal, "wb");
+		if (f_pat && f_nam && f_pal)
+		{
+			uint8_t packed[128];
+			for (int i = 0; i < set->n; i++)
+			{
+				pack_pattern(set->px[i], ts, packed);
+				fwrite(packed, 1, npx / 2, f_pat);
+			}
+			for (int i = 0; i < tw * th; i++) write_be16(f_nam, nam[i]);
+			for (int p = 0; p < num_pals; p++)
+			{
+				write_be16(f_pal, 0);
+				for (int c = 0; c < COLORS_PER_PAL; c++)
+				{
+					write_be16(f_pal, (c < pals[p].n) ?
+					                  to_pal_rgb5(pals[p].c[c]) : 0);
+				}
+			}
+		}
+		else
+		{
+			fprintf(stderr, "%s: can't write output\n", in);
+			ret = -1;
+		}
+		if (f_pat) fclose(f_pat);
+		if (f_nam) fclose(f_nam);
+		if (f_pal) fclose(f_pal);
+
+		// The hash goes last so that a failed run is redone next time.
+		FILE *f_hash = ret ? NULL : fopen(p_hash, "w");
+		if (f_hash)
+		{
+			fprintf(f_hash, "%016llx\n", (unsigned long long)h);
+			fclose(f_hash);
+		}
+		printf("%s: %dx%d tiles, %d patterns, %d palettes\n", in, tw, th,
+		       set->n, num_pals);
+		free(p_pat);
+		free(p_nam);
+		free(p_pal);
+		free(p_hash);
+	}
+	free(set);
+	free(nam);
+	return ret;
+}
+
+// Workers ===================================================================
+
+typedef struct Jobs
+{
+	const Options *o;
+	char **files;
+	int num_files;
+	int next;
+	int failed;
+	pthread_mutex_t lock;
+} Jobs;
+
+static void *worker(void *arg)
+{
+	Jobs *j = arg;
+	for (;;)
+	{
+		pthread_mutex_lock(&j->lock);
+		const int idx = j->next++;
+		pthread_mutex_unlock(&j->lock);
+		if (idx >= j->num_files) break;
+
+		if (convert(j->o, j->files[idx]))
+		{
+			pthread_mutex_lock(&j->lock);
+			j->failed++;
+			pthread_mutex_unlock(&j->lock);
+		}
+	}
+	return NULL;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: pcgconv [-s 8|16] [-o outdir] [-j jobs] [-f] "
+	                "image.png ...\n");
+}
+
+int main(int argc, char **argv)
+{
+	Options o = {16, ".", 0};
+	int jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	int opt;
+	while ((opt = getopt(argc, argv, "s:o:j:f")) != -1)
+	{
+		switch (opt)
+		{
+			case 's':
+				o.tile = atoi(optarg);
+				break;
+			case 'o':
+				o.outdir = optarg;
+				break;
+			case 'j':
+				jobs = atoi(optarg);
+				break;
+			case 'f':
+				o.force = 1;
+				break;
+			default:
+				usage();
+				return 1;
+		}
+	}
+	if ((o.tile != 8 && o.tile != 16) || optind >= argc)
+	{
+		usage();
+		return 1;
+	}
+	mkdir(o.outdir, 0755);
+
+	Jobs j;
+	j.o = &o;
+	j.files = &argv[optind];
+	j.num_files = argc - optind;
+	j.next = 0;
+	j.failed = 0;
+	pthread_mutex_init(&j.lock, NULL);
+
+	if (jobs < 1) jobs = 1;
+	if (jobs > j.num_files) jobs = j.num_files;
+	pthread_t *threads = malloc(sizeof(pthread_t) * jobs);
+	for (int i = 0; i < jobs; i++)
+	{
+		pthread_create(&threads[i], NULL, worker, &j);
+	}
+	for (int i = 0; i < jobs; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	free(threads);
+	pthread_mutex_destroy(&j.lock);
+	return j.failed ? 1 : 0;
+}
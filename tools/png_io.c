@@ -0,0 +1,64 @@
+#include "png_io.h"
+
+#include <png.h>
+#include <stdlib.h>
+#include <string.h>
+
+int png_io_load(const char *path, PngImage *img)
+{
+	memset(img, 0, sizeof(*img));
+
+	png_image p;
+	memset(&p, 0, sizeof(p));
+	p.version = PNG_IMAGE_VERSION;
+	if (!png_image_begin_read_from_file(&p, path)) return -1;
+	const int indexed = (p.format & PNG_FORMAT_FLAG_COLORMAP) != 0;
+
+	p.format = PNG_FORMAT_RGBA;
+	img->w = p.width;
+	img->h = p.height;
+	img->rgba = malloc(PNG_IMAGE_SIZE(p));
+	if (!img->rgba || !png_image_finish_read(&p, NULL, img->rgba, 0, NULL))
+	{
+		png_image_free(&p);
+		png_io_free(img);
+		return -1;
+	}
+
+	if (!indexed) return 0;
+
+	// Read it again for the indices. Palette order is kept for paletted files.
+	memset(&p, 0, sizeof(p));
+	p.version = PNG_IMAGE_VERSION;
+	if (!png_image_begin_read_from_file(&p, path)) return 0;
+	p.format = PNG_FORMAT_RGBA_COLORMAP;
+	uint8_t colormap[256 * 4];
+	img->index = malloc(PNG_IMAGE_SIZE(p));
+	if (!img->index ||
+	    !png_image_finish_read(&p, NULL, img->index, 0, colormap))
+	{
+		png_image_free(&p);
+		free(img->index);
+		img->index = NULL;
+	}
+	return 0;
+}
+
+void png_io_free(PngImage *img)
+{
+	free(img->rgba);
+	free(img->index);
+	img->rgba = NULL;
+	img->index = NULL;
+}
+
+int png_io_save_rgba(const char *path, const uint8_t *rgba, int w, int h)
+{
+	png_image p;
+	memset(&p, 0, sizeof(p));
+	p.version = PNG_IMAGE_VERSION;
+	p.width = w;
+	p.height = h;
+	p.format = PNG_FORMAT_RGBA;
+	return png_image_write_to_file(&p, path, 0, rgba, 0, NULL) ? 0 : -1;
+}
@@ -0,0 +1,24 @@
+// PNG loading and saving shared by the host tools.
+#ifndef PNG_IO_H
+#define PNG_IO_H
+
+#include <stdint.h>
+
+typedef struct PngImage
+{
+	int w;
+	int h;
+	// RGBA8, w * h * 4 bytes.
+	uint8_t *rgba;
+	// Palette indices, w * h bytes, if the source was indexed; else NULL.
+	uint8_t *index;
+} PngImage;
+
+// Returns 0 on success.
+int png_io_load(const char *path, PngImage *img);
+void png_io_free(PngImage *img);
+
+// Writes RGBA8 data. Returns 0 on success.
+int png_io_save_rgba(const char *path, const uint8_t *rgba, int w, int h);
+
+#endif  // PNG_IO_H
@@ -0,0 +1,380 @@
+/*
+
+rastcheck: runs x68k_raster against rastref (host tool)
+
+Build:
+	cc -O2 -DX68K_CPU_HOST -I../src -o rastcheck rastcheck.c \
+		../src/util/x68k_raster.c ../src/x68000/x68k_cpu.c
+
+Usage:
+	rastcheck [-r rastref] [-n scripts] [-p primitives] [-s seed] [-d dir]
+	          [script.txt ...]
+
+Maps host memory over GVRAM ($C00000 - $DFFFFF), so src/util/x68k_raster.c
+draws somewhere it can be read back, then draws rastref scripts with it.
+Each page is dumped next to its script as <script>.raw, one big-endian word
+per pixel, and compared with `rastref -c` (-r, default ./rastref).
+
+Without script arguments, it makes up -n scripts (default 40) of -p random
+primitives each (default 500), as <dir>/rast<n>.txt (-d, default .), from
+seed -s (default 1). Each picks a page layout and changes the clip now and
+then, sometimes past the page. Primitives are spans, lines, triangles and
+quads, filled and outlined, reaching off the page, and about one in eight
+is degenerate: a zero-length line or span, a triangle or quad with repeated
+vertices, or one with all its vertices on a line.
+
+Prints a line per script:
+
+	script,primitives,status
+
+and exits with 1 if any script differed.
+
+*/
+#include "util/x68k_raster.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define GVRAM_ADDR 0xC00000
+#define GVRAM_SIZE 0x200000
+
+static X68kRaster s_raster;
+static int s_pitch;
+
+static uint32_t s_rand = 1;
+
+static uint32_t rnd(void)
+{
+	s_rand ^= s_rand << 13;
+	s_rand ^= s_rand >> 17;
+	s_rand ^= s_rand << 5;
+	return s_rand;
+}
+
+// lo to hi inclusive.
+static int rnd_range(int lo, int hi)
+{
+	return lo + (int)(rnd() % (uint32_t)(hi - lo + 1));
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: rastcheck [-r rastref] [-n scripts] "
+	                "[-p primitives] [-s seed] [-d dir] [script.txt ...]\n");
+	exit(2);
+}
+
+// Library side ==============================================================
+
+static void set_mode(int mode)
+{
+	X68kRasterMode m = X68K_RASTER_16;
+	s_pitch = 512;
+	if (mode == 256) m = X68K_RASTER_256;
+	if (mode == 1024)
+	{
+		m = X68K_RASTER_16_1024;
+		s_pitch = 1024;
+	}
+	memset((void *)GVRAM_ADDR, 0, GVRAM_SIZE);
+	x68k_raster_init(&s_raster, m, 0);
+}
+
+static void points(X68kRasterPoint *v, const int *a, int n)
+{
+	for (int i = 0; i < n; i++)
+	{
+		v[i] = (X68kRasterPoint){a[i * 2], a[i * 2 + 1]};
+	}
+}
+
+// Same commands as rastref. Returns the number of primitives, or -1.
+static int draw_script(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	if (!f)
+	{
+		perror(path);
+		return -1;
+	}
+	set_mode(16);
+	char line[256];
+	int lineno = 0;
+	int prims = 0;
+	while (fgets(line, sizeof(line), f))
+	{
+		lineno++;
+		char *hash = strchr(line, '#');
+		if (hash) *hash = '\0';
+		char cmd[16];
+		int a[9];
+		const int n = sscanf(line, "%15s %d %d %d %d %d %d %d %d %d", cmd,
+		                     &a[0], &a[1], &a[2], &a[3], &a[4], &a[5], &a[6],
+		                     &a[7], &a[8]) - 1;
+		if (n < 0) continue;
+		X68kRasterPoint v[4];
+		int want = -1;
+		if (!strcmp(cmd, "mode"))
+		{
+			want = 1;
+			if (n == want) set_mode(a[0]);
+		}
+		else if (!strcmp(cmd, "clip"))
+		{
+			want = 4;
+			if (n == want)
+			{
+				x68k_raster_set_clip(&s_raster, a[0], a[1], a[2], a[3]);
+			}
+		}
+		else if (!strcmp(cmd, "hline"))
+		{
+			want = 4;
+			if (n == want) x68k_raster_hline(&s_raster, a[0], a[1], a[2], a[3]);
+		}
+		else if (!strcmp(cmd, "line"))
+		{
+			want = 5;
+			if (n == want)
+			{
+				x68k_raster_line(&s_raster, a[0], a[1], a[2], a[3], a[4]);
+			}
+		}
+		else if (!strcmp(cmd, "tri") || !strcmp(cmd, "trio"))
+		{
+			want = 7;
+			points(v, a, 3);
+			const int outline = cmd[3] != '\0';
+			if (n == want && outline)
+			{
+				x68k_raster_tri_outline(&s_raster, v, a[6]);
+			}
+			else if (n == want)
+			{
+				x68k_raster_tri(&s_raster, v, a[6]);
+			}
+		}
+		else if (!strcmp(cmd, "quad") || !strcmp(cmd, "quado"))
+		{
+			want = 9;
+			points(v, a, 4);
+			const int outline = cmd[4] != '\0';
+			if (n == want && outline)
+			{
+				x68k_raster_quad_outline(&s_raster, v, a[8]);
+			}
+			else if (n == want)
+			{
+				x68k_raster_quad(&s_raster, v, a[8]);
+			}
+		}
+		if (want < 0 || n != want)
+		{
+			fprintf(stderr, "%s:%d: bad command\n", path, lineno);
+			fclose(f);
+			return -1;
+		}
+		if (strcmp(cmd, "mode") && strcmp(cmd, "clip")) prims++;
+	}
+	fclose(f);
+	return prims;
+}
+
+static int dump(const char *path)
+{
+	FILE *f = fopen(path, "wb");
+	if (!f)
+	{
+		perror(path);
+		return -1;
+	}
+	const volatile uint16_t *px = s_raster.base;
+	for (int i = 0; i < s_pitch * s_pitch; i++)
+	{
+		fputc(px[i] >> 8, f);
+		fputc(px[i] & 0xFF, f);
+	}
+	fclose(f);
+	return 0;
+}
+
+// Random scripts ============================================================
+
+// A coordinate mostly on the page, sometimes well off it.
+static int coord(void)
+{
+	if (!(rnd() % 8)) return rnd_range(-1500, 1500 + s_pitch);
+	return rnd_range(-40, s_pitch + 40);
+}
+
+// Vertices, some of them repeated or all on one line if `degenerate`.
+static void make_points(int *a, int n, int degenerate)
+{
+	for (int i = 0; i < n * 2; i++) a[i] = coord();
+	if (!degenerate) return;
+	if (rnd() & 1)
+	{
+		// Repeat a vertex (or all of them).
+		const int from = rnd() % n;
+		for (int i = 0; i < n; i++)
+		{
+			if (i == from || (rnd() % 3)) continue;
+			a[i * 2] = a[from * 2];
+			a[i * 2 + 1] = a[from * 2 + 1];
+		}
+		const int to = (from + 1) % n;
+		a[to * 2] = a[from * 2];
+		a[to * 2 + 1] = a[from * 2 + 1];
+	}
+	else
+	{
+		// On one line through the first vertex.
+		const int dx = rnd_range(-20, 20);
+		const int dy = rnd_range(-20, 20);
+		for (int i = 1; i < n; i++)
+		{
+			const int k = rnd_range(-8, 8);
+			a[i * 2] = a[0] + k * dx;
+			a[i * 2 + 1] = a[1] + k * dy;
+		}
+	}
+}
+
+static int make_script(const char *path, int prims)
+{
+	FILE *f = fopen(path, "w");
+	if (!f)
+	{
+		perror(path);
+		return -1;
+	}
+	static const int modes[3] = {16, 256, 1024};
+	const int mode = modes[rnd() % 3];
+	s_pitch = (mode == 1024) ? 1024 : 512;
+	fprintf(f, "mode %d\n", mode);
+	for (int i = 0; i < prims; i++)
+	{
+		if (!(rnd() % 50))
+		{
+			const int x0 = rnd_range(-100, s_pitch);
+			const int y0 = rnd_range(-100, s_pitch);
+			fprintf(f, "clip %d %d %d %d\n", x0, y0,
+			        x0 + rnd_range(-10, s_pitch), y0 + rnd_range(-10, s_pitch));
+		}
+		const int degenerate = !(rnd() % 8);
+		const int color = rnd_range(1, 255);
+		int a[8];
+		switch (rnd() % 6)
+		{
+			case 0:
+				a[0] = coord();
+				a[1] = degenerate ? a[0] : coord();
+				fprintf(f, "hline %d %d %d %d\n", a[0], a[1], coord(), color);
+				break;
+			case 1:
+				make_points(a, 2, degenerate);
+				fprintf(f, "line %d %d %d %d %d\n", a[0], a[1], a[2], a[3],
+				        color);
+				break;
+			case 2:
+			case 3:
+				make_points(a, 3, degenerate);
+				fprintf(f, "%s %d %d %d %d %d %d %d\n",
+				        (rnd() & 1) ? "tri" : "trio", a[0], a[1], a[2], a[3],
+				        a[4], a[5], color);
+				break;
+			default:
+				make_points(a, 4, degenerate);
+				fprintf(f, "%s %d %d %d %d %d %d %d %d %d\n",
+				        (rnd() & 1) ? "quad" : "quado", a[0], a[1], a[2], a[3],
+				        a[4], a[5], a[6], a[7], color);
+				break;
+		}
+	}
+	fclose(f);
+	return 0;
+}
+
+// Checking ==================================================================
+
+static int check(const char *rastref, const char *script)
+{
+	const int prims = draw_script(script);
+	char raw[4096];
+	snprintf(raw, sizeof(raw), "%s.raw", script);
+	int ok = prims >= 0 && !dump(raw);
+	if (ok)
+	{
+		char cmd[8192];
+		snprintf(cmd, sizeof(cmd), "'%s' -c '%s' '%s' > /dev/null", rastref,
+		         raw, script);
+		ok = system(cmd) == 0;
+	}
+	printf("%s,%d,%s\n", script, prims, ok ? "ok" : "FAIL");
+	return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+	const char *rastref = "./rastref";
+	const char *dir = ".";
+	int scripts = 40;
+	int prims = 500;
+	int opt;
+	while ((opt = getopt(argc, argv, "r:n:p:s:d:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'r':
+				rastref = optarg;
+				break;
+			case 'n':
+				scripts = atoi(optarg);
+				break;
+			case 'p':
+				prims = atoi(optarg);
+				break;
+			case 's':
+				s_rand = strtoul(optarg, NULL, 0);
+				if (!s_rand) s_rand = 1;
+				break;
+			case 'd':
+				dir = optarg;
+				break;
+			default:
+				usage();
+		}
+	}
+	if (scripts < 1 || prims < 1) usage();
+
+	void *gvram = mmap((void *)GVRAM_ADDR, GVRAM_SIZE, PROT_READ | PROT_WRITE,
+	                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE,
+	                   -1, 0);
+	if (gvram != (void *)GVRAM_ADDR)
+	{
+		fprintf(stderr, "rastcheck: can't map $%X\n", GVRAM_ADDR);
+		return 1;
+	}
+
+	printf("script,primitives,status\n");
+	int failed = 0;
+	if (optind < argc)
+	{
+		for (int i = optind; i < argc; i++) failed += check(rastref, argv[i]);
+	}
+	else
+	{
+		for (int i = 0; i < scripts; i++)
+		{
+			char path[4096];
+			snprintf(path, sizeof(path), "%s/rast%d.txt", dir, i);
+			if (make_script(path, prims)) return 1;
+			failed += check(rastref, path);
+		}
+	}
+	return failed ? 1 : 0;
+}
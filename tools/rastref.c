@@ -0,0 +1,364 @@
+/*
+
+rastref: reference rasterizer for x68k_raster (host tool)
+
+Build:
+	cc -O2 -o rastref rastref.c png_io.c -lpng
+
+Usage:
+	rastref [-o out.raw] [-p out.png] [-c dump.raw] script.txt
+
+Draws the primitives in a script the way src/util/x68k_raster.c should, but
+with the simplest possible method for each: every pixel of a triangle's
+bounding box is tested against its edges, and every step of a line is worked
+out from scratch. The result can be saved as a raw page (-o: one big-endian
+word per pixel, as GVRAM is laid out), as a PNG (-p), or compared against a
+page dumped from the machine (-c), which lists the pixels that differ.
+
+Script lines, with # comments:
+
+	mode 16 | 256 | 1024         Page layout; clears the page and the clip
+	clip x0 y0 x1 y1
+	hline x0 x1 y color
+	line x0 y0 x1 y1 color
+	tri x0 y0 x1 y1 x2 y2 color
+	quad x0 y0 x1 y1 x2 y2 x3 y3 color
+	trio ... / quado ...         Outlines
+
+*/
+#include "png_io.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct Page
+{
+	uint16_t *px;
+	int pitch;
+	uint16_t mask;
+	int cx0, cy0, cx1, cy1;
+} Page;
+
+static void page_init(Page *p, int pitch, uint16_t mask)
+{
+	free(p->px);
+	p->px = calloc((size_t)pitch * pitch, sizeof(uint16_t));
+	p->pitch = pitch;
+	p->mask = mask;
+	p->cx0 = 0;
+	p->cy0 = 0;
+	p->cx1 = pitch - 1;
+	p->cy1 = pitch - 1;
+}
+
+static void plot(Page *p, int x, int y, int color)
+{
+	if (x < p->cx0 || x > p->cx1 || y < p->cy0 || y > p->cy1) return;
+	p->px[y * p->pitch + x] = color & p->mask;
+}
+
+static long floor_div(long num, long den)
+{
+	long q = num / den;
+	return (q * den > num) ? q - 1 : q;
+}
+
+static void ref_hline(Page *p, int x0, int x1, int y, int color)
+{
+	if (x0 > x1)
+	{
+		const int t = x0;
+		x0 = x1;
+		x1 = t;
+	}
+	for (int x = x0; x <= x1; x++) plot(p, x, y, color);
+}
+
+static void ref_line(Page *p, int x0, int y0, int x1, int y1, int color)
+{
+	const int dx = abs(x1 - x0);
+	const int dy = abs(y1 - y0);
+	const int sx = (x1 < x0) ? -1 : 1;
+	const int sy = (y1 < y0) ? -1 : 1;
+	if (!dx && !dy)
+	{
+		plot(p, x0, y0, color);
+	}
+	else if (dx >= dy)
+	{
+		for (int i = 0; i <= dx; i++)
+		{
+			const long k = floor_div(2L * i * dy + dx, 2L * dx);
+			plot(p, x0 + sx * i, y0 + sy * (int)k, color);
+		}
+	}
+	else
+	{
+		for (int i = 0; i <= dy; i++)
+		{
+			const long k = floor_div(2L * i * dx + dy, 2L * dy);
+			plot(p, x0 + sx * (int)k, y0 + sy * i, color);
+		}
+	}
+}
+
+// Edge function at the center of (px, py), doubled to stay in integers.
+static long edge_fn(const int *a, const int *b, int px, int py)
+{
+	return (long)(b[0] - a[0]) * (2 * py + 1 - 2 * a[1]) -
+	       (long)(b[1] - a[1]) * (2 * px + 1 - 2 * a[0]);
+}
+
+static void ref_tri(Page *p, const int *v, int color)
+{
+	const int *a = &v[0];
+	const int *b = &v[2];
+	const int *c = &v[4];
+	const int *e[3][2] = {{a, b}, {b, c}, {c, a}};
+	const long orient = (long)(b[0] - a[0]) * (c[1] - a[1]) -
+	                    (long)(b[1] - a[1]) * (c[0] - a[0]);
+	if (!orient) return;
+	// Make the inside positive.
+	const int s = (orient > 0) ? 1 : -1;
+
+	int minx = v[0], maxx = v[0], miny = v[1], maxy = v[1];
+	for (int i = 1; i < 3; i++)
+	{
+		if (v[i * 2] < minx) minx = v[i * 2];
+		if (v[i * 2] > maxx) maxx = v[i * 2];
+		if (v[i * 2 + 1] < miny) miny = v[i * 2 + 1];
+		if (v[i * 2 + 1] > maxy) maxy = v[i * 2 + 1];
+	}
+	for (int y = miny; y <= maxy; y++)
+	{
+		for (int x = minx; x <= maxx; x++)
+		{
+			int inside = 1;
+			for (int i = 0; i < 3 && inside; i++)
+			{
+				const long f = s * edge_fn(e[i][0], e[i][1], x, y);
+				if (f > 0) continue;
+				if (f < 0)
+				{
+					inside = 0;
+					continue;
+				}
+				// On the edge: covered only if the inside is to its right,
+				// i.e. it's a left edge.
+				const long right = s * edge_fn(e[i][0], e[i][1], x + 1, y);
+				inside = right > 0;
+			}
+			if (inside) plot(p, x, y, color);
+		}
+	}
+}
+
+static void ref_quad(Page *p, const int *v, int color)
+{
+	const int second[6] = {v[0], v[1], v[4], v[5], v[6], v[7]};
+	ref_tri(p, v, color);
+	ref_tri(p, second, color);
+}
+
+static void ref_outline(Page *p, const int *v, int n, int color)
+{
+	for (int i = 0; i < n; i++)
+	{
+		const int j = (i + 1) % n;
+		ref_line(p, v[i * 2], v[i * 2 + 1], v[j * 2], v[j * 2 + 1], color);
+	}
+}
+
+static int run_script(Page *p, FILE *f, const char *path)
+{
+	char line[256];
+	int lineno = 0;
+	while (fgets(line, sizeof(line), f))
+	{
+		lineno++;
+		char *hash = strchr(line, '#');
+		if (hash) *hash = '\0';
+		char cmd[16];
+		int a[9];
+		const int n = sscanf(line, "%15s %d %d %d %d %d %d %d %d %d", cmd,
+		                     &a[0], &a[1], &a[2], &a[3], &a[4], &a[5], &a[6],
+		                     &a[7], &a[8]) - 1;
+		if (n < 0) continue;
+
+		int want = -1;
+		if (!strcmp(cmd, "mode"))
+		{
+			want = 1;
+			if (n == want)
+			{
+				if (a[0] == 1024) page_init(p, 1024, 0x0F);
+				else page_init(p, 512, (a[0] == 256) ? 0xFF : 0x0F);
+			}
+		}
+		else if (!strcmp(cmd, "clip"))
+		{
+			want = 4;
+			if (n == want)
+			{
+				// Kept within the page, as x68k_raster_set_clip() does.
+				p->cx0 = (a[0] < 0) ? 0 : a[0];
+				p->cy0 = (a[1] < 0) ? 0 : a[1];
+				p->cx1 = (a[2] >= p->pitch) ? p->pitch - 1 : a[2];
+				p->cy1 = (a[3] >= p->pitch) ? p->pitch - 1 : a[3];
+			}
+		}
+		else if (!strcmp(cmd, "hline"))
+		{
+			want = 4;
+			if (n == want) ref_hline(p, a[0], a[1], a[2], a[3]);
+		}
+		else if (!strcmp(cmd, "line"))
+		{
+			want = 5;
+			if (n == want) ref_line(p, a[0], a[1], a[2], a[3], a[4]);
+		}
+		else if (!strcmp(cmd, "tri") || !strcmp(cmd, "trio"))
+		{
+			want = 7;
+			if (n == want && cmd[3]) ref_outline(p, a, 3, a[6]);
+			else if (n == want) ref_tri(p, a, a[6]);
+		}
+		else if (!strcmp(cmd, "quad") || !strcmp(cmd, "quado"))
+		{
+			want = 9;
+			if (n == want && cmd[4]) ref_outline(p, a, 4, a[8]);
+			else if (n == want) ref_quad(p, a, a[8]);
+		}
+		if (want < 0 || n != want)
+		{
+			fprintf(stderr, "%s:%d: bad command\n", path, lineno);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int save_raw(const Page *p, const char *path)
+{
+	FILE *f = fopen(path, "wb");
+	if (!f)
+	{
+		perror(path);
+		return -1;
+	}
+	for (int i = 0; i < p->pitch * p->pitch; i++)
+	{
+		fputc(p->px[i] >> 8, f);
+		fputc(p->px[i] & 0xFF, f);
+	}
+	fclose(f);
+	return 0;
+}
+
+static int save_png(const Page *p, const char *path)
+{
+	uint8_t *rgba = malloc((size_t)p->pitch * p->pitch * 4);
+	for (int i = 0; i < p->pitch * p->pitch; i++)
+	{
+		// Spread the color index over a fixed ramp, so it's visible.
+		const uint8_t c = p->px[i];
+		rgba[i * 4 + 0] = (c * 37) & 0xFF;
+		rgba[i * 4 + 1] = (c * 101) & 0xFF;
+		rgba[i * 4 + 2] = (c * 59) & 0xFF;
+		rgba[i * 4 + 3] = 0xFF;
+	}
+	const int ret = png_io_save_rgba(path, rgba, p->pitch, p->pitch);
+	free(rgba);
+	return ret;
+}
+
+static int compare(const Page *p, const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f)
+	{
+		perror(path);
+		return -1;
+	}
+	int diffs = 0;
+	for (int i = 0; i < p->pitch * p->pitch; i++)
+	{
+		const int hi = fgetc(f);
+		const int lo = fgetc(f);
+		if (lo < 0)
+		{
+			fprintf(stderr, "%s: short dump\n", path);
+			fclose(f);
+			return -1;
+		}
+		const uint16_t got = ((hi << 8) | lo) & p->mask;
+		if (got == p->px[i]) continue;
+		if (diffs < 20)
+		{
+			printf("(%d, %d): expected %d, got %d\n", i % p->pitch,
+			       i / p->pitch, p->px[i], got);
+		}
+		diffs++;
+	}
+	fclose(f);
+	printf("%s: %d pixels differ\n", path, diffs);
+	return diffs ? 1 : 0;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: rastref [-o out.raw] [-p out.png] [-c dump.raw] "
+	                "script.txt\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *raw_path = NULL;
+	const char *png_path = NULL;
+	const char *cmp_path = NULL;
+	int c;
+	while ((c = getopt(argc, argv, "o:p:c:")) != -1)
+	{
+		switch (c)
+		{
+			case 'o':
+				raw_path = optarg;
+				break;
+			case 'p':
+				png_path = optarg;
+				break;
+			case 'c':
+				cmp_path = optarg;
+				break;
+			default:
+				usage();
+				return 1;
+		}
+	}
+	if (optind != argc - 1)
+	{
+		usage();
+		return 1;
+	}
+
+	const char *path = argv[optind];
+	FILE *f = fopen(path, "r");
+	if (!f)
+	{
+		perror(path);
+		return 1;
+	}
+	Page page = {0};
+	page_init(&page, 512, 0x0F);
+	const int ret = run_script(&page, f, path);
+	fclose(f);
+	if (ret) return 1;
+
+	if (raw_path && save_raw(&page, raw_path)) return 1;
+	if (png_path && save_png(&page, png_path)) return 1;
+	if (cmp_path) return compare(&page, cmp_path) ? 1 : 0;
+	return 0;
+}
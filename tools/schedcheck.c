@@ -0,0 +1,377 @@
+/*
+
+schedcheck: checks the x68k_sched scheduler's host build (host tool)
+
+Build:
+	cc -O2 -DX68K_SCHED_HOST -I../src -o schedcheck schedcheck.c \
+		../src/util/x68k_sched.c
+
+Usage:
+	schedcheck [-f frames] [-v]
+
+Runs the scheduler built with X68K_SCHED_HOST through a set of scenes, a
+number of frames each (-f, default 10), and checks what the tasks saw:
+
+	order       Tasks run in priority order, same priorities in the order
+	            they were added, and a task that returns stops counting as
+	            live.
+	wait_frame  A task that waits for the next frame resumes right after
+	            its x68k_sched_wait_frame() call, once per frame.
+	budget      A task that only yields is suspended at its first yield
+	            once it has used its budget, resumes from the yield next
+	            frame, and has every frame counted in over_budget.
+	deadline    A background task is suspended at its first yield once
+	            frame_us - margin_us has passed.
+	late_start  A background task isn't started once the deadline has
+	            passed.
+	late_frame  A slice running past frame_us counts as a miss, and the
+	            frame as late.
+
+Host time is wall-clock time, and the process can be preempted at any
+point, so the checks don't measure how long anything took. A yielding task
+notes the time before each yield instead: a yield that returns although that
+time was already past the budget or the deadline is an error, and so is a
+slice that was suspended before reaching it.
+
+Prints a line per scene:
+
+	scene,frames,status
+
+and exits with 1 if any check failed.
+
+*/
+#include "util/x68k_sched.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define STACK_SIZE 65536
+#define MAX_TASKS 4
+#define MAX_LOG 64
+
+#define FRAME_US X68K_SCHED_FRAME_US_15K
+#define MARGIN_US 4000
+#define BUDGET_US 3000
+
+static uint8_t s_stacks[MAX_TASKS][STACK_SIZE];
+
+static int s_frames = 10;
+static int s_verbose;
+
+// What the tasks did, filled in as they run.
+static X68kSched s_sched;
+static uint8_t s_log[MAX_LOG];
+static uint32_t s_log_frame[MAX_LOG];
+static int s_log_len;
+static uint32_t s_spins;
+static uint32_t s_missed_yields;  // Returned although they were due
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: schedcheck [-f frames] [-v]\n");
+	exit(2);
+}
+
+static int fail(const char *scene, const char *what, long got, long want)
+{
+	if (s_verbose) printf("%s: %s is %ld, want %ld\n", scene, what, got, want);
+	return 1;
+}
+
+static void add_task(X68kSchedTask *t, X68kSchedTaskConfig *c, int i,
+                     void (*fn)(void *), uint8_t prio, uint8_t background,
+                     uint16_t budget_us)
+{
+	c->name = "task";
+	c->fn = fn;
+	c->arg = (void *)(intptr_t)i;
+	c->stack = s_stacks[i];
+	c->stack_size = STACK_SIZE;
+	c->prio = prio;
+	c->background = background;
+	c->budget_us = budget_us;
+	x68k_sched_add(&s_sched, t, c);
+}
+
+static void start(void)
+{
+	s_log_len = 0;
+	s_spins = 0;
+	s_missed_yields = 0;
+	x68k_sched_init(&s_sched, FRAME_US, MARGIN_US);
+}
+
+// Tasks =====================================================================
+
+static void log_run(void *arg)
+{
+	if (s_log_len >= MAX_LOG) return;
+	s_log[s_log_len] = (uint8_t)(intptr_t)arg;
+	s_log_frame[s_log_len] = s_sched.frames;
+	s_log_len++;
+}
+
+// Logs itself once a frame for three frames, then returns.
+static void task_three_frames(void *arg)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		log_run(arg);
+		x68k_sched_wait_frame();
+	}
+}
+
+// Yields forever, counting yields that should have suspended it but didn't.
+// If none ever does, it gives up on the frame well past the end, so the check
+// fails instead of hanging.
+static void task_spin(void *arg)
+{
+	(void)arg;
+	const X68kSchedTaskConfig *c = s_sched.current->cfg;
+	for (;;)
+	{
+		s_spins++;
+		const uint32_t frame = s_sched.frames;
+		const uint32_t now = x68k_sched_now();
+		if (now > 4 * FRAME_US) x68k_sched_wait_frame();
+		const uint8_t due =
+		    (c->budget_us && now - s_sched.slice_start >= c->budget_us) ||
+		    (c->background && now >= s_sched.deadline_us);
+		x68k_sched_yield();
+		if (due && s_sched.frames == frame) s_missed_yields++;
+	}
+}
+
+// Runs until the frame time in arg, once a frame.
+static void task_busy_until(void *arg)
+{
+	const uint32_t until = (uint32_t)(intptr_t)arg;
+	for (;;)
+	{
+		while (x68k_sched_now() < until) {}
+		x68k_sched_wait_frame();
+	}
+}
+
+// Scenes ====================================================================
+
+static int scene_order(const char *name)
+{
+	X68kSchedTask t[4];
+	X68kSchedTaskConfig c[4];
+	start();
+	add_task(&t[0], &c[0], 0, task_three_frames, 2, 0, 0);
+	add_task(&t[1], &c[1], 1, task_three_frames, 0, 0, 0);
+	add_task(&t[2], &c[2], 2, task_three_frames, 1, 0, 0);
+	add_task(&t[3], &c[3], 3, task_three_frames, 0, 0, 0);
+
+	int errors = 0;
+	for (int f = 0; f < 3; f++)
+	{
+		const uint16_t live = x68k_sched_frame(&s_sched);
+		if (live != 4) errors += fail(name, "live", live, 4);
+	}
+	// Each task returns from its last wait in the fourth frame.
+	const uint16_t live = x68k_sched_frame(&s_sched);
+	if (live != 0) errors += fail(name, "live at the end", live, 0);
+
+	static const uint8_t expect[4] = {1, 3, 2, 0};
+	if (s_log_len != 12) errors += fail(name, "runs", s_log_len, 12);
+	for (int i = 0; i < s_log_len && i < 12; i++)
+	{
+		if (s_log[i] != expect[i & 3])
+		{
+			errors += fail(name, "task run", s_log[i], expect[i & 3]);
+		}
+	}
+	x68k_sched_shutdown(&s_sched);
+	return errors;
+}
+
+static int scene_wait_frame(const char *name)
+{
+	X68kSchedTask t;
+	X68kSchedTaskConfig c;
+	start();
+	add_task(&t, &c, 0, task_three_frames, 0, 0, 0);
+
+	int errors = 0;
+	for (int f = 0; f < 5; f++) x68k_sched_frame(&s_sched);
+	if (s_log_len != 3) errors += fail(name, "runs", s_log_len, 3);
+	for (int i = 0; i < s_log_len; i++)
+	{
+		if (s_log_frame[i] != (uint32_t)i + 1)
+		{
+			errors += fail(name, "frame of run", s_log_frame[i], i + 1);
+		}
+	}
+	if (t.state != X68K_SCHED_DONE)
+	{
+		errors += fail(name, "state", t.state, X68K_SCHED_DONE);
+	}
+	if (t.frames != 4) errors += fail(name, "frames run", t.frames, 4);
+	x68k_sched_shutdown(&s_sched);
+	return errors;
+}
+
+static int scene_budget(const char *name)
+{
+	X68kSchedTask t;
+	X68kSchedTaskConfig c;
+	start();
+	add_task(&t, &c, 0, task_spin, 0, 0, BUDGET_US);
+
+	int errors = 0;
+	uint32_t spins = 0;
+	for (int f = 0; f < s_frames; f++)
+	{
+		x68k_sched_frame(&s_sched);
+		if (t.used_us < BUDGET_US)
+		{
+			errors += fail(name, "used_us", t.used_us, BUDGET_US);
+		}
+		if (t.over_budget != f + 1)
+		{
+			errors += fail(name, "over_budget", t.over_budget, f + 1);
+		}
+		// Carried on from the yield rather than starting over.
+		if (s_spins <= spins) errors += fail(name, "spins", s_spins, spins);
+		spins = s_spins;
+	}
+	if (t.state != X68K_SCHED_READY)
+	{
+		errors += fail(name, "state", t.state, X68K_SCHED_READY);
+	}
+	if (s_missed_yields)
+	{
+		errors += fail(name, "missed yields", s_missed_yields, 0);
+	}
+	x68k_sched_shutdown(&s_sched);
+	return errors;
+}
+
+static int scene_deadline(const char *name)
+{
+	X68kSchedTask t[2];
+	X68kSchedTaskConfig c[2];
+	start();
+	add_task(&t[0], &c[0], 0, task_busy_until, 0, 0, 0);
+	c[0].arg = (void *)(intptr_t)2000;
+	add_task(&t[1], &c[1], 1, task_spin, 1, 1, 0);
+
+	int errors = 0;
+	const uint32_t deadline = s_sched.deadline_us;
+	for (int f = 0; f < s_frames; f++)
+	{
+		x68k_sched_frame(&s_sched);
+		const uint32_t end = s_sched.slice_start + t[1].used_us;
+		if (end < deadline) errors += fail(name, "suspended at", end, deadline);
+		if (t[1].frames != (uint32_t)f + 1)
+		{
+			errors += fail(name, "frames run", t[1].frames, f + 1);
+		}
+	}
+	if (t[1].over_budget)
+	{
+		errors += fail(name, "over_budget", t[1].over_budget, 0);
+	}
+	if (s_missed_yields)
+	{
+		errors += fail(name, "missed yields", s_missed_yields, 0);
+	}
+	x68k_sched_shutdown(&s_sched);
+	return errors;
+}
+
+static int scene_late_start(const char *name)
+{
+	X68kSchedTask t[2];
+	X68kSchedTaskConfig c[2];
+	start();
+	add_task(&t[0], &c[0], 0, task_busy_until, 0, 0, 0);
+	c[0].arg = (void *)(intptr_t)(FRAME_US - MARGIN_US / 2);
+	add_task(&t[1], &c[1], 1, task_spin, 1, 1, 0);
+
+	int errors = 0;
+	for (int f = 0; f < s_frames; f++)
+	{
+		const uint16_t live = x68k_sched_frame(&s_sched);
+		if (live != 2) errors += fail(name, "live", live, 2);
+	}
+	if (t[1].frames) errors += fail(name, "frames run", t[1].frames, 0);
+	if (s_spins) errors += fail(name, "spins", s_spins, 0);
+	x68k_sched_shutdown(&s_sched);
+	return errors;
+}
+
+static int scene_late_frame(const char *name)
+{
+	X68kSchedTask t;
+	X68kSchedTaskConfig c;
+	start();
+	add_task(&t, &c, 0, task_busy_until, 0, 0, 0);
+	c.arg = (void *)(intptr_t)(FRAME_US + 2000);
+
+	int errors = 0;
+	for (int f = 0; f < s_frames; f++) x68k_sched_frame(&s_sched);
+	if (t.misses != s_frames) errors += fail(name, "misses", t.misses, s_frames);
+	if (s_sched.late_frames != s_frames)
+	{
+		errors += fail(name, "late_frames", s_sched.late_frames, s_frames);
+	}
+	if (s_sched.peak_us < FRAME_US + 2000)
+	{
+		errors += fail(name, "peak_us", s_sched.peak_us, FRAME_US + 2000);
+	}
+	x68k_sched_shutdown(&s_sched);
+	return errors;
+}
+
+typedef struct Scene
+{
+	const char *name;
+	int (*run)(const char *name);
+} Scene;
+
+static const Scene s_scenes[] =
+{
+	{"order", scene_order},
+	{"wait_frame", scene_wait_frame},
+	{"budget", scene_budget},
+	{"deadline", scene_deadline},
+	{"late_start", scene_late_start},
+	{"late_frame", scene_late_frame},
+};
+
+int main(int argc, char **argv)
+{
+	int opt;
+	while ((opt = getopt(argc, argv, "f:v")) != -1)
+	{
+		switch (opt)
+		{
+			case 'f':
+				s_frames = atoi(optarg);
+				break;
+			case 'v':
+				s_verbose = 1;
+				break;
+			default:
+				usage();
+		}
+	}
+	if (optind != argc || s_frames < 1) usage();
+
+	printf("scene,frames,status\n");
+	int failed = 0;
+	for (size_t i = 0; i < sizeof(s_scenes) / sizeof(s_scenes[0]); i++)
+	{
+		const int errors = s_scenes[i].run(s_scenes[i].name);
+		printf("%s,%lu,%s\n", s_scenes[i].name, (unsigned long)s_sched.frames,
+		       errors ? "FAIL" : "ok");
+		if (errors) failed++;
+	}
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,2072 @@
+/*
+
+sim68k: cycle-counting 68000 for benchmarks (host tool)
+
+Build:
+	cc -O2 -I../src -o sim68k sim68k.c
+
+Usage:
+	sim68k [-c max_cycles] [-w start-end=waits] program.x [args...]
+
+Runs a Human68k executable on a 68000 core that counts cycles, and exits
+with the program's exit code. A benchmark program built with X68K_BENCH_SIM
+(see src/util/x68k_bench.h) times its cases with the core's cycle counter
+instead of Timer-D, prints the same table as on the machine, and returns its
+number of regressions, so a host build can run it after every change:
+
+	sim68k bench.x > bench.csv || echo "over budget"
+
+Timing follows the tables in the 68000 user's manual: each instruction costs
+its listed cycles for its addressing modes, with MULU/MULS/DIVU/DIVS and
+shifts counted from their operands, plus wait states on every bus access.
+Waits are set per 64KB region (-w takes hex addresses and may be repeated);
+the defaults are rough figures for a 10MHz X68000:
+
+	000000-BFFFFF  0   Main RAM
+	C00000-E7FFFF  1   Graphic and text VRAM
+	E80000-EBFFFF  2   I/O, sprites, BG and PCG
+	EC0000-FFFFFF  1   Expansion, SRAM, ROM
+
+Of the machine, there is just enough for library code to run:
+
+* 12MB of RAM; every other address reads back what was last written there.
+* MFP GPIP: VDISP, VSYNC and HSYNC follow a 31kHz frame of 568 lines, 512 of
+  them displayed, from the cycle count, so waits for a blank finish.
+* OPM status: never busy.
+* X68K_BENCH_SIM_CYCLES: the low 32 bits of the cycle count, as a longword.
+* No interrupts, so handlers set with _INTVCS and the like never run.
+
+DOS calls (line F) and IOCS calls (trap #15) cover a C program's startup,
+console output, memory blocks and exit. Each costs the 34 cycles of the
+exception and nothing for the call itself, so keep them out of timed code.
+Unknown calls return -1 and are reported once on stderr. Address errors,
+illegal instructions and exceptions with no handler stop the program.
+
+On exit, prints the cycle, instruction and wait state totals on stderr.
+Exits with 255 if the program was stopped or ran past max_cycles (default
+10^10).
+
+*/
+#include "util/x68k_bench.h"
+
+#include <inttypes.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ADDR_MASK 0xFFFFFF
+#define RAM_END 0xC00000
+#define SSP_TOP 0x8000
+#define ENV_ADDR 0x8000
+#define CMD_ADDR 0x8100
+#define PSP_ADDR 0x9000  // Memory block header, then the PDB
+#define LOAD_ADDR (PSP_ADDR + 0x100)
+
+#define SR_C 0x0001
+#define SR_V 0x0002
+#define SR_Z 0x0004
+#define SR_N 0x0008
+#define SR_X 0x0010
+#define SR_S 0x2000
+#define SR_MASK 0xA71F
+
+// Video timing for the GPIP bits, in cycles at 10MHz.
+#define LINE_CYCLES 318
+#define HSYNC_CYCLES 30
+#define FRAME_LINES 568
+#define DISP_LINES 512
+#define VSYNC_LINE 534
+#define VSYNC_LINES 6
+
+#define GPIP_ADDR 0xE88001
+#define OPM_STATUS_ADDR 0xE90003
+
+#define EXC_ADDRESS 3
+#define EXC_ILLEGAL 4
+#define EXC_ZERO_DIVIDE 5
+#define EXC_CHK 6
+#define EXC_TRAPV 7
+#define EXC_PRIVILEGE 8
+#define EXC_LINE_A 10
+#define EXC_LINE_F 11
+#define EXC_TRAP 32
+
+#define EXIT_STOPPED 255
+
+typedef struct Cpu
+{
+	uint32_t r[16];    // d0-d7, a0-a7; a7 is the active stack pointer
+	uint32_t other_sp; // USP in supervisor mode, SSP in user mode
+	uint32_t pc;
+	uint32_t op_pc;    // Start of the current instruction
+	uint16_t sr;
+	uint64_t cycles;
+	uint64_t waits;
+	uint64_t insns;
+} Cpu;
+
+// Operand of an instruction, decoded from its mode and register fields.
+typedef enum EaKind
+{
+	EA_DREG,
+	EA_AREG,
+	EA_MEM,
+	EA_IMM,
+} EaKind;
+
+typedef struct Ea
+{
+	uint8_t kind;
+	uint8_t reg;
+	uint8_t mi;  // Row in the timing tables
+	uint32_t addr;
+	uint32_t imm;
+} Ea;
+
+// Timing table rows: Dn, An, (An), (An)+, -(An), d16(An), d8(An,Xn), abs.W,
+// abs.L, d16(PC), d8(PC,Xn), #imm.
+enum
+{
+	MI_DREG, MI_AREG, MI_IND, MI_POSTINC, MI_PREDEC, MI_DISP, MI_INDEX,
+	MI_ABS_W, MI_ABS_L, MI_PC_DISP, MI_PC_INDEX, MI_IMM,
+};
+
+// Effective address calculation, byte/word and long.
+static const uint8_t s_ea_bw[12] = {0, 0, 4, 4, 6, 8, 10, 8, 12, 8, 10, 4};
+static const uint8_t s_ea_l[12] = {0, 0, 8, 8, 10, 12, 14, 12, 16, 12, 14, 8};
+// MOVE destinations, byte/word and long.
+static const uint8_t s_move_bw[9] = {0, 0, 4, 4, 4, 8, 10, 8, 12};
+static const uint8_t s_move_l[9] = {0, 0, 8, 8, 8, 12, 14, 12, 16};
+// Control modes, from (An) on; 0 where the mode isn't allowed.
+static const uint8_t s_jmp[12] = {0, 0, 8, 0, 0, 10, 14, 10, 12, 10, 14, 0};
+static const uint8_t s_jsr[12] = {0, 0, 16, 0, 0, 18, 22, 18, 20, 18, 22, 0};
+static const uint8_t s_lea[12] = {0, 0, 4, 0, 0, 8, 12, 8, 12, 8, 12, 0};
+static const uint8_t s_pea[12] = {0, 0, 12, 0, 0, 16, 20, 16, 20, 16, 20, 0};
+static const uint8_t s_movem_rm[12] = {0, 0, 8, 0, 8, 12, 14, 12, 16, 0, 0, 0};
+static const uint8_t s_movem_mr[12] = {0, 0, 12, 12, 0, 16, 18, 16, 20, 16,
+                                       18, 0};
+
+static uint8_t *s_mem;
+static uint8_t s_wait[256];
+
+static jmp_buf s_stop;
+static int s_exit_code;
+static uint32_t s_block_end;  // End of the program's memory block
+static uint32_t s_malloc_next;
+static uint8_t s_reported[2][256];
+
+static void usage(void)
+{
+	fprintf(stderr,
+	        "usage: sim68k [-c max_cycles] [-w start-end=waits] program.x "
+	        "[args...]\n"
+	        "  -c  stop after this many cycles (default 10000000000)\n"
+	        "  -w  wait states per bus access in a range of addresses, in hex"
+	        "\n"
+	        "      (e.g. -w e80000-ebffff=2)\n");
+	exit(2);
+}
+
+static void stop(Cpu *c, const char *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	fprintf(stderr, "sim68k: ");
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fprintf(stderr, " at pc $%06" PRIX32 "\n", c->op_pc);
+	s_exit_code = EXIT_STOPPED;
+	longjmp(s_stop, 1);
+}
+
+// Memory =====================================================================
+
+static inline uint32_t mask_of(int sz)
+{
+	return (sz == 1) ? 0xFF : (sz == 2) ? 0xFFFF : 0xFFFFFFFF;
+}
+
+static inline uint32_t msb_of(int sz)
+{
+	return (sz == 1) ? 0x80 : (sz == 2) ? 0x8000 : 0x80000000;
+}
+
+static inline int32_t sext(uint32_t v, int sz)
+{
+	return (sz == 1) ? (int8_t)v : (sz == 2) ? (int16_t)v : (int32_t)v;
+}
+
+static uint8_t gpip(const Cpu *c)
+{
+	const uint32_t line = (c->cycles / LINE_CYCLES) % FRAME_LINES;
+	uint8_t v = 0x2F;
+	if (line < DISP_LINES) v |= 1 << 4;
+	if (line < VSYNC_LINE || line >= VSYNC_LINE + VSYNC_LINES) v |= 1 << 6;
+	if (c->cycles % LINE_CYCLES >= HSYNC_CYCLES) v |= 1 << 7;
+	return v;
+}
+
+static uint8_t peek8(const Cpu *c, uint32_t addr)
+{
+	addr &= ADDR_MASK;
+	if (addr >= RAM_END)
+	{
+		if (addr == GPIP_ADDR) return gpip(c);
+		if (addr == OPM_STATUS_ADDR) return 0;
+		if (addr - X68K_BENCH_SIM_CYCLES < 4)
+		{
+			return (uint32_t)c->cycles >> ((3 - (addr & 3)) * 8);
+		}
+	}
+	return s_mem[addr];
+}
+
+static uint16_t peek16(const Cpu *c, uint32_t addr)
+{
+	return (peek8(c, addr) << 8) | peek8(c, addr + 1);
+}
+
+static uint32_t peek32(const Cpu *c, uint32_t addr)
+{
+	return ((uint32_t)peek16(c, addr) << 16) | peek16(c, addr + 2);
+}
+
+static void poke8(uint32_t addr, uint8_t v)
+{
+	s_mem[addr & ADDR_MASK] = v;
+}
+
+static void poke16(uint32_t addr, uint16_t v)
+{
+	poke8(addr, v >> 8);
+	poke8(addr + 1, v);
+}
+
+static void poke32(uint32_t addr, uint32_t v)
+{
+	poke16(addr, v >> 16);
+	poke16(addr + 2, v);
+}
+
+// One bus cycle's wait states.
+static inline void bus(Cpu *c, uint32_t addr)
+{
+	const uint8_t w = s_wait[(addr >> 16) & 0xFF];
+	c->cycles += w;
+	c->waits += w;
+}
+
+static uint32_t mem_read(Cpu *c, uint32_t addr, int sz)
+{
+	addr &= ADDR_MASK;
+	if (sz > 1 && (addr & 1)) stop(c, "address error reading $%06" PRIX32,
+	                               addr);
+	bus(c, addr);
+	if (sz == 1) return peek8(c, addr);
+	if (sz == 2) return peek16(c, addr);
+	bus(c, addr);
+	// The cycle counter is read on the first of the two bus cycles.
+	const uint16_t hi = peek16(c, addr);
+	return ((uint32_t)hi << 16) | peek16(c, addr + 2);
+}
+
+static void mem_write(Cpu *c, uint32_t addr, int sz, uint32_t v)
+{
+	addr &= ADDR_MASK;
+	if (sz > 1 && (addr & 1)) stop(c, "address error writing $%06" PRIX32,
+	                               addr);
+	bus(c, addr);
+	if (sz == 1)
+	{
+		poke8(addr, v);
+	}
+	else if (sz == 2)
+	{
+		poke16(addr, v);
+	}
+	else
+	{
+		bus(c, addr);
+		poke32(addr, v);
+	}
+}
+
+static uint16_t fetch16(Cpu *c)
+{
+	const uint16_t v = mem_read(c, c->pc, 2);
+	c->pc += 2;
+	return v;
+}
+
+static uint32_t fetch32(Cpu *c)
+{
+	const uint32_t hi = fetch16(c);
+	return (hi << 16) | fetch16(c);
+}
+
+static void push32(Cpu *c, uint32_t v)
+{
+	c->r[15] -= 4;
+	mem_write(c, c->r[15], 4, v);
+}
+
+static uint32_t pop32(Cpu *c)
+{
+	const uint32_t v = mem_read(c, c->r[15], 4);
+	c->r[15] += 4;
+	return v;
+}
+
+// CPU state ==================================================================
+
+static void set_sr(Cpu *c, uint16_t sr)
+{
+	sr &= SR_MASK;
+	if ((sr ^ c->sr) & SR_S)
+	{
+		const uint32_t sp = c->r[15];
+		c->r[15] = c->other_sp;
+		c->other_sp = sp;
+	}
+	c->sr = sr;
+}
+
+static void exception(Cpu *c, int vec, const char *name)
+{
+	const uint32_t handler = peek32(c, vec * 4);
+	if (!handler) stop(c, "%s with no handler", name);
+	const uint16_t sr = c->sr;
+	set_sr(c, (sr | SR_S) & ~0x8000);
+	push32(c, c->pc);
+	c->r[15] -= 2;
+	mem_write(c, c->r[15], 2, sr);
+	c->pc = handler;
+}
+
+// Returns 0 after taking the exception in user mode.
+static int privileged(Cpu *c)
+{
+	if (c->sr & SR_S) return 1;
+	c->pc = c->op_pc;
+	c->cycles += 34;
+	exception(c, EXC_PRIVILEGE, "privilege violation");
+	return 0;
+}
+
+static int cond(const Cpu *c, int cc)
+{
+	const int C = c->sr & SR_C;
+	const int V = !!(c->sr & SR_V);
+	const int Z = c->sr & SR_Z;
+	const int N = !!(c->sr & SR_N);
+	switch (cc)
+	{
+		case 0: return 1;
+		case 1: return 0;
+		case 2: return !C && !Z;
+		case 3: return C || Z;
+		case 4: return !C;
+		case 5: return C;
+		case 6: return !Z;
+		case 7: return Z;
+		case 8: return !V;
+		case 9: return V;
+		case 10: return !N;
+		case 11: return N;
+		case 12: return N == V;
+		case 13: return N != V;
+		case 14: return !Z && N == V;
+		default: return Z || N != V;
+	}
+}
+
+// N and Z from a result, V and C cleared.
+static void set_nz(Cpu *c, uint32_t v, int sz)
+{
+	c->sr &= ~(SR_N | SR_Z | SR_V | SR_C);
+	if (!(v & mask_of(sz))) c->sr |= SR_Z;
+	if (v & msb_of(sz)) c->sr |= SR_N;
+}
+
+// d + s (+ X for ADDX, which only ever clears Z).
+static uint32_t alu_add(Cpu *c, uint32_t s, uint32_t d, int sz, int extend)
+{
+	const uint32_t m = mask_of(sz);
+	const uint32_t hi = msb_of(sz);
+	s &= m;
+	d &= m;
+	const uint32_t x = extend ? !!(c->sr & SR_X) : 0;
+	const uint32_t r = (d + s + x) & m;
+	const uint16_t z = extend ? (c->sr & SR_Z) : SR_Z;
+	c->sr &= ~(SR_X | SR_N | SR_Z | SR_V | SR_C);
+	if (((s & d) | ((s | d) & ~r)) & hi) c->sr |= SR_C | SR_X;
+	if ((~(s ^ d) & (s ^ r)) & hi) c->sr |= SR_V;
+	if (r & hi) c->sr |= SR_N;
+	if (!r) c->sr |= z;
+	return r;
+}
+
+// d - s (- X for SUBX and NEGX). CMP keeps X.
+static uint32_t alu_sub(Cpu *c, uint32_t s, uint32_t d, int sz, int extend,
+                        int keep_x)
+{
+	const uint32_t m = mask_of(sz);
+	const uint32_t hi = msb_of(sz);
+	s &= m;
+	d &= m;
+	const uint32_t x = extend ? !!(c->sr & SR_X) : 0;
+	const uint32_t r = (d - s - x) & m;
+	const uint16_t z = extend ? (c->sr & SR_Z) : SR_Z;
+	const uint16_t old_x = c->sr & SR_X;
+	c->sr &= ~(SR_X | SR_N | SR_Z | SR_V | SR_C);
+	if (((s & ~d) | ((s | ~d) & r)) & hi) c->sr |= SR_C | SR_X;
+	if (((s ^ d) & (r ^ d)) & hi) c->sr |= SR_V;
+	if (r & hi) c->sr |= SR_N;
+	if (!r) c->sr |= z;
+	if (keep_x) c->sr = (c->sr & ~SR_X) | old_x;
+	return r;
+}
+
+static uint8_t bcd_add(Cpu *c, uint8_t s, uint8_t d)
+{
+	int lo = (d & 0x0F) + (s & 0x0F) + !!(c->sr & SR_X);
+	int hi = (d >> 4) + (s >> 4);
+	if (lo > 9)
+	{
+		lo -= 10;
+		hi++;
+	}
+	const int carry = hi > 9;
+	if (carry) hi -= 10;
+	const uint8_t r = ((hi & 0x0F) << 4) | (lo & 0x0F);
+	c->sr &= ~(SR_X | SR_C | SR_N);
+	if (carry) c->sr |= SR_X | SR_C;
+	if (r) c->sr &= ~SR_Z;
+	if (r & 0x80) c->sr |= SR_N;
+	return r;
+}
+
+static uint8_t bcd_sub(Cpu *c, uint8_t s, uint8_t d)
+{
+	int lo = (d & 0x0F) - (s & 0x0F) - !!(c->sr & SR_X);
+	int hi = (d >> 4) - (s >> 4);
+	if (lo < 0)
+	{
+		lo += 10;
+		hi--;
+	}
+	const int borrow = hi < 0;
+	if (borrow) hi += 10;
+	const uint8_t r = ((hi & 0x0F) << 4) | (lo & 0x0F);
+	c->sr &= ~(SR_X | SR_C | SR_N);
+	if (borrow) c->sr |= SR_X | SR_C;
+	if (r) c->sr &= ~SR_Z;
+	if (r & 0x80) c->sr |= SR_N;
+	return r;
+}
+
+// Operands ===================================================================
+
+static uint32_t index_ext(Cpu *c, uint32_t base)
+{
+	const uint16_t ext = fetch16(c);
+	int32_t x = c->r[(ext >> 12) & 15];
+	if (!(ext & 0x800)) x = (int16_t)x;
+	return base + x + (int8_t)ext;
+}
+
+// Decodes mode and register fields, fetching any extension words and
+// updating the register for (An)+ and -(An). Returns 0 for a bad mode.
+static int ea_decode(Cpu *c, Ea *e, int mode, int reg, int sz)
+{
+	const int step = (sz == 1 && reg == 7) ? 2 : sz;
+	e->reg = reg;
+	e->kind = EA_MEM;
+	switch (mode)
+	{
+		case 0:
+			e->kind = EA_DREG;
+			e->mi = MI_DREG;
+			return 1;
+		case 1:
+			e->kind = EA_AREG;
+			e->mi = MI_AREG;
+			return 1;
+		case 2:
+			e->addr = c->r[8 + reg];
+			e->mi = MI_IND;
+			return 1;
+		case 3:
+			e->addr = c->r[8 + reg];
+			c->r[8 + reg] += step;
+			e->mi = MI_POSTINC;
+			return 1;
+		case 4:
+			c->r[8 + reg] -= step;
+			e->addr = c->r[8 + reg];
+			e->mi = MI_PREDEC;
+			return 1;
+		case 5:
+			e->addr = c->r[8 + reg] + (int16_t)fetch16(c);
+			e->mi = MI_DISP;
+			return 1;
+		case 6:
+			e->addr = index_ext(c, c->r[8 + reg]);
+			e->mi = MI_INDEX;
+			return 1;
+		default:
+			break;
+	}
+	switch (reg)
+	{
+		case 0:
+			e->addr = (int16_t)fetch16(c);
+			e->mi = MI_ABS_W;
+			return 1;
+		case 1:
+			e->addr = fetch32(c);
+			e->mi = MI_ABS_L;
+			return 1;
+		case 2:
+		{
+			const uint32_t base = c->pc;
+			e->addr = base + (int16_t)fetch16(c);
+			e->mi = MI_PC_DISP;
+			return 1;
+		}
+		case 3:
+			e->addr = index_ext(c, c->pc);
+			e->mi = MI_PC_INDEX;
+			return 1;
+		case 4:
+			e->kind = EA_IMM;
+			e->imm = (sz == 4) ? fetch32(c) : (fetch16(c) & mask_of(sz));
+			e->mi = MI_IMM;
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+// As ea_decode(), adding the address calculation time.
+static void ea_get(Cpu *c, Ea *e, int mode, int reg, int sz)
+{
+	if (!ea_decode(c, e, mode, reg, sz))
+	{
+		c->pc = c->op_pc;
+		stop(c, "illegal instruction $%04" PRIX32, peek16(c, c->op_pc));
+	}
+	c->cycles += (sz == 4) ? s_ea_l[e->mi] : s_ea_bw[e->mi];
+}
+
+static uint32_t ea_read(Cpu *c, const Ea *e, int sz)
+{
+	switch (e->kind)
+	{
+		case EA_DREG: return c->r[e->reg] & mask_of(sz);
+		case EA_AREG: return c->r[8 + e->reg] & mask_of(sz);
+		case EA_IMM: return e->imm;
+		default: return mem_read(c, e->addr, sz);
+	}
+}
+
+static void ea_write(Cpu *c, const Ea *e, int sz, uint32_t v)
+{
+	const uint32_t m = mask_of(sz);
+	switch (e->kind)
+	{
+		case EA_DREG:
+			c->r[e->reg] = (c->r[e->reg] & ~m) | (v & m);
+			break;
+		case EA_AREG:
+			c->r[8 + e->reg] = v;
+			break;
+		case EA_MEM:
+			mem_write(c, e->addr, sz, v);
+			break;
+		default:
+			stop(c, "write to an immediate operand");
+	}
+}
+
+// Address of a control mode operand, for LEA, PEA, JMP and JSR. Returns the
+// table row.
+static int ea_control(Cpu *c, int op, const uint8_t *table, uint32_t *addr)
+{
+	Ea e;
+	if (!ea_decode(c, &e, (op >> 3) & 7, op & 7, 4) || !table[e.mi])
+	{
+		stop(c, "illegal instruction $%04" PRIX32, op);
+	}
+	*addr = e.addr;
+	c->cycles += table[e.mi];
+	return e.mi;
+}
+
+static void illegal(Cpu *c, int op)
+{
+	c->pc = c->op_pc;
+	c->cycles += 34;
+	if ((op & 0xF000) == 0xA000)
+	{
+		exception(c, EXC_LINE_A, "line A");
+		return;
+	}
+	if (!peek32(c, EXC_ILLEGAL * 4))
+	{
+		stop(c, "illegal instruction $%04" PRIX32, op);
+	}
+	exception(c, EXC_ILLEGAL, "illegal instruction");
+}
+
+// Exact MULU/MULS and DIVU/DIVS timings, from the number of bits set in the
+// operand and the steps the microcode's division loop takes.
+static int mulu_cycles(uint16_t s)
+{
+	return 38 + 2 * __builtin_popcount(s);
+}
+
+static int muls_cycles(uint16_t s)
+{
+	const uint32_t x = (uint32_t)s << 1;
+	return 38 + 2 * __builtin_popcount((x ^ (x >> 1)) & 0xFFFF);
+}
+
+static int divu_cycles(uint32_t dividend, uint16_t divisor)
+{
+	if ((dividend >> 16) >= divisor) return 10;
+	int mcycles = 38;
+	const uint32_t hdivisor = (uint32_t)divisor << 16;
+	for (int i = 0; i < 15; i++)
+	{
+		const uint32_t temp = dividend;
+		dividend <<= 1;
+		if ((int32_t)temp < 0)
+		{
+			dividend -= hdivisor;
+		}
+		else
+		{
+			mcycles += 2;
+			if (dividend >= hdivisor)
+			{
+				dividend -= hdivisor;
+				mcycles--;
+			}
+		}
+	}
+	return mcycles * 2;
+}
+
+static int divs_cycles(int32_t dividend, int16_t divisor)
+{
+	int mcycles = (dividend < 0) ? 7 : 6;
+	const uint32_t adividend = (dividend < 0) ? -(uint32_t)dividend :
+	                           (uint32_t)dividend;
+	const uint16_t adivisor = (divisor < 0) ? -divisor : divisor;
+	if ((adividend >> 16) >= adivisor) return (mcycles + 2) * 2;
+	uint32_t aquot = adividend / adivisor;
+	mcycles += 55;
+	if (divisor >= 0)
+	{
+		if (dividend >= 0) mcycles--;
+		else mcycles++;
+	}
+	for (int i = 0; i < 15; i++)
+	{
+		if ((int16_t)aquot >= 0) mcycles++;
+		aquot <<= 1;
+	}
+	return mcycles * 2;
+}
+
+// Shifts and rotates; type 0 AS, 1 LS, 2 ROX, 3 RO.
+static uint32_t shift(Cpu *c, int type, int left, uint32_t v, int sz, int n)
+{
+	const uint32_t m = mask_of(sz);
+	const uint32_t hi = msb_of(sz);
+	v &= m;
+	int carry = 0;
+	int x = !!(c->sr & SR_X);
+	int overflow = 0;
+	for (int i = 0; i < n; i++)
+	{
+		const uint32_t before = v;
+		if (left)
+		{
+			carry = !!(v & hi);
+			v = (v << 1) & m;
+			if (type == 2) v |= x;
+			if (type == 3) v |= carry;
+			if (type == 0 && ((before ^ v) & hi)) overflow = 1;
+		}
+		else
+		{
+			carry = v & 1;
+			v >>= 1;
+			if (type == 0) v |= before & hi;
+			if (type == 2 && x) v |= hi;
+			if (type == 3 && carry) v |= hi;
+		}
+		if (type != 3) x = carry;
+	}
+	uint16_t sr = c->sr & ~(SR_N | SR_Z | SR_V | SR_C);
+	if (type != 3 && n) sr = (sr & ~SR_X) | (x ? SR_X : 0);
+	if (type == 2 && !n) carry = x;
+	if (carry) sr |= SR_C;
+	if (overflow) sr |= SR_V;
+	if (!v) sr |= SR_Z;
+	if (v & hi) sr |= SR_N;
+	c->sr = sr;
+	return v;
+}
+
+// System calls ===============================================================
+
+static void unknown_call(Cpu *c, int table, int n)
+{
+	if (!s_reported[table][n])
+	{
+		fprintf(stderr, "sim68k: unsupported %s call $%02X at pc $%06" PRIX32
+		        "\n", table ? "IOCS" : "DOS", n, c->op_pc);
+		s_reported[table][n] = 1;
+	}
+	c->r[0] = 0xFFFFFFFF;
+}
+
+static void put_string(const Cpu *c, uint32_t addr, FILE *f)
+{
+	for (uint8_t ch; (ch = peek8(c, addr)) != 0; addr++) fputc(ch, f);
+}
+
+static FILE *host_file(uint16_t fileno)
+{
+	return (fileno == 2) ? stderr : (fileno == 1) ? stdout : NULL;
+}
+
+// _SUPER and _B_SUPER: 0 enters supervisor mode on the user stack and
+// returns the old SSP; anything else is the SSP to go back to user mode with.
+static uint32_t super(Cpu *c, uint32_t ssp)
+{
+	if (!ssp)
+	{
+		if (c->sr & SR_S) return 0xFFFFFFFF;
+		const uint32_t old = c->other_sp;
+		c->other_sp = c->r[15];
+		c->sr |= SR_S;
+		return old;
+	}
+	if (c->sr & SR_S)
+	{
+		c->other_sp = ssp;
+		c->sr &= ~SR_S;
+	}
+	return 0;
+}
+
+// _MALLOC and _SETBLOCK; the rest of RAM after the program's block.
+static uint32_t mem_free_size(void)
+{
+	const uint32_t next = s_malloc_next ? s_malloc_next : s_block_end;
+	return (RAM_END - next) & ~0xF;
+}
+
+static uint32_t dos_malloc(uint32_t size)
+{
+	size &= ADDR_MASK;
+	if (!s_malloc_next) s_malloc_next = (s_block_end + 15) & ~0xF;
+	if (size == ADDR_MASK || size + 16 > mem_free_size())
+	{
+		return (size == ADDR_MASK ? 0x81000000 : 0x82000000) |
+		       (mem_free_size() - 16);
+	}
+	const uint32_t p = s_malloc_next + 16;
+	s_malloc_next = (p + size + 15) & ~0xF;
+	return p;
+}
+
+static uint32_t dos_setblock(uint32_t block, uint32_t size)
+{
+	size &= ADDR_MASK;
+	if (block != PSP_ADDR + 0x10) return 0xFFFFFFF7;  // Bad memory block
+	const uint32_t limit = s_malloc_next ? s_malloc_next : RAM_END;
+	if (size == ADDR_MASK || block + size > limit)
+	{
+		return (size == ADDR_MASK ? 0x81000000 : 0x82000000) |
+		       (limit - block);
+	}
+	s_block_end = block + size;
+	poke32(PSP_ADDR + 8, s_block_end);
+	return 0;
+}
+
+static void dos_call(Cpu *c, uint8_t n)
+{
+	const uint32_t sp = c->r[15];
+	// Human68k 2 numbered the calls from $FF80 on as $FF50 on.
+	if (n >= 0x50 && n < 0x80) n += 0x30;
+	uint32_t d0 = 0;
+	switch (n)
+	{
+		case 0x00:  // _EXIT
+			s_exit_code = 0;
+			longjmp(s_stop, 1);
+		case 0x31:  // _KEEPPR
+			s_exit_code = peek16(c, sp + 4);
+			longjmp(s_stop, 1);
+		case 0x4C:  // _EXIT2
+			s_exit_code = peek16(c, sp);
+			longjmp(s_stop, 1);
+		case 0x02:  // _PUTCHAR
+			putchar(peek16(c, sp) & 0xFF);
+			break;
+		case 0x06:  // _INPOUT
+			if (peek16(c, sp) < 0xFE) putchar(peek16(c, sp) & 0xFF);
+			break;
+		case 0x09:  // _PRINT
+			put_string(c, peek32(c, sp), stdout);
+			break;
+		case 0x1D:  // _FPUTC
+			if (host_file(peek16(c, sp + 2)))
+			{
+				fputc(peek16(c, sp) & 0xFF, host_file(peek16(c, sp + 2)));
+			}
+			break;
+		case 0x1E:  // _FPUTS
+			if (host_file(peek16(c, sp + 4)))
+			{
+				put_string(c, peek32(c, sp), host_file(peek16(c, sp + 4)));
+			}
+			break;
+		case 0x01:  // _GETCHAR
+		case 0x07:  // _INKEY
+		case 0x08:  // _GETC
+			d0 = 0x1A;
+			break;
+		case 0x0B:  // _KEYSNS
+		case 0x33:  // _BREAKCK
+		case 0x3E:  // _CLOSE
+		case 0x49:  // _MFREE
+		case 0x1F:  // _ALLCLOSE
+			break;
+		case 0x20:  // _SUPER
+			d0 = super(c, peek32(c, sp));
+			break;
+		case 0x25:  // _INTVCS
+		{
+			const uint16_t vec = peek16(c, sp);
+			if (vec < 0x100)
+			{
+				d0 = peek32(c, vec * 4);
+				poke32(vec * 4, peek32(c, sp + 2));
+			}
+			break;
+		}
+		case 0x35:  // _INTVCG
+			if (peek16(c, sp) < 0x100) d0 = peek32(c, peek16(c, sp) * 4);
+			break;
+		case 0x3D:  // _OPEN
+			d0 = 0xFFFFFFFE;  // File not found
+			break;
+		case 0x3F:  // _READ
+			break;
+		case 0x40:  // _WRITE
+		{
+			FILE *f = host_file(peek16(c, sp));
+			const uint32_t buf = peek32(c, sp + 2);
+			d0 = peek32(c, sp + 6);
+			for (uint32_t i = 0; f && i < d0; i++) fputc(peek8(c, buf + i), f);
+			break;
+		}
+		case 0x44:  // _IOCTRL
+		{
+			const uint16_t mode = peek16(c, sp);
+			const uint16_t fileno = peek16(c, sp + 2);
+			// Character devices: the console for 0-2.
+			if (mode == 0) d0 = (fileno <= 2) ? (fileno ? 0x82 : 0x81) : 0;
+			if (mode == 7) d0 = 0xFF;
+			break;
+		}
+		case 0x48:  // _MALLOC
+			d0 = dos_malloc(peek32(c, sp));
+			break;
+		case 0x4A:  // _SETBLOCK
+			d0 = dos_setblock(peek32(c, sp), peek32(c, sp + 4));
+			break;
+		case 0x81:  // _GETPDB
+			d0 = PSP_ADDR + 0x10;
+			break;
+		default:
+			unknown_call(c, 0, n);
+			return;
+	}
+	c->r[0] = d0;
+}
+
+static void iocs_call(Cpu *c, uint8_t n)
+{
+	uint32_t d0 = 0;
+	switch (n)
+	{
+		case 0x20:  // _B_PUTC
+			putchar(c->r[1] & 0xFF);
+			break;
+		case 0x21:  // _B_PRINT
+			put_string(c, c->r[9], stdout);
+			break;
+		case 0x00:  // _B_KEYINP
+		case 0x01:  // _B_KEYSNS
+		case 0x04:  // _BITSNS
+		case 0x10:  // _CRTMOD
+		case 0x30:  // _SET232C
+		case 0x6B:  // _TIMERDST
+		case 0x6C:  // _VDISPST
+		case 0xC0:  // _SP_INIT
+		case 0xC1:  // _SP_ON
+		case 0xC2:  // _SP_OFF
+			break;
+		case 0x80:  // _B_INTVCS
+		{
+			const uint16_t vec = c->r[1] & 0xFFFF;
+			if (vec < 0x100)
+			{
+				d0 = peek32(c, vec * 4);
+				poke32(vec * 4, c->r[9]);
+			}
+			break;
+		}
+		case 0x81:  // _B_SUPER
+			d0 = super(c, c->r[9]);
+			break;
+		case 0x82:  // _B_BPEEK
+		case 0x83:  // _B_WPEEK
+		case 0x84:  // _B_LPEEK
+		{
+			const int sz = 1 << (n - 0x82);
+			d0 = (sz == 1) ? peek8(c, c->r[9]) :
+			     (sz == 2) ? peek16(c, c->r[9]) : peek32(c, c->r[9]);
+			c->r[9] += sz;
+			break;
+		}
+		case 0x8F:  // _ROMVER: a stock 1.0 ROM
+			d0 = 0x10000000;
+			break;
+		case 0xAC:  // _SYS_STAT: 68000 at 10MHz
+			d0 = (c->r[1] & 0xFFFF) ? 0xFFFFFFFF : (100 << 16);
+			break;
+		default:
+			unknown_call(c, 1, n);
+			return;
+	}
+	c->r[0] = d0;
+}
+
+// Instructions ===============================================================
+
+// Size field in bits 7-6: 0 byte, 1 word, 2 long.
+static inline int size_of(int op)
+{
+	return 1 << ((op >> 6) & 3);
+}
+
+static void op_bit(Cpu *c, int op, uint32_t bit, int dynamic)
+{
+	const int type = (op >> 6) & 3;  // BTST, BCHG, BCLR, BSET
+	const int mode = (op >> 3) & 7;
+	if (mode == 0)
+	{
+		uint32_t *d = &c->r[op & 7];
+		bit &= 31;
+		c->sr = (*d & (1u << bit)) ? (c->sr & ~SR_Z) : (c->sr | SR_Z);
+		if (type == 1) *d ^= 1u << bit;
+		if (type == 2) *d &= ~(1u << bit);
+		if (type == 3) *d |= 1u << bit;
+		static const uint8_t low[4] = {6, 6, 8, 6};
+		c->cycles += (type && bit >= 16) ? low[type] + 2 : low[type];
+		if (!dynamic) c->cycles += 4;
+		return;
+	}
+	Ea e;
+	ea_get(c, &e, mode, op & 7, 1);
+	uint8_t v = ea_read(c, &e, 1);
+	bit &= 7;
+	c->sr = (v & (1u << bit)) ? (c->sr & ~SR_Z) : (c->sr | SR_Z);
+	if (type == 1) v ^= 1u << bit;
+	if (type == 2) v &= ~(1u << bit);
+	if (type == 3) v |= 1u << bit;
+	if (type) ea_write(c, &e, 1, v);
+	c->cycles += (type ? 8 : 4) + (dynamic ? 0 : 4);
+}
+
+static void op_group0(Cpu *c, int op)
+{
+	if (op & 0x100)
+	{
+		if (((op >> 3) & 7) == 1)
+		{
+			// MOVEP
+			const int opmode = (op >> 6) & 7;
+			const int sz = (opmode & 1) ? 4 : 2;
+			uint32_t addr = c->r[8 + (op & 7)] + (int16_t)fetch16(c);
+			uint32_t *d = &c->r[(op >> 9) & 7];
+			if (opmode >= 6)
+			{
+				for (int i = sz - 1; i >= 0; i--, addr += 2)
+				{
+					mem_write(c, addr, 1, *d >> (i * 8));
+				}
+			}
+			else
+			{
+				uint32_t v = 0;
+				for (int i = 0; i < sz; i++, addr += 2)
+				{
+					v = (v << 8) | mem_read(c, addr, 1);
+				}
+				*d = (sz == 2) ? ((*d & 0xFFFF0000) | v) : v;
+			}
+			c->cycles += (sz == 2) ? 16 : 24;
+			return;
+		}
+		op_bit(c, op, c->r[(op >> 9) & 7], 1);
+		return;
+	}
+
+	const int kind = (op >> 9) & 7;
+	if (kind == 4)
+	{
+		op_bit(c, op, fetch16(c) & 0xFF, 0);
+		return;
+	}
+	if ((op & 0xBF) == 0x3C && (kind == 0 || kind == 1 || kind == 5))
+	{
+		// ORI/ANDI/EORI to CCR and SR
+		const int to_sr = op & 0x40;
+		if (to_sr && !privileged(c)) return;
+		const uint16_t mask = to_sr ? 0xFFFF : 0x00FF;
+		const uint16_t imm = fetch16(c) & mask;
+		uint16_t sr = c->sr;
+		if (kind == 0) sr |= imm;
+		if (kind == 1) sr &= imm | ~mask;
+		if (kind == 5) sr ^= imm;
+		set_sr(c, sr);
+		c->cycles += 20;
+		return;
+	}
+	if (kind == 7 || ((op >> 6) & 3) == 3)
+	{
+		illegal(c, op);
+		return;
+	}
+
+	const int sz = size_of(op);
+	const uint32_t imm = (sz == 4) ? fetch32(c) : (fetch16(c) & mask_of(sz));
+	Ea e;
+	ea_get(c, &e, (op >> 3) & 7, op & 7, sz);
+	const uint32_t d = ea_read(c, &e, sz);
+	const int reg = e.kind == EA_DREG;
+	uint32_t r;
+	switch (kind)
+	{
+		case 0:
+			r = d | imm;
+			set_nz(c, r, sz);
+			break;
+		case 1:
+			r = d & imm;
+			set_nz(c, r, sz);
+			break;
+		case 2:
+			r = alu_sub(c, imm, d, sz, 0, 0);
+			break;
+		case 3:
+			r = alu_add(c, imm, d, sz, 0);
+			break;
+		case 5:
+			r = d ^ imm;
+			set_nz(c, r, sz);
+			break;
+		default:  // CMPI
+			alu_sub(c, imm, d, sz, 0, 1);
+			c->cycles += reg ? ((sz == 4) ? 14 : 8) : ((sz == 4) ? 12 : 8);
+			return;
+	}
+	ea_write(c, &e, sz, r);
+	c->cycles += reg ? ((sz == 4) ? 16 : 8) : ((sz == 4) ? 20 : 12);
+}
+
+static void op_move(Cpu *c, int op)
+{
+	static const uint8_t sizes[4] = {0, 1, 4, 2};
+	const int sz = sizes[(op >> 12) & 3];
+	Ea src;
+	ea_get(c, &src, (op >> 3) & 7, op & 7, sz);
+	const uint32_t v = ea_read(c, &src, sz);
+	const int mode = (op >> 6) & 7;
+	const int reg = (op >> 9) & 7;
+	c->cycles += 4;
+	if (mode == 1)
+	{
+		// MOVEA
+		c->r[8 + reg] = sext(v, sz);
+		return;
+	}
+	Ea dst;
+	if (!ea_decode(c, &dst, mode, reg, sz) || dst.mi > MI_ABS_L)
+	{
+		stop(c, "illegal instruction $%04" PRIX32, op);
+	}
+	c->cycles += (sz == 4) ? s_move_l[dst.mi] : s_move_bw[dst.mi];
+	ea_write(c, &dst, sz, v);
+	set_nz(c, v, sz);
+}
+
+static void op_movem(Cpu *c, int op)
+{
+	const int sz = (op & 0x40) ? 4 : 2;
+	const int to_mem = !(op & 0x400);
+	const uint16_t mask = fetch16(c);
+	const int mode = (op >> 3) & 7;
+	const int an = 8 + (op & 7);
+	const int per = (sz == 4) ? 8 : 4;
+	int n = 0;
+
+	if (to_mem && mode == 4)
+	{
+		// -(An) takes the mask backwards, from a7 down to d0.
+		uint32_t addr = c->r[an];
+		for (int i = 0; i < 16; i++)
+		{
+			if (!(mask & (1 << i))) continue;
+			addr -= sz;
+			mem_write(c, addr, sz, c->r[15 - i]);
+			n++;
+		}
+		c->r[an] = addr;
+		c->cycles += s_movem_rm[MI_PREDEC] + per * n;
+		return;
+	}
+	if (!to_mem && mode == 3)
+	{
+		uint32_t addr = c->r[an];
+		for (int i = 0; i < 16; i++)
+		{
+			if (!(mask & (1 << i))) continue;
+			c->r[i] = sext(mem_read(c, addr, sz), sz);
+			addr += sz;
+			n++;
+		}
+		c->r[an] = addr;
+		c->cycles += s_movem_mr[MI_POSTINC] + per * n;
+		return;
+	}
+
+	Ea e;
+	const uint8_t *table = to_mem ? s_movem_rm : s_movem_mr;
+	if (!ea_decode(c, &e, mode, op & 7, sz) || !table[e.mi] ||
+	    e.mi == MI_POSTINC || e.mi == MI_PREDEC)
+	{
+		stop(c, "illegal instruction $%04" PRIX32, op);
+	}
+	uint32_t addr = e.addr;
+	for (int i = 0; i < 16; i++)
+	{
+		if (!(mask & (1 << i))) continue;
+		if (to_mem) mem_write(c, addr, sz, c->r[i]);
+		else c->r[i] = sext(mem_read(c, addr, sz), sz);
+		addr += sz;
+		n++;
+	}
+	c->cycles += table[e.mi] + per * n;
+}
+
+// NEGX, CLR, NEG, NOT.
+static void op_unary(Cpu *c, int op, int kind)
+{
+	const int sz = size_of(op);
+	Ea e;
+	ea_get(c, &e, (op >> 3) & 7, op & 7, sz);
+	const uint32_t d = ea_read(c, &e, sz);
+	uint32_t r;
+	switch (kind)
+	{
+		case 0:
+			r = alu_sub(c, d, 0, sz, 1, 0);
+			break;
+		case 1:
+			r = 0;
+			set_nz(c, r, sz);
+			break;
+		case 2:
+			r = alu_sub(c, d, 0, sz, 0, 0);
+			break;
+		default:
+			r = ~d;
+			set_nz(c, r, sz);
+			break;
+	}
+	ea_write(c, &e, sz, r);
+	if (e.kind == EA_DREG) c->cycles += (sz == 4) ? 6 : 4;
+	else c->cycles += (sz == 4) ? 12 : 8;
+}
+
+static void op_group4(Cpu *c, int op)
+{
+	const int mode = (op >> 3) & 7;
+	Ea e;
+	uint32_t addr;
+
+	if ((op & 0x1C0) == 0x1C0)
+	{
+		// LEA
+		ea_control(c, op, s_lea, &addr);
+		c->r[8 + ((op >> 9) & 7)] = addr;
+		return;
+	}
+	if ((op & 0x1C0) == 0x180)
+	{
+		// CHK.W
+		ea_get(c, &e, mode, op & 7, 2);
+		const int16_t bound = ea_read(c, &e, 2);
+		const int16_t v = c->r[(op >> 9) & 7];
+		c->cycles += 10;
+		if (v < 0 || v > bound)
+		{
+			c->sr = (v < 0) ? (c->sr | SR_N) : (c->sr & ~SR_N);
+			c->cycles += 30;
+			exception(c, EXC_CHK, "CHK");
+		}
+		return;
+	}
+
+	const int sized = ((op >> 6) & 3) != 3;
+	switch ((op >> 8) & 0xF)
+	{
+		case 0x0:
+			if (sized)
+			{
+				op_unary(c, op, 0);
+				return;
+			}
+			// MOVE from SR
+			ea_get(c, &e, mode, op & 7, 2);
+			ea_write(c, &e, 2, c->sr);
+			c->cycles += (e.kind == EA_DREG) ? 6 : 8;
+			return;
+		case 0x2:
+			if (sized)
+			{
+				op_unary(c, op, 1);
+				return;
+			}
+			break;
+		case 0x4:
+			if (sized)
+			{
+				op_unary(c, op, 2);
+				return;
+			}
+			// MOVE to CCR
+			ea_get(c, &e, mode, op & 7, 2);
+			c->sr = (c->sr & 0xFF00) | (ea_read(c, &e, 2) & 0x1F);
+			c->cycles += 12;
+			return;
+		case 0x6:
+			if (sized)
+			{
+				op_unary(c, op, 3);
+				return;
+			}
+			// MOVE to SR
+			if (!privileged(c)) return;
+			ea_get(c, &e, mode, op & 7, 2);
+			set_sr(c, ea_read(c, &e, 2));
+			c->cycles += 12;
+			return;
+		case 0x8:
+			switch ((op >> 6) & 3)
+			{
+				case 0:
+				{
+					// NBCD
+					ea_get(c, &e, mode, op & 7, 1);
+					const uint8_t v = ea_read(c, &e, 1);
+					ea_write(c, &e, 1, bcd_sub(c, v, 0));
+					c->cycles += (e.kind == EA_DREG) ? 6 : 8;
+					return;
+				}
+				case 1:
+					if (mode == 0)
+					{
+						// SWAP
+						uint32_t *d = &c->r[op & 7];
+						*d = (*d << 16) | (*d >> 16);
+						set_nz(c, *d, 4);
+						c->cycles += 4;
+						return;
+					}
+					// PEA
+					ea_control(c, op, s_pea, &addr);
+					push32(c, addr);
+					return;
+				default:
+					if (mode == 0)
+					{
+						// EXT
+						uint32_t *d = &c->r[op & 7];
+						if (op & 0x40)
+						{
+							*d = (int16_t)*d;
+							set_nz(c, *d, 4);
+						}
+						else
+						{
+							*d = (*d & 0xFFFF0000) | ((int8_t)*d & 0xFFFF);
+							set_nz(c, *d, 2);
+						}
+						c->cycles += 4;
+						return;
+					}
+					op_movem(c, op);
+					return;
+			}
+		case 0xA:
+			if (sized)
+			{
+				// TST
+				const int sz = size_of(op);
+				ea_get(c, &e, mode, op & 7, sz);
+				set_nz(c, ea_read(c, &e, sz), sz);
+				c->cycles += 4;
+				return;
+			}
+			if (op == 0x4AFC) break;  // ILLEGAL
+			{
+				// TAS
+				ea_get(c, &e, mode, op & 7, 1);
+				const uint8_t v = ea_read(c, &e, 1);
+				set_nz(c, v, 1);
+				ea_write(c, &e, 1, v | 0x80);
+				c->cycles += (e.kind == EA_DREG) ? 4 : 14;
+				return;
+			}
+		case 0xC:
+			if ((op & 0x80) && mode != 0)
+			{
+				op_movem(c, op);
+				return;
+			}
+			break;
+		case 0xE:
+			if ((op & 0xF0) == 0x40)
+			{
+				// TRAP
+				c->cycles += 34;
+				if ((op & 15) == 15)
+				{
+					iocs_call(c, c->r[0] & 0xFF);
+					return;
+				}
+				exception(c, EXC_TRAP + (op & 15), "TRAP");
+				return;
+			}
+			if ((op & 0xF8) == 0x50)
+			{
+				// LINK
+				const int16_t disp = fetch16(c);
+				push32(c, c->r[8 + (op & 7)]);
+				c->r[8 + (op & 7)] = c->r[15];
+				c->r[15] += disp;
+				c->cycles += 16;
+				return;
+			}
+			if ((op & 0xF8) == 0x58)
+			{
+				// UNLK
+				c->r[15] = c->r[8 + (op & 7)];
+				c->r[8 + (op & 7)] = pop32(c);
+				c->cycles += 12;
+				return;
+			}
+			if ((op & 0xF0) == 0x60)
+			{
+				// MOVE USP
+				if (!privileged(c)) return;
+				if (op & 8) c->r[8 + (op & 7)] = c->other_sp;
+				else c->other_sp = c->r[8 + (op & 7)];
+				c->cycles += 4;
+				return;
+			}
+			switch (op & 0xFF)
+			{
+				case 0x70:  // RESET
+					if (!privileged(c)) return;
+					c->cycles += 132;
+					return;
+				case 0x71:  // NOP
+					c->cycles += 4;
+					return;
+				case 0x72:  // STOP
+					if (!privileged(c)) return;
+					stop(c, "STOP with no interrupts to wake it");
+					return;
+				case 0x73:  // RTE
+				{
+					if (!privileged(c)) return;
+					const uint16_t sr = mem_read(c, c->r[15], 2);
+					c->pc = mem_read(c, c->r[15] + 2, 4);
+					c->r[15] += 6;
+					set_sr(c, sr);
+					c->cycles += 20;
+					return;
+				}
+				case 0x75:  // RTS
+					c->pc = pop32(c);
+					c->cycles += 16;
+					return;
+				case 0x76:  // TRAPV
+					c->cycles += 4;
+					if (c->sr & SR_V)
+					{
+						c->cycles += 30;
+						exception(c, EXC_TRAPV, "TRAPV");
+					}
+					return;
+				case 0x77:  // RTR
+				{
+					const uint16_t ccr = mem_read(c, c->r[15], 2);
+					c->pc = mem_read(c, c->r[15] + 2, 4);
+					c->r[15] += 6;
+					c->sr = (c->sr & 0xFF00) | (ccr & 0x1F);
+					c->cycles += 20;
+					return;
+				}
+				default:
+					break;
+			}
+			if ((op & 0xC0) == 0x80)
+			{
+				// JSR
+				ea_control(c, op, s_jsr, &addr);
+				push32(c, c->pc);
+				c->pc = addr;
+				return;
+			}
+			if ((op & 0xC0) == 0xC0)
+			{
+				// JMP
+				ea_control(c, op, s_jmp, &addr);
+				c->pc = addr;
+				return;
+			}
+			break;
+		default:
+			break;
+	}
+	illegal(c, op);
+}
+
+static void op_group5(Cpu *c, int op)
+{
+	const int mode = (op >> 3) & 7;
+	Ea e;
+	if ((op & 0xC0) == 0xC0)
+	{
+		const int cc = (op >> 8) & 15;
+		if (mode == 1)
+		{
+			// DBcc
+			const uint32_t base = c->pc;
+			const int16_t disp = fetch16(c);
+			if (cond(c, cc))
+			{
+				c->cycles += 12;
+				return;
+			}
+			uint32_t *d = &c->r[op & 7];
+			const uint16_t count = (*d - 1) & 0xFFFF;
+			*d = (*d & 0xFFFF0000) | count;
+			if (count != 0xFFFF)
+			{
+				c->pc = base + disp;
+				c->cycles += 10;
+				return;
+			}
+			c->cycles += 14;
+			return;
+		}
+		// Scc
+		ea_get(c, &e, mode, op & 7, 1);
+		const int t = cond(c, cc);
+		ea_write(c, &e, 1, t ? 0xFF : 0);
+		c->cycles += (e.kind == EA_DREG) ? (t ? 6 : 4) : 8;
+		return;
+	}
+
+	// ADDQ, SUBQ
+	const int sz = size_of(op);
+	const uint32_t data = ((op >> 9) & 7) ? ((op >> 9) & 7) : 8;
+	const int sub = op & 0x100;
+	if (mode == 1)
+	{
+		uint32_t *a = &c->r[8 + (op & 7)];
+		*a = sub ? *a - data : *a + data;
+		c->cycles += 8;
+		return;
+	}
+	ea_get(c, &e, mode, op & 7, sz);
+	const uint32_t d = ea_read(c, &e, sz);
+	ea_write(c, &e, sz, sub ? alu_sub(c, data, d, sz, 0, 0) :
+	                    alu_add(c, data, d, sz, 0));
+	if (e.kind == EA_DREG) c->cycles += (sz == 4) ? 8 : 4;
+	else c->cycles += (sz == 4) ? 12 : 8;
+}
+
+static void op_branch(Cpu *c, int op)
+{
+	const int cc = (op >> 8) & 15;
+	const uint32_t base = c->pc;
+	int32_t disp = (int8_t)op;
+	const int word = !disp;
+	if (word) disp = (int16_t)fetch16(c);
+	if (cc == 1)
+	{
+		// BSR
+		push32(c, c->pc);
+		c->pc = base + disp;
+		c->cycles += 18;
+		return;
+	}
+	if (cond(c, cc))
+	{
+		c->pc = base + disp;
+		c->cycles += 10;
+		return;
+	}
+	c->cycles += word ? 12 : 8;
+}
+
+// Register-to-register timing of ADD, SUB, AND and OR to Dn: long takes 8
+// rather than 6 for register and immediate sources.
+static int long_to_dreg(const Ea *e)
+{
+	return (e->mi == MI_DREG || e->mi == MI_AREG || e->mi == MI_IMM) ? 8 : 6;
+}
+
+// OR, AND, SUB, ADD with a data register on one side.
+static void op_alu(Cpu *c, int op, int kind)
+{
+	const int sz = size_of(op);
+	const int to_mem = op & 0x100;
+	uint32_t *dn = &c->r[(op >> 9) & 7];
+	Ea e;
+	ea_get(c, &e, (op >> 3) & 7, op & 7, sz);
+	const uint32_t a = ea_read(c, &e, sz);
+	const uint32_t s = to_mem ? *dn : a;
+	const uint32_t d = to_mem ? a : *dn;
+	uint32_t r;
+	switch (kind)
+	{
+		case 0:
+			r = s | d;
+			set_nz(c, r, sz);
+			break;
+		case 1:
+			r = s & d;
+			set_nz(c, r, sz);
+			break;
+		case 2:
+			r = alu_sub(c, s, d, sz, 0, 0);
+			break;
+		default:
+			r = alu_add(c, s, d, sz, 0);
+			break;
+	}
+	if (to_mem)
+	{
+		ea_write(c, &e, sz, r);
+		c->cycles += (sz == 4) ? 12 : 8;
+		return;
+	}
+	const uint32_t m = mask_of(sz);
+	*dn = (*dn & ~m) | (r & m);
+	c->cycles += (sz == 4) ? long_to_dreg(&e) : 4;
+}
+
+// ADDX, SUBX, ABCD, SBCD: Dy,Dx or -(Ay),-(Ax).
+static void op_extend(Cpu *c, int op, int kind)
+{
+	const int sz = (kind >= 2) ? 1 : size_of(op);
+	const int rx = (op >> 9) & 7;
+	const int ry = op & 7;
+	uint32_t s, d;
+	Ea ex, ey;
+	if (op & 8)
+	{
+		ea_decode(c, &ey, 4, ry, sz);
+		s = mem_read(c, ey.addr, sz);
+		ea_decode(c, &ex, 4, rx, sz);
+		d = mem_read(c, ex.addr, sz);
+	}
+	else
+	{
+		ex.kind = EA_DREG;
+		ex.reg = rx;
+		s = c->r[ry] & mask_of(sz);
+		d = c->r[rx] & mask_of(sz);
+	}
+	uint32_t r;
+	switch (kind)
+	{
+		case 0: r = alu_add(c, s, d, sz, 1); break;
+		case 1: r = alu_sub(c, s, d, sz, 1, 0); break;
+		case 2: r = bcd_add(c, s, d); break;
+		default: r = bcd_sub(c, s, d); break;
+	}
+	ea_write(c, &ex, sz, r);
+	if (kind >= 2) c->cycles += (op & 8) ? 18 : 6;
+	else if (op & 8) c->cycles += (sz == 4) ? 30 : 18;
+	else c->cycles += (sz == 4) ? 8 : 4;
+}
+
+// ADDA, SUBA, CMPA.
+static void op_addr(Cpu *c, int op, int kind)
+{
+	const int sz = (op & 0x100) ? 4 : 2;
+	Ea e;
+	ea_get(c, &e, (op >> 3) & 7, op & 7, sz);
+	const uint32_t s = sext(ea_read(c, &e, sz), sz);
+	uint32_t *an = &c->r[8 + ((op >> 9) & 7)];
+	if (kind == 2)
+	{
+		alu_sub(c, s, *an, 4, 0, 1);
+		c->cycles += 6;
+		return;
+	}
+	*an = kind ? *an - s : *an + s;
+	c->cycles += (sz == 4) ? long_to_dreg(&e) : 8;
+}
+
+static void op_div(Cpu *c, int op, int sign)
+{
+	Ea e;
+	ea_get(c, &e, (op >> 3) & 7, op & 7, 2);
+	const uint16_t s = ea_read(c, &e, 2);
+	uint32_t *dn = &c->r[(op >> 9) & 7];
+	if (!s)
+	{
+		c->cycles += 38;
+		exception(c, EXC_ZERO_DIVIDE, "division by zero");
+		return;
+	}
+	c->sr &= ~(SR_N | SR_Z | SR_V | SR_C);
+	if (sign)
+	{
+		c->cycles += divs_cycles(*dn, s);
+		const int64_t q = (int64_t)(int32_t)*dn / (int16_t)s;
+		const int64_t rem = (int64_t)(int32_t)*dn % (int16_t)s;
+		if (q < -32768 || q > 32767)
+		{
+			c->sr |= SR_V | SR_N;
+			return;
+		}
+		*dn = ((uint32_t)(rem & 0xFFFF) << 16) | (q & 0xFFFF);
+	}
+	else
+	{
+		c->cycles += divu_cycles(*dn, s);
+		const uint32_t q = *dn / s;
+		if (q > 0xFFFF)
+		{
+			c->sr |= SR_V | SR_N;
+			return;
+		}
+		*dn = ((*dn % s) << 16) | q;
+	}
+	if (*dn & 0x8000) c->sr |= SR_N;
+	if (!(*dn & 0xFFFF)) c->sr |= SR_Z;
+}
+
+static void op_mul(Cpu *c, int op, int sign)
+{
+	Ea e;
+	ea_get(c, &e, (op >> 3) & 7, op & 7, 2);
+	const uint16_t s = ea_read(c, &e, 2);
+	uint32_t *dn = &c->r[(op >> 9) & 7];
+	if (sign)
+	{
+		*dn = (int32_t)(int16_t)*dn * (int16_t)s;
+		c->cycles += muls_cycles(s);
+	}
+	else
+	{
+		*dn = (uint32_t)(uint16_t)*dn * s;
+		c->cycles += mulu_cycles(s);
+	}
+	set_nz(c, *dn, 4);
+}
+
+static void op_group8(Cpu *c, int op)
+{
+	const int opmode = (op >> 6) & 7;
+	if (opmode == 3 || opmode == 7) op_div(c, op, opmode == 7);
+	else if ((op & 0x1F0) == 0x100) op_extend(c, op, 3);
+	else op_alu(c, op, 0);
+}
+
+static void op_addsub(Cpu *c, int op, int add)
+{
+	const int opmode = (op >> 6) & 7;
+	if (opmode == 3 || opmode == 7) op_addr(c, op, !add);
+	else if ((op & 0x130) == 0x100) op_extend(c, op, !add);
+	else op_alu(c, op, add ? 3 : 2);
+}
+
+static void op_groupB(Cpu *c, int op)
+{
+	const int opmode = (op >> 6) & 7;
+	const int sz = size_of(op);
+	Ea e;
+	if (opmode == 3 || opmode == 7)
+	{
+		op_addr(c, op, 2);
+		return;
+	}
+	if (opmode < 3)
+	{
+		// CMP
+		ea_get(c, &e, (op >> 3) & 7, op & 7, sz);
+		alu_sub(c, ea_read(c, &e, sz), c->r[(op >> 9) & 7], sz, 0, 1);
+		c->cycles += (sz == 4) ? 6 : 4;
+		return;
+	}
+	if (((op >> 3) & 7) == 1)
+	{
+		// CMPM
+		Ea ey, ex;
+		ea_decode(c, &ey, 3, op & 7, sz);
+		const uint32_t s = mem_read(c, ey.addr, sz);
+		ea_decode(c, &ex, 3, (op >> 9) & 7, sz);
+		alu_sub(c, s, mem_read(c, ex.addr, sz), sz, 0, 1);
+		c->cycles += (sz == 4) ? 20 : 12;
+		return;
+	}
+	// EOR
+	ea_get(c, &e, (op >> 3) & 7, op & 7, sz);
+	const uint32_t r = ea_read(c, &e, sz) ^ c->r[(op >> 9) & 7];
+	ea_write(c, &e, sz, r);
+	set_nz(c, r, sz);
+	if (e.kind == EA_DREG) c->cycles += (sz == 4) ? 8 : 4;
+	else c->cycles += (sz == 4) ? 12 : 8;
+}
+
+static void op_groupC(Cpu *c, int op)
+{
+	const int opmode = (op >> 6) & 7;
+	if (opmode == 3 || opmode == 7)
+	{
+		op_mul(c, op, opmode == 7);
+		return;
+	}
+	if ((op & 0x1F0) == 0x100)
+	{
+		op_extend(c, op, 2);
+		return;
+	}
+	const int rx = (op >> 9) & 7;
+	const int ry = op & 7;
+	int a = -1, b = -1;
+	if ((op & 0x1F8) == 0x140)
+	{
+		a = rx;
+		b = ry;
+	}
+	else if ((op & 0x1F8) == 0x148)
+	{
+		a = 8 + rx;
+		b = 8 + ry;
+	}
+	else if ((op & 0x1F8) == 0x188)
+	{
+		a = rx;
+		b = 8 + ry;
+	}
+	if (a >= 0)
+	{
+		// EXG
+		const uint32_t t = c->r[a];
+		c->r[a] = c->r[b];
+		c->r[b] = t;
+		c->cycles += 6;
+		return;
+	}
+	op_alu(c, op, 1);
+}
+
+static void op_shift(Cpu *c, int op)
+{
+	const int left = op & 0x100;
+	if ((op & 0xC0) == 0xC0)
+	{
+		// Memory, by one
+		Ea e;
+		ea_get(c, &e, (op >> 3) & 7, op & 7, 2);
+		const uint32_t v = ea_read(c, &e, 2);
+		ea_write(c, &e, 2, shift(c, (op >> 9) & 3, left, v, 2, 1));
+		c->cycles += 8;
+		return;
+	}
+	const int sz = size_of(op);
+	int n = (op >> 9) & 7;
+	if (op & 0x20) n = c->r[n] & 63;
+	else if (!n) n = 8;
+	uint32_t *d = &c->r[op & 7];
+	const uint32_t r = shift(c, (op >> 3) & 3, left, *d, sz, n);
+	const uint32_t m = mask_of(sz);
+	*d = (*d & ~m) | (r & m);
+	c->cycles += ((sz == 4) ? 8 : 6) + 2 * n;
+}
+
+static void step(Cpu *c)
+{
+	c->op_pc = c->pc;
+	const uint16_t op = fetch16(c);
+	c->insns++;
+	switch (op >> 12)
+	{
+		case 0x0:
+			op_group0(c, op);
+			break;
+		case 0x1:
+		case 0x2:
+		case 0x3:
+			op_move(c, op);
+			break;
+		case 0x4:
+			op_group4(c, op);
+			break;
+		case 0x5:
+			op_group5(c, op);
+			break;
+		case 0x6:
+			op_branch(c, op);
+			break;
+		case 0x7:
+			if (op & 0x100)
+			{
+				illegal(c, op);
+				break;
+			}
+			c->r[(op >> 9) & 7] = (int8_t)op;
+			set_nz(c, op & 0xFF, 1);
+			c->cycles += 4;
+			break;
+		case 0x8:
+			op_group8(c, op);
+			break;
+		case 0x9:
+			op_addsub(c, op, 0);
+			break;
+		case 0xB:
+			op_groupB(c, op);
+			break;
+		case 0xC:
+			op_groupC(c, op);
+			break;
+		case 0xD:
+			op_addsub(c, op, 1);
+			break;
+		case 0xE:
+			op_shift(c, op);
+			break;
+		case 0xF:
+			c->cycles += 34;
+			if ((op & 0xFF00) == 0xFF00)
+			{
+				dos_call(c, op & 0xFF);
+				break;
+			}
+			c->pc = c->op_pc;
+			exception(c, EXC_LINE_F, "line F");
+			break;
+		default:
+			illegal(c, op);
+			break;
+	}
+}
+
+// Loading ====================================================================
+
+static inline uint32_t be16(const uint8_t *p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static inline uint32_t be32(const uint8_t *p)
+{
+	return (be16(p) << 16) | be16(p + 2);
+}
+
+// Loads a Human68k .X file at LOAD_ADDR and returns its entry point, or 0.
+static uint32_t load_x(Cpu *c, const char *path, uint32_t *end)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f)
+	{
+		perror(path);
+		return 0;
+	}
+	fseek(f, 0, SEEK_END);
+	const long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	uint8_t *buf = malloc(size > 0 ? size : 1);
+	const int ok = buf && size >= 64 && fread(buf, 1, size, f) == (size_t)size;
+	fclose(f);
+	if (!ok || buf[0] != 'H' || buf[1] != 'U')
+	{
+		fprintf(stderr, "%s: not a Human68k .X file\n", path);
+		free(buf);
+		return 0;
+	}
+	const uint32_t base = be32(buf + 0x04);
+	const uint32_t exec = be32(buf + 0x08);
+	const uint32_t image = be32(buf + 0x0C) + be32(buf + 0x10);
+	const uint32_t bss = be32(buf + 0x14);
+	const uint32_t rel = be32(buf + 0x18);
+	if (0x40 + (uint64_t)image + rel > (uint64_t)size ||
+	    LOAD_ADDR + (uint64_t)image + bss > RAM_END)
+	{
+		fprintf(stderr, "%s: bad header\n", path);
+		free(buf);
+		return 0;
+	}
+	memcpy(s_mem + LOAD_ADDR, buf + 0x40, image);
+	memset(s_mem + LOAD_ADDR + image, 0, bss);
+
+	// Offsets between relocated longwords; 1 escapes a long offset, and an
+	// odd offset marks a word.
+	const uint8_t *r = buf + 0x40 + image;
+	const uint32_t delta = LOAD_ADDR - base;
+	uint32_t pos = LOAD_ADDR;
+	for (uint32_t i = 0; i + 2 <= rel;)
+	{
+		uint32_t off = be16(r + i);
+		i += 2;
+		if (off == 1)
+		{
+			if (i + 4 > rel) break;
+			off = be32(r + i);
+			i += 4;
+		}
+		pos += off & ~1u;
+		if (off & 1) poke16(pos, peek16(c, pos) + delta);
+		else poke32(pos, peek32(c, pos) + delta);
+	}
+	free(buf);
+	*end = LOAD_ADDR + image + bss;
+	return LOAD_ADDR + (exec - base);
+}
+
+// Registers and process block as Human68k sets them up.
+static void start_process(Cpu *c, uint32_t entry, uint32_t end,
+                          int argc, char **argv)
+{
+	// Environment: size, then no variables.
+	poke32(ENV_ADDR, 0x100);
+
+	// Command line: length, then the arguments after a space each.
+	uint32_t len = 0;
+	for (int i = 0; i < argc; i++)
+	{
+		if (len < 255) poke8(CMD_ADDR + 1 + len++, ' ');
+		for (const char *p = argv[i]; *p && len < 255; p++)
+		{
+			poke8(CMD_ADDR + 1 + len++, *p);
+		}
+	}
+	poke8(CMD_ADDR, len);
+	poke8(CMD_ADDR + 1 + len, 0);
+
+	s_block_end = RAM_END;
+	poke32(PSP_ADDR + 0x08, s_block_end);
+	poke32(PSP_ADDR + 0x10, ENV_ADDR);
+	poke32(PSP_ADDR + 0x20, CMD_ADDR);
+	poke32(PSP_ADDR + 0x30, end);
+	poke32(PSP_ADDR + 0x34, end);
+	poke32(PSP_ADDR + 0x38, end);
+
+	c->r[8] = PSP_ADDR;
+	c->r[9] = end;
+	c->r[10] = CMD_ADDR;
+	c->r[11] = ENV_ADDR;
+	c->r[12] = entry;
+	c->r[15] = end;
+	c->other_sp = SSP_TOP;
+	c->sr = 0;
+	c->pc = entry;
+}
+
+static void run(Cpu *c, uint64_t max_cycles)
+{
+	if (setjmp(s_stop)) return;
+	while (c->cycles < max_cycles) step(c);
+	fprintf(stderr, "sim68k: stopped after %" PRIu64 " cycles\n", c->cycles);
+	s_exit_code = EXIT_STOPPED;
+}
+
+static int parse_waits(const char *arg)
+{
+	char *p;
+	const unsigned long lo = strtoul(arg, &p, 16);
+	if (*p++ != '-') return 0;
+	const unsigned long hi = strtoul(p, &p, 16);
+	if (*p++ != '=' || lo > hi || hi > ADDR_MASK) return 0;
+	const unsigned long w = strtoul(p, &p, 0);
+	if (*p || w > 255) return 0;
+	for (unsigned long i = lo >> 16; i <= hi >> 16; i++) s_wait[i] = w;
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t max_cycles = 10000000000ull;
+	for (int i = 0xC0; i <= 0xE7; i++) s_wait[i] = 1;
+	for (int i = 0xE8; i <= 0xEB; i++) s_wait[i] = 2;
+	for (int i = 0xEC; i <= 0xFF; i++) s_wait[i] = 1;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "+c:w:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'c':
+				max_cycles = strtoull(optarg, NULL, 0);
+				break;
+			case 'w':
+				if (!parse_waits(optarg)) usage();
+				break;
+			default:
+				usage();
+		}
+	}
+	if (optind >= argc) usage();
+
+	s_mem = calloc(1, ADDR_MASK + 1);
+	static Cpu cpu;
+	Cpu *c = &cpu;
+	uint32_t end;
+	const uint32_t entry = s_mem ? load_x(c, argv[optind], &end) : 0;
+	if (!entry) return EXIT_STOPPED;
+	start_process(c, entry, end, argc - optind - 1, argv + optind + 1);
+
+	run(c, max_cycles);
+	fflush(stdout);
+	fprintf(stderr, "sim68k: %" PRIu64 " cycles, %" PRIu64 " instructions, "
+	        "%" PRIu64 " wait states\n", c->cycles, c->insns, c->waits);
+	free(s_mem);
+	return s_exit_code;
+}
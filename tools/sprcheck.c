@@ -0,0 +1,325 @@
+/*
+
+sprcheck: checks the sprite queue's overflow rotation (host tool)
+
+Build:
+	cc -O2 -DX68K_CPU_HOST -I../src -o sprcheck sprcheck.c \
+		../src/x68000/x68k_pcg.c ../src/x68000/x68k_cpu.c
+
+Usage:
+	sprcheck [-f frames] [-v]
+
+Maps host memory over the sprite table ($EB0000), then runs scenes through
+x68k_pcg_add_sprite_ranked() and x68k_pcg_finish_sprites() for a number of
+frames each (-f, default 240), reading back what was written every frame.
+The same sprites are queued every frame, so dropping should rotate through
+them.
+
+Checked every frame:
+
+* No 16-line band holds more than X68K_PCG_LINE_LIMIT shown sprites, and no
+  more than 128 are shown.
+* Shown sprites are in submission order, and slots past them are hidden.
+* A sprite within one band is only dropped if every lower-ranked sprite
+  touching that band is dropped too.
+
+Checked over the run, for each rank that loses sprites: with n sprites of
+that rank queued and at most k of them dropped in any frame, every one of
+them is shown at least once every ceil(n / (n - k)) frames. A rank that is
+dropped entirely (k == n) is skipped. The rotation carries on from wherever
+the previous scene left it, so this is counted after SETTLE_FRAMES.
+
+Prints a line per scene:
+
+	scene,sprites,dropped,worst_gap,bound
+
+and exits with 1 if any check failed.
+
+*/
+#include "x68000/x68k_pcg.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define TABLE_BASE 0xEB0000
+#define TABLE_SIZE 0x10000
+#define HW_SPRITES 128
+#define MAX_SPRITES X68K_PCG_SPR_QUEUE_LEN
+#define SETTLE_FRAMES 8
+
+typedef struct Sprite
+{
+	int16_t x, y;
+	uint8_t rank;
+} Sprite;
+
+typedef struct Scene
+{
+	const char *name;
+	int count;
+	void (*make)(Sprite *s, int count);
+} Scene;
+
+static int s_verbose;
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: sprcheck [-f frames] [-v]\n");
+	exit(2);
+}
+
+// Scenes ====================================================================
+
+// Everything on the same band.
+static void make_one_band(Sprite *s, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		s[i].x = (i * 9) & 255;
+		s[i].y = 100 - (100 & 15);
+		s[i].rank = X68K_PCG_RANK_NORMAL;
+	}
+}
+
+// Straddling two bands, half of them a band lower.
+static void make_straddle(Sprite *s, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		s[i].x = (i * 9) & 255;
+		s[i].y = 200 + ((i & 1) ? 8 : 0);
+		s[i].rank = X68K_PCG_RANK_NORMAL;
+	}
+}
+
+// One band, every third sprite low rank.
+static void make_ranked(Sprite *s, int count)
+{
+	make_one_band(s, count);
+	for (int i = 0; i < count; i += 3) s[i].rank = X68K_PCG_RANK_LOW;
+}
+
+// Spread out so no band is full, but more than the table holds.
+static void make_table(Sprite *s, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		s[i].x = (i * 37) & 255;
+		s[i].y = (i % 30) * 16;
+		s[i].rank = (i % 5) ? X68K_PCG_RANK_NORMAL : X68K_PCG_RANK_HIGH;
+	}
+}
+
+// Both at once: an overloaded band and a full table.
+static void make_both(Sprite *s, int count)
+{
+	make_table(s, count);
+	for (int i = 0; i < 48; i++) s[i].y = 320;
+}
+
+static const Scene s_scenes[] =
+{
+	{"one_band_40", 40, make_one_band},
+	{"one_band_64", 64, make_one_band},
+	{"one_band_100", 100, make_one_band},
+	{"straddle_80", 80, make_straddle},
+	{"ranked_60", 60, make_ranked},
+	{"table_160", 160, make_table},
+	{"both_190", 190, make_both},
+};
+
+// Checks =====================================================================
+
+static int band_of(int y)
+{
+	return y >> X68K_PCG_BAND_SHIFT;
+}
+
+// Bands a sprite touches, as a bit mask; 0 if off screen.
+static uint64_t bands(const Sprite *s)
+{
+	uint64_t m = 0;
+	for (int y = s->y; y <= s->y + 15; y += 15)
+	{
+		if (y < 0 || y >= (X68K_PCG_NUM_BANDS << X68K_PCG_BAND_SHIFT)) continue;
+		m |= 1ULL << band_of(y);
+	}
+	return m;
+}
+
+static int run_scene(const Scene *sc, int frames)
+{
+	Sprite spr[MAX_SPRITES];
+	sc->make(spr, sc->count);
+	const volatile X68kPcgSprite *table =
+	    (const volatile X68kPcgSprite *)TABLE_BASE;
+
+	int last_shown[MAX_SPRITES];
+	int worst[X68K_PCG_NUM_RANKS] = {0};
+	int rank_count[X68K_PCG_NUM_RANKS] = {0};
+	int rank_drop_max[X68K_PCG_NUM_RANKS] = {0};
+	int errors = 0;
+	int dropped_total = 0;
+	for (int i = 0; i < sc->count; i++)
+	{
+		last_shown[i] = SETTLE_FRAMES - 1;
+		rank_count[spr[i].rank]++;
+	}
+
+	for (int f = 0; f < frames; f++)
+	{
+		for (int i = 0; i < sc->count; i++)
+		{
+			x68k_pcg_add_sprite_ranked(spr[i].x, spr[i].y, i, 3, spr[i].rank);
+		}
+		x68k_pcg_finish_sprites();
+		const X68kPcgSpriteStats *st = x68k_pcg_get_sprite_stats();
+
+		// What made it into the table, in order.
+		uint8_t shown[MAX_SPRITES] = {0};
+		int band_count[X68K_PCG_NUM_BANDS] = {0};
+		int count = 0;
+		int prev = -1;
+		for (int t = 0; t < HW_SPRITES; t++)
+		{
+			if (!table[t].prio)
+			{
+				for (int u = t; u < HW_SPRITES; u++)
+				{
+					if (table[u].prio) errors++;
+				}
+				break;
+			}
+			const int id = table[t].attr;
+			if (id <= prev || id >= sc->count) errors++;
+			prev = id;
+			shown[id] = 1;
+			count++;
+			const uint64_t m = bands(&spr[id]);
+			for (int b = 0; b < X68K_PCG_NUM_BANDS; b++)
+			{
+				if ((m >> b) & 1) band_count[b]++;
+			}
+		}
+		if (count != st->shown) errors++;
+		for (int b = 0; b < X68K_PCG_NUM_BANDS; b++)
+		{
+			if (band_count[b] > X68K_PCG_LINE_LIMIT) errors++;
+		}
+
+		// Rank order: a sprite on one band is only dropped once every
+		// lower-ranked sprite touching that band has been.
+		int rank_drop[X68K_PCG_NUM_RANKS] = {0};
+		for (int i = 0; i < sc->count; i++)
+		{
+			if (shown[i]) continue;
+			rank_drop[spr[i].rank]++;
+			dropped_total++;
+			const uint64_t m = bands(&spr[i]);
+			if (!m || (m & (m - 1))) continue;
+			for (int j = 0; j < sc->count; j++)
+			{
+				if (!shown[j] || spr[j].rank >= spr[i].rank) continue;
+				if (!(bands(&spr[j]) & m)) continue;
+				if (s_verbose)
+				{
+					printf("%s: frame %d dropped %d over %d\n", sc->name, f, i,
+					       j);
+				}
+				errors++;
+				break;
+			}
+		}
+
+		if (f < SETTLE_FRAMES) continue;
+		for (int r = 0; r < X68K_PCG_NUM_RANKS; r++)
+		{
+			if (rank_drop[r] > rank_drop_max[r]) rank_drop_max[r] = rank_drop[r];
+		}
+		for (int i = 0; i < sc->count; i++)
+		{
+			if (!shown[i]) continue;
+			const int gap = f - last_shown[i];
+			if (gap > worst[spr[i].rank]) worst[spr[i].rank] = gap;
+			last_shown[i] = f;
+		}
+	}
+
+	// Sprites never shown again after their last appearance count too.
+	for (int i = 0; i < sc->count; i++)
+	{
+		const int gap = frames - last_shown[i];
+		if (gap > worst[spr[i].rank]) worst[spr[i].rank] = gap;
+	}
+
+	int worst_gap = 0;
+	int bound = 0;
+	for (int r = 0; r < X68K_PCG_NUM_RANKS; r++)
+	{
+		const int n = rank_count[r];
+		const int k = rank_drop_max[r];
+		if (!k || k == n) continue;
+		const int b = (n + (n - k) - 1) / (n - k);
+		if (worst[r] > b)
+		{
+			if (s_verbose)
+			{
+				printf("%s: rank %d shown every %d frames, bound %d\n",
+				       sc->name, r, worst[r], b);
+			}
+			errors++;
+		}
+		if (worst[r] > worst_gap) worst_gap = worst[r];
+		if (b > bound) bound = b;
+	}
+
+	printf("%s,%d,%d,%d,%d\n", sc->name, sc->count, dropped_total / frames,
+	       worst_gap, bound);
+	if (errors) printf("%s: %d errors\n", sc->name, errors);
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	int frames = 240;
+	int opt;
+	while ((opt = getopt(argc, argv, "f:v")) != -1)
+	{
+		switch (opt)
+		{
+			case 'f':
+				frames = atoi(optarg);
+				break;
+			case 'v':
+				s_verbose = 1;
+				break;
+			default:
+				usage();
+		}
+	}
+	if (optind != argc || frames <= SETTLE_FRAMES) usage();
+
+	void *table = mmap((void *)TABLE_BASE, TABLE_SIZE, PROT_READ | PROT_WRITE,
+	                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE,
+	                   -1, 0);
+	if (table != (void *)TABLE_BASE)
+	{
+		fprintf(stderr, "sprcheck: can't map $%X\n", TABLE_BASE);
+		return 1;
+	}
+
+	printf("scene,sprites,dropped,worst_gap,bound\n");
+	int errors = 0;
+	for (size_t i = 0; i < sizeof(s_scenes) / sizeof(s_scenes[0]); i++)
+	{
+		// Start each scene from an empty table.
+		memset(table, 0, TABLE_SIZE);
+		x68k_pcg_finish_sprites();
+		errors += run_scene(&s_scenes[i], frames);
+	}
+	return errors ? 1 : 0;
+}
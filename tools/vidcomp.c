@@ -0,0 +1,719 @@
+/*
+
+vidcomp: reference video compositor (host tool)
+
+Build:
+	cc -O2 -o vidcomp vidcomp.c png_io.c -lpng -lpthread
+
+Usage:
+	vidcomp [-o outdir] [-g goldendir] [-d diffdir] [-j jobs] capture ...
+
+Renders what the monitor would show for frames captured from the machine or
+an emulator, so rendering changes can be checked without real hardware.
+
+Each capture is a directory of raw, big-endian memory dumps. Missing files
+and short dumps read as zeros.
+
+	mode.txt    The display mode and scroll registers (below)
+	spr.bin     PCG_SPR_TABLE, $400 bytes
+	pcg.bin     PCG_TILE_DATA onwards, up to $8000 bytes (this covers the
+	            nametables too if it's complete)
+	bg0.bin     PCG_BG0_NAME, $2000 bytes; replaces that part of pcg.bin
+	bg1.bin     PCG_BG1_NAME, $2000 bytes; likewise
+	pal.bin     Palettes from $E82000: graphics, then text / PCG; $400 bytes
+	gvram.bin   GVRAM_BASE, up to $200000 bytes
+	tvram.bin   TVRAM ($E00000), up to $80000 bytes
+
+mode.txt has one `name value` pair per line, with # comments. The names are
+the fields of X68kDisplayMode (crtc.htotal ... crtc.flags, pcg.htotal ...
+pcg.flags, vidcon.screen, vidcon.prio, vidcon.flags), and the registers it
+doesn't cover: text.x, text.y, gp0.x ... gp3.y (CRTC R10-R19), bg0.x, bg0.y,
+bg1.x, bg1.y and bg.ctrl. Values may be decimal or 0x hex.
+
+The frame is composited the way the video controller does it:
+
+* Screen size comes from CRTC R20 (256, 512 or 768 dots by 256 or 512 lines).
+* The text, graphics and PCG groups are stacked by vidcon.prio, and the
+  graphics planes within their group by its low byte. Disabled layers
+  (vidcon.flags, and bit 9 of bg.ctrl for the PCG) are skipped. Color 0 is
+  transparent everywhere; a pixel nothing covers is black.
+* Graphics pages follow vidcon.screen: four 16 color pages, two 256 color
+  pages, one 65536 color page or the 1024 x 1024 16 color screen, each with
+  its own scroll registers (GP0 and GP2 for the 256 color pages).
+* Within the PCG, from front to back: sprites with PRW 3, BG0, sprites with
+  PRW 2, BG1, sprites with PRW 1. A lower numbered sprite is in front of a
+  higher one, and only the first X68K_PCG_LINE_LIMIT (32) sprites on a line
+  are shown.
+* BG tiles are 8 x 8 on a 512 x 512 plane when the H-res bits of pcg.flags
+  are 0, and 16 x 16 on a 1024 x 1024 plane otherwise, where there is no BG1.
+
+With -o, each frame is saved as <outdir>/<capture>.png. With -g, it's
+compared against <goldendir>/<capture>.png, and with -d, frames that differ
+also get <diffdir>/<capture>.png, marking the differing pixels in red. The
+exit status is 1 if any frame differs.
+
+Frames are rendered one at a time, with their lines spread over all cores
+(-j sets the number of threads). Colors are looked up in RGBA tables and
+layers are merged eight pixels at a time with GCC vector extensions, which
+compile to SIMD selects on hosts that have them.
+
+*/
+#include "png_io.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_W 768
+#define MAX_H 512
+
+#define SPR_SIZE 0x400
+#define PCG_SIZE 0x8000
+#define PCG_BG0_OFFS 0x4000
+#define PCG_BG1_OFFS 0x6000
+#define BG_NAME_SIZE 0x2000
+#define PAL_SIZE 0x400
+#define GVRAM_SIZE 0x200000
+#define TVRAM_SIZE 0x80000
+#define TVRAM_PLANE 0x20000
+
+#define SPR_COUNT 128
+#define SPR_LINE_LIMIT 32
+
+// Combined palette: 256 graphics colors, then 256 text / PCG colors.
+#define PAL_TEXT 256
+
+typedef uint32_t Vec8 __attribute__((vector_size(32)));
+
+// Registers ================================================================
+
+typedef struct Regs
+{
+	// X68kDisplayMode
+	uint16_t crtc[10];  // R00-R08, R20
+	uint16_t pcg[4];    // htotal, hdisp, vdisp, flags
+	uint16_t vc_screen;
+	uint16_t vc_prio;
+	uint16_t vc_flags;
+	// Everything else
+	uint16_t text_x;
+	uint16_t text_y;
+	uint16_t gp_x[4];
+	uint16_t gp_y[4];
+	uint16_t bg_x[2];
+	uint16_t bg_y[2];
+	uint16_t bg_ctrl;
+} Regs;
+
+#define REG(n, f) {n, offsetof(Regs, f)}
+
+static const struct { const char *name; size_t offs; } s_reg_names[] =
+{
+	REG("crtc.htotal", crtc[0]), REG("crtc.hsync_length", crtc[1]),
+	REG("crtc.hdisp_start", crtc[2]), REG("crtc.hdisp_end", crtc[3]),
+	REG("crtc.vtotal", crtc[4]), REG("crtc.vsync_length", crtc[5]),
+	REG("crtc.vdisp_start", crtc[6]), REG("crtc.vdisp_end", crtc[7]),
+	REG("crtc.ext_h_adjust", crtc[8]), REG("crtc.flags", crtc[9]),
+	REG("pcg.htotal", pcg[0]), REG("pcg.hdisp", pcg[1]),
+	REG("pcg.vdisp", pcg[2]), REG("pcg.flags", pcg[3]),
+	REG("vidcon.screen", vc_screen), REG("vidcon.prio", vc_prio),
+	REG("vidcon.flags", vc_flags),
+	REG("text.x", text_x), REG("text.y", text_y),
+	REG("gp0.x", gp_x[0]), REG("gp0.y", gp_y[0]),
+	REG("gp1.x", gp_x[1]), REG("gp1.y", gp_y[1]),
+	REG("gp2.x", gp_x[2]), REG("gp2.y", gp_y[2]),
+	REG("gp3.x", gp_x[3]), REG("gp3.y", gp_y[3]),
+	REG("bg0.x", bg_x[0]), REG("bg0.y", bg_y[0]),
+	REG("bg1.x", bg_x[1]), REG("bg1.y", bg_y[1]),
+	REG("bg.ctrl", bg_ctrl),
+};
+
+#undef REG
+
+static int load_regs(Regs *r, const char *path)
+{
+	memset(r, 0, sizeof(*r));
+	FILE *f = fopen(path, "r");
+	if (!f)
+	{
+		perror(path);
+		return -1;
+	}
+	char line[256];
+	int lineno = 0;
+	int ret = 0;
+	while (fgets(line, sizeof(line), f))
+	{
+		lineno++;
+		char *hash = strchr(line, '#');
+		if (hash) *hash = '\0';
+		char name[32];
+		char val[32];
+		const int n = sscanf(line, "%31s %31s", name, val);
+		if (n <= 0) continue;
+
+		size_t i;
+		const size_t count = sizeof(s_reg_names) / sizeof(s_reg_names[0]);
+		for (i = 0; i < count; i++)
+		{
+			if (!strcmp(name, s_reg_names[i].name)) break;
+		}
+		char *end = val;
+		const long v = (n == 2) ? strtol(val, &end, 0) : 0;
+		if (i == count || n != 2 || *end)
+		{
+			fprintf(stderr, "%s:%d: bad line\n", path, lineno);
+			ret = -1;
+			break;
+		}
+		*(uint16_t *)((uint8_t *)r + s_reg_names[i].offs) = (uint16_t)v;
+	}
+	fclose(f);
+	return ret;
+}
+
+// Captures =================================================================
+
+typedef struct Frame
+{
+	Regs regs;
+	uint8_t spr_raw[SPR_SIZE];
+	uint8_t pcg[PCG_SIZE];
+	uint8_t pal_raw[PAL_SIZE];
+	uint8_t *gvram;
+	uint8_t *tvram;
+
+	// Decoded
+	uint16_t spr[SPR_COUNT][4];  // x, y, attr, prio
+	uint32_t pal[512];           // RGBA
+	int w;
+	int h;
+} Frame;
+
+// 16-bit color word (G5 R5 B5 I) to RGBA, for palettes and 65536 color mode.
+static uint32_t s_rgba[65536];
+
+static void rgba_init(void)
+{
+	for (uint32_t c = 0; c < 65536; c++)
+	{
+		// Intensity is a sixth, shared low bit.
+		const uint8_t i = c & 1;
+		const uint8_t g = (((c >> 11) & 31) << 1) | i;
+		const uint8_t r = (((c >> 6) & 31) << 1) | i;
+		const uint8_t b = (((c >> 1) & 31) << 1) | i;
+		const uint8_t px[4] = {(uint8_t)((r << 2) | (r >> 4)),
+		                       (uint8_t)((g << 2) | (g >> 4)),
+		                       (uint8_t)((b << 2) | (b >> 4)), 0xFF};
+		memcpy(&s_rgba[c], px, sizeof(px));
+	}
+}
+
+// Reads up to `size` bytes; the rest is cleared.
+static int load_dump(const char *dir, const char *name, uint8_t *buf,
+                     size_t size)
+{
+	char path[1024];
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	memset(buf, 0, size);
+	FILE *f = fopen(path, "rb");
+	if (!f) return 0;
+	fread(buf, 1, size, f);
+	const int err = ferror(f);
+	fclose(f);
+	if (err)
+	{
+		fprintf(stderr, "%s: read error\n", path);
+		return -1;
+	}
+	return 1;
+}
+
+static int load_frame(Frame *f, const char *dir)
+{
+	char path[1024];
+	snprintf(path, sizeof(path), "%s/mode.txt", dir);
+	if (load_regs(&f->regs, path)) return -1;
+
+	uint8_t name[BG_NAME_SIZE];
+	if (load_dump(dir, "spr.bin", f->spr_raw, SPR_SIZE) < 0 ||
+	    load_dump(dir, "pcg.bin", f->pcg, PCG_SIZE) < 0 ||
+	    load_dump(dir, "pal.bin", f->pal_raw, PAL_SIZE) < 0 ||
+	    load_dump(dir, "gvram.bin", f->gvram, GVRAM_SIZE) < 0 ||
+	    load_dump(dir, "tvram.bin", f->tvram, TVRAM_SIZE) < 0)
+	{
+		return -1;
+	}
+	int got = load_dump(dir, "bg0.bin", name, BG_NAME_SIZE);
+	if (got < 0) return -1;
+	if (got) memcpy(&f->pcg[PCG_BG0_OFFS], name, BG_NAME_SIZE);
+	got = load_dump(dir, "bg1.bin", name, BG_NAME_SIZE);
+	if (got < 0) return -1;
+	if (got) memcpy(&f->pcg[PCG_BG1_OFFS], name, BG_NAME_SIZE);
+
+	for (int i = 0; i < SPR_COUNT; i++)
+	{
+		for (int j = 0; j < 4; j++)
+		{
+			const uint8_t *p = &f->spr_raw[(i * 4 + j) * 2];
+			f->spr[i][j] = (p[0] << 8) | p[1];
+		}
+	}
+	for (int i = 0; i < 512; i++)
+	{
+		const uint8_t *p = &f->pal_raw[i * 2];
+		f->pal[i] = s_rgba[(p[0] << 8) | p[1]];
+	}
+
+	static const int widths[4] = {256, 512, 512, 768};
+	const uint16_t r20 = f->regs.crtc[9];
+	f->w = widths[r20 & 3];
+	f->h = (r20 & 0x0C) ? 512 : 256;
+	return 0;
+}
+
+// Layers ===================================================================
+
+// Each layer fills a line of RGBA pixels, 0 where it's transparent.
+
+static void text_line(const Frame *f, int y, uint32_t *out)
+{
+	const int ty = (y + f->regs.text_y) & 1023;
+	const uint8_t *row = &f->tvram[ty * 128];
+	for (int x = 0; x < f->w; x++)
+	{
+		const int tx = (x + f->regs.text_x) & 1023;
+		const uint8_t bit = 0x80 >> (tx & 7);
+		const uint8_t *p = &row[tx >> 3];
+		const uint8_t idx = ((p[0] & bit) ? 1 : 0) |
+		                    ((p[TVRAM_PLANE] & bit) ? 2 : 0) |
+		                    ((p[TVRAM_PLANE * 2] & bit) ? 4 : 0) |
+		                    ((p[TVRAM_PLANE * 3] & bit) ? 8 : 0);
+		out[x] = idx ? f->pal[PAL_TEXT + idx] : 0;
+	}
+}
+
+// Graphics page `page` as laid out by vidcon.screen.
+static void gp_line(const Frame *f, int page, int y, uint32_t *out)
+{
+	const uint16_t screen = f->regs.vc_screen;
+	const int depth = screen & 3;
+	const int real = (screen & 4) && depth == 0;
+	const int scroll = (depth == 1) ? page * 2 : page;
+	const int size = real ? 1024 : 512;
+	const int sx = f->regs.gp_x[scroll];
+	const int gy = (y + f->regs.gp_y[scroll]) & (size - 1);
+	const uint8_t *row = f->gvram + (size_t)page * 0x80000 + gy * size * 2;
+	const uint8_t mask = (depth == 1) ? 0xFF : 0x0F;
+
+	if (depth == 3)
+	{
+		for (int x = 0; x < f->w; x++)
+		{
+			const uint8_t *p = &row[((x + sx) & 511) * 2];
+			const uint16_t c = (p[0] << 8) | p[1];
+			out[x] = c ? s_rgba[c] : 0;
+		}
+		return;
+	}
+	// Only the low byte of each word holds color.
+	for (int x = 0; x < f->w; x++)
+	{
+		const uint8_t idx = row[((x + sx) & (size - 1)) * 2 + 1] & mask;
+		out[x] = idx ? f->pal[idx] : 0;
+	}
+}
+
+// Pixel (px, py) of a pattern.
+static inline uint8_t pcg_pixel(const Frame *f, int pattern, int tile16,
+                                int px, int py)
+{
+	const uint8_t *p;
+	if (tile16)
+	{
+		// Four 8 x 8 blocks: top left, bottom left, top right, bottom right.
+		p = &f->pcg[pattern * 128 + ((px >> 3) * 2 + (py >> 3)) * 32 +
+		            (py & 7) * 4 + ((px & 7) >> 1)];
+	}
+	else
+	{
+		p = &f->pcg[pattern * 32 + py * 4 + (px >> 1)];
+	}
+	return (px & 1) ? (*p & 0x0F) : (*p >> 4);
+}
+
+static void bg_line(const Frame *f, int bg, int y, uint32_t *out)
+{
+	const int tile16 = (f->regs.pcg[3] & 3) != 0;
+	const int shift = tile16 ? 4 : 3;
+	const int size = 64 << shift;
+	const int tmask = (1 << shift) - 1;
+	const int txsel = (f->regs.bg_ctrl >> (bg ? 4 : 1)) & 1;
+	const uint8_t *name = &f->pcg[txsel ? PCG_BG1_OFFS : PCG_BG0_OFFS];
+	const int sx = f->regs.bg_x[bg] & 0x3FF;
+	const int by = (y + (f->regs.bg_y[bg] & 0x3FF)) & (size - 1);
+	const uint8_t *row = &name[(by >> shift) * 128];
+
+	for (int x = 0; x < f->w; x++)
+	{
+		const int bx = (x + sx) & (size - 1);
+		const uint8_t *e = &row[(bx >> shift) * 2];
+		const uint16_t attr = (e[0] << 8) | e[1];
+		const int px = (attr & 0x4000) ? (tmask - (bx & tmask)) : (bx & tmask);
+		const int py = (attr & 0x8000) ? (tmask - (by & tmask)) : (by & tmask);
+		const uint8_t c = pcg_pixel(f, attr & 0xFF, tile16, px, py);
+		out[x] = c ? f->pal[PAL_TEXT + ((attr >> 4) & 0xF0) + c] : 0;
+	}
+}
+
+// Sprites into one line per PRW level (out[0] is PRW 1).
+static void sprite_lines(const Frame *f, int y, uint32_t out[3][MAX_W])
+{
+	int shown = 0;
+	for (int i = 0; i < SPR_COUNT && shown < SPR_LINE_LIMIT; i++)
+	{
+		const uint16_t *s = f->spr[i];
+		const int prw = s[3] & 3;
+		if (!prw) continue;
+		const int sy = (s[1] & 0x3FF) - 16;
+		if (y < sy || y >= sy + 16) continue;
+		shown++;
+
+		const int sx = (s[0] & 0x3FF) - 16;
+		const uint16_t attr = s[2];
+		const int py = (attr & 0x8000) ? (15 - (y - sy)) : (y - sy);
+		uint32_t *line = out[prw - 1];
+		for (int j = 0; j < 16; j++)
+		{
+			const int x = sx + j;
+			if (x < 0 || x >= f->w || line[x]) continue;
+			const int px = (attr & 0x4000) ? (15 - j) : j;
+			const uint8_t c = pcg_pixel(f, attr & 0xFF, 1, px, py);
+			if (c) line[x] = f->pal[PAL_TEXT + ((attr >> 4) & 0xF0) + c];
+		}
+	}
+}
+
+// Fills the transparent pixels of `acc` from `layer`.
+static void merge(uint32_t *restrict acc, const uint32_t *restrict layer,
+                  int w)
+{
+	for (int x = 0; x < w; x += 8)
+	{
+		Vec8 a, l;
+		memcpy(&a, &acc[x], sizeof(a));
+		memcpy(&l, &layer[x], sizeof(l));
+		a |= l & (Vec8)(a == 0);
+		memcpy(&acc[x], &a, sizeof(a));
+	}
+}
+
+static void pcg_line(const Frame *f, int y, uint32_t *acc)
+{
+	static __thread uint32_t spr[3][MAX_W];
+	static __thread uint32_t layer[MAX_W];
+	const uint16_t ctrl = f->regs.bg_ctrl;
+	const int tile16 = (f->regs.pcg[3] & 3) != 0;
+
+	memset(spr, 0, sizeof(spr));
+	sprite_lines(f, y, spr);
+	merge(acc, spr[2], f->w);
+	if (ctrl & 0x0001)
+	{
+		bg_line(f, 0, y, layer);
+		merge(acc, layer, f->w);
+	}
+	merge(acc, spr[1], f->w);
+	if ((ctrl & 0x0008) && !tile16)
+	{
+		bg_line(f, 1, y, layer);
+		merge(acc, layer, f->w);
+	}
+	merge(acc, spr[0], f->w);
+}
+
+// Compositing ==============================================================
+
+enum { GROUP_TEXT, GROUP_GP, GROUP_PCG };
+
+static void render_line(const Frame *f, int y, uint32_t *out)
+{
+	static __thread uint32_t layer[MAX_W];
+	static __thread uint32_t pcg[MAX_W];
+	const Regs *r = &f->regs;
+
+	// Groups front to back; on equal settings, text goes first, then PCG.
+	const int group_prio[3] =
+	{
+		(r->vc_prio >> 10) & 3, (r->vc_prio >> 8) & 3, (r->vc_prio >> 12) & 3,
+	};
+	static const int group_tie[3] = {GROUP_TEXT, GROUP_PCG, GROUP_GP};
+	int groups[3];
+	int num_groups = 0;
+	for (int prio = 0; prio < 4; prio++)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			const int g = group_tie[i];
+			if (group_prio[g] == prio) groups[num_groups++] = g;
+		}
+	}
+
+	// Graphics pages front to back.
+	const int depth = r->vc_screen & 3;
+	const int num_pages = (depth == 3 || (r->vc_screen & 4)) ? 1 :
+	                      (depth == 1) ? 2 : 4;
+	int pages[4];
+	int num_gp = 0;
+	for (int prio = 0; prio < 4; prio++)
+	{
+		for (int p = 0; p < num_pages; p++)
+		{
+			// The 256 color pages go by GP0 and GP2.
+			const int plane = (num_pages == 2) ? p * 2 : p;
+			if (((r->vc_prio >> (plane * 2)) & 3) != prio) continue;
+			if (!(r->vc_flags & (1 << plane))) continue;
+			pages[num_gp++] = p;
+		}
+	}
+
+	memset(out, 0, sizeof(uint32_t) * f->w);
+	for (int g = 0; g < num_groups; g++)
+	{
+		switch (groups[g])
+		{
+			case GROUP_TEXT:
+				if (!(r->vc_flags & 0x0020)) break;
+				text_line(f, y, layer);
+				merge(out, layer, f->w);
+				break;
+			case GROUP_GP:
+				if (!(r->vc_flags & 0x0010)) break;
+				for (int i = 0; i < num_gp; i++)
+				{
+					gp_line(f, pages[i], y, layer);
+					merge(out, layer, f->w);
+				}
+				break;
+			case GROUP_PCG:
+				if (!(r->vc_flags & 0x0040) || !(r->bg_ctrl & 0x0200)) break;
+				memset(pcg, 0, sizeof(uint32_t) * f->w);
+				pcg_line(f, y, pcg);
+				merge(out, pcg, f->w);
+				break;
+		}
+	}
+
+	// Nothing covered: black.
+	const uint8_t black_px[4] = {0, 0, 0, 0xFF};
+	uint32_t black;
+	memcpy(&black, black_px, sizeof(black));
+	for (int x = 0; x < f->w; x++)
+	{
+		if (!out[x]) out[x] = black;
+	}
+}
+
+typedef struct Slice
+{
+	const Frame *f;
+	uint32_t *rgba;
+	int first;
+	int step;
+} Slice;
+
+static void *render_slice(void *arg)
+{
+	const Slice *s = arg;
+	for (int y = s->first; y < s->f->h; y += s->step)
+	{
+		render_line(s->f, y, &s->rgba[y * s->f->w]);
+	}
+	return NULL;
+}
+
+// Lines are dealt out round robin, so every thread gets a similar mix.
+static void render(const Frame *f, uint32_t *rgba, int jobs)
+{
+	pthread_t threads[64];
+	Slice slices[64];
+	if (jobs > 64) jobs = 64;
+	for (int i = 0; i < jobs; i++)
+	{
+		slices[i].f = f;
+		slices[i].rgba = rgba;
+		slices[i].first = i;
+		slices[i].step = jobs;
+		if (i) pthread_create(&threads[i], NULL, render_slice, &slices[i]);
+	}
+	render_slice(&slices[0]);
+	for (int i = 1; i < jobs; i++) pthread_join(threads[i], NULL);
+}
+
+// Golden frames ============================================================
+
+// Returns the number of differing pixels, or -1 if the golden frame can't be
+// compared at all.
+static long compare(const uint32_t *rgba, int w, int h, const char *path,
+                    const char *diff_path)
+{
+	PngImage img;
+	if (png_io_load(path, &img))
+	{
+		fprintf(stderr, "%s: can't load golden frame\n", path);
+		return -1;
+	}
+	if (img.w != w || img.h != h)
+	{
+		fprintf(stderr, "%s: %d x %d, rendered %d x %d\n", path, img.w, img.h,
+		        w, h);
+		png_io_free(&img);
+		return -1;
+	}
+
+	const uint8_t *got = (const uint8_t *)rgba;
+	long diffs = 0;
+	uint8_t *diff = diff_path ? malloc((size_t)w * h * 4) : NULL;
+	for (long i = 0; i < (long)w * h; i++)
+	{
+		const uint8_t *a = &got[i * 4];
+		const uint8_t *b = &img.rgba[i * 4];
+		const int same = a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+		if (!same)
+		{
+			if (diffs < 20)
+			{
+				printf("(%ld, %ld): expected %02X%02X%02X, got %02X%02X%02X\n",
+				       i % w, i / w, b[0], b[1], b[2], a[0], a[1], a[2]);
+			}
+			diffs++;
+		}
+		if (!diff) continue;
+		// Differences in red, over a dimmed copy of the frame.
+		const uint8_t grey = (a[0] + a[1] + a[2]) / 12;
+		diff[i * 4 + 0] = same ? grey : 0xFF;
+		diff[i * 4 + 1] = same ? grey : 0;
+		diff[i * 4 + 2] = same ? grey : 0;
+		diff[i * 4 + 3] = 0xFF;
+	}
+	if (diffs && diff) png_io_save_rgba(diff_path, diff, w, h);
+	free(diff);
+	png_io_free(&img);
+	return diffs;
+}
+
+// Main =====================================================================
+
+// Last path component, without trailing slashes.
+static void capture_name(const char *path, char *out, size_t size)
+{
+	size_t len = strlen(path);
+	while (len > 1 && path[len - 1] == '/') len--;
+	size_t start = len;
+	while (start > 0 && path[start - 1] != '/') start--;
+	if (len - start >= size) len = start + size - 1;
+	memcpy(out, &path[start], len - start);
+	out[len - start] = '\0';
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: vidcomp [-o outdir] [-g goldendir] [-d diffdir] "
+	                "[-j jobs] capture ...\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *out_dir = NULL;
+	const char *golden_dir = NULL;
+	const char *diff_dir = NULL;
+	int jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	int c;
+	while ((c = getopt(argc, argv, "o:g:d:j:")) != -1)
+	{
+		switch (c)
+		{
+			case 'o':
+				out_dir = optarg;
+				break;
+			case 'g':
+				golden_dir = optarg;
+				break;
+			case 'd':
+				diff_dir = optarg;
+				break;
+			case 'j':
+				jobs = atoi(optarg);
+				break;
+			default:
+				usage();
+				return 1;
+		}
+	}
+	if (optind >= argc || (!out_dir && !golden_dir))
+	{
+		usage();
+		return 1;
+	}
+	if (jobs < 1) jobs = 1;
+
+	rgba_init();
+	Frame *f = malloc(sizeof(Frame));
+	f->gvram = malloc(GVRAM_SIZE);
+	f->tvram = malloc(TVRAM_SIZE);
+	uint32_t *rgba = malloc(sizeof(uint32_t) * MAX_W * MAX_H);
+
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	int frames = 0;
+	int failed = 0;
+	for (int i = optind; i < argc; i++)
+	{
+		char name[256];
+		char path[1024];
+		capture_name(argv[i], name, sizeof(name));
+		if (load_frame(f, argv[i]))
+		{
+			failed++;
+			continue;
+		}
+		render(f, rgba, jobs);
+		frames++;
+
+		if (out_dir)
+		{
+			snprintf(path, sizeof(path), "%s/%s.png", out_dir, name);
+			if (png_io_save_rgba(path, (const uint8_t *)rgba, f->w, f->h))
+			{
+				fprintf(stderr, "%s: can't save\n", path);
+				failed++;
+			}
+		}
+		if (golden_dir)
+		{
+			char diff_path[1024];
+			snprintf(path, sizeof(path), "%s/%s.png", golden_dir, name);
+			snprintf(diff_path, sizeof(diff_path), "%s/%s.png",
+			         diff_dir ? diff_dir : "", name);
+			const long diffs = compare(rgba, f->w, f->h, path,
+			                           diff_dir ? diff_path : NULL);
+			if (diffs) failed++;
+			if (diffs > 0) printf("%s: %ld pixels differ\n", name, diffs);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	const double ms = (t1.tv_sec - t0.tv_sec) * 1e3 +
+	                  (t1.tv_nsec - t0.tv_nsec) / 1e6;
+	printf("%d frames in %.0f ms, %d failed\n", frames, ms, failed);
+
+	free(rgba);
+	free(f->gvram);
+	free(f->tvram);
+	free(f);
+	return failed ? 1 : 0;
+}